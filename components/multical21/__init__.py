@@ -5,22 +5,112 @@
 
 import esphome.codegen as cg
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome import pins
 from esphome.components import spi
-from esphome.const import CONF_ID
+from esphome.components import time as time_
+from esphome.components.esp32 import get_esp32_variant
+from esphome.components.esp32.const import VARIANT_ESP32, VARIANT_ESP32S3
+from esphome.const import CONF_ID, CONF_PLATFORM, CONF_TIME_ID
+from esphome.core import CORE
 
 DEPENDENCIES = ["spi"]
-AUTO_LOAD = ["sensor", "text_sensor"]
+AUTO_LOAD = ["binary_sensor", "sensor", "text_sensor"]
 MULTI_CONF = True
 
 CONF_GDO0_PIN = "gdo0_pin"
+CONF_GDO0_INTERRUPT = "gdo0_interrupt"
 CONF_METER_ID = "meter_id"
 CONF_KEY = "key"
+CONF_METERS = "meters"
+CONF_METER = "meter"
+CONF_DEFAULT_METER_ID = "default_meter_id"
+CONF_MULTICAL21_ID = "multical21_id"
+CONF_HISTORY_FLUSH_INTERVAL = "history_flush_interval"
+CONF_CAPTURE_BUFFER_SIZE = "capture_buffer_size"
+CONF_DUTY_CYCLE = "duty_cycle"
+CONF_GUARD_TIME = "guard_time"
+CONF_MAX_MISSED_WINDOWS = "max_missed_windows"
+CONF_FREQUENCY_TRACKING = "frequency_tracking"
+CONF_RADIO_PROFILE = "radio_profile"
+CONF_SECOND_RADIO = "second_radio"
+CONF_RECEIVE_TASK = "receive_task"
+CONF_CORE = "core"
+CONF_PRIORITY = "priority"
+CONF_STACK_SIZE = "stack_size"
+CONF_ANALYTICS = "analytics"
+CONF_ZERO_FLOW_INTERVAL = "zero_flow_interval"
+CONF_PEAK_FLOW_WINDOW = "peak_flow_window"
+CONF_NIGHT_START = "night_start"
+CONF_NIGHT_END = "night_end"
+
+# Variants with a core 1 to pin the receive task to
+DUAL_CORE_VARIANTS = (VARIANT_ESP32, VARIANT_ESP32S3)
 
 multical21_ns = cg.esphome_ns.namespace("multical21")
 Multical21Component = multical21_ns.class_(
     "Multical21Component", cg.PollingComponent, spi.SPIDevice
 )
+Multical21Meter = multical21_ns.class_("Multical21Meter")
+Multical21Radio = multical21_ns.class_("Multical21Radio", cg.Component, spi.SPIDevice)
+
+# wM-Bus mode the CC1101 is configured for; each has its own register table
+RadioProfile = multical21_ns.enum("RadioProfile")
+RADIO_PROFILES = {
+    "C1": RadioProfile.RADIO_PROFILE_C1,
+    "T1": RadioProfile.RADIO_PROFILE_T1,
+}
+
+
+# Sensor platform keys by SensorSlot (publish_policy.h). Slots no sensor entry
+# configures are compiled out, so unused sensors take no RAM.
+SENSOR_SLOTS = {
+    "total_consumption": 0,
+    "month_start_value": 1,
+    "water_temperature": 2,
+    "ambient_temperature": 3,
+    "current_flow": 4,
+    "frames_received": 5,
+    "crc_errors": 6,
+    "link_crc_errors": 7,
+    "signal_quality": 8,
+    "decrypt_time": 9,
+    "processing_time": 10,
+    "history_records": 11,
+    "history_flash_writes": 12,
+    "rssi": 13,
+    "rssi_min": 14,
+    "rssi_max": 15,
+    "lqi": 16,
+    "missed_telegrams": 17,
+    "accepted_frames": 18,
+    "foreign_frames": 19,
+    "rx_duty_cycle": 20,
+    "prediction_hit_rate": 21,
+    "frequency_offset": 22,
+    "frequency_corrections": 23,
+    "radio1_accepted_frames": 24,
+    "radio2_accepted_frames": 24,
+    "duplicate_frames": 25,
+    "reading_queue_high_water": 26,
+    "reading_queue_drops": 27,
+    "continuous_flow_duration": 28,
+    "peak_flow": 29,
+    "night_min_flow": 30,
+    "reverse_flow_events": 31,
+}
+
+
+def configured_sensor_slots():
+    """Bit mask of the SensorSlots set in any multical21 sensor entry."""
+    mask = 0
+    for entry in CORE.config.get("sensor", []):
+        if entry.get(CONF_PLATFORM) != "multical21":
+            continue
+        for key, slot in SENSOR_SLOTS.items():
+            if key in entry:
+                mask |= 1 << slot
+    return mask
 
 
 def validate_hex_str(length, name):
@@ -43,31 +133,244 @@ def validate_hex_str(length, name):
     return validator
 
 
-CONFIG_SCHEMA = (
+def is_internal_pin(pin_config):
+    """Pins on an I/O expander carry the expander's key, e.g. `pcf8574:`."""
+    return not any(key in pin_config for key in pins.PIN_SCHEMA_REGISTRY if key != CORE.target_platform)
+
+
+def validate_gdo0_interrupt(config):
+    """Edge interrupts need an internal GPIO: GDO0 on an I/O expander is polled."""
+    internal = is_internal_pin(config[CONF_GDO0_PIN])
+    if CONF_GDO0_INTERRUPT not in config:
+        config[CONF_GDO0_INTERRUPT] = internal
+    elif config[CONF_GDO0_INTERRUPT] and not internal:
+        raise cv.Invalid(
+            f"'{CONF_GDO0_INTERRUPT}' needs an internal GPIO, set it to false to poll a pin on an I/O expander",
+            path=[CONF_GDO0_INTERRUPT],
+        )
+    return config
+
+
+def validate_unique_meter_ids(config):
+    """Each meter ID may only be served once per radio."""
+    ids = [m[CONF_METER_ID].upper() for m in config.get(CONF_METERS, [])]
+    if CONF_METER_ID in config:
+        ids.append(config[CONF_METER_ID].upper())
+    duplicates = sorted({i for i in ids if ids.count(i) > 1})
+    if duplicates:
+        raise cv.Invalid(f"Duplicate meter_id: {', '.join(duplicates)}")
+    return config
+
+
+# Power the radio down between the meters' predicted transmit windows
+DUTY_CYCLE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_GUARD_TIME, default="250ms"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=20), max=cv.TimePeriod(seconds=5)),
+        ),
+        cv.Optional(CONF_MAX_MISSED_WINDOWS, default=3): cv.int_range(min=1, max=100),
+    }
+)
+
+# A second CC1101 on its own CS and GDO0 pins, receiving the same meters
+SECOND_RADIO_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(Multical21Radio),
+            cv.Required(CONF_GDO0_PIN): pins.gpio_input_pin_schema,
+            cv.Optional(CONF_GDO0_INTERRUPT): cv.boolean,
+        }
+    ).extend(spi.spi_device_schema(cs_pin_required=True)),
+    validate_gdo0_interrupt,
+)
+
+# Frame draining, CRC checks and decryption in a FreeRTOS task, off the main
+# loop. Above the loop task's priority 1 and below Wi-Fi and lwIP. Core 0 by
+# default: the loop task runs on core 1 of dual-core chips, and the receive
+# task would hold it off there while a frame comes in.
+RECEIVE_TASK_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_CORE, default=0): cv.int_range(min=0, max=1),
+        cv.Optional(CONF_PRIORITY, default=5): cv.int_range(min=2, max=17),
+        cv.Optional(CONF_STACK_SIZE, default=4096): cv.int_range(min=3072, max=16384),
+    }
+)
+
+
+def validate_night_window(config):
+    """The night window may wrap past midnight but not be empty."""
+    if config[CONF_NIGHT_START] == config[CONF_NIGHT_END]:
+        raise cv.Invalid(f"'{CONF_NIGHT_START}' and '{CONF_NIGHT_END}' must differ", path=[CONF_NIGHT_END])
+    return config
+
+
+# Leak, burst and backflow indicators worked out per meter from its readings.
+# The night minimum flow needs local time, from `time_id`.
+ANALYTICS_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_TIME_ID): cv.use_id(time_.RealTimeClock),
+            cv.Optional(CONF_ZERO_FLOW_INTERVAL, default="15min"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(minutes=1), max=cv.TimePeriod(hours=24)),
+            ),
+            cv.Optional(CONF_PEAK_FLOW_WINDOW, default="24h"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(hours=1), max=cv.TimePeriod(days=7)),
+            ),
+            cv.Optional(CONF_NIGHT_START, default=2): cv.int_range(min=0, max=23),
+            cv.Optional(CONF_NIGHT_END, default=5): cv.int_range(min=0, max=23),
+        }
+    ),
+    validate_night_window,
+)
+
+METER_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(Multical21Meter),
+        cv.Required(CONF_METER_ID): validate_hex_str(8, "meter_id"),
+        cv.Required(CONF_KEY): validate_hex_str(32, "key"),
+    }
+)
+
+CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
             cv.GenerateID(): cv.declare_id(Multical21Component),
+            cv.GenerateID(CONF_DEFAULT_METER_ID): cv.declare_id(Multical21Meter),
             cv.Required(CONF_GDO0_PIN): pins.gpio_input_pin_schema,
-            cv.Required(CONF_METER_ID): validate_hex_str(
+            # Default: on for an internal GPIO, off for a pin on an I/O expander
+            cv.Optional(CONF_GDO0_INTERRUPT): cv.boolean,
+            cv.Inclusive(CONF_METER_ID, "single_meter"): validate_hex_str(
                 8, "meter_id"
             ),
-            cv.Required(CONF_KEY): validate_hex_str(
+            cv.Inclusive(CONF_KEY, "single_meter"): validate_hex_str(
                 32, "key"
             ),
+            cv.Optional(CONF_METERS): cv.ensure_list(METER_SCHEMA),
+            cv.Optional(
+                CONF_HISTORY_FLUSH_INTERVAL, default="15min"
+            ): cv.positive_time_period_milliseconds,
+            # Raw frame capture ring in RAM; 0 = off. One full-size frame takes 300 bytes (445 in T1).
+            cv.Optional(CONF_CAPTURE_BUFFER_SIZE, default=0): cv.Any(
+                cv.one_of(0, int=True), cv.int_range(min=512, max=65535)
+            ),
+            cv.Optional(CONF_DUTY_CYCLE): DUTY_CYCLE_SCHEMA,
+            cv.Optional(CONF_FREQUENCY_TRACKING, default=True): cv.boolean,
+            cv.Optional(CONF_RADIO_PROFILE, default="C1"): cv.enum(
+                RADIO_PROFILES, upper=True
+            ),
+            cv.Optional(CONF_SECOND_RADIO): SECOND_RADIO_SCHEMA,
+            cv.Optional(CONF_RECEIVE_TASK): cv.All(cv.only_on_esp32, RECEIVE_TASK_SCHEMA),
+            cv.Optional(CONF_ANALYTICS): ANALYTICS_SCHEMA,
         }
     )
     .extend(cv.polling_component_schema("1s"))
-    .extend(spi.spi_device_schema(cs_pin_required=True))
+    .extend(spi.spi_device_schema(cs_pin_required=True)),
+    cv.has_at_least_one_key(CONF_METER_ID, CONF_METERS),
+    validate_gdo0_interrupt,
+    validate_unique_meter_ids,
 )
 
 
+def final_validate_receive_task(config):
+    """The receive task can only be pinned to a core the chip has."""
+    task = config.get(CONF_RECEIVE_TASK)
+    if task is not None and task.get(CONF_CORE) == 1 and get_esp32_variant() not in DUAL_CORE_VARIANTS:
+        raise cv.Invalid(
+            f"{get_esp32_variant()} has a single core, the receive task can only run on core 0",
+            path=[CONF_RECEIVE_TASK, CONF_CORE],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = final_validate_receive_task
+
+
+def final_validate_meter_reference(config):
+    """Sensors without `meter:` attach to the hub's top-level meter, which must exist."""
+    if CONF_METER in config:
+        return config
+    full_config = fv.full_config.get()
+    hub_path = full_config.get_path_for_id(config[CONF_MULTICAL21_ID])[:-1]
+    hub_config = full_config.get_config_for_path(hub_path)
+    if CONF_METER_ID not in hub_config:
+        raise cv.Invalid(
+            f"'{CONF_METER}' is required when the multical21 component only has a '{CONF_METERS}' list"
+        )
+    return config
+
+
+async def get_meter(config):
+    """Resolve the meter a sensor platform entry belongs to."""
+    if CONF_METER in config:
+        return await cg.get_variable(config[CONF_METER])
+    parent = await cg.get_variable(config[CONF_MULTICAL21_ID])
+    return parent.Pget_default_meter()
+
+
+def register_meter(var, config, meter_id, hub_config):
+    meter = cg.new_Pvariable(meter_id)
+    cg.add(meter.set_meter_id(config[CONF_METER_ID]))
+    cg.add(meter.set_key(config[CONF_KEY]))
+    cg.add(meter.set_history_flush_interval(hub_config[CONF_HISTORY_FLUSH_INTERVAL].total_milliseconds))
+    cg.add(var.register_meter(meter))
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     await spi.register_spi_device(var, config)
+    cg.add_define("MULTICAL21_SENSOR_SLOTS", configured_sensor_slots())
 
     gdo0_pin = await cg.gpio_pin_expression(config[CONF_GDO0_PIN])
     cg.add(var.set_gdo0_pin(gdo0_pin))
+    if config[CONF_GDO0_INTERRUPT]:
+        # An internal GPIO, as validate_gdo0_interrupt() made sure
+        cg.add(var.set_gdo0_isr_pin(gdo0_pin))
+    cg.add(var.set_radio_profile(config[CONF_RADIO_PROFILE]))
+    if CONF_SECOND_RADIO in config:
+        radio_config = config[CONF_SECOND_RADIO]
+        radio = cg.new_Pvariable(radio_config[CONF_ID])
+        await cg.register_component(radio, radio_config)
+        await spi.register_spi_device(radio, radio_config)
+        radio_gdo0_pin = await cg.gpio_pin_expression(radio_config[CONF_GDO0_PIN])
+        radio_isr_pin = radio_gdo0_pin if radio_config[CONF_GDO0_INTERRUPT] else cg.nullptr
+        cg.add(var.set_second_radio(radio, radio_gdo0_pin, radio_isr_pin))
+    if CONF_RECEIVE_TASK in config:
+        task = config[CONF_RECEIVE_TASK]
+        cg.add_define("USE_MULTICAL21_RECEIVE_TASK")
+        cg.add(var.set_receive_task(task[CONF_CORE], task[CONF_PRIORITY], task[CONF_STACK_SIZE]))
+    if config[CONF_CAPTURE_BUFFER_SIZE] > 0:
+        cg.add(var.set_capture_buffer_size(config[CONF_CAPTURE_BUFFER_SIZE]))
+    if not config[CONF_FREQUENCY_TRACKING]:
+        cg.add(var.set_frequency_tracking(False))
+    if CONF_DUTY_CYCLE in config:
+        duty_cycle = config[CONF_DUTY_CYCLE]
+        cg.add(
+            var.set_duty_cycle(
+                duty_cycle[CONF_GUARD_TIME].total_milliseconds,
+                duty_cycle[CONF_MAX_MISSED_WINDOWS],
+            )
+        )
+
+    if CONF_ANALYTICS in config:
+        analytics = config[CONF_ANALYTICS]
+        cg.add(
+            var.set_analytics(
+                analytics[CONF_ZERO_FLOW_INTERVAL].total_milliseconds,
+                analytics[CONF_PEAK_FLOW_WINDOW].total_milliseconds,
+                analytics[CONF_NIGHT_START],
+                analytics[CONF_NIGHT_END],
+            )
+        )
+        if CONF_TIME_ID in analytics:
+            clock = await cg.get_variable(analytics[CONF_TIME_ID])
+            cg.add(var.set_time(clock))
 
-    cg.add(var.set_meter_id(config[CONF_METER_ID]))
-    cg.add(var.set_key(config[CONF_KEY]))
+    # The top-level meter is registered first so it becomes the default meter
+    if CONF_METER_ID in config:
+        register_meter(var, config, config[CONF_DEFAULT_METER_ID], config)
+    for meter_config in config.get(CONF_METERS, []):
+        register_meter(var, meter_config, meter_config[CONF_ID], config)
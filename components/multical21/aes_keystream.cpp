@@ -0,0 +1,106 @@
+// Multical21 ESPHome Component - AES-128 CTR keystream engine
+
+#include "aes_keystream.h"
+#include "esphome/core/log.h"
+#include <cstring>
+
+namespace esphome {
+namespace multical21 {
+
+static const char *const TAG = "multical21.aes";
+
+// 128-bit big endian increment, as PSA_ALG_CTR advances its counter block
+static inline void increment_counter(uint8_t *counter) {
+  for (int i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+    if (++counter[i] != 0) {
+      break;
+    }
+  }
+}
+
+AesKeystream::~AesKeystream() {
+  if (this->key_id_ != 0) {
+    psa_destroy_key(this->key_id_);
+  }
+}
+
+bool AesKeystream::set_key(const uint8_t *key) {
+  psa_status_t ps = psa_crypto_init();
+  if (ps != PSA_SUCCESS) {
+    ESP_LOGE(TAG, "psa_crypto_init failed: %d", (int) ps);
+    return false;
+  }
+
+  // Destroy any existing key
+  if (this->key_id_ != 0) {
+    psa_destroy_key(this->key_id_);
+    this->key_id_ = 0;
+  }
+
+  psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
+  psa_set_key_usage_flags(&attr, PSA_KEY_USAGE_ENCRYPT);
+  psa_set_key_algorithm(&attr, PSA_ALG_ECB_NO_PADDING);
+  psa_set_key_type(&attr, PSA_KEY_TYPE_AES);
+  psa_set_key_bits(&attr, 128);
+
+  ps = psa_import_key(&attr, key, AES_BLOCK_SIZE, &this->key_id_);
+  psa_reset_key_attributes(&attr);
+  if (ps != PSA_SUCCESS) {
+    ESP_LOGE(TAG, "psa_import_key failed: %d", (int) ps);
+    this->key_id_ = 0;
+    return false;
+  }
+  return true;
+}
+
+// Keystream block i = AES-ECB(IV + i), counter incremented big endian over
+// the whole block. One ECB operation covers the frame, fed a chunk of counter
+// blocks at a time.
+bool AesKeystream::decrypt(const uint8_t *iv, const uint8_t *cipher, uint8_t *plain, size_t length) {
+  if (this->key_id_ == 0) {
+    return false;
+  }
+
+  psa_cipher_operation_t operation = PSA_CIPHER_OPERATION_INIT;
+  psa_status_t ps = psa_cipher_encrypt_setup(&operation, this->key_id_, PSA_ALG_ECB_NO_PADDING);
+  if (ps != PSA_SUCCESS) {
+    ESP_LOGE(TAG, "psa_cipher_encrypt_setup failed: %d", (int) ps);
+    return false;
+  }
+
+  uint8_t counter[AES_BLOCK_SIZE];
+  memcpy(counter, iv, AES_BLOCK_SIZE);
+  uint8_t blocks[KEYSTREAM_CHUNK_SIZE];
+  uint8_t keystream[KEYSTREAM_CHUNK_SIZE];
+  for (size_t offset = 0; offset < length; offset += KEYSTREAM_CHUNK_SIZE) {
+    size_t n = (length - offset < KEYSTREAM_CHUNK_SIZE) ? length - offset : KEYSTREAM_CHUNK_SIZE;
+    size_t padded = (n + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+    for (size_t block = 0; block < padded; block += AES_BLOCK_SIZE) {
+      memcpy(&blocks[block], counter, AES_BLOCK_SIZE);
+      increment_counter(counter);
+    }
+    size_t out_len = 0;
+    ps = psa_cipher_update(&operation, blocks, padded, keystream, sizeof(keystream), &out_len);
+    if (ps != PSA_SUCCESS || out_len != padded) {
+      ESP_LOGE(TAG, "psa_cipher_update failed: %d", (int) ps);
+      psa_cipher_abort(&operation);
+      return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+      plain[offset + i] = cipher[offset + i] ^ keystream[i];
+    }
+  }
+
+  // Whole blocks only went in, so nothing is left to come out
+  size_t out_len = 0;
+  ps = psa_cipher_finish(&operation, keystream, sizeof(keystream), &out_len);
+  if (ps != PSA_SUCCESS) {
+    ESP_LOGE(TAG, "psa_cipher_finish failed: %d", (int) ps);
+    psa_cipher_abort(&operation);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,40 @@
+// Multical21 ESPHome Component - AES-128 CTR keystream engine
+//
+// Generates CTR keystream with AES-ECB over the counter blocks on a key
+// imported once into PSA, instead of importing the key for every frame. Each
+// frame takes one multipart ECB operation: with the mbedTLS PSA driver every
+// operation setup expands the key again, so a single-shot call per block
+// would repeat that work for every 16 bytes.
+// There is no keystream to prepare ahead: the IV holds the ELL CC byte and
+// session number (SN), and SN changes with every telegram.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <psa/crypto.h>
+
+namespace esphome {
+namespace multical21 {
+
+static const uint8_t AES_BLOCK_SIZE = 16;
+// Counter blocks encrypted per psa_cipher_update() call; bounds the stack used
+static const uint8_t KEYSTREAM_CHUNK_SIZE = 4 * AES_BLOCK_SIZE;
+
+class AesKeystream {
+ public:
+  ~AesKeystream();
+
+  // Import a 128-bit key for ECB block encryption
+  bool set_key(const uint8_t *key);
+  bool is_ready() const { return this->key_id_ != 0; }
+
+  // CTR decrypt (== encrypt): plain = cipher XOR keystream(iv)
+  bool decrypt(const uint8_t *iv, const uint8_t *cipher, uint8_t *plain, size_t length);
+
+ protected:
+  psa_key_id_t key_id_{0};
+};
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,70 @@
+# Multical21 ESPHome Component - Binary Sensor Platform
+# Based on work by:
+#   Patrik Thalin - https://github.com/pthalin/esp32-multical21
+#   Chester - https://github.com/chester4444/esp-multical21
+
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import binary_sensor
+from esphome.const import DEVICE_CLASS_PROBLEM
+from . import (
+    CONF_METER,
+    CONF_MULTICAL21_ID,
+    Multical21Component,
+    Multical21Meter,
+    final_validate_meter_reference,
+    get_meter,
+)
+
+# The meter's own info flags, sent in every telegram
+CONF_DRY = "dry"
+CONF_REVERSE_FLOW = "reverse_flow"
+CONF_LEAK = "leak"
+CONF_BURST = "burst"
+
+DEPENDENCIES = ["multical21"]
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_MULTICAL21_ID): cv.use_id(Multical21Component),
+        cv.Optional(CONF_METER): cv.use_id(Multical21Meter),
+        cv.Optional(CONF_DRY): binary_sensor.binary_sensor_schema(
+            icon="mdi:water-off",
+            device_class=DEVICE_CLASS_PROBLEM,
+        ),
+        cv.Optional(CONF_REVERSE_FLOW): binary_sensor.binary_sensor_schema(
+            icon="mdi:swap-horizontal",
+            device_class=DEVICE_CLASS_PROBLEM,
+        ),
+        cv.Optional(CONF_LEAK): binary_sensor.binary_sensor_schema(
+            icon="mdi:pipe-leak",
+            device_class=DEVICE_CLASS_PROBLEM,
+        ),
+        cv.Optional(CONF_BURST): binary_sensor.binary_sensor_schema(
+            icon="mdi:pipe-disconnected",
+            device_class=DEVICE_CLASS_PROBLEM,
+        ),
+    }
+)
+
+FINAL_VALIDATE_SCHEMA = final_validate_meter_reference
+
+
+async def to_code(config):
+    meter = await get_meter(config)
+
+    if CONF_DRY in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_DRY])
+        cg.add(meter.set_dry_sensor(sens))
+
+    if CONF_REVERSE_FLOW in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_REVERSE_FLOW])
+        cg.add(meter.set_reverse_flow_sensor(sens))
+
+    if CONF_LEAK in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_LEAK])
+        cg.add(meter.set_leak_sensor(sens))
+
+    if CONF_BURST in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_BURST])
+        cg.add(meter.set_burst_sensor(sens))
@@ -0,0 +1,140 @@
+// Multical21 ESPHome Component - Raw frame capture
+
+#include "capture.h"
+#include "esphome/core/log.h"
+#include <cstring>
+
+namespace esphome {
+namespace multical21 {
+
+const char *capture_outcome_to_string(uint8_t outcome) {
+  switch (outcome) {
+    case CAPTURE_DECODED:
+      return "decoded";
+    case CAPTURE_DECODE_FAILED:
+      return "decode failed";
+    case CAPTURE_FOREIGN:
+      return "other meter";
+    case CAPTURE_LINK_CRC:
+      return "link CRC error";
+    case CAPTURE_BAD_HEADER:
+      return "bad header";
+    case CAPTURE_RX_ERROR:
+      return "RX error";
+    case CAPTURE_DUPLICATE:
+      return "duplicate";
+    default:
+      return "unknown";
+  }
+}
+
+void CaptureRing::allocate(size_t bytes) {
+  this->ring_.assign(bytes, 0);
+  this->pending_.assign(bytes > 0 ? CAPTURE_RECORD_HEADER_BYTES + CAPTURE_MAX_FRAME_LENGTH : 0, 0);
+  this->capacity_ = bytes;
+  this->clear();
+}
+
+void CaptureRing::clear() {
+  this->tail_ = 0;
+  this->used_ = 0;
+  this->records_ = 0;
+  this->overwritten_ = 0;
+  this->active_ = false;
+}
+
+void CaptureRing::begin(uint32_t arrival_us) {
+  if (!this->enabled()) {
+    return;
+  }
+  memset(this->pending_.data(), 0, CAPTURE_RECORD_HEADER_BYTES);
+  this->pending_[0] = (uint8_t) arrival_us;
+  this->pending_[1] = (uint8_t) (arrival_us >> 8);
+  this->pending_[2] = (uint8_t) (arrival_us >> 16);
+  this->pending_[3] = (uint8_t) (arrival_us >> 24);
+  this->pending_length_ = 0;
+  this->active_ = true;
+}
+
+void CaptureRing::append(const uint8_t *data, uint16_t len) {
+  if (!this->active_) {
+    return;
+  }
+  uint16_t room = CAPTURE_MAX_FRAME_LENGTH - this->pending_length_;
+  if (len > room) {
+    len = room;
+  }
+  memcpy(this->pending_.data() + CAPTURE_RECORD_HEADER_BYTES + this->pending_length_, data, len);
+  this->pending_length_ += len;
+}
+
+void CaptureRing::finish(CaptureOutcome outcome) {
+  if (!this->active_) {
+    return;
+  }
+  this->active_ = false;
+  this->pending_[7] = outcome;
+  this->pending_[8] = (uint8_t) this->pending_length_;
+  this->pending_[9] = (uint8_t) (this->pending_length_ >> 8);
+
+  size_t size = CAPTURE_RECORD_HEADER_BYTES + this->pending_length_;
+  if (size > this->capacity_) {
+    this->overwritten_++;
+    return;
+  }
+  while (this->capacity_ - this->used_ < size) {
+    this->drop_oldest();
+  }
+  size_t head = (this->tail_ + this->used_) % this->capacity_;
+  size_t first = size < this->capacity_ - head ? size : this->capacity_ - head;
+  memcpy(&this->ring_[head], this->pending_.data(), first);
+  memcpy(&this->ring_[0], this->pending_.data() + first, size - first);
+  this->used_ += size;
+  this->records_++;
+}
+
+void CaptureRing::drop_oldest() {
+  size_t length_at = (this->tail_ + 8) % this->capacity_;
+  uint16_t length = this->ring_[length_at] | (this->ring_[(length_at + 1) % this->capacity_] << 8);
+  size_t size = CAPTURE_RECORD_HEADER_BYTES + length;
+  this->tail_ = (this->tail_ + size) % this->capacity_;
+  this->used_ -= size;
+  this->records_--;
+  this->overwritten_++;
+}
+
+size_t CaptureRing::read(size_t offset, uint8_t *out, size_t len) const {
+  size_t copied = 0;
+  while (copied < len && offset < sizeof(CAPTURE_MAGIC)) {
+    out[copied++] = CAPTURE_MAGIC[offset++];
+  }
+  while (copied < len && offset < this->file_size()) {
+    out[copied++] = this->ring_[(this->tail_ + offset - sizeof(CAPTURE_MAGIC)) % this->capacity_];
+    offset++;
+  }
+  return copied;
+}
+
+// Hex lines keep the dump readable in any log viewer; tests/native
+// replay_capture reassembles the file from the "capture: " lines.
+void CaptureRing::dump(const char *tag) const {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  ESP_LOGI(tag, "capture begin: %u frames, %u bytes, %u overwritten", (unsigned) this->records_,
+           (unsigned) this->file_size(), (unsigned) this->overwritten_);
+  uint8_t chunk[CAPTURE_DUMP_LINE_BYTES];
+  char line[CAPTURE_DUMP_LINE_BYTES * 2 + 1];
+  size_t offset = 0;
+  while (size_t count = this->read(offset, chunk, sizeof(chunk))) {
+    for (size_t i = 0; i < count; i++) {
+      line[2 * i] = HEX_DIGITS[chunk[i] >> 4];
+      line[2 * i + 1] = HEX_DIGITS[chunk[i] & 0x0F];
+    }
+    line[2 * count] = '\0';
+    ESP_LOGI(tag, "capture: %s", line);
+    offset += count;
+  }
+  ESP_LOGI(tag, "capture end");
+}
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,109 @@
+// Multical21 ESPHome Component - Raw frame capture
+//
+// An optional fixed-size RAM ring of frames exactly as they came out of the
+// RX FIFO, before link CRC stripping and decryption, with their arrival time,
+// signal and what the receiver made of them. The ring is read as one byte
+// stream in the capture file format below, so a dump over the log can be
+// turned back into a file and replayed on the host (tests/native).
+//
+// Capture file format, version 1, little endian:
+//
+//   file:   "MC21CAP" 0x01, then records oldest first
+//   record: uint32 arrival_us   micros() at the sync word
+//           uint8  rssi         CC1101 RSSI register (raw)
+//           uint8  lqi          CC1101 LQI register (raw)
+//           uint8  format_sync  Byte after 0x54: 0x3D format B, 0xCD format A;
+//                               0x00 Mode T1, frame as received (3-of-6 encoded)
+//           uint8  outcome      CaptureOutcome
+//           uint16 length       Number of frame bytes that follow
+//           uint8  frame[length] L-field, then the frame with its block CRCs,
+//                                cut short where the receiver stopped reading
+
+#pragma once
+
+#include "three_of_six.h"
+#include "wmbus_link.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace multical21 {
+
+static const uint8_t CAPTURE_MAGIC[8] = {'M', 'C', '2', '1', 'C', 'A', 'P', 0x01};
+static const uint8_t CAPTURE_RECORD_HEADER_BYTES = 10;
+static const uint8_t CAPTURE_FORMAT_T1 = 0x00;
+// Largest frame record: a maximum length frame encoded for Mode T1
+static const uint16_t CAPTURE_MAX_FRAME_LENGTH = three_of_six_length(MAX_LINK_FRAME_LENGTH);
+// Frame bytes per log line when the ring is dumped as hex
+static const uint8_t CAPTURE_DUMP_LINE_BYTES = 32;
+
+enum CaptureOutcome : uint8_t {
+  CAPTURE_DECODED = 0,     // Passed the link CRCs and was decoded by its meter
+  CAPTURE_DECODE_FAILED,   // Passed the link CRCs, rejected by the meter (application CRC, unknown format)
+  CAPTURE_FOREIGN,         // For a meter this radio does not serve; read up to the ID only
+  CAPTURE_LINK_CRC,        // A data link block CRC failed; read up to that block
+  CAPTURE_BAD_HEADER,      // Unknown format byte or L-field too short
+  CAPTURE_RX_ERROR,        // FIFO overflow or timeout while draining
+  CAPTURE_DUPLICATE,       // Passed the link CRCs, but the telegram was decoded already (other radio, repeater)
+  CAPTURE_OUTCOMES,
+};
+
+const char *capture_outcome_to_string(uint8_t outcome);
+
+class CaptureRing {
+ public:
+  // Allocate the ring once from setup(); 0 bytes leaves capture off
+  void allocate(size_t bytes);
+  bool enabled() const { return this->capacity_ > 0; }
+  // Heap taken by the ring and the record being received
+  size_t heap_bytes() const { return this->ring_.capacity() + this->pending_.capacity(); }
+
+  // Frame in progress. begin() starts it, append() adds bytes as they are
+  // drained, finish() stores it, dropping the oldest records to make room.
+  void begin(uint32_t arrival_us);
+  void set_format(uint8_t format_sync) {
+    if (this->active_) {
+      this->pending_[6] = format_sync;
+    }
+  }
+  void set_signal(uint8_t rssi, uint8_t lqi) {
+    if (this->active_) {
+      this->pending_[4] = rssi;
+      this->pending_[5] = lqi;
+    }
+  }
+  void append(const uint8_t *data, uint16_t len);
+  void finish(CaptureOutcome outcome);
+  bool active() const { return this->active_; }
+
+  uint32_t records() const { return this->records_; }
+  uint32_t overwritten() const { return this->overwritten_; }
+  void clear();
+
+  // The ring as a capture file: magic, then the records oldest first
+  size_t file_size() const { return sizeof(CAPTURE_MAGIC) + this->used_; }
+  // Copy up to `len` bytes of the file from `offset`; returns the count copied
+  size_t read(size_t offset, uint8_t *out, size_t len) const;
+  // Log the file as hex lines prefixed "capture: ", between begin and end lines
+  void dump(const char *tag) const;
+
+ protected:
+  void drop_oldest();
+
+  std::vector<uint8_t> ring_;
+  size_t capacity_{0};
+  size_t tail_{0};  // Oldest record
+  size_t used_{0};
+  uint32_t records_{0};
+  uint32_t overwritten_{0};
+
+  // Record being received: CAPTURE_RECORD_HEADER_BYTES + CAPTURE_MAX_FRAME_LENGTH,
+  // allocated with the ring, so capture costs no RAM while it is off
+  std::vector<uint8_t> pending_;
+  uint16_t pending_length_{0};
+  bool active_{false};
+};
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,243 @@
+// Multical21 ESPHome Component - Consumption analytics
+//
+// Leak, burst and backflow indicators worked out on the device from the
+// stream of totals, so Home Assistant automations need not scan the recorder
+// history of every meter. Each reading updates a few counters and a ring of
+// PEAK_FLOW_BUCKETS maxima; nothing grows with time.
+//
+// - Continuous flow: how long water has run without a still interval, i.e.
+//   without the total standing for the zero-flow interval. The total counts
+//   whole litres, so less than 1 L per interval cannot be told from none.
+// - Peak flow: the highest flow estimate over the peak window.
+// - Night minimum flow: the lowest hourly average flow within the night hours
+//   of local time, for the last night that had readings. Needs a time source.
+// - Reverse flow: the total stepping back by up to REVERSE_FLOW_MAX_LITRES, or
+//   the meter's own REVERSE flag coming on. A larger step is a meter reset.
+//
+// Times are millis() values; only differences are used, so wraparound is
+// harmless.
+
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+// Kamstrup info codes (the 16-bit record with VIFE 0x20): a flag per condition
+// in bits 0-3, and per condition a 3-bit code for how long it has lasted
+static const uint16_t INFO_CODE_DRY = 0x01;
+static const uint16_t INFO_CODE_REVERSE = 0x02;
+static const uint16_t INFO_CODE_LEAK = 0x04;
+static const uint16_t INFO_CODE_BURST = 0x08;
+static const uint8_t INFO_CODE_DRY_SHIFT = 4;
+static const uint8_t INFO_CODE_REVERSE_SHIFT = 7;
+static const uint8_t INFO_CODE_LEAK_SHIFT = 10;
+static const uint8_t INFO_CODE_BURST_SHIFT = 13;
+
+inline uint8_t info_code_duration(uint16_t info_codes, uint8_t shift) { return (info_codes >> shift) & 0x07; }
+
+// The meter's duration code as text
+inline const char *info_code_duration_text(uint8_t code) {
+  static const char *const TEXT[8] = {"under 1 hour", "1-8 hours", "9-24 hours", "2-3 days",
+                                      "4-7 days", "8-14 days", "15-21 days", "22-31 days"};
+  return TEXT[code & 0x07];
+}
+
+static const uint8_t PEAK_FLOW_BUCKETS = 24;
+// Night minimum flow is the lowest average over slots of this length
+static const uint32_t NIGHT_SLOT_MS = 3600000;
+// A bigger step back of the total is a meter reset, not water flowing back
+static const uint32_t REVERSE_FLOW_MAX_LITRES = 100;
+
+struct AnalyticsConfig {
+  uint32_t zero_flow_interval_ms{15 * 60 * 1000};
+  uint32_t peak_flow_window_ms{24 * 3600 * 1000};
+  uint8_t night_start_hour{2};  // Local time, [start, end); may wrap past midnight
+  uint8_t night_end_hour{5};
+};
+
+class ConsumptionAnalytics {
+ public:
+  void configure(const AnalyticsConfig &config) { this->config_ = config; }
+  const AnalyticsConfig &config() const { return this->config_; }
+
+  // Add a reading: the total, the meter's info codes and the current flow
+  // estimate in 0.1 L/h (`has_flow` false while there is none). `hour` is the
+  // local hour, or negative without a valid time source.
+  void add(uint32_t now_ms, uint32_t total_litres, uint16_t info_codes, bool has_flow, uint32_t flow_dlph,
+           int8_t hour) {
+    if (!this->started_) {
+      this->started_ = true;
+      this->last_ms_ = now_ms;
+      this->last_change_ms_ = now_ms;
+      this->last_total_ = total_litres;
+      this->peak_bucket_ms_ = now_ms;
+    }
+
+    bool stepped_back = false;
+    if (total_litres < this->last_total_) {
+      if (this->last_total_ - total_litres > REVERSE_FLOW_MAX_LITRES) {
+        this->reset(now_ms);
+      } else {
+        stepped_back = true;
+      }
+    } else if (total_litres > this->last_total_) {
+      // Flow resumed after a still interval, or across a gap that may have
+      // hidden one: it started within the interval up to this reading
+      if (!this->flowing_ || now_ms - this->last_ms_ >= this->config_.zero_flow_interval_ms) {
+        this->flowing_ = true;
+        this->flow_since_ms_ = this->last_ms_;
+      }
+      this->last_change_ms_ = now_ms;
+    } else if (this->flowing_ && now_ms - this->last_change_ms_ >= this->config_.zero_flow_interval_ms) {
+      this->flowing_ = false;
+    }
+    this->continuous_flow_ms_ = this->flowing_ ? now_ms - this->flow_since_ms_ : 0;
+
+    // A reverse-flow event starts when either sign of it appears
+    bool reverse = stepped_back || (info_codes & INFO_CODE_REVERSE) != 0;
+    if (reverse && !this->reverse_) {
+      this->reverse_events_++;
+    }
+    this->reverse_ = reverse;
+
+    if (has_flow) {
+      this->add_peak(now_ms, flow_dlph);
+    }
+    this->add_night(now_ms, total_litres, hour);
+
+    this->last_ms_ = now_ms;
+    this->last_total_ = total_litres;
+    this->info_codes_ = info_codes;
+  }
+
+  // Time water has run without a still interval, at the last reading
+  uint32_t continuous_flow_ms() const { return this->continuous_flow_ms_; }
+  bool flowing() const { return this->flowing_; }
+  // Highest flow estimate over the peak window, in whole L/h
+  uint32_t peak_flow_lph() const {
+    uint16_t peak = 0;
+    for (uint16_t bucket : this->peak_buckets_) {
+      if (bucket > peak) {
+        peak = bucket;
+      }
+    }
+    return peak;
+  }
+  // Lowest hourly flow of the last night, in 0.1 L/h; false until a night
+  // with a full slot has ended
+  bool night_min_flow_dlph(uint32_t *flow) const {
+    if (!this->has_night_min_) {
+      return false;
+    }
+    *flow = this->night_min_dlph_;
+    return true;
+  }
+  uint32_t reverse_events() const { return this->reverse_events_; }
+  uint16_t info_codes() const { return this->info_codes_; }
+
+ protected:
+  // Meter replaced or reset: start over, keeping the event count
+  void reset(uint32_t now_ms) {
+    this->flowing_ = false;
+    this->last_change_ms_ = now_ms;
+    this->in_night_ = false;
+  }
+
+  void add_peak(uint32_t now_ms, uint32_t flow_dlph) {
+    uint32_t bucket_ms = this->config_.peak_flow_window_ms / PEAK_FLOW_BUCKETS;
+    uint32_t steps = bucket_ms > 0 ? (now_ms - this->peak_bucket_ms_) / bucket_ms : 0;
+    if (steps >= PEAK_FLOW_BUCKETS) {
+      for (uint16_t &bucket : this->peak_buckets_) {
+        bucket = 0;
+      }
+      this->peak_bucket_ms_ = now_ms;
+    } else if (steps > 0) {
+      for (uint32_t i = 0; i < steps; i++) {
+        this->peak_head_ = (uint8_t) ((this->peak_head_ + 1) % PEAK_FLOW_BUCKETS);
+        this->peak_buckets_[this->peak_head_] = 0;
+      }
+      this->peak_bucket_ms_ += steps * bucket_ms;
+    }
+    uint32_t lph = (flow_dlph + 5) / 10;
+    uint16_t clamped = lph > UINT16_MAX ? UINT16_MAX : (uint16_t) lph;
+    if (clamped > this->peak_buckets_[this->peak_head_]) {
+      this->peak_buckets_[this->peak_head_] = clamped;
+    }
+  }
+
+  bool in_night_window(int8_t hour) const {
+    if (hour < 0) {
+      return false;
+    }
+    uint8_t start = this->config_.night_start_hour;
+    uint8_t end = this->config_.night_end_hour;
+    return start <= end ? hour >= start && hour < end : hour >= start || hour < end;
+  }
+
+  void add_night(uint32_t now_ms, uint32_t total_litres, int8_t hour) {
+    if (!this->in_night_window(hour)) {
+      if (this->in_night_) {
+        // Night over: its minimum, if it had a full slot, replaces the last one
+        this->in_night_ = false;
+        if (this->night_running_min_dlph_ != UINT32_MAX) {
+          this->night_min_dlph_ = this->night_running_min_dlph_;
+          this->has_night_min_ = true;
+        }
+      }
+      return;
+    }
+    if (!this->in_night_) {
+      this->in_night_ = true;
+      this->night_running_min_dlph_ = UINT32_MAX;
+      this->slot_start_ms_ = now_ms;
+      this->slot_start_total_ = total_litres;
+      return;
+    }
+    uint32_t elapsed_ms = now_ms - this->slot_start_ms_;
+    if (elapsed_ms < NIGHT_SLOT_MS) {
+      return;
+    }
+    // 0.1 L/h = litres * 36 000 000 / ms; water that flowed back counts as none
+    uint64_t litres = total_litres > this->slot_start_total_ ? total_litres - this->slot_start_total_ : 0;
+    uint32_t flow = (uint32_t) (litres * 36000000ULL / elapsed_ms);
+    if (flow < this->night_running_min_dlph_) {
+      this->night_running_min_dlph_ = flow;
+    }
+    this->slot_start_ms_ = now_ms;
+    this->slot_start_total_ = total_litres;
+  }
+
+  AnalyticsConfig config_;
+  uint32_t last_ms_{0};
+  uint32_t last_total_{0};
+
+  // Continuous flow
+  uint32_t flow_since_ms_{0};
+  uint32_t last_change_ms_{0};  // Last reading at which the total went up
+  uint32_t continuous_flow_ms_{0};
+
+  uint32_t reverse_events_{0};
+
+  // Peak flow: the maximum of each slice of the window, newest at peak_head_
+  uint16_t peak_buckets_[PEAK_FLOW_BUCKETS]{};
+  uint32_t peak_bucket_ms_{0};  // Start of the newest slice
+
+  // Night minimum flow
+  uint32_t slot_start_ms_{0};
+  uint32_t slot_start_total_{0};
+  uint32_t night_running_min_dlph_{UINT32_MAX};
+  uint32_t night_min_dlph_{0};
+
+  uint16_t info_codes_{0};
+  uint8_t peak_head_{0};
+  bool started_{false};
+  bool flowing_{false};
+  bool reverse_{false};
+  bool in_night_{false};
+  bool has_night_min_{false};
+};
+
+}  // namespace multical21
+}  // namespace esphome
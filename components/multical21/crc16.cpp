@@ -0,0 +1,59 @@
+// Multical21 ESPHome Component - CRC16 EN13757
+// Compile-time tables and the byte-wise / sliced update loops
+
+#include "crc16.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace multical21 {
+
+static constexpr Crc16Tables<1> CRC16_TABLES_1 PROGMEM = make_crc16_tables<1>(CRC16_EN13757_POLY);
+static constexpr Crc16Tables<4> CRC16_TABLES_4 PROGMEM = make_crc16_tables<4>(CRC16_EN13757_POLY);
+static constexpr Crc16Tables<8> CRC16_TABLES_8 PROGMEM = make_crc16_tables<8>(CRC16_EN13757_POLY);
+
+// Spot checks against the values of the former hand-written table
+static_assert(CRC16_TABLES_1.table[0][0x01] == 0x3D65, "CRC16 table generation");
+static_assert(CRC16_TABLES_1.table[0][0xFF] == 0xAC48, "CRC16 table generation");
+static_assert(CRC16_TABLES_8.table[0][0x80] == CRC16_TABLES_1.table[0][0x80], "CRC16 table generation");
+
+static inline uint16_t crc16_lookup(const uint16_t *entry) {
+#ifdef USE_ESP8266
+  return progmem_read_uint16(entry);
+#else
+  return *entry;
+#endif
+}
+
+template<size_t Slices>
+static inline uint16_t crc16_fold(const Crc16Tables<Slices> &tables, uint16_t crc, const uint8_t *data,
+                                  size_t length) {
+  // Slices bytes per step: the CRC register only overlaps the first two
+  for (; Slices > 1 && length >= Slices; data += Slices, length -= Slices) {
+    uint16_t next = crc16_lookup(&tables.table[Slices - 1][(crc >> 8) ^ data[0]]) ^
+                    crc16_lookup(&tables.table[Slices - 2][(crc & 0xFF) ^ data[1]]);
+    for (size_t k = 2; k < Slices; k++) {
+      next ^= crc16_lookup(&tables.table[Slices - 1 - k][data[k]]);
+    }
+    crc = next;
+  }
+  // Remaining bytes one table access each
+  for (; length > 0; data++, length--) {
+    crc = (uint16_t) (crc << 8) ^ crc16_lookup(&tables.table[0][((crc >> 8) ^ *data) & 0xFF]);
+  }
+  return crc;
+}
+
+template<> uint16_t crc16_en13757_update_sliced<1>(uint16_t crc, const uint8_t *data, size_t length) {
+  return crc16_fold(CRC16_TABLES_1, crc, data, length);
+}
+
+template<> uint16_t crc16_en13757_update_sliced<4>(uint16_t crc, const uint8_t *data, size_t length) {
+  return crc16_fold(CRC16_TABLES_4, crc, data, length);
+}
+
+template<> uint16_t crc16_en13757_update_sliced<8>(uint16_t crc, const uint8_t *data, size_t length) {
+  return crc16_fold(CRC16_TABLES_8, crc, data, length);
+}
+
+}  // namespace multical21
+}  // namespace esphome
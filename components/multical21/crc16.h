@@ -0,0 +1,76 @@
+// Multical21 ESPHome Component - CRC16 EN13757
+//
+// Table-driven CRC with the tables generated at compile time from the
+// polynomial. Slicing-by-N folds N bytes per step using N tables of 512 bytes;
+// the default is chosen per target and can be overridden with
+// -DMULTICAL21_CRC_SLICES=1|4|8. ESP8266 keeps .rodata in RAM, so there the
+// default is a single table placed in flash.
+//
+// Incremental use, e.g. while bytes are drained from the radio:
+//   uint16_t crc = CRC16_EN13757_INIT;
+//   crc = crc16_en13757_update(crc, chunk, chunk_length);  // any number of times
+//   uint16_t result = crc16_en13757_final(crc);
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MULTICAL21_CRC_SLICES
+#ifdef USE_ESP8266
+#define MULTICAL21_CRC_SLICES 1
+#else
+#define MULTICAL21_CRC_SLICES 4
+#endif
+#endif
+
+namespace esphome {
+namespace multical21 {
+
+// CRC polynomial for EN13757
+static const uint16_t CRC16_EN13757_POLY = 0x3D65;
+static const uint16_t CRC16_EN13757_INIT = 0x0000;
+
+template<size_t Slices> struct Crc16Tables {
+  // table[k][b]: CRC register contribution of byte b followed by k zero bytes
+  uint16_t table[Slices][256];
+};
+
+template<size_t Slices> constexpr Crc16Tables<Slices> make_crc16_tables(uint16_t poly) {
+  Crc16Tables<Slices> tables{};
+  for (int byte = 0; byte < 256; byte++) {
+    uint16_t crc = (uint16_t) (byte << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ poly) : (uint16_t) (crc << 1);
+    }
+    tables.table[0][byte] = crc;
+  }
+  for (size_t k = 1; k < Slices; k++) {
+    for (int byte = 0; byte < 256; byte++) {
+      uint16_t prev = tables.table[k - 1][byte];
+      tables.table[k][byte] = (uint16_t) (prev << 8) ^ tables.table[0][prev >> 8];
+    }
+  }
+  return tables;
+}
+
+// Fold `length` bytes into a running CRC register using Slices tables.
+// Provided for 1, 4 and 8; the linker only keeps the tables that are used.
+template<size_t Slices> uint16_t crc16_en13757_update_sliced(uint16_t crc, const uint8_t *data, size_t length);
+template<> uint16_t crc16_en13757_update_sliced<1>(uint16_t crc, const uint8_t *data, size_t length);
+template<> uint16_t crc16_en13757_update_sliced<4>(uint16_t crc, const uint8_t *data, size_t length);
+template<> uint16_t crc16_en13757_update_sliced<8>(uint16_t crc, const uint8_t *data, size_t length);
+
+inline uint16_t crc16_en13757_update(uint16_t crc, const uint8_t *data, size_t length) {
+  return crc16_en13757_update_sliced<MULTICAL21_CRC_SLICES>(crc, data, length);
+}
+
+// Final XOR with 0xFFFF per EN 13757
+inline uint16_t crc16_en13757_final(uint16_t crc) { return (uint16_t) ~crc; }
+
+inline uint16_t crc16_en13757(const uint8_t *data, size_t length) {
+  return crc16_en13757_final(crc16_en13757_update(CRC16_EN13757_INIT, data, length));
+}
+
+}  // namespace multical21
+}  // namespace esphome
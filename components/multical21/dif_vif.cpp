@@ -0,0 +1,234 @@
+// Multical21 ESPHome Component - M-Bus data records (EN 13757-3)
+// DIF/VIF parsing, layout construction and value extraction
+
+#include "dif_vif.h"
+#include <cstring>
+
+namespace esphome {
+namespace multical21 {
+
+// DIF data field (low nibble) -> data bytes; 0xFF for variable length and special functions
+static const uint8_t DIF_DATA_LENGTH[16] = {0, 1, 2, 3, 4, 4, 6, 8, 0, 1, 2, 3, 4, 0xFF, 6, 0xFF};
+
+static const uint8_t DIF_EXTENSION = 0x80;
+static const uint8_t DIF_STORAGE_LSB = 0x40;
+static const uint8_t DIF_FUNCTION_MASK = 0x30;
+static const uint8_t DIF_FUNCTION_INSTANTANEOUS = 0x00;
+static const uint8_t DIF_FUNCTION_MAX = 0x10;
+static const uint8_t DIF_FUNCTION_MIN = 0x20;
+static const uint8_t DIF_IDLE_FILLER = 0x2F;
+static const uint8_t VIF_EXTENSION = 0x80;
+static const uint8_t VIF_MANUFACTURER = 0xFF;
+static const uint8_t VIFE_KAMSTRUP_INFO_CODES = 0x20;
+// A record header is at most DIF + 10 DIFE + VIF + 10 VIFE
+static const uint8_t MAX_EXTENSIONS = 10;
+
+struct RecordHeader {
+  uint8_t dif;
+  uint8_t vif;
+  uint8_t first_vife;  // 0 when the VIF is not extended
+  uint8_t storage;
+  uint8_t tariff_subunit;  // Non-zero tariff or subunit in a DIFE
+  uint8_t header_length;
+  uint8_t data_length;
+};
+
+// Parse the DIF/DIFE/VIF/VIFE bytes of one record at `bytes`. Returns false on
+// a truncated header or a record whose data length the DIF does not fix.
+static bool parse_header(const uint8_t *bytes, uint8_t available, RecordHeader *header) {
+  uint8_t pos = 0;
+  header->dif = bytes[pos++];
+  header->data_length = DIF_DATA_LENGTH[header->dif & 0x0F];
+  if (header->data_length == 0xFF) {
+    return false;
+  }
+  header->storage = (header->dif & DIF_STORAGE_LSB) ? 1 : 0;
+  header->tariff_subunit = 0;
+
+  uint8_t last = header->dif;
+  for (uint8_t n = 0; (last & DIF_EXTENSION) && n < MAX_EXTENSIONS; n++) {
+    if (pos >= available) {
+      return false;
+    }
+    last = bytes[pos++];
+    header->storage |= (last & 0x0F) << (1 + 4 * n);
+    header->tariff_subunit |= last & 0x70;
+  }
+
+  if (pos >= available) {
+    return false;
+  }
+  header->vif = bytes[pos++];
+  header->first_vife = 0;
+  last = header->vif;
+  for (uint8_t n = 0; (last & VIF_EXTENSION) && n < MAX_EXTENSIONS; n++) {
+    if (pos >= available) {
+      return false;
+    }
+    last = bytes[pos++];
+    if (n == 0) {
+      header->first_vife = last;
+    }
+  }
+  header->header_length = pos;
+  return true;
+}
+
+// Map a record to the layout field it fills, if any
+static RecordField *classify(const RecordHeader &header, RecordLayout *layout, int8_t *exponent) {
+  if (header.vif == VIF_MANUFACTURER) {
+    return header.first_vife == VIFE_KAMSTRUP_INFO_CODES ? &layout->info_codes : nullptr;
+  }
+  // Extended VIFs and tariff/subunit records qualify the quantity; not ours
+  if ((header.vif & VIF_EXTENSION) || header.tariff_subunit != 0) {
+    return nullptr;
+  }
+
+  uint8_t function = header.dif & DIF_FUNCTION_MASK;
+  uint8_t vif = header.vif;
+  if ((vif & 0x78) == 0x10) {  // Volume, 10^(nnn-6) m3
+    *exponent = (int8_t) ((vif & 0x07) - 6);
+    if (header.storage == 0 && function == DIF_FUNCTION_INSTANTANEOUS) {
+      return &layout->total_volume;
+    }
+    return header.storage == 1 ? &layout->target_volume : nullptr;
+  }
+  if ((vif & 0x7C) == 0x58) {  // Flow temperature, 10^(nn-3) C
+    *exponent = (int8_t) ((vif & 0x03) - 3);
+    return &layout->flow_temperature;
+  }
+  if ((vif & 0x7C) == 0x64) {  // External temperature, 10^(nn-3) C
+    *exponent = (int8_t) ((vif & 0x03) - 3);
+    return &layout->external_temperature;
+  }
+  if ((vif & 0x78) == 0x38) {  // Volume flow, 10^(nnn-6) m3/h
+    *exponent = (int8_t) ((vif & 0x07) - 6);
+    if (function == DIF_FUNCTION_MAX) {
+      return &layout->max_flow;
+    }
+    return function == DIF_FUNCTION_MIN ? &layout->min_flow : nullptr;
+  }
+  return nullptr;
+}
+
+bool build_record_layout(const uint8_t *format, uint8_t format_length, RecordLayout *layout) {
+  *layout = RecordLayout{};
+  uint8_t pos = 0;
+  uint16_t data_offset = 0;
+  while (pos < format_length) {
+    if (format[pos] == DIF_IDLE_FILLER) {
+      pos++;
+      continue;
+    }
+    RecordHeader header;
+    if (!parse_header(format + pos, format_length - pos, &header)) {
+      return false;
+    }
+
+    int8_t exponent = 0;
+    RecordField *field = classify(header, layout, &exponent);
+    // The first record of each kind wins; later ones are usually history
+    if (field != nullptr && !field->present() && header.data_length > 0) {
+      field->offset = (uint8_t) data_offset;
+      field->length = header.data_length;
+      field->exponent = exponent;
+      uint8_t coding = header.dif & 0x0F;
+      field->coding = coding == 0x05 ? RECORD_REAL : (coding >= 0x09 ? RECORD_BCD : RECORD_INTEGER);
+    }
+
+    pos += header.header_length;
+    data_offset += header.data_length;
+    if (data_offset > MAX_RECORD_DATA) {
+      return false;
+    }
+  }
+  layout->data_length = (uint8_t) data_offset;
+  return true;
+}
+
+bool split_records(const uint8_t *records, uint8_t length, uint8_t *format, uint8_t *format_length, uint8_t *data,
+                   uint8_t *data_length) {
+  uint8_t pos = 0;
+  *format_length = 0;
+  *data_length = 0;
+  while (pos < length) {
+    // Manufacturer specific data runs to the end of the frame
+    if ((records[pos] & 0xEF) == 0x0F) {
+      break;
+    }
+    if (records[pos] == DIF_IDLE_FILLER) {
+      pos++;
+      continue;
+    }
+    RecordHeader header;
+    if (!parse_header(records + pos, length - pos, &header) ||
+        pos + header.header_length + header.data_length > length ||
+        *format_length + header.header_length > MAX_FORMAT_BYTES ||
+        *data_length + header.data_length > MAX_RECORD_DATA) {
+      return false;
+    }
+    memcpy(format + *format_length, records + pos, header.header_length);
+    *format_length += header.header_length;
+    pos += header.header_length;
+    memcpy(data + *data_length, records + pos, header.data_length);
+    *data_length += header.data_length;
+    pos += header.data_length;
+  }
+  return *format_length > 0;
+}
+
+int64_t RecordField::raw(const uint8_t *data) const {
+  const uint8_t *bytes = data + this->offset;
+  if (this->coding == RECORD_REAL) {
+    float real;
+    memcpy(&real, bytes, sizeof(real));
+    return (int64_t) real;
+  }
+  if (this->coding == RECORD_BCD) {
+    int64_t value = 0;
+    bool negative = (bytes[this->length - 1] & 0xF0) == 0xF0;
+    for (int i = this->length - 1; i >= 0; i--) {
+      uint8_t high = bytes[i] >> 4;
+      value = value * 10 + ((negative && i == this->length - 1) ? 0 : high);
+      value = value * 10 + (bytes[i] & 0x0F);
+    }
+    return negative ? -value : value;
+  }
+  uint64_t value = 0;
+  for (int i = this->length - 1; i >= 0; i--) {
+    value = (value << 8) | bytes[i];
+  }
+  // Sign-extend from the field width
+  unsigned shift = 64 - 8 * this->length;
+  return (int64_t) (value << shift) >> shift;
+}
+
+int64_t RecordField::scaled(const uint8_t *data, int8_t exponent) const {
+  int64_t value = this->raw(data);
+  for (int8_t e = this->exponent; e > exponent; e--) {
+    value *= 10;
+  }
+  for (int8_t e = this->exponent; e < exponent; e++) {
+    value /= 10;
+  }
+  return value;
+}
+
+float RecordField::value(const uint8_t *data) const {
+  float value;
+  if (this->coding == RECORD_REAL) {
+    memcpy(&value, data + this->offset, sizeof(value));
+  } else {
+    value = (float) this->raw(data);
+  }
+  for (int8_t e = this->exponent; e > 0; e--) {
+    value *= 10.0f;
+  }
+  for (int8_t e = this->exponent; e < 0; e++) {
+    value /= 10.0f;
+  }
+  return value;
+}
+
+}  // namespace multical21
+}  // namespace esphome
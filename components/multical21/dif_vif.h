@@ -0,0 +1,76 @@
+// Multical21 ESPHome Component - M-Bus data records (EN 13757-3)
+//
+// Long frames (CI=0x78) carry DIF/VIF data records. Compact frames (CI=0x79)
+// carry only the record data plus a format signature: the CRC16 of the
+// DIF/VIF bytes of the matching long frame. A RecordLayout is built once per
+// format from those DIF/VIF bytes and then decodes either frame type with
+// fixed offsets into the record data.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+// Application layer CI fields (first byte after the plaintext CRC)
+static const uint8_t CI_LONG_FRAME = 0x78;
+static const uint8_t CI_COMPACT_FRAME = 0x79;
+
+// Plaintext layout: CRC (2), CI (1), then records (long) or signature (2),
+// full-frame data CRC (2) and record data (compact)
+static const uint8_t PLAIN_CI = 2;
+static const uint8_t LONG_RECORDS_START = 3;
+static const uint8_t COMPACT_SIGNATURE = 3;
+static const uint8_t COMPACT_DATA_START = 7;
+
+// Upper bounds for one record format; Multical 21 data sets use ~11 format bytes
+static const uint8_t MAX_FORMAT_BYTES = 32;
+static const uint8_t MAX_RECORD_DATA = 64;
+
+static const uint8_t FIELD_ABSENT = 0xFF;
+
+enum RecordCoding : uint8_t {
+  RECORD_INTEGER,  // Signed little endian (type B)
+  RECORD_BCD,      // Packed BCD, 0xF in the top digit means negative (type A)
+  RECORD_REAL,     // 32-bit IEEE float (type H)
+};
+
+// One value inside the record data
+struct RecordField {
+  uint8_t offset{FIELD_ABSENT};  // Into the record data
+  uint8_t length{0};
+  int8_t exponent{0};  // Value = raw * 10^exponent in the field's unit
+  RecordCoding coding{RECORD_INTEGER};
+
+  bool present() const { return this->offset != FIELD_ABSENT; }
+  int64_t raw(const uint8_t *data) const;
+  // Integer value in units of 10^exponent, e.g. -3 for litres from m3 fields
+  int64_t scaled(const uint8_t *data, int8_t exponent) const;
+  float value(const uint8_t *data) const;
+};
+
+struct RecordLayout {
+  uint16_t signature{0};
+  uint8_t data_length{0};
+  RecordField total_volume;          // m3, current
+  RecordField target_volume;         // m3, storage 1 (start of billing period)
+  RecordField flow_temperature;      // C
+  RecordField external_temperature;  // C
+  RecordField max_flow;              // m3/h
+  RecordField min_flow;              // m3/h
+  RecordField info_codes;            // Kamstrup status bits
+};
+
+// Build the layout for a run of DIF/VIF bytes. Fails on record types a
+// compact frame cannot carry (variable length, special functions).
+bool build_record_layout(const uint8_t *format, uint8_t format_length, RecordLayout *layout);
+
+// Split the records of a long frame into their DIF/VIF bytes and the record
+// data they describe, the two halves a compact frame is built from.
+bool split_records(const uint8_t *records, uint8_t length, uint8_t *format, uint8_t *format_length, uint8_t *data,
+                   uint8_t *data_length);
+
+}  // namespace multical21
+}  // namespace esphome
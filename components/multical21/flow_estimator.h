@@ -0,0 +1,83 @@
+// Multical21 ESPHome Component - Flow estimate from successive totals
+//
+// The meter reports its total in whole litres about every 16 s, so the
+// difference between two readings is coarse (1 L in 16 s is 225 L/h) and a
+// missed telegram doubles the gap. The estimate is taken over a short window
+// of recent (time, litres) samples instead, in integer arithmetic so the
+// ESP8266 does not pay for soft-float on every frame. Sample times are
+// millis() values; only differences are used, so wraparound is harmless.
+
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+static const uint8_t FLOW_SAMPLES = 8;
+// Oldest sample still used while newer ones exist
+static const uint32_t FLOW_WINDOW_MS = 120000;
+// A reading further apart than this starts over rather than averaging a gap
+static const uint32_t FLOW_MAX_GAP_MS = 600000;
+
+class FlowEstimator {
+ public:
+  // Add a reading. A total that went backwards (meter replaced or reset) or a
+  // long silence clears the history.
+  void add(uint32_t now_ms, uint32_t total_litres) {
+    if (this->count_ > 0) {
+      const Sample &newest = this->at(0);
+      if (total_litres < newest.litres || now_ms - newest.ms > FLOW_MAX_GAP_MS) {
+        this->count_ = 0;
+      }
+    }
+    this->head_ = (uint8_t) ((this->head_ + 1) % FLOW_SAMPLES);
+    this->samples_[this->head_] = Sample{now_ms, total_litres};
+    if (this->count_ < FLOW_SAMPLES) {
+      this->count_++;
+    }
+  }
+
+  // Flow in units of 0.1 L/h over the window ending at the newest sample.
+  // False until two samples are available.
+  bool flow_decilitres_per_hour(uint32_t *flow) const {
+    if (this->count_ < 2) {
+      return false;
+    }
+    const Sample &newest = this->at(0);
+    // Walk back to the oldest sample inside the window, always using at least the previous one
+    uint8_t back = 1;
+    while (back + 1 < this->count_ && newest.ms - this->at(back + 1).ms <= FLOW_WINDOW_MS) {
+      back++;
+    }
+    const Sample &oldest = this->at(back);
+    uint32_t elapsed_ms = newest.ms - oldest.ms;
+    if (elapsed_ms == 0) {
+      return false;
+    }
+    // 0.1 L/h = litres * 36 000 000 / ms; 64-bit so a large difference cannot overflow
+    uint64_t litres = newest.litres - oldest.litres;
+    *flow = (uint32_t) (litres * 36000000ULL / elapsed_ms);
+    return true;
+  }
+
+  void clear() { this->count_ = 0; }
+
+ protected:
+  struct Sample {
+    uint32_t ms;
+    uint32_t litres;
+  };
+
+  // `back` samples before the newest
+  const Sample &at(uint8_t back) const {
+    return this->samples_[(this->head_ + FLOW_SAMPLES - back) % FLOW_SAMPLES];
+  }
+
+  Sample samples_[FLOW_SAMPLES]{};
+  uint8_t head_{0};
+  uint8_t count_{0};
+};
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,112 @@
+// Multical21 ESPHome Component - Record format cache
+
+#include "format_cache.h"
+#include "crc16.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cstring>
+
+namespace esphome {
+namespace multical21 {
+
+static const char *const TAG = "multical21.formats";
+
+// Record format of the Multical 21 default data set: info codes, total,
+// target (storage 1), flow temperature and external temperature. Signature 0xA8ED.
+static const uint8_t DEFAULT_FORMAT[] = {0x02, 0xFF, 0x20, 0x04, 0x13, 0x44, 0x13, 0x61, 0x5B, 0x61, 0x67};
+
+FormatCache::FormatCache() { this->insert(DEFAULT_FORMAT, sizeof(DEFAULT_FORMAT), false); }
+
+void FormatCache::load(uint32_t meter_id) {
+  this->pref_ = global_preferences->make_preference<Store>(fnv1_hash("multical21.formats") ^ meter_id, true);
+  Store store;
+  if (!this->pref_.load(&store)) {
+    return;
+  }
+  for (uint8_t i = 0; i < store.count && i < FORMAT_CACHE_SIZE; i++) {
+    const StoredFormat &format = store.formats[i];
+    if (format.length <= MAX_FORMAT_BYTES) {
+      this->insert(format.bytes, format.length, false);
+    }
+  }
+  ESP_LOGD(TAG, "[%08X] Restored %u record formats", (unsigned) meter_id, this->count_);
+}
+
+const RecordLayout *FormatCache::find(uint16_t signature) {
+  for (uint8_t i = 0; i < this->count_; i++) {
+    if (this->entries_[i].layout.signature == signature) {
+      this->entries_[i].last_used = ++this->use_counter_;
+      return &this->entries_[i].layout;
+    }
+  }
+  return nullptr;
+}
+
+const RecordLayout *FormatCache::learn(const uint8_t *format, uint8_t format_length) {
+  const RecordLayout *layout = this->find(crc16_en13757(format, format_length));
+  if (layout != nullptr) {
+    return layout;
+  }
+  return this->insert(format, format_length, true);
+}
+
+const RecordLayout *FormatCache::insert(const uint8_t *format, uint8_t format_length, bool persist) {
+  RecordLayout layout;
+  if (format_length > MAX_FORMAT_BYTES || !build_record_layout(format, format_length, &layout)) {
+    return nullptr;
+  }
+  layout.signature = crc16_en13757(format, format_length);
+  for (uint8_t i = 0; i < this->count_; i++) {
+    if (this->entries_[i].layout.signature == layout.signature) {
+      return &this->entries_[i].layout;
+    }
+  }
+
+  uint8_t slot = this->count_;
+  if (slot == FORMAT_CACHE_SIZE) {
+    slot = 0;
+    for (uint8_t i = 1; i < FORMAT_CACHE_SIZE; i++) {
+      if (this->entries_[i].last_used < this->entries_[slot].last_used) {
+        slot = i;
+      }
+    }
+    ESP_LOGD(TAG, "Evicting record format 0x%04X", this->entries_[slot].layout.signature);
+  } else {
+    this->count_++;
+  }
+
+  Entry &entry = this->entries_[slot];
+  entry.format.length = format_length;
+  memcpy(entry.format.bytes, format, format_length);
+  entry.layout = layout;
+  entry.last_used = ++this->use_counter_;
+  if (persist) {
+    ESP_LOGI(TAG, "Learnt record format 0x%04X (%u data bytes)", layout.signature, layout.data_length);
+    this->unsaved_ = true;
+  }
+  return &entry.layout;
+}
+
+void FormatCache::save_learnt() {
+  if (this->unsaved_) {
+    this->unsaved_ = false;
+    this->save();
+  }
+}
+
+// Only called when a new format is learnt, which happens a handful of times
+// over a meter's life, so flash wear is not a concern
+void FormatCache::save() {
+  Store store;
+  memset(&store, 0, sizeof(store));
+  store.count = this->count_;
+  for (uint8_t i = 0; i < this->count_; i++) {
+    store.formats[i] = this->entries_[i].format;
+  }
+  if (!this->pref_.save(&store)) {
+    ESP_LOGW(TAG, "Failed to save record formats");
+  }
+}
+
+}  // namespace multical21
+}  // namespace esphome
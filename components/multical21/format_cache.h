@@ -0,0 +1,65 @@
+// Multical21 ESPHome Component - Record format cache
+//
+// Compact frames only carry a signature of their record format, so the
+// format has to be learnt from a long frame first. Learnt formats are kept per
+// meter, bounded, and saved to preferences so compact frames decode straight
+// after a reboot instead of waiting for the next long frame.
+
+#pragma once
+
+#include "dif_vif.h"
+#include "esphome/core/preferences.h"
+
+namespace esphome {
+namespace multical21 {
+
+static const uint8_t FORMAT_CACHE_SIZE = 4;
+
+class FormatCache {
+ public:
+  // Starts out knowing the Multical 21 default format
+  FormatCache();
+  // Restore the formats learnt for this meter before the last reboot
+  void load(uint32_t meter_id);
+
+  // Layout for a compact frame signature, or nullptr if not learnt yet
+  const RecordLayout *find(uint16_t signature);
+  // Layout for the DIF/VIF bytes of a long frame, learnt if new. nullptr if
+  // the records cannot be described by a layout.
+  const RecordLayout *learn(const uint8_t *format, uint8_t format_length);
+  // Formats are learnt wherever frames are decoded, possibly on the receive
+  // task, but written to flash from the main loop: learnt formats wait here
+  bool unsaved() const { return this->unsaved_; }
+  void save_learnt();
+
+  uint8_t size() const { return this->count_; }
+  const RecordLayout &layout(uint8_t index) const { return this->entries_[index].layout; }
+
+ protected:
+  struct StoredFormat {
+    uint8_t length;
+    uint8_t bytes[MAX_FORMAT_BYTES];
+  };
+  // What goes to flash: the DIF/VIF bytes only, layouts are rebuilt on load
+  struct Store {
+    uint8_t count;
+    StoredFormat formats[FORMAT_CACHE_SIZE];
+  };
+  struct Entry {
+    StoredFormat format;
+    RecordLayout layout;
+    uint32_t last_used;
+  };
+
+  const RecordLayout *insert(const uint8_t *format, uint8_t format_length, bool persist);
+  void save();
+
+  Entry entries_[FORMAT_CACHE_SIZE];
+  uint8_t count_{0};
+  uint32_t use_counter_{0};  // Orders entries for least-recently-used eviction
+  bool unsaved_{false};
+  ESPPreferenceObject pref_;
+};
+
+}  // namespace multical21
+}  // namespace esphome
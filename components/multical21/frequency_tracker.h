@@ -0,0 +1,80 @@
+// Multical21 ESPHome Component - Frequency offset tracking
+//
+// Crystal error on cheap CC1101 modules puts the receiver several kHz off the
+// meter's carrier, more than the frequency offset compensation (FOC) can pull
+// in during a Mode C1 preamble. The chip reports the offset it measured for
+// each packet in FREQEST, relative to the FSCTRL0 offset in use. Their sum is
+// filtered over frames, and FSCTRL0 is moved to the filtered value when it is
+// more than FREQ_TRACK_THRESHOLD_STEPS off.
+
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+// FREQEST / FSCTRL0 resolution: f_XOSC / 2^14 with the 26 MHz crystal
+static const float FREQ_STEP_KHZ = 26000.0f / 16384.0f;
+// Filtered offset in 1/16 steps; each frame moves it 1/8 of the way
+static const int16_t FREQ_FILTER_SCALE = 16;
+static const int16_t FREQ_FILTER_WEIGHT = 8;
+// Frames measured before the first correction, and the drift that triggers one
+static const uint8_t FREQ_TRACK_MIN_FRAMES = 4;
+static const int16_t FREQ_TRACK_THRESHOLD_STEPS = 2;
+// About +/-50 kHz, 60 ppm at 868 MHz; larger estimates are not crystal error
+static const int16_t FREQ_OFFSET_LIMIT_STEPS = 32;
+
+class FrequencyTracker {
+ public:
+  // Continue from an offset learnt before a reboot
+  void restore(int8_t offset) {
+    this->applied_ = offset;
+    this->filtered_ = offset * FREQ_FILTER_SCALE;
+  }
+
+  // FREQEST of a frame received with applied() in FSCTRL0. Returns true when
+  // applied() changed and FSCTRL0 should be rewritten.
+  bool add(uint8_t freqest) {
+    int16_t measured = this->applied_ + (int8_t) freqest;
+    if (measured > FREQ_OFFSET_LIMIT_STEPS || measured < -FREQ_OFFSET_LIMIT_STEPS) {
+      this->rejected_++;
+      return false;
+    }
+    if (this->frames_ == 0) {
+      this->filtered_ = measured * FREQ_FILTER_SCALE;
+    } else {
+      this->filtered_ += (measured * FREQ_FILTER_SCALE - this->filtered_) / FREQ_FILTER_WEIGHT;
+    }
+    if (this->frames_ < FREQ_TRACK_MIN_FRAMES) {
+      this->frames_++;
+      return false;
+    }
+    int16_t half = this->filtered_ >= 0 ? FREQ_FILTER_SCALE / 2 : -FREQ_FILTER_SCALE / 2;
+    int16_t target = (this->filtered_ + half) / FREQ_FILTER_SCALE;
+    int16_t drift = target - this->applied_;
+    if (drift < FREQ_TRACK_THRESHOLD_STEPS && drift > -FREQ_TRACK_THRESHOLD_STEPS) {
+      return false;
+    }
+    this->applied_ = (int8_t) target;
+    this->corrections_++;
+    return true;
+  }
+
+  // FSCTRL0 value in use, and the filtered estimate of the receiver's offset
+  int8_t applied() const { return this->applied_; }
+  bool measured() const { return this->frames_ > 0; }
+  float offset_khz() const { return this->filtered_ * FREQ_STEP_KHZ / FREQ_FILTER_SCALE; }
+  uint32_t corrections() const { return this->corrections_; }
+  uint32_t rejected() const { return this->rejected_; }
+
+ protected:
+  int8_t applied_{0};
+  int16_t filtered_{0};
+  uint8_t frames_{0};
+  uint32_t corrections_{0};
+  uint32_t rejected_{0};
+};
+
+}  // namespace multical21
+}  // namespace esphome
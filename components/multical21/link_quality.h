@@ -0,0 +1,115 @@
+// Multical21 ESPHome Component - Link quality from the radio's packet status
+//
+// With PKTCTRL1.APPEND_STATUS the CC1101 appends the RSSI and LQI it measured
+// for a packet after the packet's last byte, so every frame read in full comes
+// with its own signal level at no extra SPI transaction. Each meter keeps them
+// in fixed memory: min/avg/max over its last LINK_WINDOW frames, which follow
+// a link that is losing margin well before frames start failing their CRCs,
+// and an RSSI histogram since boot for judging antenna placement.
+
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+// Appended after the packet: RSSI, then CRC_OK (bit 7) and LQI (bits 6-0)
+static const uint8_t PACKET_STATUS_BYTES = 2;
+static const uint8_t PACKET_STATUS_LQI_MASK = 0x7F;
+
+// CC1101 RSSI register: two's complement in 0.5 dB steps, offset 74 dB at 868 MHz
+static const int16_t RSSI_OFFSET_DB = 74;
+
+static const uint8_t LINK_WINDOW = 16;  // About four minutes of telegrams
+// RSSI histogram: below -110 dBm, 10 dB bins up to -50 dBm, and above
+static const uint8_t RSSI_BINS = 8;
+static const int16_t RSSI_FIRST_BIN_DBM = -110;
+static const int16_t RSSI_BIN_DB = 10;
+
+// RSSI register value in units of 0.5 dBm
+inline int16_t rssi_half_dbm(uint8_t raw) { return (int16_t) (int8_t) raw - 2 * RSSI_OFFSET_DB; }
+
+class LinkQuality {
+ public:
+  void add(uint8_t rssi_raw, uint8_t lqi_status) {
+    this->head_ = (uint8_t) ((this->head_ + 1) % LINK_WINDOW);
+    this->rssi_[this->head_] = rssi_half_dbm(rssi_raw);
+    this->lqi_[this->head_] = lqi_status & PACKET_STATUS_LQI_MASK;
+    if (this->count_ < LINK_WINDOW) {
+      this->count_++;
+    }
+    this->frames_++;
+    this->histogram_[this->last_bin()]++;
+  }
+
+  // Another copy of the last frame, e.g. from a second radio: the stronger
+  // of the two stands for the frame
+  void keep_stronger(uint8_t rssi_raw, uint8_t lqi_status) {
+    if (this->count_ == 0 || rssi_half_dbm(rssi_raw) <= this->rssi_[this->head_]) {
+      return;
+    }
+    this->histogram_[this->last_bin()]--;
+    this->rssi_[this->head_] = rssi_half_dbm(rssi_raw);
+    this->lqi_[this->head_] = lqi_status & PACKET_STATUS_LQI_MASK;
+    this->histogram_[this->last_bin()]++;
+  }
+
+  // Frames since boot; the window holds the last min(frames, LINK_WINDOW)
+  uint32_t frames() const { return this->frames_; }
+  bool empty() const { return this->count_ == 0; }
+
+  float last_rssi_dbm() const { return this->rssi_[this->head_] / 2.0f; }
+  uint8_t last_lqi() const { return this->lqi_[this->head_]; }
+
+  // Over the window; RSSI in dBm. LQI is lower for a cleaner signal.
+  float min_rssi_dbm() const { return this->rssi_[this->find(true)] / 2.0f; }
+  float max_rssi_dbm() const { return this->rssi_[this->find(false)] / 2.0f; }
+  float avg_rssi_dbm() const {
+    int32_t sum = 0;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      sum += this->rssi_[i];
+    }
+    return this->count_ > 0 ? sum / (2.0f * this->count_) : 0.0f;
+  }
+  float avg_lqi() const {
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      sum += this->lqi_[i];
+    }
+    return this->count_ > 0 ? (float) sum / this->count_ : 0.0f;
+  }
+
+  // Frames per RSSI bin since boot; bin 0 is below RSSI_FIRST_BIN_DBM
+  uint32_t bin(uint8_t index) const { return this->histogram_[index]; }
+  static int16_t bin_low_dbm(uint8_t index) { return RSSI_FIRST_BIN_DBM + (index - 1) * RSSI_BIN_DB; }
+
+ protected:
+  // Histogram bin of the last frame
+  uint8_t last_bin() const {
+    int16_t dbm = this->rssi_[this->head_] / 2;
+    int bin = dbm < RSSI_FIRST_BIN_DBM ? 0 : 1 + (dbm - RSSI_FIRST_BIN_DBM) / RSSI_BIN_DB;
+    return (uint8_t) (bin < RSSI_BINS ? bin : RSSI_BINS - 1);
+  }
+
+  // Index of the weakest (min) or strongest RSSI in the window
+  uint8_t find(bool min) const {
+    uint8_t best = this->head_;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      if (min ? this->rssi_[i] < this->rssi_[best] : this->rssi_[i] > this->rssi_[best]) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  int16_t rssi_[LINK_WINDOW]{};  // 0.5 dBm units
+  uint8_t lqi_[LINK_WINDOW]{};
+  uint8_t head_{LINK_WINDOW - 1};
+  uint8_t count_{0};
+  uint32_t frames_{0};
+  uint32_t histogram_[RSSI_BINS]{};
+};
+
+}  // namespace multical21
+}  // namespace esphome
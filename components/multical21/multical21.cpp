@@ -1,5 +1,5 @@
 // Multical21 ESPHome Component
-// Kamstrup Multical 21 water meter reader via CC1101 (wM-Bus Mode C1)
+// Kamstrup Multical 21 water meter reader via CC1101 (wM-Bus Mode C1 or T1)
 //
 // Based on work by:
 //   Patrik Thalin - https://github.com/pthalin/esp32-multical21
@@ -8,617 +8,1302 @@
 #include "multical21.h"
 #include "esphome/core/log.h"
 #include "esphome/core/helpers.h"
+#include <algorithm>
 #include <cstring>
 
+#ifdef USE_API
+#include "esphome/components/api/api_server.h"
+#endif
+#ifdef USE_MQTT
+#include "esphome/components/mqtt/mqtt_client.h"
+#endif
+
 namespace esphome {
 namespace multical21 {
 
 static const char *const TAG = "multical21";
 
+// Frame buffers shared by all hubs: a frame is read, checked and decrypted
+// within one receive_frame() call, and hubs take turns at service_radios()
+// under frame_lock, whether from loop() or their own receive task
+static struct {
+  uint8_t frame[MAX_LINK_FRAME_LENGTH];  // L-field + frame as received; CRCs stripped in place
+  uint8_t plaintext[MAX_FRAME_LENGTH];
+} frame_arena;
+static Mutex frame_lock;
+
+// Configuration registers 0x00-0x2E in address order, written in one burst,
+// one table per radio profile. Both listen on 868.95 MHz for sync word 0x543D.
+// Registers a configuration does not use keep their datasheet reset values.
+
+// wM-Bus Mode C1: ~103 kbps 2-GFSK
+static const uint8_t CC1101_CONFIG_C1[CC1101_CONFIG_REGISTERS] PROGMEM = {
+    0x00,                      // IOCFG2: GDO2 asserts when the RX FIFO reaches the threshold
+    0x2E,                      // IOCFG1: high impedance (reset value)
+    0x06,                      // IOCFG0: GDO0 asserts on sync word, deasserts at end of packet
+    0x07,                      // FIFOTHR: RX FIFO threshold 32 bytes
+    WMBUS_PREAMBLE_1,          // SYNC1
+    WMBUS_PREAMBLE_2,          // SYNC0
+    0x30,                      // PKTLEN: rewritten per frame once the L-field is known
+    0x04,                      // PKTCTRL1: APPEND_STATUS, RSSI and LQI follow each packet
+    PKTCTRL0_INFINITE_LENGTH,  // PKTCTRL0: until the L-field is known
+    0x00,                      // ADDR
+    0x00,                      // CHANNR
+    0x08,                      // FSCTRL1
+    0x00,                      // FSCTRL0: frequency offset, replaced by the tracked offset
+    0x21,                      // FREQ2: 868.95 MHz
+    0x6B,                      // FREQ1
+    0xD0,                      // FREQ0
+    0x5C,                      // MDMCFG4: ~103 kbps
+    0x04,                      // MDMCFG3
+    0x06,                      // MDMCFG2: 2-GFSK, 16/16 sync bits
+    0x22,                      // MDMCFG1
+    0xF8,                      // MDMCFG0
+    0x44,                      // DEVIATN
+    0x07,                      // MCSM2 (reset value)
+    0x0C,                      // MCSM1: RXOFF_MODE = stay in RX after a packet
+    0x18,                      // MCSM0: calibrate when going from IDLE to RX
+    0x2E,                      // FOCCFG: frequency offset compensation
+    0xBF,                      // BSCFG
+    0x43,                      // AGCCTRL2
+    0x09,                      // AGCCTRL1
+    0xB5,                      // AGCCTRL0
+    0x87,                      // WOREVT1 (reset value)
+    0x6B,                      // WOREVT0 (reset value)
+    0xF8,                      // WORCTRL (reset value)
+    0xB6,                      // FREND1
+    0x10,                      // FREND0
+    0xEA,                      // FSCAL3
+    0x2A,                      // FSCAL2
+    0x00,                      // FSCAL1
+    0x1F,                      // FSCAL0
+    0x41,                      // RCCTRL1 (reset value)
+    0x00,                      // RCCTRL0 (reset value)
+    0x59,                      // FSTEST
+    0x7F,                      // PTEST (reset value)
+    0x3F,                      // AGCTEST (reset value)
+    0x81,                      // TEST2
+    0x35,                      // TEST1
+    0x09,                      // TEST0
+};
+
+// wM-Bus Mode T1: 100 kchip/s 2-FSK with the wider T1 deviation; the chips
+// are 3-out-of-6 encoded data, decoded as the FIFO is drained
+static const uint8_t CC1101_CONFIG_T1[CC1101_CONFIG_REGISTERS] PROGMEM = {
+    0x00,                      // IOCFG2: GDO2 asserts when the RX FIFO reaches the threshold
+    0x2E,                      // IOCFG1: high impedance (reset value)
+    0x06,                      // IOCFG0: GDO0 asserts on sync word, deasserts at end of packet
+    0x07,                      // FIFOTHR: RX FIFO threshold 32 bytes
+    WMBUS_PREAMBLE_1,          // SYNC1
+    WMBUS_PREAMBLE_2,          // SYNC0
+    0x30,                      // PKTLEN: rewritten per frame once the L-field is known
+    0x04,                      // PKTCTRL1: APPEND_STATUS, RSSI and LQI follow each packet
+    PKTCTRL0_INFINITE_LENGTH,  // PKTCTRL0: until the L-field is known
+    0x00,                      // ADDR
+    0x00,                      // CHANNR
+    0x08,                      // FSCTRL1
+    0x00,                      // FSCTRL0: frequency offset, replaced by the tracked offset
+    0x21,                      // FREQ2: 868.95 MHz
+    0x6B,                      // FREQ1
+    0xD0,                      // FREQ0
+    0x5C,                      // MDMCFG4: ~103 kbps
+    0x04,                      // MDMCFG3
+    0x05,                      // MDMCFG2: 2-FSK, 15/16 sync bits
+    0x22,                      // MDMCFG1
+    0xF8,                      // MDMCFG0
+    0x50,                      // DEVIATN: ~50 kHz
+    0x07,                      // MCSM2 (reset value)
+    0x0C,                      // MCSM1: RXOFF_MODE = stay in RX after a packet
+    0x18,                      // MCSM0: calibrate when going from IDLE to RX
+    0x2E,                      // FOCCFG: frequency offset compensation
+    0xBF,                      // BSCFG
+    0x43,                      // AGCCTRL2
+    0x09,                      // AGCCTRL1
+    0xB5,                      // AGCCTRL0
+    0x87,                      // WOREVT1 (reset value)
+    0x6B,                      // WOREVT0 (reset value)
+    0xF8,                      // WORCTRL (reset value)
+    0xB6,                      // FREND1
+    0x10,                      // FREND0
+    0xEA,                      // FSCAL3
+    0x2A,                      // FSCAL2
+    0x00,                      // FSCAL1
+    0x1F,                      // FSCAL0
+    0x41,                      // RCCTRL1 (reset value)
+    0x00,                      // RCCTRL0 (reset value)
+    0x59,                      // FSTEST
+    0x7F,                      // PTEST (reset value)
+    0x3F,                      // AGCTEST (reset value)
+    0x81,                      // TEST2
+    0x35,                      // TEST1
+    0x09,                      // TEST0
+};
+
+static const char *radio_state_to_string(RadioState state) {
+  switch (state) {
+    case RADIO_RESET:
+      return "reset";
+    case RADIO_CALIBRATING:
+      return "calibrating";
+    case RADIO_IDLE_WAIT:
+      return "returning to idle";
+    case RADIO_RX_WAIT:
+      return "entering RX";
+    case RADIO_RX:
+      return "RX";
+    case RADIO_SLEEP_WAIT:
+      return "powering down";
+    case RADIO_SLEEP:
+      return "asleep";
+    case RADIO_WAKING:
+      return "waking";
+    default:
+      return "failed";
+  }
+}
+
+// Whether published states currently reach Home Assistant or an MQTT broker
+static bool frontend_connected() {
+#ifdef USE_API
+  if (api::global_api_server != nullptr && api::global_api_server->is_connected()) {
+    return true;
+  }
+#endif
+#ifdef USE_MQTT
+  if (mqtt::global_mqtt_client != nullptr && mqtt::global_mqtt_client->is_connected()) {
+    return true;
+  }
+#endif
+#if defined(USE_API) || defined(USE_MQTT)
+  return false;
+#else
+  return true;
+#endif
+}
+
 void Multical21Component::setup() {
   ESP_LOGCONFIG(TAG, "Setting up Multical21 v%s...", VERSION);
 
   // Note: the AES key is imported into PSA in set_key() which is called before setup()
 
-  // Setup GDO0 pin
-  if (this->gdo0_pin_ != nullptr) {
-    this->gdo0_pin_->setup();
+  // Restore the record formats each meter learnt before the last reboot
+  for (auto *meter : this->meters_) {
+    meter->setup();
+    meter->get_schedule().configure(this->guard_ms_, this->max_missed_windows_);
+    meter->set_diversity(this->radio_count_ > 1);
+    meter->get_analytics().configure(this->analytics_);
+#ifdef USE_TIME
+    meter->set_time(this->time_);
+#endif
+  }
+  this->radio_time_ms_ = millis();
+
+  if (this->capture_buffer_size_ > 0) {
+    this->capture_.allocate(this->capture_buffer_size_);
   }
 
-  // Initialize SPI
+  // Initialize SPI; a second radio's SPI device sets itself up
   this->spi_setup();
 
-  // Reset and initialize CC1101
-  if (!this->reset_cc1101()) {
-    ESP_LOGE(TAG, "Failed to reset CC1101!");
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    RadioChannel &radio = this->radios_[i];
+
+    // The offset learnt before the last reboot goes into the first configuration
+    if (this->frequency_tracking_ && this->default_meter_ != nullptr) {
+      radio.frequency_pref = global_preferences->make_preference<int8_t>(
+          fnv1_hash(i == 0 ? "multical21.frequency" : "multical21.frequency.2") ^
+              this->default_meter_->get_meter_id(),
+          true);
+      int8_t offset;
+      if (radio.frequency_pref.load(&offset) && offset >= -FREQ_OFFSET_LIMIT_STEPS &&
+          offset <= FREQ_OFFSET_LIMIT_STEPS) {
+        radio.frequency.restore(offset);
+        ESP_LOGD(TAG, "Restored frequency offset of radio %u: %.1f kHz", radio.number, offset * FREQ_STEP_KHZ);
+      }
+    }
+
+    // Only needed when there is another radio to drain frames from meanwhile
+    if (this->radio_count_ > 1) {
+      radio.spill.bytes.resize(SPILL_BUFFER_SIZE);
+    }
+
+    // Setup GDO0 pin
+    if (radio.gdo0_pin != nullptr) {
+      radio.gdo0_pin->setup();
+    }
+
+    // Capture sync edges in an ISR so a slow main loop cannot delay sync detection.
+    // Edges are discarded until the receiver is armed.
+    if (radio.gdo0_isr_pin != nullptr) {
+      radio.gdo0_isr_pin->attach_interrupt(&Multical21Component::gdo0_isr, &radio, gpio::INTERRUPT_RISING_EDGE);
+    }
+
+    // Reset the CC1101; configuration, calibration and RX entry continue from loop()
+    this->reset_cc1101(radio);
+  }
+
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  if (this->receive_task_stack_size_ > 0) {
+    this->start_receive_task();
+  }
+#endif
+}
+
+void Multical21Component::loop() {
+  if (this->radios_failed_) {
     this->mark_failed();
     return;
   }
+  // With a receive task, frames are processed there
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  if (this->receive_task_ == nullptr) {
+    this->service_radios();
+  }
+#else
+  this->service_radios();
+#endif
+  this->publish_readings();
+}
 
-  ESP_LOGI(TAG, "CC1101 reset successful");
+void Multical21Component::service_radios() {
+  LockGuard guard(frame_lock);
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    this->service_radio(this->radios_[i]);
+  }
+}
 
-  // Initialize CC1101 registers for wM-Bus Mode C1
-  this->init_cc1101_registers();
+// Sensor publishing for the frames service_radios() decoded, and the flash
+// writes they asked for, both of which belong in the main loop
+void Multical21Component::publish_readings() {
+  QueuedReading queued;
+  bool unsaved = false;
+  while (this->readings_.pop(&queued)) {
+    queued.meter->publish_reading(queued.reading);
+    unsaved |= queued.reading.formats_learnt;
+  }
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    unsaved |= this->radios_[i].frequency_unsaved;
+  }
+  if (unsaved) {
+    this->save_learnt();
+  }
+}
 
-  // Calibrate
-  this->send_strobe(CC1101_SCAL);
-  delay(1);
+// Frame processing only marks what it learnt as unsaved: on the receive task
+// it must not touch the preferences, which are not thread safe
+void Multical21Component::save_learnt() {
+  LockGuard guard(frame_lock);
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    RadioChannel &radio = this->radios_[i];
+    if (radio.frequency_unsaved) {
+      radio.frequency_unsaved = false;
+      int8_t offset = radio.frequency.applied();
+      radio.frequency_pref.save(&offset);
+    }
+  }
+  for (auto *meter : this->meters_) {
+    meter->save_learnt_formats();
+  }
+}
 
-  // Start receiver
-  this->start_receiver();
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+void Multical21Component::start_receive_task() {
+  BaseType_t created = xTaskCreatePinnedToCore(&Multical21Component::receive_task, "multical21_rx",
+                                               this->receive_task_stack_size_, this, this->receive_task_priority_,
+                                               &this->receive_task_, this->receive_task_core_);
+  if (created != pdPASS) {
+    this->receive_task_ = nullptr;
+    ESP_LOGE(TAG, "Could not create the receive task, receiving from loop()");
+    return;
+  }
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    this->radios_[i].receive_task = this->receive_task_;
+  }
+}
 
-  this->cc1101_initialized_ = true;
-  ESP_LOGI(TAG, "Multical21 setup complete");
+// How long the receive task may sleep before the radios need it again. A
+// sync edge on an interrupt pin wakes it early.
+TickType_t Multical21Component::receive_task_wait() const {
+  TickType_t wait = pdMS_TO_TICKS(RECEIVE_TASK_IDLE_MS);
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    const RadioChannel &radio = this->radios_[i];
+    if (radio.spill.length > 0) {
+      return 0;  // Spilled frame bytes to take before the FIFO fills up again
+    }
+    bool settled = radio.state == RADIO_RX || radio.state == RADIO_SLEEP || radio.state == RADIO_FAILED;
+    if (radio.gdo0_isr_pin == nullptr || !settled) {
+      wait = 1;  // GDO0 polled, or a state change to follow up
+    }
+  }
+  return wait;
 }
 
-void Multical21Component::loop() {
-  if (!this->cc1101_initialized_) {
+void Multical21Component::receive_task(void *arg) {
+  auto *hub = static_cast<Multical21Component *>(arg);
+  for (;;) {
+    hub->service_radios();
+    ulTaskNotifyTake(pdTRUE, hub->receive_task_wait());
+  }
+}
+#endif
+
+// Bring a radio up or back to RX, or receive the frame it has started
+void Multical21Component::service_radio(RadioChannel &radio) {
+  if (radio.state != RADIO_RX) {
+    this->advance_radio(radio);
+    if (radio.state != RADIO_RX) {
+      return;
+    }
+  }
+
+  // Part of a frame was pulled from the FIFO while the other radio's frame
+  // was drained; its sync edge, if any, is the one that started it
+  if (radio.spill.length > 0) {
+    radio.packet_available = false;
+    this->receive_frame(radio);
+    return;
+  }
+
+  // Interrupt mode: only drain frames flagged by gdo0_isr()
+  if (radio.gdo0_isr_pin != nullptr) {
+    if (!radio.packet_available) {
+      this->idle_rx(radio);
+      return;
+    }
+    radio.packet_available = false;
+    uint32_t latency = micros() - radio.sync_time_us;
+    if (latency > this->max_sync_latency_us_) {
+      this->max_sync_latency_us_ = latency;
+    }
+    this->receive_frame(radio);
     return;
   }
 
-  // Check GDO0 for packet available (GDO0 LOW means sync detected)
-  if (this->gdo0_pin_ != nullptr && !this->gdo0_pin_->digital_read()) {
-    this->receive_frame();
+  // Polling fallback: GDO0 is HIGH from sync word until the end of the packet
+  if (radio.gdo0_pin != nullptr && radio.gdo0_pin->digital_read()) {
+    this->receive_frame(radio);
+    return;
   }
+  this->idle_rx(radio);
+}
+
+// GDO0 rising edge: sync word detected, frame bytes are arriving in the RX FIFO
+void IRAM_ATTR Multical21Component::gdo0_isr(RadioChannel *radio) {
+  radio->sync_time_us = micros();
+  radio->packet_available = true;
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  if (radio->receive_task != nullptr) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(radio->receive_task, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+#endif
 }
 
 void Multical21Component::update() {
-  if (this->frames_received_ > 0 || this->crc_errors_ > 0 || this->decrypt_errors_ > 0) {
-    ESP_LOGD(TAG, "Stats - frames: %u, CRC errors: %u, decrypt errors: %u, parse errors: %u",
-             this->frames_received_, this->crc_errors_, this->decrypt_errors_, this->parse_errors_);
+  // Also without duty cycling, where the hit rate shows whether it would work
+  {
+    LockGuard guard(frame_lock);
+    this->poll_schedules(millis());
+    this->account_radio_time();
   }
+  // Formats learnt from a reading the queue had to drop
+  this->save_learnt();
 
-  // Publish diagnostic sensors
-  if (this->frames_received_sensor_ != nullptr) {
-    this->frames_received_sensor_->publish_state(this->frames_received_);
+  if (this->foreign_frames_ > 0 || this->link_crc_errors_ > 0 || this->rearms_ > 0) {
+    ESP_LOGD(TAG, "Stats - accepted: %u, other meters: %u, link CRC errors: %u, re-arms: %u (FIFO overflows: %u)",
+             this->accepted_frames_, this->foreign_frames_, this->link_crc_errors_, this->rearms_,
+             this->fifo_overflows_);
+  }
+  if (this->readings_.drops() > 0) {
+    ESP_LOGD(TAG, "Reading queue - high water: %u of %u, dropped: %u", (unsigned) this->readings_.high_water(),
+             READING_QUEUE_SIZE, (unsigned) this->readings_.drops());
+  }
+  this->accepted_frames_sensor_.publish(this->accepted_frames_, &this->publish_stats_);
+  this->foreign_frames_sensor_.publish(this->foreign_frames_, &this->publish_stats_);
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    this->radio_accepted_frames_sensors_[i].publish(this->radios_[i].accepted_frames, &this->publish_stats_);
+  }
+  this->duplicate_frames_sensor_.publish(this->duplicate_frames_, &this->publish_stats_);
+  this->reading_queue_high_water_sensor_.publish(this->readings_.high_water(), &this->publish_stats_);
+  this->reading_queue_drops_sensor_.publish(this->readings_.drops(), &this->publish_stats_);
+
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  for (auto *meter : this->meters_) {
+    hits += meter->get_schedule().hits();
+    misses += meter->get_schedule().misses();
   }
-  if (this->crc_errors_sensor_ != nullptr) {
-    this->crc_errors_sensor_->publish_state(this->crc_errors_);
+  if (hits + misses > 0) {
+    this->prediction_hit_rate_sensor_.publish(100.0f * hits / (hits + misses), &this->publish_stats_);
   }
-  if (this->signal_quality_sensor_ != nullptr) {
-    uint32_t total = this->frames_received_ + this->crc_errors_ + this->decrypt_errors_;
-    float quality = (total > 0) ? (this->frames_received_ * 100.0f / total) : 0.0f;
-    this->signal_quality_sensor_->publish_state(quality);
+  if (this->awake_ms_ + this->asleep_ms_ > 0) {
+    this->rx_duty_cycle_sensor_.publish(100.0f * this->awake_ms_ / (this->awake_ms_ + this->asleep_ms_),
+                                        &this->publish_stats_);
+  }
+  const FrequencyTracker &frequency = this->radios_[0].frequency;
+  if (frequency.measured()) {
+    this->frequency_offset_sensor_.publish(frequency.offset_khz(), &this->publish_stats_);
+  }
+  this->frequency_corrections_sensor_.publish(frequency.corrections(), &this->publish_stats_);
+
+  // The receive task updates the meters' counters and statistics: copy them
+  // under the lock, one meter at a time, and publish from the copy
+  bool connected = frontend_connected();
+  for (auto *meter : this->meters_) {
+    MeterDiagnostics diagnostics;
+    {
+      LockGuard guard(frame_lock);
+      diagnostics = meter->diagnostics();
+    }
+    meter->update_history(connected, diagnostics.counters);
+    meter->publish_diagnostics(diagnostics);
   }
 }
 
+void Multical21Component::on_shutdown() {
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  if (this->receive_task_ != nullptr) {
+    // Between frames, as the task holds the lock for each one
+    LockGuard guard(frame_lock);
+    vTaskSuspend(this->receive_task_);
+  }
+#endif
+  this->publish_readings();
+  this->save_learnt();
+  for (auto *meter : this->meters_) {
+    meter->flush_history();
+  }
+}
+
+void Multical21Component::dump_capture() {
+  LockGuard guard(frame_lock);
+  this->capture_.dump(TAG_CAPTURE);
+}
+
+void Multical21Component::clear_capture() {
+  LockGuard guard(frame_lock);
+  this->capture_.clear();
+}
+
+MemoryUsage Multical21Component::memory_usage() const {
+  MemoryUsage usage{sizeof(*this), sizeof(frame_arena), 0};
+  if (this->radio_count_ > 1) {
+    usage.objects += sizeof(Multical21Radio);
+  }
+  usage.objects += this->meters_.size() * sizeof(Multical21Meter);
+  usage.heap += this->meters_.capacity() * sizeof(Multical21Meter *);
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    usage.heap += this->radios_[i].spill.bytes.capacity();
+  }
+  usage.heap += this->capture_.heap_bytes();
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  if (this->receive_task_ != nullptr) {
+    usage.heap += this->receive_task_stack_size_;
+  }
+#endif
+  return usage;
+}
+
 void Multical21Component::dump_config() {
   ESP_LOGCONFIG(TAG, "Multical21:");
   ESP_LOGCONFIG(TAG, "  Version: %s", VERSION);
-  LOG_PIN("  GDO0 Pin: ", this->gdo0_pin_);
-  ESP_LOGCONFIG(TAG, "  Meter ID: %02X%02X%02X%02X", this->meter_id_[0], this->meter_id_[1], this->meter_id_[2],
-                this->meter_id_[3]);
-  if (this->cc1101_initialized_) {
-    ESP_LOGCONFIG(TAG, "  CC1101: Initialized");
-  } else {
-    ESP_LOGCONFIG(TAG, "  CC1101: NOT initialized");
-  }
-  ESP_LOGCONFIG(TAG, "  Frames received: %u", this->frames_received_);
-  ESP_LOGCONFIG(TAG, "  CRC errors: %u", this->crc_errors_);
-  ESP_LOGCONFIG(TAG, "  Decrypt errors: %u", this->decrypt_errors_);
-  ESP_LOGCONFIG(TAG, "  Parse errors: %u", this->parse_errors_);
-}
-
-void Multical21Component::set_meter_id(const std::string &meter_id) {
-  if (meter_id.length() >= 8) {
-    this->hex_to_bytes(meter_id, this->meter_id_, 4);
-    ESP_LOGD(TAG, "Meter ID set: %02X%02X%02X%02X", this->meter_id_[0], this->meter_id_[1], this->meter_id_[2],
-             this->meter_id_[3]);
-  }
-}
-
-void Multical21Component::set_key(const std::string &key) {
-  if (key.length() >= 32) {
-    this->hex_to_bytes(key, this->aes_key_, 16);
-
-    // Import key into PSA immediately. This simplifies lifecycle handling
-    // and avoids deferred state.
-    psa_status_t ps = psa_crypto_init();
-    if (ps != PSA_SUCCESS) {
-      ESP_LOGE(TAG, "psa_crypto_init failed in set_key: %d", (int)ps);
-      this->aes_key_set_ = false;
+  uint32_t best_radio_frames = 0;
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    const RadioChannel &radio = this->radios_[i];
+    if (this->radio_count_ > 1) {
+      ESP_LOGCONFIG(TAG, "  Radio %u:", radio.number);
+    }
+    LOG_PIN("  GDO0 Pin: ", radio.gdo0_pin);
+    ESP_LOGCONFIG(TAG, "  GDO0 Mode: %s", radio.gdo0_isr_pin != nullptr ? "interrupt" : "polling");
+    if (radio.initialized) {
+      ESP_LOGCONFIG(TAG, "  CC1101: Initialized");
     } else {
-      // Destroy any existing key handle
-      if (this->aes_key_handle_ != 0) {
-        psa_destroy_key(this->aes_key_handle_);
-        this->aes_key_handle_ = 0;
-      }
-
-      psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
-      psa_set_key_usage_flags(&attr, PSA_KEY_USAGE_ENCRYPT | PSA_KEY_USAGE_DECRYPT);
-      psa_set_key_algorithm(&attr, PSA_ALG_CTR);
-      psa_set_key_type(&attr, PSA_KEY_TYPE_AES);
-      psa_set_key_bits(&attr, 128);
-
-      ps = psa_import_key(&attr, this->aes_key_, sizeof(this->aes_key_), &this->aes_key_handle_);
-      psa_reset_key_attributes(&attr);
-
-      if (ps != PSA_SUCCESS) {
-        ESP_LOGE(TAG, "psa_import_key failed in set_key: %d", (int)ps);
-        this->aes_key_set_ = false;
-      } else {
-        this->aes_key_set_ = true;
-      }
+      ESP_LOGCONFIG(TAG, "  CC1101: NOT initialized");
     }
-
-    ESP_LOGD(TAG, "AES key stored (first/last 4 bytes): %02X%02X%02X%02X...%02X%02X%02X%02X",
-             this->aes_key_[0], this->aes_key_[1], this->aes_key_[2], this->aes_key_[3],
-             this->aes_key_[12], this->aes_key_[13], this->aes_key_[14], this->aes_key_[15]);
+    ESP_LOGCONFIG(TAG, "  Radio state: %s", radio_state_to_string(radio.state));
+    if (this->frequency_tracking_) {
+      ESP_LOGCONFIG(TAG, "  Frequency offset: %.1f kHz (FSCTRL0 %d), %u corrections, %u estimates out of range",
+                    radio.frequency.offset_khz(), radio.frequency.applied(),
+                    (unsigned) radio.frequency.corrections(), (unsigned) radio.frequency.rejected());
+    } else {
+      ESP_LOGCONFIG(TAG, "  Frequency tracking: off");
+    }
+    if (this->radio_count_ > 1) {
+      ESP_LOGCONFIG(TAG, "  Frames accepted: %u", (unsigned) radio.accepted_frames);
+    }
+    best_radio_frames = std::max(best_radio_frames, radio.accepted_frames);
+  }
+  ESP_LOGCONFIG(TAG, "  Radio state timeouts: %u", this->radio_timeouts_);
+  ESP_LOGCONFIG(TAG, "  Receiver re-arms: %u (FIFO overflows: %u)", this->rearms_, this->fifo_overflows_);
+  ESP_LOGCONFIG(TAG, "  Frames accepted: %u", this->accepted_frames_);
+  if (this->radio_count_ > 1) {
+    // Telegrams decoded against what the better radio alone would have received
+    ESP_LOGCONFIG(TAG, "  Diversity: %u duplicates dropped, %.1f%% more telegrams than the best single radio",
+                  (unsigned) this->duplicate_frames_,
+                  best_radio_frames > 0 ? 100.0f * (this->accepted_frames_ - best_radio_frames) / best_radio_frames
+                                        : 0.0f);
+  }
+  ESP_LOGCONFIG(TAG, "  Frames for other meters (rejected after the ID): %u", this->foreign_frames_);
+  ESP_LOGCONFIG(TAG, "  Link CRC errors: %u", this->link_crc_errors_);
+  if (this->duty_cycle_) {
+    {
+      LockGuard guard(frame_lock);
+      this->account_radio_time();
+    }
+    uint64_t total_ms = this->awake_ms_ + this->asleep_ms_;
+    ESP_LOGCONFIG(TAG, "  Duty cycle: guard %u ms, continuous RX after %u missed windows", (unsigned) this->guard_ms_,
+                  this->max_missed_windows_);
+    ESP_LOGCONFIG(TAG, "    RX on %u s of %u s (%.1f%%), %u wake-ups", (unsigned) (this->awake_ms_ / 1000),
+                  (unsigned) (total_ms / 1000), total_ms > 0 ? 100.0f * this->awake_ms_ / total_ms : 100.0f,
+                  this->wakeups_);
+  }
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  if (this->receive_task_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  Receive task: core %u, priority %u, %u B stack (%u B never used)",
+                  this->receive_task_core_, this->receive_task_priority_, (unsigned) this->receive_task_stack_size_,
+                  (unsigned) uxTaskGetStackHighWaterMark(this->receive_task_));
+  }
+#endif
+  bool has_time = false;
+#ifdef USE_TIME
+  has_time = this->time_ != nullptr;
+#endif
+  ESP_LOGCONFIG(TAG, "  Analytics: flow stops after %u s still, peak flow over %u min, night %02u:00-%02u:00%s",
+                (unsigned) (this->analytics_.zero_flow_interval_ms / 1000),
+                (unsigned) (this->analytics_.peak_flow_window_ms / 60000), this->analytics_.night_start_hour,
+                this->analytics_.night_end_hour, has_time ? "" : " (no time source)");
+  ESP_LOGCONFIG(TAG, "  Reading queue: %u slots, high water %u, %u readings dropped", READING_QUEUE_SIZE,
+                (unsigned) this->readings_.high_water(), (unsigned) this->readings_.drops());
+  ESP_LOGCONFIG(TAG, "  Radio sensor publishes: %u sent, %u suppressed", this->publish_stats_.sent,
+                this->publish_stats_.suppressed);
+  if (this->radios_[0].gdo0_isr_pin != nullptr || this->radios_[1].gdo0_isr_pin != nullptr) {
+    ESP_LOGCONFIG(TAG, "  Max sync latency: %u us", this->max_sync_latency_us_);
+  }
+  if (this->capture_.enabled()) {
+    ESP_LOGCONFIG(TAG, "  Capture: %u frames in %u of %u bytes (%u overwritten)", (unsigned) this->capture_.records(),
+                  (unsigned) this->capture_.file_size(), (unsigned) this->capture_buffer_size_,
+                  (unsigned) this->capture_.overwritten());
+  }
+  // PSA's key slots come on top, one per meter
+  MemoryUsage memory = this->memory_usage();
+  ESP_LOGCONFIG(TAG, "  Memory: %u B in objects (hub %u B, %u meters of %u B), %u B heap buffers, %u B shared frame "
+                "buffers", (unsigned) memory.objects, (unsigned) sizeof(*this), (unsigned) this->meters_.size(),
+                (unsigned) sizeof(Multical21Meter), (unsigned) memory.heap, (unsigned) memory.shared);
+  ESP_LOGCONFIG(TAG, "  Stage timing:");
+  this->drain_stage_.dump_config(TAG, "    ", "drain");
+  this->dispatch_stage_.dump_config(TAG, "    ", "dispatch");
+  this->link_stage_.dump_config(TAG, "    ", "link CRC");
+  ESP_LOGCONFIG(TAG, "  Meters: %u", (unsigned) this->meters_.size());
+  for (auto *meter : this->meters_) {
+    meter->dump_config();
   }
 }
 
-// Convert hex string to bytes using direct character arithmetic
-// This is faster than strtol() as it avoids function call overhead and string allocation
-void Multical21Component::hex_to_bytes(const std::string &hex, uint8_t *bytes, size_t len) {
-  for (size_t i = 0; i < len && i * 2 + 1 < hex.length(); i++) {
-    char hi = hex[i * 2];
-    char lo = hex[i * 2 + 1];
-    // Convert ASCII hex char to value: '0'-'9' -> 0-9, 'a'-'f'/'A'-'F' -> 10-15
-    uint8_t hi_val = (hi >= 'a') ? (hi - 'a' + 10) : (hi >= 'A') ? (hi - 'A' + 10) : (hi - '0');
-    uint8_t lo_val = (lo >= 'a') ? (lo - 'a' + 10) : (lo >= 'A') ? (lo - 'A' + 10) : (lo - '0');
-    bytes[i] = (hi_val << 4) | lo_val;
+// Keep meters_ sorted by ID so frames can be dispatched with a binary search
+void Multical21Component::register_meter(Multical21Meter *meter) {
+  auto it = std::lower_bound(this->meters_.begin(), this->meters_.end(), meter->get_meter_id(),
+                             [](const Multical21Meter *m, uint32_t id) { return m->get_meter_id() < id; });
+  if (it != this->meters_.end() && (*it)->get_meter_id() == meter->get_meter_id()) {
+    ESP_LOGE(TAG, "Meter %08X registered twice, ignoring duplicate", (unsigned) meter->get_meter_id());
+    return;
+  }
+  this->meters_.insert(it, meter);
+  if (this->default_meter_ == nullptr) {
+    this->default_meter_ = meter;
   }
 }
 
-void Multical21Component::write_register(uint8_t reg, uint8_t value) {
-  this->enable();
-  delayMicroseconds(5);
-  this->transfer_byte(reg);
-  this->transfer_byte(value);
-  this->disable();
+// Register helpers. No fixed delays: once the crystal is running the CC1101
+// is ready as soon as CSn goes low, and the SPI driver's own setup time
+// exceeds the 20 ns CSn-to-SCLK minimum. After reset the chip signals
+// readiness through CHIP_RDYn, which advance_radio() polls.
+void Multical21Component::write_register(RadioChannel &radio, uint8_t reg, uint8_t value) {
+  radio.transport->select();
+  radio.transport->transfer(reg);
+  radio.transport->transfer(value);
+  radio.transport->deselect();
 }
 
-uint8_t Multical21Component::read_register(uint8_t reg) {
-  this->enable();
-  delayMicroseconds(5);
-  this->transfer_byte(reg | READ_SINGLE);
-  uint8_t value = this->transfer_byte(0x00);
-  this->disable();
+uint8_t Multical21Component::read_register(RadioChannel &radio, uint8_t reg) {
+  radio.transport->select();
+  radio.transport->transfer(reg | READ_SINGLE);
+  uint8_t value = radio.transport->transfer(0x00);
+  radio.transport->deselect();
   return value;
 }
 
-uint8_t Multical21Component::read_status_register(uint8_t reg) {
-  this->enable();
-  delayMicroseconds(5);
-  this->transfer_byte(reg | READ_BURST);
-  uint8_t value = this->transfer_byte(0x00);
-  this->disable();
+uint8_t Multical21Component::read_status_register(RadioChannel &radio, uint8_t reg) {
+  radio.transport->select();
+  radio.transport->transfer(reg | READ_BURST);
+  uint8_t value = radio.transport->transfer(0x00);
+  radio.transport->deselect();
   return value;
 }
 
 // Read multiple bytes in a single SPI transaction (burst mode)
 // More efficient than multiple read_register() calls for sequential data
-void Multical21Component::read_burst(uint8_t reg, uint8_t *buffer, uint8_t len) {
-  this->enable();
-  delayMicroseconds(5);
-  this->transfer_byte(reg | READ_BURST);
+void Multical21Component::read_burst(RadioChannel &radio, uint8_t reg, uint8_t *buffer, uint8_t len) {
+  radio.transport->select();
+  radio.transport->transfer(reg | READ_BURST);
   for (uint8_t i = 0; i < len; i++) {
-    buffer[i] = this->transfer_byte(0x00);
+    buffer[i] = radio.transport->transfer(0x00);
   }
-  delayMicroseconds(2);
-  this->disable();
+  radio.transport->deselect();
 }
 
-void Multical21Component::send_strobe(uint8_t strobe) {
-  this->enable();
-  delayMicroseconds(5);
-  this->transfer_byte(strobe);
-  delayMicroseconds(5);
-  this->disable();
+// Write consecutive registers in a single SPI transaction (burst mode)
+void Multical21Component::write_burst(RadioChannel &radio, uint8_t reg, const uint8_t *buffer, uint8_t len) {
+  radio.transport->select();
+  radio.transport->transfer(reg | WRITE_BURST);
+  for (uint8_t i = 0; i < len; i++) {
+    radio.transport->transfer(buffer[i]);
+  }
+  radio.transport->deselect();
 }
 
-bool Multical21Component::reset_cc1101() {
-  this->disable();
-  delayMicroseconds(5);
-
-  this->enable();
-  delayMicroseconds(10);
-  this->disable();
-  delayMicroseconds(45);
-
-  this->enable();
-  delayMicroseconds(5);
-
-  this->transfer_byte(CC1101_SRES);
-
-  // Wait for reset to complete
-  delay(10);
+uint8_t Multical21Component::send_strobe(RadioChannel &radio, uint8_t strobe) {
+  radio.transport->select();
+  uint8_t status = radio.transport->transfer(strobe);
+  radio.transport->deselect();
+  return status;
+}
 
-  this->disable();
+// Issue SRES and return. The chip holds CHIP_RDYn high until its crystal is
+// stable again; advance_radio() polls for that instead of sleeping 10 ms.
+void Multical21Component::reset_cc1101(RadioChannel &radio) {
+  radio.initialized = false;
+  this->send_strobe(radio, CC1101_SRES);
+  this->set_radio_state(radio, RADIO_RESET);
+}
 
-  // Verify by reading a register
-  uint8_t version = this->read_status_register(0x31);  // CC1101_VERSION
+bool Multical21Component::verify_cc1101(RadioChannel &radio) {
+  uint8_t version = this->read_status_register(radio, CC1101_VERSION);
   ESP_LOGD(TAG, "CC1101 Version: 0x%02X", version);
-
   return (version == 0x14 || version == 0x04 || version == 0x03);
 }
 
-void Multical21Component::init_cc1101_registers() {
-  // Configure CC1101 for wM-Bus Mode C1 (868.95 MHz, ~100 kbps)
-  this->write_register(CC1101_IOCFG2, 0x2E);   // GDO2 - High impedance
-  this->write_register(CC1101_IOCFG0, 0x06);   // GDO0 - Asserts when sync word has been sent/received
-  this->write_register(CC1101_FIFOTHR, 0x00);  // RX FIFO threshold
-  this->write_register(CC1101_PKTLEN, 0x30);   // Packet length (48 bytes)
-  this->write_register(CC1101_PKTCTRL1, 0x00);
-  this->write_register(CC1101_PKTCTRL0, 0x02);  // Infinite packet length mode
-  this->write_register(CC1101_SYNC1, 0x54);    // Sync word high byte
-  this->write_register(CC1101_SYNC0, 0x3D);    // Sync word low byte
-  this->write_register(CC1101_ADDR, 0x00);
-  this->write_register(CC1101_CHANNR, 0x00);
-
-  // Frequency settings for 868.95 MHz
-  this->write_register(CC1101_FSCTRL1, 0x08);
-  this->write_register(CC1101_FSCTRL0, 0x00);
-  this->write_register(CC1101_FREQ2, 0x21);
-  this->write_register(CC1101_FREQ1, 0x6B);
-  this->write_register(CC1101_FREQ0, 0xD0);
-
-  // Modem configuration (~103 kbps, 2-GFSK)
-  this->write_register(CC1101_MDMCFG4, 0x5C);
-  this->write_register(CC1101_MDMCFG3, 0x04);
-  this->write_register(CC1101_MDMCFG2, 0x06);
-  this->write_register(CC1101_MDMCFG1, 0x22);
-  this->write_register(CC1101_MDMCFG0, 0xF8);
-  this->write_register(CC1101_DEVIATN, 0x44);
-
-  // Main radio control state machine
-  this->write_register(CC1101_MCSM1, 0x00);
-  this->write_register(CC1101_MCSM0, 0x18);
-
-  // Frequency offset compensation
-  this->write_register(CC1101_FOCCFG, 0x2E);
-  this->write_register(CC1101_BSCFG, 0xBF);
-
-  // AGC control
-  this->write_register(CC1101_AGCCTRL2, 0x43);
-  this->write_register(CC1101_AGCCTRL1, 0x09);
-  this->write_register(CC1101_AGCCTRL0, 0xB5);
-
-  // Front end configuration
-  this->write_register(CC1101_FREND1, 0xB6);
-  this->write_register(CC1101_FREND0, 0x10);
-
-  // Frequency synthesizer calibration
-  this->write_register(CC1101_FSCAL3, 0xEA);
-  this->write_register(CC1101_FSCAL2, 0x2A);
-  this->write_register(CC1101_FSCAL1, 0x00);
-  this->write_register(CC1101_FSCAL0, 0x1F);
-
-  // Test registers
-  this->write_register(CC1101_FSTEST, 0x59);
-  this->write_register(CC1101_TEST2, 0x81);
-  this->write_register(CC1101_TEST1, 0x35);
-  this->write_register(CC1101_TEST0, 0x09);
-
+void Multical21Component::init_cc1101_registers(RadioChannel &radio) {
+  this->write_config(radio);
   ESP_LOGD(TAG, "CC1101 registers initialized");
 }
 
-// Reset CC1101 to receive mode
-// Uses 100µs polling intervals (vs 1ms) for faster state transitions while
-// maintaining same 5ms max timeout. State changes typically complete in <500µs.
-void Multical21Component::start_receiver() {
-  // Enter IDLE state
-  this->send_strobe(CC1101_SIDLE);
+// The profile's configuration burst, with FSCTRL0 set to the radio's tracked
+// frequency offset
+void Multical21Component::write_config(RadioChannel &radio) {
+  const uint8_t *table = this->radio_profile_ == RADIO_PROFILE_T1 ? CC1101_CONFIG_T1 : CC1101_CONFIG_C1;
+  uint8_t config[CC1101_CONFIG_REGISTERS];
+#ifdef USE_ESP8266
+  for (uint8_t i = 0; i < CC1101_CONFIG_REGISTERS; i++) {
+    config[i] = progmem_read_byte(&table[i]);
+  }
+#else
+  memcpy(config, table, sizeof(config));
+#endif
+  config[CC1101_FSCTRL0] = (uint8_t) radio.frequency.applied();
+  this->write_burst(radio, CC1101_IOCFG2, config, CC1101_CONFIG_REGISTERS);
+}
+
+// Move the synthesizer to the new offset: FSCTRL0 only takes effect with a
+// calibration, which SRX does on the way back from IDLE (MCSM0.FS_AUTOCAL)
+void Multical21Component::retune(RadioChannel &radio) {
+  radio.retune_pending = false;
+  ESP_LOGI(TAG, "Radio %u frequency offset %.1f kHz, FSCTRL0 now %d", radio.number, radio.frequency.offset_khz(),
+           radio.frequency.applied());
+  this->write_register(radio, CC1101_FSCTRL0, (uint8_t) radio.frequency.applied());
+  radio.frequency_unsaved = true;
+  this->abort_packet(radio);
+}
 
-  // Wait for IDLE (typically <500µs)
-  for (int i = 0; i < 50; i++) {
-    if ((this->read_status_register(CC1101_MARCSTATE) & 0x1F) == MARCSTATE_IDLE) {
-      break;
+// Read the RX FIFO byte count. Per CC1101 errata the register can be read
+// while it is being updated, so read until two consecutive values agree.
+uint8_t Multical21Component::read_rx_bytes(RadioChannel &radio) {
+  uint8_t last = this->read_status_register(radio, CC1101_RXBYTES);
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t value = this->read_status_register(radio, CC1101_RXBYTES);
+    if (value == last) {
+      return value;
     }
-    delayMicroseconds(100);
+    last = value;
   }
+  return last;
+}
 
-  // Flush RX FIFO
-  this->send_strobe(CC1101_SFRX);
+// Drain `len` bytes from the RX FIFO as they arrive over the air.
+// Reads in chunks of whatever RXBYTES reports, leaving one byte behind while
+// more are still expected (CC1101 errata: never empty the FIFO mid-packet).
+// Bytes spilled while another radio's frame was drained are taken first, and
+// while waiting for bytes the other radios' FIFOs are spilled in turn.
+// With `link_crc`, each chunk is CRC-checked while the next one is on the air,
+// and the drain stops at the first block that fails. The check strips CRCs in
+// place, so a capture copies the chunk first.
+// With `decoder` (T1, together with `link_crc`), `len` counts encoded FIFO
+// bytes: each chunk is read into a FIFO-sized buffer and decoded to `buffer`
+// onward before the CRC check. The decoder is finished when `len` is reached,
+// so that must be the frame's end or a whole number of triples. An invalid
+// symbol stops the drain like a failed block.
+bool Multical21Component::drain_fifo(RadioChannel &radio, uint8_t *buffer, uint16_t len, uint32_t deadline_us,
+                                     LinkCrcStream *link_crc, ThreeOfSixStream *decoder) {
+  uint8_t encoded[CC1101_FIFO_SIZE];
+  FifoSpill &spill = radio.spill;
+  uint16_t received = 0;
+  while (received < len) {
+    uint8_t *raw = decoder != nullptr ? encoded : buffer;
+    uint16_t remaining = len - received;
+    uint8_t chunk;
+    if (spill.read < spill.length) {
+      chunk = (uint8_t) std::min<uint16_t>(std::min<uint16_t>(remaining, spill.length - spill.read),
+                                           CC1101_FIFO_SIZE);
+      memcpy(raw, &spill.bytes[spill.read], chunk);
+      spill.read += chunk;
+    } else {
+      uint8_t rx_bytes = this->read_rx_bytes(radio);
+      if (rx_bytes & RXBYTES_OVERFLOW) {
+        ESP_LOGW(TAG, "RX FIFO overflow after %d of %d bytes", received, len);
+        this->fifo_overflows_++;
+        return false;
+      }
+      uint8_t available = rx_bytes & RXBYTES_COUNT_MASK;
+      this->update_length_mode(radio, available);
+      chunk = (available >= remaining) ? (uint8_t) remaining : (available > 1 ? available - 1 : 0);
+      if (chunk > 0) {
+        this->read_burst(radio, CC1101_RXFIFO, raw, chunk);
+        radio.packet_read += chunk;
+      }
+    }
 
-  // Enter RX state
-  this->send_strobe(CC1101_SRX);
+    if (chunk > 0) {
+      received += chunk;
+      if (link_crc == nullptr) {
+        buffer += chunk;
+        continue;
+      }
+      this->capture_.append(raw, chunk);
+      uint32_t link_start = stage_clock();
+      size_t data = chunk;
+      if (decoder != nullptr) {
+        data = decoder->feed(raw, chunk, buffer);
+        if (received == len) {
+          data += decoder->finish(buffer + data);
+        }
+      }
+      link_crc->feed(data);
+      buffer += data;
+      this->link_cycles_ += stage_clock() - link_start;
+      if (!link_crc->ok() || (decoder != nullptr && !decoder->ok())) {
+        return false;
+      }
+      continue;
+    }
 
-  // Wait for RX (typically <500µs)
-  for (int i = 0; i < 50; i++) {
-    if ((this->read_status_register(CC1101_MARCSTATE) & 0x1F) == MARCSTATE_RX) {
-      break;
+    for (uint8_t i = 0; i < this->radio_count_; i++) {
+      if (&this->radios_[i] != &radio) {
+        this->spill_fifo(this->radios_[i]);
+      }
+    }
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+    // The receive task outranks the tasks sharing its core: block while the
+    // next bytes arrive rather than spin. A tick of 1 ms is 13 bytes on air.
+    if (portTICK_PERIOD_MS <= 1 && xTaskGetCurrentTaskHandle() == this->receive_task_) {
+      vTaskDelay(1);
+    }
+#endif
+    if ((int32_t) (micros() - deadline_us) > 0) {
+      ESP_LOGW(TAG, "RX timeout after %d of %d bytes", received, len);
+      return false;
     }
-    delayMicroseconds(100);
   }
+  return true;
 }
 
-bool Multical21Component::receive_frame() {
-  // Read preamble (should be 0x54 0x3D)
-  uint8_t preamble[2];
-  preamble[0] = this->read_register(CC1101_RXFIFO);
-  preamble[1] = this->read_register(CC1101_RXFIFO);
-
-  if (preamble[0] != WMBUS_PREAMBLE_1 || preamble[1] != WMBUS_PREAMBLE_2) {
-    this->start_receiver();
-    return false;
+// Pull what a radio has received so far into its spill buffer, while another
+// radio's frame is being drained. Same one-byte rule as drain_fifo() until the
+// frame's length is known; the header is checked as soon as it is in, and the
+// radio switched to fixed length as receive_frame() would.
+void Multical21Component::spill_fifo(RadioChannel &radio) {
+  FifoSpill &spill = radio.spill;
+  if (radio.state != RADIO_RX || spill.stopped || (spill.expected > 0 && spill.length >= spill.expected)) {
+    return;
   }
-
-  // Read payload length
-  uint8_t length = this->read_register(CC1101_RXFIFO);
-  if (length < 18 || length >= MAX_FRAME_LENGTH) {
-    ESP_LOGW(TAG, "Invalid frame length: %d", length);
-    this->start_receiver();
-    return false;
+  uint8_t rx_bytes = this->read_rx_bytes(radio);
+  if (rx_bytes & RXBYTES_OVERFLOW) {
+    spill.stopped = true;  // Reported by receive_frame() once the spilled bytes are used up
+    return;
   }
-
-  // Read payload using burst mode (single SPI transaction vs per-byte reads)
-  // This reduces SPI overhead from O(n) transactions to O(1)
-  this->read_burst(CC1101_RXFIFO, this->frame_buffer_, length);
-  this->start_receiver();
-
-  // Process only if meter ID matches
-  if (!this->check_meter_id(this->frame_buffer_)) {
-    return false;
+  uint8_t available = rx_bytes & RXBYTES_COUNT_MASK;
+  this->update_length_mode(radio, available);
+  uint16_t remaining = spill.expected > 0 ? spill.expected - spill.length : SPILL_BUFFER_SIZE - spill.length;
+  uint8_t chunk = (spill.expected > 0 && available >= remaining) ? (uint8_t) remaining
+                                                                   : (available > 1 ? available - 1 : 0);
+  chunk = (uint8_t) std::min<uint16_t>(chunk, SPILL_BUFFER_SIZE - spill.length);
+  if (chunk == 0) {
+    return;
   }
-
-  this->frames_received_++;
-  return this->decrypt_frame(this->frame_buffer_, length);
-}
-
-bool Multical21Component::check_meter_id(const uint8_t *payload) {
-  // Meter ID is at bytes 3-6 in reverse order (little endian)
-  // payload[6] = meter_id[0], payload[5] = meter_id[1], etc.
-  for (uint8_t i = 0; i < 4; i++) {
-    if (this->meter_id_[i] != payload[6 - i]) {
-      return false;
+  if (spill.length == 0) {
+    spill.sync_us = micros();
+  }
+  this->read_burst(radio, CC1101_RXFIFO, &spill.bytes[spill.length], chunk);
+  spill.length += chunk;
+  radio.packet_read += chunk;
+
+  if (spill.expected == 0 && spill.length >= FRAME_HEADER_BYTES) {
+    uint8_t frame[2];
+    LinkFrameFormat format;
+    uint16_t fifo_bytes = this->decode_header(spill.bytes.data(), frame, &format)
+                              ? this->fifo_frame_bytes(format, frame[0])
+                              : 0;
+    if (fifo_bytes == 0) {
+      spill.stopped = true;
+      return;
     }
+    this->set_packet_length(radio, FRAME_HEADER_BYTES + fifo_bytes);
+    spill.expected = FRAME_HEADER_BYTES + fifo_bytes + PACKET_STATUS_BYTES;
   }
-  return true;
 }
 
-// Decrypt wM-Bus Mode C1 encrypted payload
-// Frame structure: [header 16 bytes][encrypted data][CRC 2 bytes]
-bool Multical21Component::decrypt_frame(const uint8_t *payload, uint8_t length) {
-  if (length < 18) {
-    ESP_LOGW(TAG, "Frame too short for decryption: %d bytes", length);
-    this->decrypt_errors_++;
-    return false;
-  }
+// Frame length known: PKTLEN takes it modulo 256 now, but the radio stays in
+// infinite length mode until fewer than 256 bytes are left to receive (CC1101
+// datasheet §15.3). Fixed length mode any earlier would end a longer frame
+// the first time the packet byte counter wrapped around to PKTLEN.
+void Multical21Component::set_packet_length(RadioChannel &radio, uint16_t packet_bytes) {
+  this->write_register(radio, CC1101_PKTLEN, (uint8_t) (packet_bytes & 0xFF));
+  radio.packet_length = packet_bytes;
+  this->update_length_mode(radio, 0);
+}
 
-  // Cipher length = total - 16 byte header - 2 byte CRC
-  uint8_t cipher_length = length - 18;
-  if (cipher_length == 0 || cipher_length > MAX_FRAME_LENGTH - 16) {
-    ESP_LOGW(TAG, "Invalid cipher length: %d (frame length: %d)", cipher_length, length);
-    this->decrypt_errors_++;
-    return false;
+// Called with the FIFO byte count each time it is read while a packet comes
+// in. The radio has received at least what was read out plus what waits in
+// the FIFO; once that is within 256 bytes of the end, the next time the
+// counter matches PKTLEN is the end of the frame.
+void Multical21Component::update_length_mode(RadioChannel &radio, uint8_t available) {
+  if (radio.packet_length == 0 ||
+      radio.packet_read + available + CC1101_PACKET_COUNTER_RANGE <= radio.packet_length) {
+    return;
   }
+  this->write_register(radio, CC1101_PKTCTRL0, PKTCTRL0_FIXED_LENGTH);
+  radio.packet_length = 0;
+}
 
-  // Build wM-Bus IV per EN 13757-4:
-  // IV[0-7]  = M-field + A-field (payload bytes 1-8)
-  // IV[8]    = ACC (payload byte 10)
-  // IV[9-12] = SN (payload bytes 12-15)
-  // IV[13-15] = 0x00 padding
-  uint8_t iv[16];
-  memcpy(iv, &payload[1], 8);
-  iv[8] = payload[10];
-  memcpy(&iv[9], &payload[12], 4);
-  memset(&iv[13], 0, 3);
+// Full re-arm after a fault: an overflow, a timeout or a malformed frame
+// while the radio is still in infinite length mode
+void Multical21Component::start_receiver(RadioChannel &radio) {
+  this->rearms_++;
+  this->abort_packet(radio);
+}
 
-  this->aes_ctr_decrypt(&payload[16], this->plaintext_, cipher_length, iv);
-  this->parse_meter_data(this->plaintext_, cipher_length);
+// Abort the packet in progress, flush the FIFO and re-enter RX. Only SIDLE is
+// sent here; the flush and SRX follow from advance_radio() once the chip
+// reports IDLE, so frame processing overlaps the radio turnaround.
+void Multical21Component::abort_packet(RadioChannel &radio) {
+  this->send_strobe(radio, CC1101_SIDLE);
+  this->set_radio_state(radio, RADIO_IDLE_WAIT);
+}
 
-  return true;
+// A fixed-length packet has been read completely. With MCSM1 RXOFF_MODE = RX
+// the radio is already listening again with an empty FIFO; only the length
+// mode needs restoring for the next sync. A sync that arrives before this
+// write is still handled: receive_frame() rewrites PKTLEN from its L-field.
+void Multical21Component::resume_rx(RadioChannel &radio) {
+  this->write_register(radio, CC1101_PKTCTRL0, PKTCTRL0_INFINITE_LENGTH);
 }
 
-// AES-128 CTR mode decryption using PSA
-// CTR mode: encrypt counter block, XOR with ciphertext to get plaintext
-void Multical21Component::aes_ctr_decrypt(const uint8_t *cipher, uint8_t *plain, uint8_t length, const uint8_t *iv) {
-  if (!this->aes_key_set_ || this->aes_key_handle_ == 0) {
-    ESP_LOGW(TAG, "AES key not set, cannot decrypt");
-    this->decrypt_errors_++;
+// Catch a receiver that stopped listening without a GDO0 edge to report it,
+// e.g. a FIFO overflow after a false sync that was never serviced
+void Multical21Component::check_rx_health(RadioChannel &radio) {
+  uint32_t now = millis();
+  if (now - radio.last_health_check_ms < RX_HEALTH_CHECK_INTERVAL_MS) {
     return;
   }
-
-  psa_status_t ps;
-  psa_cipher_operation_t operation = PSA_CIPHER_OPERATION_INIT;
-
-  ps = psa_cipher_decrypt_setup(&operation, this->aes_key_handle_, PSA_ALG_CTR);
-  if (ps != PSA_SUCCESS) {
-    ESP_LOGE(TAG, "psa_cipher_decrypt_setup failed: %d", (int)ps);
-    this->decrypt_errors_++;
-    return;
+  radio.last_health_check_ms = now;
+
+  uint8_t state = this->send_strobe(radio, CC1101_SNOP) & STATUS_STATE_MASK;
+  if (state == STATUS_STATE_RXFIFO_OVERFLOW) {
+    ESP_LOGW(TAG, "RX FIFO overflow outside a frame, re-arming");
+    this->fifo_overflows_++;
+    this->start_receiver(radio);
+  } else if (state == STATUS_STATE_IDLE) {
+    ESP_LOGW(TAG, "Receiver left RX unexpectedly, re-arming");
+    this->start_receiver(radio);
   }
+}
 
-  ps = psa_cipher_set_iv(&operation, iv, 16);
-  if (ps != PSA_SUCCESS) {
-    ESP_LOGE(TAG, "psa_cipher_set_iv failed: %d", (int)ps);
-    this->decrypt_errors_++;
-    psa_cipher_abort(&operation);
+// Between frames: apply a new frequency offset, power down until the next
+// predicted window when duty cycling, or make sure the receiver still listens
+void Multical21Component::idle_rx(RadioChannel &radio) {
+  if (radio.retune_pending) {
+    this->retune(radio);
     return;
   }
-
-  size_t out_len = 0;
-  const uint8_t *src = cipher;
-  uint8_t *dst = plain;
-  size_t remaining = (size_t)length;
-
-  while (remaining > 0) {
-    size_t chunk = remaining;  // PSA streaming update can handle arbitrary chunk sizes
-    ps = psa_cipher_update(&operation, src, chunk, dst, remaining, &out_len);
-    if (ps != PSA_SUCCESS) {
-      ESP_LOGE(TAG, "psa_cipher_update failed: %d", (int)ps);
-      this->decrypt_errors_++;
-      psa_cipher_abort(&operation);
+  if (this->duty_cycle_) {
+    uint32_t now = millis();
+    uint32_t sleep_ms = this->poll_schedules(now);
+    if (sleep_ms >= DUTY_CYCLE_MIN_SLEEP_MS + DUTY_CYCLE_WAKE_LEAD_MS) {
+      radio.wake_at_ms = now + sleep_ms - DUTY_CYCLE_WAKE_LEAD_MS;
+      this->send_strobe(radio, CC1101_SIDLE);
+      this->set_radio_state(radio, RADIO_SLEEP_WAIT);
       return;
     }
-    src += out_len;
-    dst += out_len;
-    remaining -= out_len;
   }
+  this->check_rx_health(radio);
+}
 
-  // Finish (may output additional data for some algorithms)
-  size_t finish_len = 0;
-  ps = psa_cipher_finish(&operation, dst, 0, &finish_len);
-  if (ps != PSA_SUCCESS) {
-    ESP_LOGE(TAG, "psa_cipher_finish failed: %d", (int)ps);
-    this->decrypt_errors_++;
-    psa_cipher_abort(&operation);
-    return;
+// Close the windows that passed without a telegram and return how long the
+// radio may sleep: until the first meter's next window, or 0 while any
+// meter's schedule is still being learnt
+uint32_t Multical21Component::poll_schedules(uint32_t now_ms) {
+  uint32_t sleep_ms = UINT32_MAX;
+  for (auto *meter : this->meters_) {
+    TransmitSchedule &schedule = meter->get_schedule();
+    if (schedule.poll(now_ms) && this->duty_cycle_) {
+      ESP_LOGW(TAG, "Meter %08X missed %u windows in a row, continuous RX until its schedule is learnt again",
+               (unsigned) meter->get_meter_id(), this->max_missed_windows_);
+    }
+    sleep_ms = std::min(sleep_ms, schedule.locked() ? schedule.until_window(now_ms) : 0);
   }
+  return sleep_ms;
 }
 
-// CRC16 EN13757 lookup table for wM-Bus frames
-// Polynomial: 0x3D65 (EN 13757-4), pre-computed for byte-at-a-time processing
-// Using a lookup table is ~8x faster than bit-by-bit calculation
-static const uint16_t CRC16_TABLE[256] = {
-    0x0000, 0x3D65, 0x7ACA, 0x47AF, 0xF594, 0xC8F1, 0x8F5E, 0xB23B,
-    0xD64D, 0xEB28, 0xAC87, 0x91E2, 0x23D9, 0x1EBC, 0x5913, 0x6476,
-    0x91FF, 0xAC9A, 0xEB35, 0xD650, 0x646B, 0x590E, 0x1EA1, 0x23C4,
-    0x47B2, 0x7AD7, 0x3D78, 0x001D, 0xB226, 0x8F43, 0xC8EC, 0xF589,
-    0x1E9B, 0x23FE, 0x6451, 0x5934, 0xEB0F, 0xD66A, 0x91C5, 0xACA0,
-    0xC8D6, 0xF5B3, 0xB21C, 0x8F79, 0x3D42, 0x0027, 0x4788, 0x7AED,
-    0x8F64, 0xB201, 0xF5AE, 0xC8CB, 0x7AF0, 0x4795, 0x003A, 0x3D5F,
-    0x5929, 0x644C, 0x23E3, 0x1E86, 0xACBD, 0x91D8, 0xD677, 0xEB12,
-    0x3D36, 0x0053, 0x47FC, 0x7A99, 0xC8A2, 0xF5C7, 0xB268, 0x8F0D,
-    0xEB7B, 0xD61E, 0x91B1, 0xACD4, 0x1EEF, 0x238A, 0x6425, 0x5940,
-    0xACC9, 0x91AC, 0xD603, 0xEB66, 0x595D, 0x6438, 0x2397, 0x1EF2,
-    0x7A84, 0x47E1, 0x004E, 0x3D2B, 0x8F10, 0xB275, 0xF5DA, 0xC8BF,
-    0x23AD, 0x1EC8, 0x5967, 0x6402, 0xD639, 0xEB5C, 0xACF3, 0x9196,
-    0xF5E0, 0xC885, 0x8F2A, 0xB24F, 0x0074, 0x3D11, 0x7ABE, 0x47DB,
-    0xB252, 0x8F37, 0xC898, 0xF5FD, 0x47C6, 0x7AA3, 0x3D0C, 0x0069,
-    0x641F, 0x597A, 0x1ED5, 0x23B0, 0x918B, 0xACEE, 0xEB41, 0xD624,
-    0x7A6C, 0x4709, 0x00A6, 0x3DC3, 0x8FF8, 0xB29D, 0xF532, 0xC857,
-    0xAC21, 0x9144, 0xD6EB, 0xEB8E, 0x59B5, 0x64D0, 0x237F, 0x1E1A,
-    0xEB93, 0xD6F6, 0x9159, 0xAC3C, 0x1E07, 0x2362, 0x64CD, 0x59A8,
-    0x3DDE, 0x00BB, 0x4714, 0x7A71, 0xC84A, 0xF52F, 0xB280, 0x8FE5,
-    0x64F7, 0x5992, 0x1E3D, 0x2358, 0x9163, 0xAC06, 0xEBA9, 0xD6CC,
-    0xB2BA, 0x8FDF, 0xC870, 0xF515, 0x472E, 0x7A4B, 0x3DE4, 0x0081,
-    0xF508, 0xC86D, 0x8FC2, 0xB2A7, 0x009C, 0x3DF9, 0x7A56, 0x4733,
-    0x2345, 0x1E20, 0x598F, 0x64EA, 0xD6D1, 0xEBB4, 0xAC1B, 0x917E,
-    0x475A, 0x7A3F, 0x3D90, 0x00F5, 0xB2CE, 0x8FAB, 0xC804, 0xF561,
-    0x9117, 0xAC72, 0xEBDD, 0xD6B8, 0x6483, 0x59E6, 0x1E49, 0x232C,
-    0xD6A5, 0xEBC0, 0xAC6F, 0x910A, 0x2331, 0x1E54, 0x59FB, 0x649E,
-    0x00E8, 0x3D8D, 0x7A22, 0x4747, 0xF57C, 0xC819, 0x8FB6, 0xB2D3,
-    0x59C1, 0x64A4, 0x230B, 0x1E6E, 0xAC55, 0x9130, 0xD69F, 0xEBFA,
-    0x8F8C, 0xB2E9, 0xF546, 0xC823, 0x7A18, 0x477D, 0x00D2, 0x3DB7,
-    0xC83E, 0xF55B, 0xB2F4, 0x8F91, 0x3DAA, 0x00CF, 0x4760, 0x7A05,
-    0x1E73, 0x2316, 0x64B9, 0x59DC, 0xEBE7, 0xD682, 0x912D, 0xAC48
-};
+// Add the time since the last call to the radio's awake or asleep total. Both
+// radios follow the same schedule, so the first one stands for the hub.
+void Multical21Component::account_radio_time() {
+  uint32_t now = millis();
+  (this->radios_[0].state == RADIO_SLEEP ? this->asleep_ms_ : this->awake_ms_) += now - this->radio_time_ms_;
+  this->radio_time_ms_ = now;
+}
 
-// Calculate CRC16 using table lookup (one table access per byte)
-uint16_t Multical21Component::crc16_en13757(const uint8_t *data, size_t length) {
-  uint16_t crc = 0x0000;
-  for (size_t i = 0; i < length; i++) {
-    crc = (crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ data[i]) & 0xFF];
-  }
-  return ~crc;  // Final XOR with 0xFFFF per EN 13757
+void Multical21Component::enter_rx(RadioChannel &radio) {
+  // Flush RX FIFO and return to infinite length mode for the next sync
+  this->send_strobe(radio, CC1101_SFRX);
+  this->write_register(radio, CC1101_PKTCTRL0, PKTCTRL0_INFINITE_LENGTH);
+  radio.spill.clear();
+  radio.packet_read = 0;
+  radio.packet_length = 0;
+
+  // GDO0 toggles while re-arming; drop edges that are not a real sync
+  radio.packet_available = false;
+  this->send_strobe(radio, CC1101_SRX);
+  this->set_radio_state(radio, RADIO_RX_WAIT);
 }
 
-void Multical21Component::parse_meter_data(const uint8_t *data, uint8_t length) {
-  if (length < 3) {
-    this->parse_errors_++;
-    return;
+void Multical21Component::set_radio_state(RadioChannel &radio, RadioState state) {
+  if (&radio == &this->radios_[0]) {
+    this->account_radio_time();
   }
+  radio.state = state;
+  radio.state_since_us = micros();
+}
 
-  // Determine frame type and field positions
-  uint8_t pos_total, pos_target, pos_flow_temp, pos_ambient_temp, min_length;
-
-  if (data[2] == COMPACT_FRAME_TYPE) {
-    pos_total = COMPACT_POS_TOTAL;
-    pos_target = COMPACT_POS_TARGET;
-    pos_flow_temp = COMPACT_POS_FLOW_TEMP;
-    pos_ambient_temp = COMPACT_POS_AMBIENT_TEMP;
-    min_length = COMPACT_MIN_LENGTH;
-  } else if (data[2] == LONG_FRAME_TYPE) {
-    pos_total = LONG_POS_TOTAL;
-    pos_target = LONG_POS_TARGET;
-    pos_flow_temp = LONG_POS_FLOW_TEMP;
-    pos_ambient_temp = LONG_POS_AMBIENT_TEMP;
-    min_length = LONG_MIN_LENGTH;
-  } else {
-    ESP_LOGW(TAG, "Unknown frame type: 0x%02X", data[2]);
-    this->parse_errors_++;
-    return;
+// A radio that does not respond. The hub carries on while another one works;
+// with none left, loop() marks it failed, as this may run on the receive task.
+void Multical21Component::fail_radio(RadioChannel &radio) {
+  this->set_radio_state(radio, RADIO_FAILED);
+  for (uint8_t i = 0; i < this->radio_count_; i++) {
+    if (this->radios_[i].state != RADIO_FAILED) {
+      return;
+    }
   }
+  this->radios_failed_ = true;
+}
 
-  // Validate frame length for the detected type
-  if (length < min_length) {
-    ESP_LOGW(TAG, "Frame too short for type 0x%02X: got %d, need %d", data[2], length, min_length);
-    this->parse_errors_++;
-    return;
-  }
+// One non-blocking step of radio bring-up or re-arm. Each step reads the chip
+// status byte with a single SNOP strobe and either moves on or returns.
+void Multical21Component::advance_radio(RadioChannel &radio) {
+  uint32_t elapsed_us = micros() - radio.state_since_us;
+
+  switch (radio.state) {
+    case RADIO_RESET: {
+      if (this->send_strobe(radio, CC1101_SNOP) & STATUS_CHIP_RDYN) {
+        if (elapsed_us > RADIO_RESET_TIMEOUT_US) {
+          ESP_LOGE(TAG, "CC1101 (radio %u) not ready after reset!", radio.number);
+          this->fail_radio(radio);
+        }
+        return;
+      }
+      if (!this->verify_cc1101(radio)) {
+        ESP_LOGE(TAG, "Failed to reset CC1101 (radio %u)!", radio.number);
+        this->fail_radio(radio);
+        return;
+      }
+      ESP_LOGI(TAG, "CC1101 reset successful");
+      this->init_cc1101_registers(radio);
+      this->send_strobe(radio, CC1101_SCAL);
+      this->set_radio_state(radio, RADIO_CALIBRATING);
+      return;
+    }
 
-  // Verify CRC
-  uint16_t calc_crc = this->crc16_en13757(data + 2, length - 2);
-  uint16_t read_crc = (data[1] << 8) | data[0];
+    case RADIO_CALIBRATING:
+    case RADIO_IDLE_WAIT: {
+      uint8_t state = this->send_strobe(radio, CC1101_SNOP) & STATUS_STATE_MASK;
+      if (state == STATUS_STATE_IDLE || state == STATUS_STATE_RXFIFO_OVERFLOW) {
+        this->enter_rx(radio);
+      } else if (elapsed_us > RADIO_STATE_TIMEOUT_US) {
+        ESP_LOGW(TAG, "CC1101 did not reach IDLE (status 0x%02X), retrying", state);
+        this->radio_timeouts_++;
+        this->start_receiver(radio);
+      }
+      return;
+    }
 
-  if (calc_crc != read_crc) {
-    ESP_LOGW(TAG, "CRC mismatch: expected 0x%04X, got 0x%04X", calc_crc, read_crc);
-    this->crc_errors_++;
-    return;
-  }
+    case RADIO_RX_WAIT: {
+      uint8_t state = this->send_strobe(radio, CC1101_SNOP) & STATUS_STATE_MASK;
+      if (state == STATUS_STATE_RX) {
+        this->set_radio_state(radio, RADIO_RX);
+        if (!radio.initialized) {
+          radio.initialized = true;
+          if (this->radio_count_ > 1) {
+            ESP_LOGI(TAG, "Radio %u listening", radio.number);
+          } else {
+            ESP_LOGI(TAG, "Multical21 setup complete");
+          }
+        }
+      } else if (elapsed_us > RADIO_STATE_TIMEOUT_US) {
+        ESP_LOGW(TAG, "CC1101 did not enter RX (status 0x%02X), retrying", state);
+        this->radio_timeouts_++;
+        this->start_receiver(radio);
+      }
+      return;
+    }
+
+    case RADIO_SLEEP_WAIT: {
+      uint8_t state = this->send_strobe(radio, CC1101_SNOP) & STATUS_STATE_MASK;
+      if (state == STATUS_STATE_IDLE) {
+        // The chip powers down when CSn goes high after the strobe
+        this->send_strobe(radio, CC1101_SPWD);
+        this->set_radio_state(radio, RADIO_SLEEP);
+      } else if (elapsed_us > RADIO_STATE_TIMEOUT_US) {
+        ESP_LOGW(TAG, "CC1101 did not reach IDLE to power down (status 0x%02X), retrying", state);
+        this->radio_timeouts_++;
+        this->start_receiver(radio);
+      }
+      return;
+    }
 
-  // Parse values (little endian)
-  uint32_t total_raw = data[pos_total] | (data[pos_total + 1] << 8) | (data[pos_total + 2] << 16) |
-                       (data[pos_total + 3] << 24);
-  uint32_t target_raw = data[pos_target] | (data[pos_target + 1] << 8) | (data[pos_target + 2] << 16) |
-                        (data[pos_target + 3] << 24);
+    case RADIO_SLEEP: {
+      // Any SPI access wakes the chip, so nothing is sent before it is due
+      if ((int32_t) (millis() - radio.wake_at_ms) < 0) {
+        return;
+      }
+      this->send_strobe(radio, CC1101_SNOP);
+      this->set_radio_state(radio, RADIO_WAKING);
+      return;
+    }
+
+    case RADIO_WAKING: {
+      if (this->send_strobe(radio, CC1101_SNOP) & STATUS_CHIP_RDYN) {
+        if (elapsed_us > RADIO_RESET_TIMEOUT_US) {
+          ESP_LOGW(TAG, "CC1101 did not wake up, resetting");
+          this->radio_timeouts_++;
+          this->reset_cc1101(radio);
+        }
+        return;
+      }
+      // The test registers are not retained in SLEEP: rewrite the whole
+      // configuration, then SRX calibrates on the way to RX (MCSM0.FS_AUTOCAL)
+      this->write_config(radio);
+      this->wakeups_++;
+      this->enter_rx(radio);
+      return;
+    }
 
-  float total_m3 = total_raw / 1000.0f;
-  float target_m3 = target_raw / 1000.0f;
-  uint8_t flow_temp = data[pos_flow_temp];
-  uint8_t ambient_temp = data[pos_ambient_temp];
+    default:
+      return;
+  }
+}
 
-  this->reading_count_++;
-  ESP_LOGI(TAG, "Reading #%u - Total: %.3f m3, Month start: %.3f m3, Water temp: %d C, Ambient temp: %d C",
-           this->reading_count_, total_m3, target_m3, flow_temp, ambient_temp);
+// Check the FRAME_HEADER_BYTES that start a frame and decode them into
+// `frame`: C1 sends 0x54, 0xCD (format A) or 0x3D (format B) and the L-field;
+// T1 sends one triple holding the L- and C-field, always format A
+bool Multical21Component::decode_header(const uint8_t *header, uint8_t *frame, LinkFrameFormat *format) const {
+  if (this->radio_profile_ == RADIO_PROFILE_T1) {
+    *format = FRAME_FORMAT_A;
+    return three_of_six_decode(header, 1, frame);
+  }
+  if (header[0] != WMBUS_PREAMBLE_1 || (header[1] != WMBUS_FORMAT_A_SYNC && header[1] != WMBUS_FORMAT_B_SYNC)) {
+    return false;
+  }
+  *format = header[1] == WMBUS_FORMAT_A_SYNC ? FRAME_FORMAT_A : FRAME_FORMAT_B;
+  frame[0] = header[2];
+  return true;
+}
 
-  // Store values
-  this->last_total_ = total_m3;
-  this->last_month_start_ = target_m3;
-  this->last_water_temp_ = flow_temp;
-  this->last_ambient_temp_ = ambient_temp;
+// FIFO bytes of a frame after its header, or 0 for an L-field too short to be
+// a Multical 21 telegram. T1 sends L-field and frame as 3-of-6 symbols.
+uint16_t Multical21Component::fifo_frame_bytes(LinkFrameFormat format, uint8_t length) const {
+  if (length < 18) {
+    return 0;
+  }
+  uint16_t frame_bytes = link_frame_bytes(format, length);
+  return this->radio_profile_ == RADIO_PROFILE_T1 ? three_of_six_length(1 + frame_bytes) - FRAME_HEADER_BYTES
+                                                  : frame_bytes;
+}
 
-  // Publish to sensors
-  if (this->total_consumption_sensor_ != nullptr) {
-    this->total_consumption_sensor_->publish_state(total_m3);
+bool Multical21Component::receive_frame(RadioChannel &radio) {
+  uint32_t start = stage_clock();
+  uint32_t deadline_us = micros() + FRAME_HEADER_BYTES * FRAME_BYTE_TIME_US + FRAME_TIMEOUT_MARGIN_US;
+  uint32_t sync_us = radio.gdo0_isr_pin != nullptr ? radio.sync_time_us
+                     : radio.spill.length > 0      ? radio.spill.sync_us
+                                                   : micros();
+  this->capture_.begin(sync_us);
+
+  // Read the header as soon as it arrives
+  bool t1 = this->radio_profile_ == RADIO_PROFILE_T1;
+  uint8_t header[FRAME_HEADER_BYTES];
+  if (!this->drain_fifo(radio, header, FRAME_HEADER_BYTES, deadline_us)) {
+    this->start_receiver(radio);
+    return this->finish_frame(radio, CAPTURE_RX_ERROR, false);
+  }
+  if (this->capture_.active()) {
+    // For frames dropped before their end, which get no status bytes. LQI is
+    // latched at the sync word and RSSI still reflects this frame.
+    this->capture_.set_signal(this->read_status_register(radio, CC1101_RSSI),
+                              this->read_status_register(radio, CC1101_LQI));
+    this->capture_.set_format(t1 ? CAPTURE_FORMAT_T1 : header[1]);
+    this->capture_.append(t1 ? header : &header[2], t1 ? FRAME_HEADER_BYTES : 1);
   }
 
-  if (this->month_start_sensor_ != nullptr) {
-    this->month_start_sensor_->publish_state(target_m3);
+  uint8_t *frame = frame_arena.frame;
+  LinkFrameFormat format = FRAME_FORMAT_A;
+  if (!this->decode_header(header, frame, &format)) {
+    this->start_receiver(radio);
+    return this->finish_frame(radio, CAPTURE_BAD_HEADER, false);
+  }
+  uint16_t fifo_bytes = this->fifo_frame_bytes(format, frame[0]);
+  if (fifo_bytes == 0) {
+    ESP_LOGW(TAG, "Invalid frame length: %d", frame[0]);
+    this->start_receiver(radio);
+    return this->finish_frame(radio, CAPTURE_BAD_HEADER, false);
   }
 
-  if (this->water_temp_sensor_ != nullptr) {
-    this->water_temp_sensor_->publish_state(flow_temp);
+  // L-field known: have the radio stop at the end of the frame, switching to
+  // fixed length once it is close enough for the 8-bit packet counter. A
+  // spilled header has done this already.
+  if (radio.spill.expected == 0) {
+    this->set_packet_length(radio, FRAME_HEADER_BYTES + fifo_bytes);
   }
 
-  if (this->ambient_temp_sensor_ != nullptr) {
-    this->ambient_temp_sensor_->publish_state(ambient_temp);
+  // Early reject: read only C, M and the meter ID, and drop frames for other
+  // meters before the rest of the payload is clocked out over SPI. Aborting
+  // the packet also gets the radio listening again before the frame ends.
+  // Format A puts a CRC right after the A-field, so there the ID is checked
+  // before it is trusted; format B has no CRC before the end of block 2.
+  // Block CRCs are checked and stripped chunk by chunk as the frame drains,
+  // in T1 right after the chunk is decoded. The prefix ends on a whole triple.
+  this->link_crc_.start(format, frame);
+  this->link_cycles_ = 0;
+  uint8_t prefix = format == FRAME_FORMAT_A ? FORMAT_A_FIRST_BLOCK - 1 + LINK_CRC_BYTES : FRAME_ID_PREFIX_BYTES;
+  uint16_t fifo_prefix = prefix;
+  ThreeOfSixStream *decoder = nullptr;
+  if (t1) {
+    this->link_crc_.feed(1);  // The C-field came with the header
+    this->decoder_.start();
+    decoder = &this->decoder_;
+    fifo_prefix = three_of_six_length(1 + prefix) - FRAME_HEADER_BYTES;
+  }
+  uint8_t header_data = t1 ? 2 : 1;
+  deadline_us = micros() + (fifo_bytes + PACKET_STATUS_BYTES) * FRAME_BYTE_TIME_US + FRAME_TIMEOUT_MARGIN_US;
+  if (!this->drain_fifo(radio, frame + header_data, fifo_prefix, deadline_us, &this->link_crc_, decoder)) {
+    if (!this->link_crc_.ok() || !this->decoder_.ok()) {
+      this->link_crc_errors_++;
+      this->abort_packet(radio);
+      return this->finish_frame(radio, CAPTURE_LINK_CRC, false);
+    }
+    this->start_receiver(radio);
+    return this->finish_frame(radio, CAPTURE_RX_ERROR, false);
+  }
+  uint32_t dispatch_start = stage_clock();
+  Multical21Meter *meter = this->check_meter_id(frame + 1);
+  this->dispatch_stage_.record_since(dispatch_start);
+  if (meter == nullptr) {
+    this->foreign_frames_++;
+    this->abort_packet(radio);
+    return this->finish_frame(radio, CAPTURE_FOREIGN, false);
+  }
+  meter->record_arrival(millis() - (micros() - sync_us) / 1000);
+  // The estimate is held from the sync word on, and the ID match rules out a
+  // false sync. Frames that go on to fail a block CRC count too: a large
+  // offset is what corrupts them.
+  if (this->frequency_tracking_ && radio.frequency.add(this->read_status_register(radio, CC1101_FREQEST))) {
+    radio.retune_pending = true;
   }
 
-  // Calculate and publish current flow (L/h)
-  if (this->current_flow_sensor_ != nullptr) {
-    uint32_t current_time = millis();
-    if (this->prev_reading_time_ > 0 && this->prev_total_ > 0) {
-      float delta_total_liters = (total_m3 - this->prev_total_) * 1000.0f;
-      float delta_time_hours = (current_time - this->prev_reading_time_) / 3600000.0f;
-      if (delta_time_hours > 0.001f && delta_total_liters >= 0) {
-        float flow_lph = delta_total_liters / delta_time_hours;
-        this->current_flow_sensor_->publish_state(flow_lph);
-      } else {
-        ESP_LOGD(TAG, "Flow calculation skipped: delta_time=%.4fh, delta_liters=%.1f",
-                 delta_time_hours, delta_total_liters);
-      }
+  // Stream the rest of the payload out of the FIFO while it is still being
+  // received. A frame corrupted on air is dropped at its first bad block, so
+  // it never reaches decryption and is not mistaken for a wrong key.
+  bool drained = this->drain_fifo(radio, frame + 1 + prefix, fifo_bytes - fifo_prefix, deadline_us, &this->link_crc_,
+                                  decoder);
+  this->link_stage_.record(this->link_cycles_);
+  if (!drained && this->link_crc_.ok() && this->decoder_.ok()) {
+    this->start_receiver(radio);
+    return this->finish_frame(radio, CAPTURE_RX_ERROR, false);
+  }
+  if (drained) {
+    // A packet read to its end is followed by the RSSI and LQI status bytes.
+    // They must come out before the next packet's data, CRCs good or not.
+    uint8_t status[PACKET_STATUS_BYTES];
+    if (!this->drain_fifo(radio, status, PACKET_STATUS_BYTES, deadline_us)) {
+      this->start_receiver(radio);
+      return this->finish_frame(radio, CAPTURE_RX_ERROR, false);
+    }
+    meter->record_signal(status[0], status[1]);
+    this->capture_.set_signal(status[0], status[1]);
+  }
+  uint8_t data_length = this->link_crc_.data_length();
+  if (data_length == 0) {
+    ESP_LOGD(TAG, "Link CRC error in frame for %08X", (unsigned) meter->get_meter_id());
+    this->link_crc_errors_++;
+    meter->record_link_crc_error();
+    // Stop receiving the rest of the frame, unless it is already all in. A
+    // frame cut short gets no status bytes, but it is still on the air, so the
+    // RSSI register still measures it; LQI was latched at its sync word.
+    if (drained) {
+      this->resume_rx(radio);
     } else {
-      ESP_LOGD(TAG, "Flow calculation waiting for second reading");
+      meter->record_signal(this->read_status_register(radio, CC1101_RSSI),
+                           this->read_status_register(radio, CC1101_LQI));
+      this->abort_packet(radio);
     }
-    this->prev_total_ = total_m3;
-    this->prev_reading_time_ = current_time;
+    return this->finish_frame(radio, CAPTURE_LINK_CRC, false);
+  }
+  this->drain_stage_.record_since(start);
+  this->resume_rx(radio);
+  radio.accepted_frames++;
+
+  // The other radio or a repeater may have delivered this telegram already:
+  // a repeat is dropped here, before decryption
+  if (!meter->accept_telegram(frame + 1, data_length)) {
+    this->duplicate_frames_++;
+    return this->finish_frame(radio, CAPTURE_DUPLICATE, false);
+  }
+  this->accepted_frames_++;
+
+  // Only publishing is left, which loop() does
+  QueuedReading queued{meter, {}};
+  bool decoded = meter->decode_frame(frame + 1, data_length, frame_arena.plaintext, &queued.reading);
+  if (decoded && !this->readings_.push(queued)) {
+    ESP_LOGW(TAG, "Reading queue full, dropped a reading of %08X", (unsigned) meter->get_meter_id());
   }
+  return this->finish_frame(radio, decoded ? CAPTURE_DECODED : CAPTURE_DECODE_FAILED, decoded);
+}
+
+// Store the frame in the capture ring, if capturing, with what became of it,
+// and forget the radio's spilled bytes: whatever the frame left is not used
+bool Multical21Component::finish_frame(RadioChannel &radio, CaptureOutcome outcome, bool result) {
+  radio.spill.clear();
+  radio.packet_read = 0;
+  radio.packet_length = 0;
+  this->capture_.finish(outcome);
+  return result;
+}
 
-  // Publish last update
-  if (this->last_update_sensor_ != nullptr) {
-    uint32_t uptime_sec = millis() / 1000;
-    uint32_t hours = uptime_sec / 3600;
-    uint32_t minutes = (uptime_sec % 3600) / 60;
-    uint32_t seconds = uptime_sec % 60;
-    char buffer[48];
-    snprintf(buffer, sizeof(buffer), "#%lu (uptime: %02lu:%02lu:%02lu)",
-             (unsigned long) this->reading_count_,
-             (unsigned long) hours, (unsigned long) minutes, (unsigned long) seconds);
-    this->last_update_sensor_->publish_state(buffer);
+// Look up the meter a frame is addressed to, O(log n) over the sorted meter table
+Multical21Meter *Multical21Component::check_meter_id(const uint8_t *payload) {
+  uint32_t id = meter_id_from_payload(payload);
+  auto it = std::lower_bound(this->meters_.begin(), this->meters_.end(), id,
+                             [](const Multical21Meter *m, uint32_t key) { return m->get_meter_id() < key; });
+  if (it == this->meters_.end() || (*it)->get_meter_id() != id) {
+    return nullptr;
   }
+  return *it;
 }
 
 }  // namespace multical21
@@ -1,5 +1,5 @@
 // Multical21 ESPHome Component
-// Kamstrup Multical 21 water meter reader via CC1101 (wM-Bus Mode C1)
+// Kamstrup Multical 21 water meter reader via CC1101 (wM-Bus Mode C1 or T1)
 //
 // Based on work by:
 //   Patrik Thalin - https://github.com/pthalin/esp32-multical21
@@ -8,12 +8,24 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
 #include "esphome/core/hal.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/spi/spi.h"
-#include "esphome/components/sensor/sensor.h"
-#include "esphome/components/text_sensor/text_sensor.h"
+#include "capture.h"
+#include "frequency_tracker.h"
+#include "multical21_meter.h"
+#include "radio_transport.h"
+#include "spsc_queue.h"
+#include "stage_timer.h"
+#include "three_of_six.h"
+#include "wmbus_link.h"
 #include <vector>
-#include <psa/crypto.h>
+
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 namespace esphome {
 namespace multical21 {
@@ -21,8 +33,12 @@ namespace multical21 {
 // Component version (update on each release)
 static const char *const VERSION = "1.1.0";
 
+// Log tag of capture dumps, so they can be filtered out of a device log
+static const char *const TAG_CAPTURE = "multical21.capture";
+
 // CC1101 Register addresses
 static const uint8_t CC1101_IOCFG2 = 0x00;
+static const uint8_t CC1101_IOCFG1 = 0x01;
 static const uint8_t CC1101_IOCFG0 = 0x02;
 static const uint8_t CC1101_FIFOTHR = 0x03;
 static const uint8_t CC1101_SYNC1 = 0x04;
@@ -43,6 +59,7 @@ static const uint8_t CC1101_MDMCFG2 = 0x12;
 static const uint8_t CC1101_MDMCFG1 = 0x13;
 static const uint8_t CC1101_MDMCFG0 = 0x14;
 static const uint8_t CC1101_DEVIATN = 0x15;
+static const uint8_t CC1101_MCSM2 = 0x16;
 static const uint8_t CC1101_MCSM1 = 0x17;
 static const uint8_t CC1101_MCSM0 = 0x18;
 static const uint8_t CC1101_FOCCFG = 0x19;
@@ -50,156 +67,453 @@ static const uint8_t CC1101_BSCFG = 0x1A;
 static const uint8_t CC1101_AGCCTRL2 = 0x1B;
 static const uint8_t CC1101_AGCCTRL1 = 0x1C;
 static const uint8_t CC1101_AGCCTRL0 = 0x1D;
+static const uint8_t CC1101_WOREVT1 = 0x1E;
+static const uint8_t CC1101_WOREVT0 = 0x1F;
+static const uint8_t CC1101_WORCTRL = 0x20;
 static const uint8_t CC1101_FREND1 = 0x21;
 static const uint8_t CC1101_FREND0 = 0x22;
 static const uint8_t CC1101_FSCAL3 = 0x23;
 static const uint8_t CC1101_FSCAL2 = 0x24;
 static const uint8_t CC1101_FSCAL1 = 0x25;
 static const uint8_t CC1101_FSCAL0 = 0x26;
+static const uint8_t CC1101_RCCTRL1 = 0x27;
+static const uint8_t CC1101_RCCTRL0 = 0x28;
 static const uint8_t CC1101_FSTEST = 0x29;
+static const uint8_t CC1101_PTEST = 0x2A;
+static const uint8_t CC1101_AGCTEST = 0x2B;
 static const uint8_t CC1101_TEST2 = 0x2C;
 static const uint8_t CC1101_TEST1 = 0x2D;
 static const uint8_t CC1101_TEST0 = 0x2E;
+// Configuration registers 0x00-0x2E are written as one burst
+static const uint8_t CC1101_CONFIG_REGISTERS = 0x2F;
 
 // CC1101 Status registers
+static const uint8_t CC1101_VERSION = 0x31;
+static const uint8_t CC1101_FREQEST = 0x32;
+static const uint8_t CC1101_LQI = 0x33;
+static const uint8_t CC1101_RSSI = 0x34;
 static const uint8_t CC1101_MARCSTATE = 0x35;
 static const uint8_t CC1101_RXBYTES = 0x3B;
 
+// RXBYTES fields
+static const uint8_t RXBYTES_OVERFLOW = 0x80;
+static const uint8_t RXBYTES_COUNT_MASK = 0x7F;
+
 // CC1101 Strobe commands
 static const uint8_t CC1101_SRES = 0x30;
 static const uint8_t CC1101_SCAL = 0x33;
 static const uint8_t CC1101_SRX = 0x34;
 static const uint8_t CC1101_SIDLE = 0x36;
+static const uint8_t CC1101_SPWD = 0x39;
 static const uint8_t CC1101_SFRX = 0x3A;
+static const uint8_t CC1101_SNOP = 0x3D;
 
 // CC1101 FIFO
 static const uint8_t CC1101_RXFIFO = 0x3F;
+static const uint8_t CC1101_FIFO_SIZE = 64;
+// The packet byte counter is 8 bits: fixed length mode ends a packet when it
+// wraps to PKTLEN, so longer frames start in infinite length mode
+static const uint16_t CC1101_PACKET_COUNTER_RANGE = 256;
 
 // Register access modes
+static const uint8_t WRITE_BURST = 0x40;
 static const uint8_t READ_SINGLE = 0x80;
 static const uint8_t READ_BURST = 0xC0;
 
+// Chip status byte, clocked out with every header byte. CHIP_RDYn mirrors
+// MISO: high until the crystal is running after reset or power down.
+static const uint8_t STATUS_CHIP_RDYN = 0x80;
+static const uint8_t STATUS_STATE_MASK = 0x70;
+static const uint8_t STATUS_STATE_IDLE = 0x00;
+static const uint8_t STATUS_STATE_RX = 0x10;
+static const uint8_t STATUS_STATE_RXFIFO_OVERFLOW = 0x60;
+
 // MARCSTATE values
 static const uint8_t MARCSTATE_IDLE = 0x01;
 static const uint8_t MARCSTATE_RX = 0x0D;
 
-// wM-Bus Mode C1 preamble
+// wM-Bus sync word. In Mode C1 the FIFO then starts with 0x54 and a byte
+// selecting the frame format (WMBUS_FORMAT_A_SYNC / WMBUS_FORMAT_B_SYNC); in
+// Mode T1 the 3-out-of-6 encoded frame follows directly, always format A.
 static const uint8_t WMBUS_PREAMBLE_1 = 0x54;
 static const uint8_t WMBUS_PREAMBLE_2 = 0x3D;
 
-// Maximum frame length
-static const uint8_t MAX_FRAME_LENGTH = 64;
+// PKTCTRL0 length modes
+static const uint8_t PKTCTRL0_FIXED_LENGTH = 0x00;
+static const uint8_t PKTCTRL0_INFINITE_LENGTH = 0x02;
+
+// Streaming receive: format sync (2) + L-field (1) precede the payload in the
+// FIFO (C1), or L- and C-field encoded in 3 bytes (T1)
+static const uint8_t FRAME_HEADER_BYTES = 3;
+// C (1) + M (2) + meter ID (4): enough of the payload to reject foreign frames
+static const uint8_t FRAME_ID_PREFIX_BYTES = 7;
+// One byte every 80 µs at ~100 kbps, plus margin for late sync service
+static const uint32_t FRAME_BYTE_TIME_US = 80;
+static const uint32_t FRAME_TIMEOUT_MARGIN_US = 5000;
+
+// Radio state machine timeouts: chip ready after SRES, and any strobe-driven
+// state change (calibration ~720 µs, IDLE -> RX with autocal ~800 µs)
+static const uint32_t RADIO_RESET_TIMEOUT_US = 10000;
+static const uint32_t RADIO_STATE_TIMEOUT_US = 5000;
+// How often loop() checks that an idle receiver is still in RX
+static const uint32_t RX_HEALTH_CHECK_INTERVAL_MS = 50;
+
+// Duty-cycled RX: gaps shorter than this stay in RX, and the radio wakes this
+// long before a window opens to cover loop() latency, wake-up and calibration
+static const uint32_t DUTY_CYCLE_MIN_SLEEP_MS = 100;
+static const uint32_t DUTY_CYCLE_WAKE_LEAD_MS = 20;
+
+// Readings decoded but not yet published by loop(). A meter sends one every
+// 16 s, so this rides out main loop stalls of well over a minute per meter.
+static const uint8_t READING_QUEUE_SIZE = 8;
+// Longest the receive task sleeps with every radio listening on an interrupt:
+// often enough for the RX health check and a duty-cycled radio's wake-up
+static const uint32_t RECEIVE_TASK_IDLE_MS = 10;
+
+// wM-Bus mode, selecting the register table and how frames are read
+enum RadioProfile : uint8_t {
+  RADIO_PROFILE_C1,  // Compact mode, 100 kbps NRZ; what a Multical 21 sends by default
+  RADIO_PROFILE_T1,  // Frequent transmit mode, 100 kchip/s 3-out-of-6
+};
+
+// Radio bring-up and re-arm, advanced from loop() without blocking
+enum RadioState : uint8_t {
+  RADIO_RESET,        // SRES sent, waiting for CHIP_RDYn
+  RADIO_CALIBRATING,  // Registers written, SCAL sent, waiting for IDLE
+  RADIO_IDLE_WAIT,    // SIDLE sent after a frame, waiting for IDLE
+  RADIO_RX_WAIT,      // SRX sent, waiting for RX
+  RADIO_RX,           // Listening for sync
+  RADIO_SLEEP_WAIT,   // SIDLE sent to power down, waiting for IDLE before SPWD
+  RADIO_SLEEP,        // Powered down until the next predicted window
+  RADIO_WAKING,       // CSn pulled low, waiting for CHIP_RDYn
+  RADIO_FAILED,
+};
+
+// Most CC1101s one hub drives, each with its own CS and GDO0 pin on the same SPI bus
+static const uint8_t MAX_RADIOS = 2;
+// Every FIFO byte of the longest frame in either profile, status bytes included
+static const uint16_t SPILL_BUFFER_SIZE = FRAME_HEADER_BYTES + CAPTURE_MAX_FRAME_LENGTH + PACKET_STATUS_BYTES;
+
+// RAM a hub takes, in bytes, as dump_config() reports it
+struct MemoryUsage {
+  size_t objects;  // The hub, second radio and meter objects
+  size_t shared;   // Frame buffers all hubs share
+  size_t heap;     // Buffers allocated on the heap in setup()
+};
+
+// A reading on its way from frame processing to loop()
+struct QueuedReading {
+  Multical21Meter *meter;
+  MeterReading reading;
+};
+
+// FIFO bytes of one radio's frame, pulled into RAM while the other radio's
+// frame is being drained so that neither FIFO overflows. The radio's own
+// receive_frame() then takes them before reading its FIFO again.
+struct FifoSpill {
+  std::vector<uint8_t> bytes;  // SPILL_BUFFER_SIZE, allocated in setup() with a second radio
+  uint16_t length{0};          // Bytes pulled from the FIFO
+  uint16_t read{0};            // Bytes taken by receive_frame()
+  uint16_t expected{0};        // Whole frame in FIFO bytes, once the spilled header gave its length
+  uint32_t sync_us{0};         // micros() when the first byte was pulled; stands in for the ISR time when polling
+  bool stopped{false};         // Bad header or overflow: left for receive_frame() to handle
+
+  void clear() {
+    this->length = 0;
+    this->read = 0;
+    this->expected = 0;
+    this->stopped = false;
+  }
+};
+
+// One CC1101 and its receive state. The frame buffers and link checks are the
+// hub's: frames are processed one at a time, whichever radio they come from.
+struct RadioChannel {
+  RadioTransport *transport{nullptr};
+  GPIOPin *gdo0_pin{nullptr};
+  InternalGPIOPin *gdo0_isr_pin{nullptr};  // Set when GDO0 is interrupt-capable, else GDO0 is polled
+  uint8_t number{1};                       // 1-based, for logs
+
+  volatile bool packet_available{false};  // Set by gdo0_isr(), cleared by loop() or the receive task
+  volatile uint32_t sync_time_us{0};      // micros() at the last GDO0 edge
+  bool initialized{false};
+  RadioState state{RADIO_RESET};
+  uint32_t state_since_us{0};  // micros() when state was entered
+  uint32_t last_health_check_ms{0};
+  uint32_t wake_at_ms{0};  // millis() at which RADIO_SLEEP ends
+  FifoSpill spill;
+  uint16_t packet_read{0};    // FIFO bytes of the current packet read out so far, spilled ones included
+  uint16_t packet_length{0};  // Packet length while the switch to fixed length is still to come, else 0
+
+  // Frequency offset tracking; each radio has its own crystal
+  FrequencyTracker frequency;
+  bool retune_pending{false};              // FSCTRL0 changed, written between frames
+  volatile bool frequency_unsaved{false};  // Set by retune(), cleared once loop() saved the offset
+  ESPPreferenceObject frequency_pref;
+
+  uint32_t accepted_frames{0};  // Frames read in full for one of our meters, duplicates included
 
-// CRC polynomial for EN13757
-static const uint16_t CRC16_EN13757_POLY = 0x3D65;
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  TaskHandle_t receive_task{nullptr};  // Woken by gdo0_isr()
+#endif
+};
 
-// Compact frame (CI=0x79) field positions within decrypted payload
-static const uint8_t COMPACT_FRAME_TYPE = 0x79;
-static const uint8_t COMPACT_POS_TOTAL = 9;
-static const uint8_t COMPACT_POS_TARGET = 13;
-static const uint8_t COMPACT_POS_FLOW_TEMP = 17;
-static const uint8_t COMPACT_POS_AMBIENT_TEMP = 18;
-static const uint8_t COMPACT_MIN_LENGTH = 19;
+// A second CC1101 on the hub's SPI bus, with its own CS pin
+class Multical21Radio : public Component,
+                        public spi::SPIDevice<spi::BIT_ORDER_MSB_FIRST, spi::CLOCK_POLARITY_LOW,
+                                              spi::CLOCK_PHASE_LEADING, spi::DATA_RATE_1MHZ>,
+                        public RadioTransport {
+ public:
+  void setup() override { this->spi_setup(); }
+  // Before the hub, which resets the chip from its own setup()
+  float get_setup_priority() const override { return setup_priority::HARDWARE; }
 
-// Long frame (CI=0x78) field positions within decrypted payload
-static const uint8_t LONG_FRAME_TYPE = 0x78;
-static const uint8_t LONG_POS_TOTAL = 10;
-static const uint8_t LONG_POS_TARGET = 16;
-static const uint8_t LONG_POS_FLOW_TEMP = 23;
-static const uint8_t LONG_POS_AMBIENT_TEMP = 29;
-static const uint8_t LONG_MIN_LENGTH = 30;
+  void select() override { this->enable(); }
+  void deselect() override { this->disable(); }
+  uint8_t transfer(uint8_t data) override { return this->transfer_byte(data); }
+};
 
 class Multical21Component : public PollingComponent,
                             public spi::SPIDevice<spi::BIT_ORDER_MSB_FIRST, spi::CLOCK_POLARITY_LOW,
-                                                   spi::CLOCK_PHASE_LEADING, spi::DATA_RATE_1MHZ> {
+                                                   spi::CLOCK_PHASE_LEADING, spi::DATA_RATE_1MHZ>,
+                            public RadioTransport {
  public:
+  Multical21Component() { this->radios_[0].transport = this; }
+
   void setup() override;
   void loop() override;
   void update() override;
   void dump_config() override;
+  void on_shutdown() override;
   float get_setup_priority() const override { return setup_priority::DATA; }
 
-  void set_gdo0_pin(GPIOPin *pin) { this->gdo0_pin_ = pin; }
-  void set_meter_id(const std::string &meter_id);
-  void set_key(const std::string &key);
+  void set_gdo0_pin(GPIOPin *pin) { this->radios_[0].gdo0_pin = pin; }
+  void set_gdo0_isr_pin(InternalGPIOPin *pin) { this->radios_[0].gdo0_isr_pin = pin; }
+  // Diversity receive: a second CC1101 with its antenna elsewhere. Frames from
+  // both radios are merged, and a telegram both received is decoded once.
+  // `gdo0_isr_pin` is null to poll GDO0.
+  void set_second_radio(RadioTransport *transport, GPIOPin *gdo0_pin, InternalGPIOPin *gdo0_isr_pin) {
+    RadioChannel &radio = this->radios_[1];
+    radio.transport = transport;
+    radio.gdo0_pin = gdo0_pin;
+    radio.gdo0_isr_pin = gdo0_isr_pin;
+    radio.number = 2;
+    this->radio_count_ = 2;
+  }
+
+  // Meters served by this radio. The first registered meter is the default for
+  // sensors that do not name a `meter:` explicitly.
+  void register_meter(Multical21Meter *meter);
+  Multical21Meter *get_default_meter() { return this->default_meter_; }
+
+  void set_accepted_frames_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->accepted_frames_sensor_.set_sensor(sensor, policy);
+  }
+  void set_foreign_frames_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->foreign_frames_sensor_.set_sensor(sensor, policy);
+  }
+  void set_rx_duty_cycle_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->rx_duty_cycle_sensor_.set_sensor(sensor, policy);
+  }
+  void set_prediction_hit_rate_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->prediction_hit_rate_sensor_.set_sensor(sensor, policy);
+  }
+  void set_frequency_offset_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->frequency_offset_sensor_.set_sensor(sensor, policy);
+  }
+  void set_frequency_corrections_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->frequency_corrections_sensor_.set_sensor(sensor, policy);
+  }
+  void set_radio_accepted_frames_sensor(uint8_t radio, sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->radio_accepted_frames_sensors_[radio].set_sensor(sensor, policy);
+  }
+  void set_duplicate_frames_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->duplicate_frames_sensor_.set_sensor(sensor, policy);
+  }
+  void set_reading_queue_high_water_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->reading_queue_high_water_sensor_.set_sensor(sensor, policy);
+  }
+  void set_reading_queue_drops_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->reading_queue_drops_sensor_.set_sensor(sensor, policy);
+  }
+
+  void set_radio_profile(RadioProfile profile) { this->radio_profile_ = profile; }
+  RadioProfile get_radio_profile() const { return this->radio_profile_; }
+
+  // Follow the carrier offset measured in FREQEST with FSCTRL0 (default on).
+  // The learnt offset is saved to flash and applied from the next boot on.
+  void set_frequency_tracking(bool enabled) { this->frequency_tracking_ = enabled; }
+  const FrequencyTracker &get_frequency_tracker(uint8_t radio = 0) const { return this->radios_[radio].frequency; }
+  MemoryUsage memory_usage() const;
+
+  // Power the radio down between the predicted transmit windows of all meters,
+  // listening from `guard_ms` before to `guard_ms` after each expected
+  // telegram. A meter whose schedule misses `max_missed_windows` in a row, or
+  // is not learnt yet, keeps the radio in continuous RX.
+  void set_duty_cycle(uint32_t guard_ms, uint8_t max_missed_windows) {
+    this->duty_cycle_ = true;
+    this->guard_ms_ = guard_ms;
+    this->max_missed_windows_ = max_missed_windows;
+  }
+
+  // Consumption analytics of every meter: a continuous-flow run ends when the
+  // total stands still for `zero_flow_interval_ms`, peak flow covers
+  // `peak_flow_window_ms`, and the night minimum flow is taken between the
+  // local hours `night_start` and `night_end`
+  void set_analytics(uint32_t zero_flow_interval_ms, uint32_t peak_flow_window_ms, uint8_t night_start,
+                     uint8_t night_end) {
+    this->analytics_ = AnalyticsConfig{zero_flow_interval_ms, peak_flow_window_ms, night_start, night_end};
+  }
+#ifdef USE_TIME
+  void set_time(time::RealTimeClock *time) { this->time_ = time; }
+#endif
+
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  // Drain, check and decrypt frames in a FreeRTOS task pinned to `core`
+  // instead of loop(), which then only publishes the readings. Started at the
+  // end of setup(); if it cannot be created, loop() does it all as before.
+  void set_receive_task(uint8_t core, uint8_t priority, uint32_t stack_size) {
+    this->receive_task_core_ = core;
+    this->receive_task_priority_ = priority;
+    this->receive_task_stack_size_ = stack_size;
+  }
+#endif
+
+  // Raw frame capture ring, allocated in setup(); 0 = off
+  void set_capture_buffer_size(uint32_t bytes) { this->capture_buffer_size_ = bytes; }
+  // Log the captured frames in the capture file format, e.g. from a button
+  // lambda. Frame processing waits until the dump is done.
+  void dump_capture();
+  void clear_capture();
+  const CaptureRing &get_capture() const { return this->capture_; }
 
-  void set_total_consumption_sensor(sensor::Sensor *sensor) { this->total_consumption_sensor_ = sensor; }
-  void set_month_start_sensor(sensor::Sensor *sensor) { this->month_start_sensor_ = sensor; }
-  void set_water_temp_sensor(sensor::Sensor *sensor) { this->water_temp_sensor_ = sensor; }
-  void set_ambient_temp_sensor(sensor::Sensor *sensor) { this->ambient_temp_sensor_ = sensor; }
-  void set_current_flow_sensor(sensor::Sensor *sensor) { this->current_flow_sensor_ = sensor; }
-  void set_last_update_sensor(text_sensor::TextSensor *sensor) { this->last_update_sensor_ = sensor; }
-  void set_frames_received_sensor(sensor::Sensor *sensor) { this->frames_received_sensor_ = sensor; }
-  void set_crc_errors_sensor(sensor::Sensor *sensor) { this->crc_errors_sensor_ = sensor; }
-  void set_signal_quality_sensor(sensor::Sensor *sensor) { this->signal_quality_sensor_ = sensor; }
+  // Radio access. Defaults to this component's SPI device; host builds swap in
+  // a simulated CC1101.
+  void set_transport(RadioTransport *transport) { this->radios_[0].transport = transport; }
+  void select() override { this->enable(); }
+  void deselect() override { this->disable(); }
+  uint8_t transfer(uint8_t data) override { return this->transfer_byte(data); }
 
  protected:
   // CC1101 communication
-  void write_register(uint8_t reg, uint8_t value);
-  uint8_t read_register(uint8_t reg);
-  uint8_t read_status_register(uint8_t reg);
-  void read_burst(uint8_t reg, uint8_t *buffer, uint8_t len);
-  void send_strobe(uint8_t strobe);
-  bool reset_cc1101();
-  void init_cc1101_registers();
-  void start_receiver();
-
-  // Frame processing
-  bool receive_frame();
-  bool check_meter_id(const uint8_t *payload);
-  bool decrypt_frame(const uint8_t *payload, uint8_t length);
-  void parse_meter_data(const uint8_t *data, uint8_t length);
-
-  // AES-128 CTR decryption (using PSA)
-  void aes_ctr_decrypt(const uint8_t *cipher, uint8_t *plain, uint8_t length, const uint8_t *iv);
-
-  // CRC calculation
-  uint16_t crc16_en13757(const uint8_t *data, size_t length);
-
-  // Utility
-  void hex_to_bytes(const std::string &hex, uint8_t *bytes, size_t len);
-
-  GPIOPin *gdo0_pin_{nullptr};
-
-  uint8_t meter_id_[4]{0};
-  uint8_t aes_key_[16]{0};
-  psa_key_handle_t aes_key_handle_{0};  // PSA key handle for AES key
-  bool aes_key_set_{false};
-  // Note: keys are imported immediately when `set_key()` is called.
-
-  // Sensors
-  sensor::Sensor *total_consumption_sensor_{nullptr};
-  sensor::Sensor *month_start_sensor_{nullptr};
-  sensor::Sensor *water_temp_sensor_{nullptr};
-  sensor::Sensor *ambient_temp_sensor_{nullptr};
-  sensor::Sensor *current_flow_sensor_{nullptr};
-  text_sensor::TextSensor *last_update_sensor_{nullptr};
-  sensor::Sensor *frames_received_sensor_{nullptr};
-  sensor::Sensor *crc_errors_sensor_{nullptr};
-  sensor::Sensor *signal_quality_sensor_{nullptr};
+  void write_register(RadioChannel &radio, uint8_t reg, uint8_t value);
+  uint8_t read_register(RadioChannel &radio, uint8_t reg);
+  uint8_t read_status_register(RadioChannel &radio, uint8_t reg);
+  void read_burst(RadioChannel &radio, uint8_t reg, uint8_t *buffer, uint8_t len);
+  uint8_t read_rx_bytes(RadioChannel &radio);
+  bool drain_fifo(RadioChannel &radio, uint8_t *buffer, uint16_t len, uint32_t deadline_us,
+                  LinkCrcStream *link_crc = nullptr, ThreeOfSixStream *decoder = nullptr);
+  void spill_fifo(RadioChannel &radio);
+  void set_packet_length(RadioChannel &radio, uint16_t packet_bytes);
+  void update_length_mode(RadioChannel &radio, uint8_t available);
+  void write_burst(RadioChannel &radio, uint8_t reg, const uint8_t *buffer, uint8_t len);
+  uint8_t send_strobe(RadioChannel &radio, uint8_t strobe);  // Returns the chip status byte
+
+  // Radio state machine. Each step issues strobes and returns; loop() calls
+  // advance_radio() until the chip reports the state the step waits for.
+  void reset_cc1101(RadioChannel &radio);
+  bool verify_cc1101(RadioChannel &radio);
+  void init_cc1101_registers(RadioChannel &radio);
+  void write_config(RadioChannel &radio);
+  void retune(RadioChannel &radio);
+  void start_receiver(RadioChannel &radio);
+  void abort_packet(RadioChannel &radio);
+  void resume_rx(RadioChannel &radio);
+  void enter_rx(RadioChannel &radio);
+  void check_rx_health(RadioChannel &radio);
+  void idle_rx(RadioChannel &radio);
+  uint32_t poll_schedules(uint32_t now_ms);
+  void account_radio_time();
+  void set_radio_state(RadioChannel &radio, RadioState state);
+  void advance_radio(RadioChannel &radio);
+  void fail_radio(RadioChannel &radio);
+
+  // Frame processing. service_radios() runs in loop(), or on the receive task,
+  // and hands decoded readings to publish_readings(), which always runs in
+  // loop(). Whatever else touches frame processing state from loop() does so
+  // holding the same lock; counters only read for logs and sensors are not
+  // locked, each being a word written whole.
+  void service_radios();
+  void publish_readings();
+  void save_learnt();
+  void service_radio(RadioChannel &radio);
+  bool decode_header(const uint8_t *header, uint8_t *frame, LinkFrameFormat *format) const;
+  uint16_t fifo_frame_bytes(LinkFrameFormat format, uint8_t length) const;
+  bool receive_frame(RadioChannel &radio);
+  bool finish_frame(RadioChannel &radio, CaptureOutcome outcome, bool result);
+  Multical21Meter *check_meter_id(const uint8_t *payload);
+
+  // GDO0 edge interrupt (sync word detected)
+  static void gdo0_isr(RadioChannel *radio);
+
+#ifdef USE_MULTICAL21_RECEIVE_TASK
+  void start_receive_task();
+  TickType_t receive_task_wait() const;
+  static void receive_task(void *arg);
+
+  TaskHandle_t receive_task_{nullptr};
+  uint8_t receive_task_core_{0};
+  uint8_t receive_task_priority_{0};
+  uint32_t receive_task_stack_size_{0};
+#endif
+
+  RadioChannel radios_[MAX_RADIOS];
+  uint8_t radio_count_{1};
+  volatile bool radios_failed_{false};  // Set by fail_radio(), acted on in loop()
+  RadioProfile radio_profile_{RADIO_PROFILE_C1};
+
+  std::vector<Multical21Meter *> meters_;  // Sorted by meter ID
+  Multical21Meter *default_meter_{nullptr};
+
+  // Radio-level diagnostic sensors
+  SlotSensor<SLOT_ACCEPTED_FRAMES> accepted_frames_sensor_;
+  SlotSensor<SLOT_FOREIGN_FRAMES> foreign_frames_sensor_;
+  SlotSensor<SLOT_RX_DUTY_CYCLE> rx_duty_cycle_sensor_;
+  SlotSensor<SLOT_PREDICTION_HIT_RATE> prediction_hit_rate_sensor_;
+  SlotSensor<SLOT_FREQUENCY_OFFSET> frequency_offset_sensor_;
+  SlotSensor<SLOT_FREQUENCY_CORRECTIONS> frequency_corrections_sensor_;
+  SlotSensor<SLOT_RADIO_ACCEPTED_FRAMES> radio_accepted_frames_sensors_[MAX_RADIOS];
+  SlotSensor<SLOT_DUPLICATE_FRAMES> duplicate_frames_sensor_;
+  SlotSensor<SLOT_READING_QUEUE_HIGH_WATER> reading_queue_high_water_sensor_;
+  SlotSensor<SLOT_READING_QUEUE_DROPS> reading_queue_drops_sensor_;
+  PublishStats publish_stats_;
 
   // State
-  volatile bool packet_available_{false};
-  bool cc1101_initialized_{false};
-  uint8_t frame_buffer_[MAX_FRAME_LENGTH]{0};
-  uint8_t plaintext_[MAX_FRAME_LENGTH]{0};
-
-  // Last values
-  float last_total_{0};
-  float last_month_start_{0};
-  uint8_t last_water_temp_{0};
-  uint8_t last_ambient_temp_{0};
-
-  // Flow calculation state
-  float prev_total_{0};            // Previous total for flow calculation
-  uint32_t prev_reading_time_{0};  // Time of previous reading (millis)
-
-  // Diagnostics
-  uint32_t frames_received_{0};
-  uint32_t crc_errors_{0};
-  uint32_t decrypt_errors_{0};
-  uint32_t parse_errors_{0};
-  uint32_t reading_count_{0};
+  LinkCrcStream link_crc_;     // Block CRC check of the frame being drained
+  ThreeOfSixStream decoder_;   // T1: symbol decoding of the frame being drained
+  uint32_t link_cycles_{0};    // CPU cycles spent in link_crc_ for this frame
+  uint32_t capture_buffer_size_{0};
+  CaptureRing capture_;  // Raw frames, copied from the FIFO before the link CRCs are stripped
+  SpscQueue<QueuedReading, READING_QUEUE_SIZE> readings_;  // Decoded, waiting for loop() to publish them
+
+  // Duty-cycled RX
+  bool duty_cycle_{false};
+  uint32_t guard_ms_{250};
+  uint8_t max_missed_windows_{3};
+  uint32_t radio_time_ms_{0};   // millis() up to which awake_ms_/asleep_ms_ are counted
+  uint64_t awake_ms_{0};        // First radio powered: RX, calibration and state changes
+  uint64_t asleep_ms_{0};       // First radio in SLEEP
+
+  bool frequency_tracking_{true};
+
+  AnalyticsConfig analytics_;
+#ifdef USE_TIME
+  time::RealTimeClock *time_{nullptr};
+#endif
+
+  // Diagnostics, over all radios
+  uint32_t accepted_frames_{0};      // Frames read in full for one of our meters, each telegram once
+  uint32_t duplicate_frames_{0};     // Repeated telegrams, dropped before decryption
+  uint32_t foreign_frames_{0};       // Frames for meters we do not serve, dropped after the ID
+  uint32_t link_crc_errors_{0};      // Frames dropped on a data link block CRC, before decryption
+  uint32_t max_sync_latency_us_{0};  // Worst GDO0 edge -> loop() service delay
+  StageStats drain_stage_;           // receive_frame() start -> payload out of the FIFO (mostly air time)
+  StageStats dispatch_stage_;        // Meter lookup by ID
+  StageStats link_stage_;            // T1 decoding, block CRC check and strip, summed over the drain
+  uint32_t radio_timeouts_{0};       // State changes that did not complete in time
+  uint32_t rearms_{0};               // Full SIDLE/SFRX/SRX cycles after a frame or fault
+  uint32_t wakeups_{0};              // Returns from SLEEP to RX
+  uint32_t fifo_overflows_{0};
 };
 
 }  // namespace multical21
@@ -0,0 +1,616 @@
+// Multical21 ESPHome Component - Meter
+// Decryption and parsing for one Kamstrup Multical 21 meter
+//
+// Based on work by:
+//   Patrik Thalin - https://github.com/pthalin/esp32-multical21
+//   Chester - https://github.com/chester4444/esp-multical21
+
+#include "multical21_meter.h"
+#include "esphome/core/log.h"
+#include "esphome/core/helpers.h"
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace multical21 {
+
+static const char *const TAG = "multical21.meter";
+
+// Zero key material through a volatile pointer, so the stores are not
+// dropped as dead
+static void wipe(uint8_t *bytes, size_t length) {
+  volatile uint8_t *p = bytes;
+  while (length-- > 0) {
+    *p++ = 0;
+  }
+}
+
+void Multical21Meter::set_meter_id(const std::string &meter_id) {
+  if (meter_id.length() >= 8) {
+    uint8_t id[4];
+    this->hex_to_bytes(meter_id, id, 4);
+    this->meter_id_ = ((uint32_t) id[0] << 24) | ((uint32_t) id[1] << 16) | ((uint32_t) id[2] << 8) | id[3];
+    ESP_LOGD(TAG, "Meter ID set: %08X", (unsigned) this->meter_id_);
+  }
+}
+
+void Multical21Meter::setup() {
+  this->formats_.load(this->meter_id_);
+
+  // Continue the counters and the last total from before the reboot
+  HistoryCounters counters;
+  if (this->history_.load(this->meter_id_, &counters)) {
+    this->frames_received_ = counters.frames_received;
+    this->link_crc_errors_ = counters.link_crc_errors;
+    this->app_crc_errors_ = counters.app_crc_errors;
+    this->reading_count_ = counters.reading_count;
+    if (this->history_.size() > 0) {
+      this->last_total_l_ = this->history_.at(0).total_l;
+    }
+  }
+}
+
+HistoryCounters Multical21Meter::history_counters() const {
+  return HistoryCounters{this->frames_received_, this->link_crc_errors_, this->app_crc_errors_, this->reading_count_};
+}
+
+void Multical21Meter::update_history(bool connected, const HistoryCounters &counters) {
+  if (connected && !this->connected_ && this->replay_backlog_ > 0) {
+    this->replay_history(this->replay_backlog_);
+  }
+  if (connected) {
+    this->replay_backlog_ = 0;
+  }
+  this->connected_ = connected;
+
+  uint32_t now = millis();
+  if (this->history_flush_interval_ms_ > 0 && this->history_.unflushed() > 0 &&
+      now - this->last_history_flush_ms_ >= this->history_flush_interval_ms_) {
+    this->history_.flush(counters);
+    this->last_history_flush_ms_ = now;
+  }
+}
+
+void Multical21Meter::flush_history() {
+  if (this->history_.unflushed() == 0) {
+    return;
+  }
+  this->history_.flush(this->history_counters());
+  this->last_history_flush_ms_ = millis();
+}
+
+// Publish readings taken while nothing was listening, oldest first, so Home
+// Assistant and MQTT subscribers see every total instead of only the latest
+void Multical21Meter::replay_history(uint8_t records) {
+  if (records > this->history_.size()) {
+    records = this->history_.size();
+  }
+  ESP_LOGI(TAG, "[%08X] Replaying %u readings taken while disconnected", (unsigned) this->meter_id_, records);
+  for (uint8_t back = records; back-- > 0;) {
+    const HistoryRecord &record = this->history_.at(back);
+    this->total_consumption_sensor_.replay(record.total_l / 1000.0f, &this->publish_stats_);
+    if (record.flags & HISTORY_TEMPERATURES_VALID) {
+      this->water_temp_sensor_.replay(record.flow_temperature, &this->publish_stats_);
+      this->ambient_temp_sensor_.replay(record.external_temperature, &this->publish_stats_);
+    }
+  }
+}
+
+bool Multical21Meter::decode_frame(const uint8_t *payload, uint8_t length, uint8_t *scratch, MeterReading *reading) {
+  this->frames_received_++;
+  uint32_t start = stage_clock();
+  bool ok = this->decrypt_frame(payload, length, scratch, reading);
+  this->frame_stage_.record_since(start);
+  return ok;
+}
+
+bool Multical21Meter::handle_frame(const uint8_t *payload, uint8_t length, uint8_t *scratch) {
+  MeterReading reading;
+  if (!this->decode_frame(payload, length, scratch, &reading)) {
+    return false;
+  }
+  this->publish_reading(reading);
+  this->save_learnt_formats();
+  return true;
+}
+
+void Multical21Meter::record_arrival(uint32_t arrival_ms) {
+  // Either radio's copy may be timed first by a millisecond or so
+  int32_t since = (int32_t) (arrival_ms - this->telegram_ms_);
+  this->telegram_copy_ = this->telegram_seen_ && (uint32_t) (since < 0 ? -since : since) < this->copy_window_ms_;
+  if (this->telegram_copy_) {
+    return;
+  }
+  // The last telegram ended without either verdict, e.g. on an RX error
+  this->schedule_telegram();
+  this->telegram_seen_ = true;
+  this->telegram_ms_ = arrival_ms;
+  this->telegram_handled_ = false;
+  this->telegram_link_error_ = false;
+  this->telegram_scheduled_ = false;
+}
+
+// A repeated telegram arrives off the meter's cadence, so an arrival only
+// goes into the schedule once the frame is known not to be one
+void Multical21Meter::schedule_telegram() {
+  if (this->telegram_seen_ && !this->telegram_scheduled_) {
+    this->telegram_scheduled_ = true;
+    this->schedule_.add(this->telegram_ms_);
+  }
+}
+
+void Multical21Meter::record_link_crc_error() {
+  this->schedule_telegram();
+  if (this->telegram_handled_ || this->telegram_link_error_) {
+    return;
+  }
+  this->telegram_link_error_ = true;
+  this->link_crc_errors_++;
+}
+
+void Multical21Meter::record_signal(uint8_t rssi, uint8_t lqi_status) {
+  if (this->telegram_copy_) {
+    this->link_quality_.keep_stronger(rssi, lqi_status);
+  } else {
+    this->link_quality_.add(rssi, lqi_status);
+  }
+}
+
+bool Multical21Meter::accept_telegram(const uint8_t *payload, uint8_t length) {
+  if (this->telegram_link_error_) {
+    // The other radio's copy failed, but the telegram got through
+    this->telegram_link_error_ = false;
+    this->link_crc_errors_--;
+  }
+  this->telegram_handled_ = true;
+  if (!this->telegrams_.accept(payload[FRAME_ACC_OFFSET], telegram_header_hash(payload, length),
+                               this->telegram_ms_)) {
+    this->telegram_scheduled_ = true;
+    return false;
+  }
+  this->schedule_telegram();
+  return true;
+}
+
+MeterDiagnostics Multical21Meter::diagnostics() const {
+  return MeterDiagnostics{this->history_counters(),
+                          this->decrypt_errors_,
+                          this->parse_errors_,
+                          this->unknown_formats_,
+                          this->telegrams_.missed(),
+                          this->telegrams_.repeated(),
+                          this->decrypt_stage_,
+                          this->crc_stage_,
+                          this->parse_stage_,
+                          this->frame_stage_,
+                          this->link_quality_};
+}
+
+void Multical21Meter::publish_diagnostics(const MeterDiagnostics &diagnostics) {
+  const HistoryCounters &counters = diagnostics.counters;
+  const LinkQuality &link = diagnostics.link;
+  if (counters.frames_received > 0 || counters.link_crc_errors > 0 || diagnostics.decrypt_errors > 0) {
+    ESP_LOGD(TAG, "[%08X] Stats - frames: %u, link CRC errors: %u, app CRC errors: %u, decrypt errors: %u, "
+             "parse errors: %u, unknown formats: %u, missed: %u, repeated: %u, publishes sent: %u, suppressed: %u",
+             (unsigned) this->meter_id_, counters.frames_received, counters.link_crc_errors, counters.app_crc_errors,
+             diagnostics.decrypt_errors, diagnostics.parse_errors, diagnostics.unknown_formats,
+             (unsigned) diagnostics.missed_telegrams, (unsigned) diagnostics.repeated_telegrams,
+             this->publish_stats_.sent, this->publish_stats_.suppressed);
+  }
+  if (!link.empty()) {
+    ESP_LOGD(TAG, "[%08X] Link - RSSI last: %.1f dBm, min/avg/max: %.1f/%.1f/%.1f dBm, LQI avg: %.1f",
+             (unsigned) this->meter_id_, link.last_rssi_dbm(), link.min_rssi_dbm(), link.avg_rssi_dbm(),
+             link.max_rssi_dbm(), link.avg_lqi());
+  }
+  if (diagnostics.frame.count > 0) {
+    ESP_LOGD(TAG, "[%08X] Timing (avg us) - decrypt: %.1f, CRC: %.1f, parse: %.1f, frame: %.1f",
+             (unsigned) this->meter_id_, diagnostics.decrypt.avg_us(), diagnostics.crc.avg_us(),
+             diagnostics.parse.avg_us(), diagnostics.frame.avg_us());
+  }
+
+  // Readings held back by a minimum interval, and heartbeats
+  this->total_consumption_sensor_.flush(&this->publish_stats_);
+  this->month_start_sensor_.flush(&this->publish_stats_);
+  this->water_temp_sensor_.flush(&this->publish_stats_);
+  this->ambient_temp_sensor_.flush(&this->publish_stats_);
+  this->current_flow_sensor_.flush(&this->publish_stats_);
+
+  this->publish(this->frames_received_sensor_, counters.frames_received);
+  this->publish(this->crc_errors_sensor_, counters.app_crc_errors);
+  this->publish(this->link_crc_errors_sensor_, counters.link_crc_errors);
+  this->publish(this->missed_telegrams_sensor_, diagnostics.missed_telegrams);
+  if (this->signal_quality_sensor_.has_sensor()) {
+    // RF conditions only: a wrong key fails the application CRC, not the link CRC
+    uint32_t total = counters.frames_received + counters.link_crc_errors;
+    float quality = (total > 0) ? (counters.frames_received * 100.0f / total) : 0.0f;
+    this->publish(this->signal_quality_sensor_, quality);
+  }
+  if (diagnostics.decrypt.count > 0) {
+    this->publish(this->decrypt_time_sensor_, diagnostics.decrypt.avg_us());
+  }
+  if (diagnostics.frame.count > 0) {
+    this->publish(this->processing_time_sensor_, diagnostics.frame.avg_us());
+  }
+  this->publish(this->history_records_sensor_, this->history_.size());
+  this->publish(this->history_flash_writes_sensor_, this->history_.flash_writes());
+
+  if (!link.empty()) {
+    this->publish(this->rssi_sensor_, link.avg_rssi_dbm());
+    this->publish(this->rssi_min_sensor_, link.min_rssi_dbm());
+    this->publish(this->rssi_max_sensor_, link.max_rssi_dbm());
+    this->publish(this->lqi_sensor_, link.avg_lqi());
+    this->publish_rssi_histogram(link);
+  }
+}
+
+// Leak, burst and backflow figures and the meter's info flags, with every total
+void Multical21Meter::publish_analytics(const MeterReading &reading, bool has_flow, uint32_t flow_dlph) {
+  uint16_t previous = this->analytics_.info_codes();
+  this->analytics_.add(reading.ms, reading.total_l, reading.info_codes, has_flow, flow_dlph, this->local_hour());
+
+  static const struct {
+    uint16_t flag;
+    uint8_t shift;
+    const char *name;
+  } FLAGS[] = {{INFO_CODE_DRY, INFO_CODE_DRY_SHIFT, "DRY"},
+               {INFO_CODE_REVERSE, INFO_CODE_REVERSE_SHIFT, "REVERSE"},
+               {INFO_CODE_LEAK, INFO_CODE_LEAK_SHIFT, "LEAK"},
+               {INFO_CODE_BURST, INFO_CODE_BURST_SHIFT, "BURST"}};
+  for (const auto &flag : FLAGS) {
+    bool on = (reading.info_codes & flag.flag) != 0;
+    if (on && (previous & flag.flag) == 0) {
+      ESP_LOGW(TAG, "[%08X] Meter reports %s (%s)", (unsigned) this->meter_id_, flag.name,
+               info_code_duration_text(info_code_duration(reading.info_codes, flag.shift)));
+    } else if (!on && (previous & flag.flag) != 0) {
+      ESP_LOGI(TAG, "[%08X] Meter cleared %s", (unsigned) this->meter_id_, flag.name);
+    }
+  }
+
+  this->publish(this->continuous_flow_duration_sensor_, this->analytics_.continuous_flow_ms() / 3600000.0f);
+  if (has_flow) {
+    this->publish(this->peak_flow_sensor_, (float) this->analytics_.peak_flow_lph());
+  }
+  uint32_t night_min_dlph;
+  if (this->analytics_.night_min_flow_dlph(&night_min_dlph)) {
+    this->publish(this->night_min_flow_sensor_, night_min_dlph / 10.0f);
+  }
+  this->publish(this->reverse_flow_events_sensor_, (float) this->analytics_.reverse_events());
+
+  // BinarySensor only sends changes
+  if (this->dry_sensor_ != nullptr) {
+    this->dry_sensor_->publish_state((reading.info_codes & INFO_CODE_DRY) != 0);
+  }
+  if (this->reverse_flow_sensor_ != nullptr) {
+    this->reverse_flow_sensor_->publish_state((reading.info_codes & INFO_CODE_REVERSE) != 0);
+  }
+  if (this->leak_sensor_ != nullptr) {
+    this->leak_sensor_->publish_state((reading.info_codes & INFO_CODE_LEAK) != 0);
+  }
+  if (this->burst_sensor_ != nullptr) {
+    this->burst_sensor_->publish_state((reading.info_codes & INFO_CODE_BURST) != 0);
+  }
+}
+
+int8_t Multical21Meter::local_hour() const {
+#ifdef USE_TIME
+  if (this->time_ != nullptr) {
+    ESPTime now = this->time_->now();
+    if (now.is_valid()) {
+      return (int8_t) now.hour;
+    }
+  }
+#endif
+  return -1;
+}
+
+// Frames per RSSI bin as "<-110: 0, -110: 2, -100: 14, ...", only when new frames came in
+void Multical21Meter::publish_rssi_histogram(const LinkQuality &link) {
+  if (this->rssi_histogram_sensor_ == nullptr || link.frames() == this->histogram_published_frames_) {
+    return;
+  }
+  this->histogram_published_frames_ = link.frames();
+  char buffer[RSSI_BINS * 20];
+  size_t pos = snprintf(buffer, sizeof(buffer), "<%d: %u", RSSI_FIRST_BIN_DBM, (unsigned) link.bin(0));
+  for (uint8_t i = 1; i < RSSI_BINS && pos < sizeof(buffer); i++) {
+    pos += snprintf(buffer + pos, sizeof(buffer) - pos, ", %d: %u", LinkQuality::bin_low_dbm(i),
+                    (unsigned) link.bin(i));
+  }
+  this->rssi_histogram_sensor_->publish_state(buffer);
+}
+
+void Multical21Meter::dump_config() {
+  ESP_LOGCONFIG(TAG, "  Meter %08X:", (unsigned) this->meter_id_);
+  ESP_LOGCONFIG(TAG, "    Key: %s", this->aes_key_set_ ? "imported" : "NOT set");
+  ESP_LOGCONFIG(TAG, "    Frames received: %u", this->frames_received_);
+  ESP_LOGCONFIG(TAG, "    Link CRC errors: %u", this->link_crc_errors_);
+  uint32_t missed = this->telegrams_.missed();
+  ESP_LOGCONFIG(TAG, "    Telegrams missed (ACC gaps since boot): %u (%.1f%% lost); repeats dropped: %u",
+                (unsigned) missed,
+                missed > 0 ? 100.0f * missed / (missed + this->frames_received_) : 0.0f,
+                (unsigned) this->telegrams_.repeated());
+  ESP_LOGCONFIG(TAG, "    Application CRC errors: %u", this->app_crc_errors_);
+  ESP_LOGCONFIG(TAG, "    Decrypt errors: %u", this->decrypt_errors_);
+  ESP_LOGCONFIG(TAG, "    Parse errors: %u", this->parse_errors_);
+  ESP_LOGCONFIG(TAG, "    Unknown record formats: %u", this->unknown_formats_);
+  if (!this->link_quality_.empty()) {
+    ESP_LOGCONFIG(TAG, "    RSSI over the last %u frames: min %.1f, avg %.1f, max %.1f dBm; LQI avg %.1f",
+                  (unsigned) (this->link_quality_.frames() < LINK_WINDOW ? this->link_quality_.frames() : LINK_WINDOW),
+                  this->link_quality_.min_rssi_dbm(), this->link_quality_.avg_rssi_dbm(),
+                  this->link_quality_.max_rssi_dbm(), this->link_quality_.avg_lqi());
+    ESP_LOGCONFIG(TAG, "    RSSI histogram since boot (%u frames):", (unsigned) this->link_quality_.frames());
+    ESP_LOGCONFIG(TAG, "      below %d dBm: %u", RSSI_FIRST_BIN_DBM, (unsigned) this->link_quality_.bin(0));
+    for (uint8_t i = 1; i < RSSI_BINS; i++) {
+      ESP_LOGCONFIG(TAG, "      from %d dBm: %u", LinkQuality::bin_low_dbm(i), (unsigned) this->link_quality_.bin(i));
+    }
+  }
+  if (this->schedule_.interval_ms() > 0) {
+    ESP_LOGCONFIG(TAG, "    Transmit interval: %u ms (%s); windows hit: %u, missed: %u, fallbacks: %u",
+                  (unsigned) this->schedule_.interval_ms(), this->schedule_.locked() ? "locked" : "learning",
+                  (unsigned) this->schedule_.hits(), (unsigned) this->schedule_.misses(),
+                  (unsigned) this->schedule_.fallbacks());
+  }
+  ESP_LOGCONFIG(TAG, "    Analytics: continuous flow %u min, peak %u L/h, %u reverse flow events, info codes 0x%04X",
+                (unsigned) (this->analytics_.continuous_flow_ms() / 60000), (unsigned) this->analytics_.peak_flow_lph(),
+                (unsigned) this->analytics_.reverse_events(), this->analytics_.info_codes());
+  uint32_t night_min_dlph;
+  if (this->analytics_.night_min_flow_dlph(&night_min_dlph)) {
+    ESP_LOGCONFIG(TAG, "    Night minimum flow: %u.%u L/h", (unsigned) (night_min_dlph / 10),
+                  (unsigned) (night_min_dlph % 10));
+  }
+  ESP_LOGCONFIG(TAG, "    Publishes: %u sent, %u suppressed", this->publish_stats_.sent,
+                this->publish_stats_.suppressed);
+  ESP_LOGCONFIG(TAG, "    History: boot %u, %u readings (%u not yet in flash), %u flash writes, flush every %u s",
+                this->history_.boot(), this->history_.size(), this->history_.unflushed(),
+                (unsigned) this->history_.flash_writes(), (unsigned) (this->history_flush_interval_ms_ / 1000));
+  for (uint8_t i = 0; i < this->formats_.size(); i++) {
+    ESP_LOGCONFIG(TAG, "    Record format 0x%04X: %u data bytes", this->formats_.layout(i).signature,
+                  this->formats_.layout(i).data_length);
+  }
+  ESP_LOGCONFIG(TAG, "    Stage timing:");
+  this->decrypt_stage_.dump_config(TAG, "      ", "decrypt");
+  this->crc_stage_.dump_config(TAG, "      ", "CRC");
+  this->parse_stage_.dump_config(TAG, "      ", "parse");
+  this->frame_stage_.dump_config(TAG, "      ", "frame");
+}
+
+void Multical21Meter::set_key(const std::string &key) {
+  if (key.length() >= 32) {
+    uint8_t key_bytes[16];
+    this->hex_to_bytes(key, key_bytes, 16);
+
+    // Import key into PSA immediately. This simplifies lifecycle handling
+    // and avoids deferred state; the imported key is then used for every frame.
+    // PSA holds the only copy from here on.
+    this->aes_key_set_ = this->keystream_.set_key(key_bytes);
+    wipe(key_bytes, sizeof(key_bytes));
+
+    ESP_LOGD(TAG, "AES key for %08X %s", (unsigned) this->meter_id_, this->aes_key_set_ ? "imported" : "NOT imported");
+  }
+}
+
+// Convert hex string to bytes using direct character arithmetic
+// This is faster than strtol() as it avoids function call overhead and string allocation
+void Multical21Meter::hex_to_bytes(const std::string &hex, uint8_t *bytes, size_t len) {
+  for (size_t i = 0; i < len && i * 2 + 1 < hex.length(); i++) {
+    char hi = hex[i * 2];
+    char lo = hex[i * 2 + 1];
+    // Convert ASCII hex char to value: '0'-'9' -> 0-9, 'a'-'f'/'A'-'F' -> 10-15
+    uint8_t hi_val = (hi >= 'a') ? (hi - 'a' + 10) : (hi >= 'A') ? (hi - 'A' + 10) : (hi - '0');
+    uint8_t lo_val = (lo >= 'a') ? (lo - 'a' + 10) : (lo >= 'A') ? (lo - 'A' + 10) : (lo - '0');
+    bytes[i] = (hi_val << 4) | lo_val;
+  }
+}
+
+// Decrypt wM-Bus Mode C1 encrypted payload
+// Frame structure (link CRCs already stripped): [header 16 bytes][encrypted data]
+bool Multical21Meter::decrypt_frame(const uint8_t *payload, uint8_t length, uint8_t *plaintext,
+                                    MeterReading *reading) {
+  if (length <= FRAME_CIPHER_OFFSET) {
+    ESP_LOGW(TAG, "Frame too short for decryption: %d bytes", length);
+    this->decrypt_errors_++;
+    return false;
+  }
+
+  uint8_t cipher_length = length - FRAME_CIPHER_OFFSET;
+
+  // Build wM-Bus IV per EN 13757-4 for the extended link layer (CI 0x8D):
+  // IV[0-7]  = M-field + A-field (payload bytes 1-8)
+  // IV[8]    = ELL CC (payload byte 10); the ACC at byte 11 is not part of it
+  // IV[9-12] = SN (payload bytes 12-15)
+  // IV[13-15] = 0x00: frame number and block counter
+  uint8_t iv[16];
+  memcpy(iv, &payload[1], 8);
+  iv[8] = payload[10];
+  memcpy(&iv[9], &payload[12], 4);
+  memset(&iv[13], 0, 3);
+
+  // Without a plaintext there is nothing to check or parse; the failure is
+  // counted as a decrypt error only
+  if (!this->aes_ctr_decrypt(&payload[FRAME_CIPHER_OFFSET], plaintext, cipher_length, iv)) {
+    return false;
+  }
+  return this->parse_meter_data(plaintext, cipher_length, reading);
+}
+
+// AES-128 CTR mode decryption using the cached PSA key
+// CTR mode: encrypt counter block, XOR with ciphertext to get plaintext
+bool Multical21Meter::aes_ctr_decrypt(const uint8_t *cipher, uint8_t *plain, uint8_t length, const uint8_t *iv) {
+  if (!this->aes_key_set_) {
+    ESP_LOGW(TAG, "AES key not set, cannot decrypt");
+    this->decrypt_errors_++;
+    return false;
+  }
+
+  uint32_t start = stage_clock();
+  if (!this->keystream_.decrypt(iv, cipher, plain, length)) {
+    this->decrypt_errors_++;
+    return false;
+  }
+  this->decrypt_stage_.record_since(start);
+  return true;
+}
+
+bool Multical21Meter::parse_meter_data(const uint8_t *data, uint8_t length, MeterReading *reading) {
+  if (length < 3) {
+    this->parse_errors_++;
+    return false;
+  }
+
+  // Verify the application CRC first: the link CRCs already passed, so a
+  // mismatch here means the plaintext is wrong (usually the wrong key)
+  uint32_t crc_start = stage_clock();
+  uint16_t calc_crc = crc16_en13757(data + 2, length - 2);
+  uint16_t read_crc = (data[1] << 8) | data[0];
+  uint32_t parse_start = this->crc_stage_.record_since(crc_start);
+
+  if (calc_crc != read_crc) {
+    ESP_LOGW(TAG, "CRC mismatch: expected 0x%04X, got 0x%04X", calc_crc, read_crc);
+    this->app_crc_errors_++;
+    return false;
+  }
+
+  // Both frame types end up as a layout plus the record data it describes
+  const RecordLayout *layout = nullptr;
+  const uint8_t *records = nullptr;
+  uint8_t records_length = 0;
+  uint8_t gathered[MAX_RECORD_DATA];
+
+  if (data[PLAIN_CI] == CI_COMPACT_FRAME) {
+    if (length < COMPACT_DATA_START) {
+      ESP_LOGW(TAG, "Compact frame too short: %d bytes", length);
+      this->parse_errors_++;
+      return false;
+    }
+    uint16_t signature = data[COMPACT_SIGNATURE] | (data[COMPACT_SIGNATURE + 1] << 8);
+    layout = this->formats_.find(signature);
+    if (layout == nullptr) {
+      ESP_LOGW(TAG, "[%08X] Unknown record format 0x%04X, waiting for a long frame", (unsigned) this->meter_id_,
+               signature);
+      this->unknown_formats_++;
+      return false;
+    }
+    records = data + COMPACT_DATA_START;
+    records_length = length - COMPACT_DATA_START;
+  } else if (data[PLAIN_CI] == CI_LONG_FRAME) {
+    uint8_t format[MAX_FORMAT_BYTES];
+    uint8_t format_length;
+    if (split_records(data + LONG_RECORDS_START, length - LONG_RECORDS_START, format, &format_length, gathered,
+                      &records_length)) {
+      layout = this->formats_.learn(format, format_length);
+    }
+    if (layout == nullptr) {
+      ESP_LOGW(TAG, "[%08X] Cannot decode long frame records", (unsigned) this->meter_id_);
+      this->parse_errors_++;
+      return false;
+    }
+    records = gathered;
+  } else {
+    ESP_LOGW(TAG, "Unknown frame type: 0x%02X", data[PLAIN_CI]);
+    this->parse_errors_++;
+    return false;
+  }
+
+  if (records_length < layout->data_length) {
+    ESP_LOGW(TAG, "Frame too short for format 0x%04X: %d record bytes, need %d", layout->signature, records_length,
+             layout->data_length);
+    this->parse_errors_++;
+    return false;
+  }
+
+  // Volumes stay integer litres; float only for the published m3 values
+  static const int8_t LITRES = -3;
+  reading->ms = millis();
+  reading->has_total = layout->total_volume.present();
+  reading->has_target = layout->target_volume.present();
+  reading->total_l = reading->has_total ? (uint32_t) layout->total_volume.scaled(records, LITRES) : 0;
+  reading->month_start_l = reading->has_target ? (uint32_t) layout->target_volume.scaled(records, LITRES) : 0;
+  reading->flow_temperature = layout->flow_temperature.present() ? layout->flow_temperature.value(records) : NAN;
+  reading->external_temperature =
+      layout->external_temperature.present() ? layout->external_temperature.value(records) : NAN;
+  reading->info_codes = layout->info_codes.present() ? (uint16_t) layout->info_codes.raw(records) : 0;
+  reading->formats_learnt = this->formats_.unsaved();
+  this->parse_stage_.record_since(parse_start);
+  return true;
+}
+
+void Multical21Meter::publish_reading(const MeterReading &reading) {
+  bool has_total = reading.has_total;
+  bool has_target = reading.has_target;
+  if (has_total) {
+    this->last_total_l_ = reading.total_l;
+  }
+  if (has_target) {
+    this->last_month_start_l_ = reading.month_start_l;
+  }
+  float flow_temp = reading.flow_temperature;
+  float ambient_temp = reading.external_temperature;
+  this->last_water_temp_ = flow_temp;
+  this->last_ambient_temp_ = ambient_temp;
+
+  this->reading_count_++;
+  if (has_total) {
+    HistoryRecord record{};
+    record.total_l = this->last_total_l_;
+    record.info_codes = reading.info_codes;
+    if (!std::isnan(flow_temp) && !std::isnan(ambient_temp)) {
+      record.flow_temperature = (int8_t) flow_temp;
+      record.external_temperature = (int8_t) ambient_temp;
+      record.flags = HISTORY_TEMPERATURES_VALID;
+    }
+    this->history_.add(record);
+    if (!this->connected_ && this->replay_backlog_ < HISTORY_RAM_RECORDS) {
+      this->replay_backlog_++;
+    }
+  }
+  ESP_LOGI(TAG, "[%08X] Reading #%u - Total: %u.%03u m3, Month start: %u.%03u m3, Water temp: %.0f C, "
+           "Ambient temp: %.0f C",
+           (unsigned) this->meter_id_, this->reading_count_, (unsigned) (this->last_total_l_ / 1000),
+           (unsigned) (this->last_total_l_ % 1000), (unsigned) (this->last_month_start_l_ / 1000),
+           (unsigned) (this->last_month_start_l_ % 1000), flow_temp, ambient_temp);
+
+  // Publish to sensors
+  if (has_total) {
+    this->publish(this->total_consumption_sensor_, this->last_total_l_ / 1000.0f);
+  }
+
+  if (has_target) {
+    this->publish(this->month_start_sensor_, this->last_month_start_l_ / 1000.0f);
+  }
+
+  if (!std::isnan(flow_temp)) {
+    this->publish(this->water_temp_sensor_, flow_temp);
+  }
+
+  if (!std::isnan(ambient_temp)) {
+    this->publish(this->ambient_temp_sensor_, ambient_temp);
+  }
+
+  // Current flow (L/h) over the recent readings
+  if (has_total) {
+    this->flow_.add(reading.ms, this->last_total_l_);
+    uint32_t flow_dlph = 0;
+    bool has_flow = this->flow_.flow_decilitres_per_hour(&flow_dlph);
+    if (has_flow) {
+      this->publish(this->current_flow_sensor_, flow_dlph / 10.0f);
+    } else {
+      ESP_LOGD(TAG, "Flow calculation waiting for a second reading");
+    }
+    this->publish_analytics(reading, has_flow, flow_dlph);
+  }
+
+  // Publish last update
+  if (this->last_update_sensor_ != nullptr) {
+    uint32_t uptime_sec = reading.ms / 1000;
+    uint32_t hours = uptime_sec / 3600;
+    uint32_t minutes = (uptime_sec % 3600) / 60;
+    uint32_t seconds = uptime_sec % 60;
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "#%lu (uptime: %02lu:%02lu:%02lu)",
+             (unsigned long) this->reading_count_,
+             (unsigned long) hours, (unsigned long) minutes, (unsigned long) seconds);
+    this->last_update_sensor_->publish_state(buffer);
+  }
+}
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,328 @@
+// Multical21 ESPHome Component - Meter
+// One Kamstrup Multical 21 meter served by a Multical21Component radio hub
+//
+// Based on work by:
+//   Patrik Thalin - https://github.com/pthalin/esp32-multical21
+//   Chester - https://github.com/chester4444/esp-multical21
+
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#ifdef USE_TIME
+#include "esphome/components/time/real_time_clock.h"
+#endif
+#include "aes_keystream.h"
+#include "consumption_analytics.h"
+#include "flow_estimator.h"
+#include "format_cache.h"
+#include "link_quality.h"
+#include "publish_policy.h"
+#include "reading_history.h"
+#include "stage_timer.h"
+#include "telegram_filter.h"
+#include "transmit_schedule.h"
+#include "wmbus_link.h"
+#include <string>
+
+namespace esphome {
+namespace multical21 {
+
+// Maximum frame length (largest L-field value, i.e. full-size wM-Bus telegrams)
+static const uint8_t MAX_FRAME_LENGTH = 255;
+
+// Two radios' copies of one telegram arrive within this of each other;
+// telegrams from one meter are seconds apart
+static const uint32_t TELEGRAM_COPY_WINDOW_MS = 50;
+
+// A decoded telegram, handed from frame processing to publishing. Volumes in
+// whole litres; temperatures NAN where the record format has none.
+struct MeterReading {
+  uint32_t ms;  // millis() when it was decoded
+  uint32_t total_l;
+  uint32_t month_start_l;
+  float flow_temperature;
+  float external_temperature;
+  uint16_t info_codes;
+  bool has_total;
+  bool has_target;
+  bool formats_learnt;  // Decoding learnt a record format that is not in flash yet
+};
+
+// What frame processing counts and measures for a meter, copied in one go
+// under the hub's frame lock so update() can log and publish it while the
+// receive task carries on
+struct MeterDiagnostics {
+  HistoryCounters counters;
+  uint32_t decrypt_errors;
+  uint32_t parse_errors;
+  uint32_t unknown_formats;
+  uint32_t missed_telegrams;
+  uint32_t repeated_telegrams;
+  StageStats decrypt;
+  StageStats crc;
+  StageStats parse;
+  StageStats frame;
+  LinkQuality link;
+};
+
+// Meter ID as a single integer: the A-field ID bytes (payload bytes 3-6) read
+// little endian, which equals the 8 hex characters on the sticker read big endian
+inline uint32_t meter_id_from_payload(const uint8_t *payload) {
+  return (uint32_t) payload[3] | ((uint32_t) payload[4] << 8) | ((uint32_t) payload[5] << 16) |
+         ((uint32_t) payload[6] << 24);
+}
+
+class Multical21Meter {
+ public:
+  void set_meter_id(const std::string &meter_id);
+  void set_key(const std::string &key);
+  uint32_t get_meter_id() const { return this->meter_id_; }
+  // Called from the hub's setup(), after the meter ID is set
+  void setup();
+  // How often new readings are written to flash; 0 keeps them in RAM only
+  void set_history_flush_interval(uint32_t interval_ms) { this->history_flush_interval_ms_ = interval_ms; }
+
+  void set_total_consumption_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->total_consumption_sensor_.set_sensor(sensor, policy);
+  }
+  void set_month_start_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->month_start_sensor_.set_sensor(sensor, policy);
+  }
+  void set_water_temp_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->water_temp_sensor_.set_sensor(sensor, policy);
+  }
+  void set_ambient_temp_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->ambient_temp_sensor_.set_sensor(sensor, policy);
+  }
+  void set_current_flow_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->current_flow_sensor_.set_sensor(sensor, policy);
+  }
+  void set_last_update_sensor(text_sensor::TextSensor *sensor) { this->last_update_sensor_ = sensor; }
+  void set_frames_received_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->frames_received_sensor_.set_sensor(sensor, policy);
+  }
+  void set_crc_errors_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->crc_errors_sensor_.set_sensor(sensor, policy);
+  }
+  void set_link_crc_errors_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->link_crc_errors_sensor_.set_sensor(sensor, policy);
+  }
+  void set_signal_quality_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->signal_quality_sensor_.set_sensor(sensor, policy);
+  }
+  void set_decrypt_time_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->decrypt_time_sensor_.set_sensor(sensor, policy);
+  }
+  void set_history_records_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->history_records_sensor_.set_sensor(sensor, policy);
+  }
+  void set_history_flash_writes_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->history_flash_writes_sensor_.set_sensor(sensor, policy);
+  }
+  void set_processing_time_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->processing_time_sensor_.set_sensor(sensor, policy);
+  }
+  void set_rssi_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->rssi_sensor_.set_sensor(sensor, policy);
+  }
+  void set_rssi_min_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->rssi_min_sensor_.set_sensor(sensor, policy);
+  }
+  void set_rssi_max_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->rssi_max_sensor_.set_sensor(sensor, policy);
+  }
+  void set_lqi_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->lqi_sensor_.set_sensor(sensor, policy);
+  }
+  void set_missed_telegrams_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->missed_telegrams_sensor_.set_sensor(sensor, policy);
+  }
+  void set_rssi_histogram_sensor(text_sensor::TextSensor *sensor) { this->rssi_histogram_sensor_ = sensor; }
+  void set_continuous_flow_duration_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->continuous_flow_duration_sensor_.set_sensor(sensor, policy);
+  }
+  void set_peak_flow_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->peak_flow_sensor_.set_sensor(sensor, policy);
+  }
+  void set_night_min_flow_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->night_min_flow_sensor_.set_sensor(sensor, policy);
+  }
+  void set_reverse_flow_events_sensor(sensor::Sensor *sensor, const PublishPolicy &policy = {}) {
+    this->reverse_flow_events_sensor_.set_sensor(sensor, policy);
+  }
+  // The meter's own info flags
+  void set_dry_sensor(binary_sensor::BinarySensor *sensor) { this->dry_sensor_ = sensor; }
+  void set_reverse_flow_sensor(binary_sensor::BinarySensor *sensor) { this->reverse_flow_sensor_ = sensor; }
+  void set_leak_sensor(binary_sensor::BinarySensor *sensor) { this->leak_sensor_ = sensor; }
+  void set_burst_sensor(binary_sensor::BinarySensor *sensor) { this->burst_sensor_ = sensor; }
+
+  // Called by the hub for every frame addressed to this meter that passed its
+  // link CRCs. `payload` is the data after the L-field with the CRCs stripped.
+  // `scratch` must hold at least MAX_FRAME_LENGTH bytes for the plaintext.
+  // Decrypts, checks and parses the frame into `reading`; false if nothing
+  // could be read from it. Runs on the receive task when there is one.
+  bool decode_frame(const uint8_t *payload, uint8_t length, uint8_t *scratch, MeterReading *reading);
+  // Called by the hub from loop() with each reading decode_frame() returned
+  void publish_reading(const MeterReading &reading);
+  // decode_frame() and publish_reading() in one, for callers without a hub
+  bool handle_frame(const uint8_t *payload, uint8_t length, uint8_t *scratch);
+  // Called by the hub from the main loop, with frame processing held off:
+  // write record formats learnt since the last call to flash
+  void save_learnt_formats() { this->formats_.save_learnt(); }
+  // Called from the hub's setup() when it has more than one radio
+  void set_diversity(bool diversity) { this->copy_window_ms_ = diversity ? TELEGRAM_COPY_WINDOW_MS : 0; }
+  // Called by the hub with the millis() time of the sync word of every frame
+  // for this meter, first thing once the ID is read, to learn when the next
+  // one is due. With diversity, a frame arriving within
+  // TELEGRAM_COPY_WINDOW_MS of the last one is a copy of the same telegram,
+  // and the calls below treat it as such. The arrival goes into the transmit
+  // schedule unless accept_telegram() finds the frame is a repeat.
+  void record_arrival(uint32_t arrival_ms);
+  // Called by the hub for a frame with this meter's ID that failed a link CRC.
+  // A telegram counts once, and not at all if another copy got through.
+  void record_link_crc_error();
+  // Called by the hub with the RSSI and LQI of every frame for this meter that
+  // got past the ID, including frames then dropped on a link CRC. Of two
+  // copies the stronger one is kept.
+  void record_signal(uint8_t rssi, uint8_t lqi_status);
+  const LinkQuality &get_link_quality() const { return this->link_quality_; }
+  // Called by the hub for a frame that passed its link CRCs, before
+  // handle_frame(). False for a telegram already handled, from the other
+  // radio or a repeater, by access number and header hash; the hub drops it
+  // undecrypted.
+  bool accept_telegram(const uint8_t *payload, uint8_t length);
+  TransmitSchedule &get_schedule() { return this->schedule_; }
+  ConsumptionAnalytics &get_analytics() { return this->analytics_; }
+#ifdef USE_TIME
+  // Local time for the night minimum flow; without it that sensor stays empty
+  void set_time(time::RealTimeClock *time) { this->time_ = time; }
+#endif
+
+  uint32_t get_unknown_formats() const { return this->unknown_formats_; }
+
+  // Called by the hub every update(): replays readings missed while Home
+  // Assistant / MQTT was disconnected and flushes the history when due, with
+  // the counters from diagnostics()
+  void update_history(bool connected, const HistoryCounters &counters);
+  // Write unflushed readings now, e.g. before a reboot; frame processing must
+  // not be running
+  void flush_history();
+  const ReadingHistory &get_history() const { return this->history_; }
+
+  // Snapshot for publish_diagnostics(); take it where frames are not being processed
+  MeterDiagnostics diagnostics() const;
+  void publish_diagnostics(const MeterDiagnostics &diagnostics);
+  void dump_config();
+
+ protected:
+  bool decrypt_frame(const uint8_t *payload, uint8_t length, uint8_t *plaintext, MeterReading *reading);
+  bool parse_meter_data(const uint8_t *data, uint8_t length, MeterReading *reading);
+  template<typename S> void publish(S &sensor, float value) { sensor.publish(value, &this->publish_stats_); }
+  void replay_history(uint8_t records);
+  void publish_rssi_histogram(const LinkQuality &link);
+  void publish_analytics(const MeterReading &reading, bool has_flow, uint32_t flow_dlph);
+  int8_t local_hour() const;
+  void schedule_telegram();
+  HistoryCounters history_counters() const;
+
+  // AES-128 CTR decryption (using the cached PSA keystream engine)
+  // Returns false, counting a decrypt error, when no plaintext could be produced
+  bool aes_ctr_decrypt(const uint8_t *cipher, uint8_t *plain, uint8_t length, const uint8_t *iv);
+
+  // Utility
+  void hex_to_bytes(const std::string &hex, uint8_t *bytes, size_t len);
+
+  uint32_t meter_id_{0};
+  AesKeystream keystream_;  // PSA key the payload keystream is generated with
+  bool aes_key_set_{false};
+  // Note: keys are imported immediately when `set_key()` is called, and the
+  // raw key is not kept.
+  FormatCache formats_;  // Record layouts by compact frame signature
+
+  // Sensors
+  SlotSensor<SLOT_TOTAL_CONSUMPTION> total_consumption_sensor_;
+  SlotSensor<SLOT_MONTH_START_VALUE> month_start_sensor_;
+  SlotSensor<SLOT_WATER_TEMPERATURE> water_temp_sensor_;
+  SlotSensor<SLOT_AMBIENT_TEMPERATURE> ambient_temp_sensor_;
+  SlotSensor<SLOT_CURRENT_FLOW> current_flow_sensor_;
+  text_sensor::TextSensor *last_update_sensor_{nullptr};
+  SlotSensor<SLOT_FRAMES_RECEIVED> frames_received_sensor_;
+  SlotSensor<SLOT_CRC_ERRORS> crc_errors_sensor_;
+  SlotSensor<SLOT_LINK_CRC_ERRORS> link_crc_errors_sensor_;
+  SlotSensor<SLOT_SIGNAL_QUALITY> signal_quality_sensor_;
+  SlotSensor<SLOT_DECRYPT_TIME> decrypt_time_sensor_;
+  SlotSensor<SLOT_PROCESSING_TIME> processing_time_sensor_;
+  SlotSensor<SLOT_HISTORY_RECORDS> history_records_sensor_;
+  SlotSensor<SLOT_HISTORY_FLASH_WRITES> history_flash_writes_sensor_;
+  SlotSensor<SLOT_RSSI> rssi_sensor_;
+  SlotSensor<SLOT_RSSI_MIN> rssi_min_sensor_;
+  SlotSensor<SLOT_RSSI_MAX> rssi_max_sensor_;
+  SlotSensor<SLOT_LQI> lqi_sensor_;
+  SlotSensor<SLOT_MISSED_TELEGRAMS> missed_telegrams_sensor_;
+  text_sensor::TextSensor *rssi_histogram_sensor_{nullptr};
+  SlotSensor<SLOT_CONTINUOUS_FLOW_DURATION> continuous_flow_duration_sensor_;
+  SlotSensor<SLOT_PEAK_FLOW> peak_flow_sensor_;
+  SlotSensor<SLOT_NIGHT_MIN_FLOW> night_min_flow_sensor_;
+  SlotSensor<SLOT_REVERSE_FLOW_EVENTS> reverse_flow_events_sensor_;
+  binary_sensor::BinarySensor *dry_sensor_{nullptr};
+  binary_sensor::BinarySensor *reverse_flow_sensor_{nullptr};
+  binary_sensor::BinarySensor *leak_sensor_{nullptr};
+  binary_sensor::BinarySensor *burst_sensor_{nullptr};
+
+  // Last values; volumes in whole litres, converted to m3 only when published
+  uint32_t last_total_l_{0};
+  uint32_t last_month_start_l_{0};
+  float last_water_temp_{0};
+  float last_ambient_temp_{0};
+
+  FlowEstimator flow_;
+  ConsumptionAnalytics analytics_;  // Fed from the published readings
+#ifdef USE_TIME
+  time::RealTimeClock *time_{nullptr};
+#endif
+
+  // Reading history; readings taken while disconnected are replayed on reconnect
+  ReadingHistory history_;
+  uint32_t history_flush_interval_ms_{0};
+  uint32_t last_history_flush_ms_{0};
+  uint8_t replay_backlog_{0};
+  bool connected_{true};
+
+  // Diagnostics
+  uint32_t frames_received_{0};
+  uint32_t link_crc_errors_{0};  // Corrupted on air, dropped before decryption
+  uint32_t app_crc_errors_{0};   // Decrypted plaintext failed its CRC (wrong key)
+  uint32_t decrypt_errors_{0};
+  uint32_t parse_errors_{0};
+  uint32_t unknown_formats_{0};  // Compact frames whose format no long frame has shown yet
+  uint32_t reading_count_{0};
+  PublishStats publish_stats_;
+  LinkQuality link_quality_;
+  uint32_t histogram_published_frames_{0};  // link_quality_.frames() at the last histogram publish
+  TransmitSchedule schedule_;
+
+  TelegramFilter telegrams_;  // Telegrams decoded lately, and ACC steps
+
+  // The telegram whose copies are coming in; with a single radio every frame
+  // is a telegram of its own
+  uint32_t copy_window_ms_{0};
+  bool telegram_seen_{false};
+  uint32_t telegram_ms_{0};          // Arrival of its first copy
+  bool telegram_copy_{false};        // The frame being received is not its first copy
+  bool telegram_handled_{false};     // A copy passed the link CRCs
+  bool telegram_link_error_{false};  // A copy failed and is counted in link_crc_errors_
+  bool telegram_scheduled_{false};   // Its arrival went into schedule_, or was left out as a repeat
+
+  // Stage timing; frame_stage_ covers the whole of decode_frame()
+  StageStats decrypt_stage_;
+  StageStats crc_stage_;
+  StageStats parse_stage_;
+  StageStats frame_stage_;
+};
+
+}  // namespace multical21
+}  // namespace esphome
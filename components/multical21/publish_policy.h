@@ -0,0 +1,200 @@
+// Multical21 ESPHome Component - Sensor publish policy
+//
+// A meter sends a telegram every ~16 s and update() runs every second, but
+// most values do not change between them. Every publish_state() is a Home
+// Assistant state change or an MQTT message, so values go through a
+// PolicySensor that publishes on change (optionally past a delta), no more
+// often than a minimum interval and at least every heartbeat interval.
+//
+// Codegen sets MULTICAL21_SENSOR_SLOTS to the sensors configured in YAML, one
+// bit per SensorSlot. The slot of a sensor no entry configures is a NoSensor
+// of one byte, which drops its values, instead of a PolicySensor; builds
+// without codegen keep every slot.
+
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/components/sensor/sensor.h"
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#ifndef MULTICAL21_SENSOR_SLOTS
+#define MULTICAL21_SENSOR_SLOTS 0xFFFFFFFFFFFFFFFFULL
+#endif
+
+namespace esphome {
+namespace multical21 {
+
+struct PublishPolicy {
+  bool only_on_change{true};
+  float min_delta{0.0f};         // Change needed to publish; 0 = any change
+  uint32_t min_interval_ms{0};   // Changes inside it are held back, the latest is sent when it ends
+  uint32_t max_interval_ms{0};   // Republish an unchanged value this often; 0 = never
+};
+
+// Per-owner totals, shown in the stats log and dump_config()
+struct PublishStats {
+  uint32_t sent{0};
+  uint32_t suppressed{0};
+};
+
+class PolicySensor {
+ public:
+  void set_sensor(sensor::Sensor *sensor, const PublishPolicy &policy) {
+    this->sensor_ = sensor;
+    this->policy_ = policy;
+  }
+  bool has_sensor() const { return this->sensor_ != nullptr; }
+
+  // Offer a new value: published now, held until the minimum interval ends,
+  // or dropped if it does not differ enough from the last published value
+  void publish(float value, PublishStats *stats) {
+    if (this->sensor_ == nullptr) {
+      return;
+    }
+    uint32_t now = millis();
+    if (!this->published_) {
+      this->send(value, now, stats);
+      return;
+    }
+
+    if (!this->changed(value)) {
+      if (this->heartbeat_due(now)) {
+        this->send(value, now, stats);
+        return;
+      }
+      stats->suppressed++;
+      if (this->pending_) {
+        // The value went back before a held change was sent: drop that too
+        stats->suppressed++;
+        this->pending_ = false;
+      }
+      return;
+    }
+
+    if (now - this->last_ms_ < this->policy_.min_interval_ms) {
+      if (this->pending_) {
+        stats->suppressed++;  // Superseded by this one
+      }
+      this->pending_value_ = value;
+      this->pending_ = true;
+      return;
+    }
+    this->send(value, now, stats);
+  }
+
+  // Publish unconditionally, e.g. a reading replayed from history. The
+  // value does not become the reference for later changes.
+  void replay(float value, PublishStats *stats) {
+    if (this->sensor_ == nullptr) {
+      return;
+    }
+    this->sensor_->publish_state(value);
+    stats->sent++;
+  }
+
+  // Called periodically: send a held value once the minimum interval has
+  // passed, and the heartbeat when it is due
+  void flush(PublishStats *stats) {
+    if (this->sensor_ == nullptr || !this->published_) {
+      return;
+    }
+    uint32_t now = millis();
+    if (this->pending_ && now - this->last_ms_ >= this->policy_.min_interval_ms) {
+      this->send(this->pending_value_, now, stats);
+    } else if (this->heartbeat_due(now)) {
+      this->send(this->pending_ ? this->pending_value_ : this->last_value_, now, stats);
+    }
+  }
+
+ protected:
+  bool changed(float value) const {
+    if (!this->policy_.only_on_change) {
+      return true;
+    }
+    if (std::isnan(value) != std::isnan(this->last_value_)) {
+      return true;
+    }
+    float delta = std::fabs(value - this->last_value_);
+    return this->policy_.min_delta > 0.0f ? delta >= this->policy_.min_delta : delta > 0.0f;
+  }
+
+  bool heartbeat_due(uint32_t now) const {
+    return this->policy_.max_interval_ms > 0 && now - this->last_ms_ >= this->policy_.max_interval_ms;
+  }
+
+  void send(float value, uint32_t now, PublishStats *stats) {
+    this->sensor_->publish_state(value);
+    this->last_value_ = value;
+    this->last_ms_ = now;
+    this->published_ = true;
+    this->pending_ = false;
+    stats->sent++;
+  }
+
+  sensor::Sensor *sensor_{nullptr};
+  PublishPolicy policy_;
+  float last_value_{NAN};
+  float pending_value_{NAN};
+  uint32_t last_ms_{0};
+  bool published_{false};
+  bool pending_{false};
+};
+
+// Sensor platform keys, in the order of SENSOR_SLOTS in __init__.py
+enum SensorSlot : uint8_t {
+  // Per meter
+  SLOT_TOTAL_CONSUMPTION = 0,
+  SLOT_MONTH_START_VALUE,
+  SLOT_WATER_TEMPERATURE,
+  SLOT_AMBIENT_TEMPERATURE,
+  SLOT_CURRENT_FLOW,
+  SLOT_FRAMES_RECEIVED,
+  SLOT_CRC_ERRORS,
+  SLOT_LINK_CRC_ERRORS,
+  SLOT_SIGNAL_QUALITY,
+  SLOT_DECRYPT_TIME,
+  SLOT_PROCESSING_TIME,
+  SLOT_HISTORY_RECORDS,
+  SLOT_HISTORY_FLASH_WRITES,
+  SLOT_RSSI,
+  SLOT_RSSI_MIN,
+  SLOT_RSSI_MAX,
+  SLOT_LQI,
+  SLOT_MISSED_TELEGRAMS,
+  // Per radio hub
+  SLOT_ACCEPTED_FRAMES,
+  SLOT_FOREIGN_FRAMES,
+  SLOT_RX_DUTY_CYCLE,
+  SLOT_PREDICTION_HIT_RATE,
+  SLOT_FREQUENCY_OFFSET,
+  SLOT_FREQUENCY_CORRECTIONS,
+  SLOT_RADIO_ACCEPTED_FRAMES,  // radio1_ and radio2_accepted_frames
+  SLOT_DUPLICATE_FRAMES,
+  SLOT_READING_QUEUE_HIGH_WATER,
+  SLOT_READING_QUEUE_DROPS,
+  // Per meter, consumption analytics
+  SLOT_CONTINUOUS_FLOW_DURATION,
+  SLOT_PEAK_FLOW,
+  SLOT_NIGHT_MIN_FLOW,
+  SLOT_REVERSE_FLOW_EVENTS,
+};
+
+constexpr bool sensor_slot_used(SensorSlot slot) { return ((MULTICAL21_SENSOR_SLOTS >> slot) & 1) != 0; }
+
+// Stands in for the PolicySensor of a slot no sensor entry configures
+class NoSensor {
+ public:
+  void set_sensor(sensor::Sensor *sensor, const PublishPolicy &policy) {}
+  bool has_sensor() const { return false; }
+  void publish(float value, PublishStats *stats) {}
+  void replay(float value, PublishStats *stats) {}
+  void flush(PublishStats *stats) {}
+};
+
+template<SensorSlot S> using SlotSensor = typename std::conditional<sensor_slot_used(S), PolicySensor, NoSensor>::type;
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,27 @@
+// Multical21 ESPHome Component - Radio transport
+//
+// Byte-level access to the CC1101. On target Multical21Component implements
+// it with its SPIDevice; host builds plug in a simulated CC1101 instead, so
+// the receive/decrypt/parse pipeline can run off-target.
+
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+class RadioTransport {
+ public:
+  virtual ~RadioTransport() = default;
+
+  // Chip select low / high around one register or FIFO transaction
+  virtual void select() = 0;
+  virtual void deselect() = 0;
+
+  // Full-duplex byte transfer; returns the byte clocked out by the radio
+  virtual uint8_t transfer(uint8_t data) = 0;
+};
+
+}  // namespace multical21
+}  // namespace esphome
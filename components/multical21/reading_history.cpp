@@ -0,0 +1,110 @@
+// Multical21 ESPHome Component - Reading history
+
+#include "reading_history.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cstring>
+
+namespace esphome {
+namespace multical21 {
+
+static const char *const TAG = "multical21.history";
+
+static_assert(sizeof(HistoryRecord) == 16, "history records are stored in flash as-is");
+
+bool ReadingHistory::load(uint32_t meter_id, HistoryCounters *counters) {
+  uint32_t key = fnv1_hash("multical21.history") ^ meter_id;
+  for (uint8_t slot = 0; slot < HISTORY_FLASH_SLOTS; slot++) {
+    this->slots_[slot] = global_preferences->make_preference<Page>(key + slot, true);
+  }
+  this->boot_pref_ = global_preferences->make_preference<uint16_t>(key + HISTORY_FLASH_SLOTS, true);
+
+  // Pages are replayed oldest first so the ring ends with the newest records
+  Page pages[HISTORY_FLASH_SLOTS];
+  bool valid[HISTORY_FLASH_SLOTS] = {false};
+  for (uint8_t slot = 0; slot < HISTORY_FLASH_SLOTS; slot++) {
+    valid[slot] = this->slots_[slot].load(&pages[slot]) && pages[slot].count <= HISTORY_PAGE_RECORDS;
+  }
+  bool found = false;
+  while (true) {
+    int oldest = -1;
+    for (uint8_t slot = 0; slot < HISTORY_FLASH_SLOTS; slot++) {
+      if (valid[slot] && (oldest < 0 || pages[slot].sequence < pages[oldest].sequence)) {
+        oldest = slot;
+      }
+    }
+    if (oldest < 0) {
+      break;
+    }
+    const Page &page = pages[oldest];
+    for (uint8_t i = 0; i < page.count; i++) {
+      this->push(page.records[i]);
+    }
+    *counters = page.counters;
+    this->next_sequence_ = page.sequence + 1;
+    valid[oldest] = false;
+    found = true;
+  }
+  this->unflushed_ = 0;
+
+  uint16_t boot = 0;
+  this->boot_pref_.load(&boot);
+  this->boot_ = boot + 1;
+  if (this->boot_pref_.save(&this->boot_)) {
+    this->flash_writes_++;
+  }
+  if (found) {
+    ESP_LOGD(TAG, "[%08X] Boot %u, restored %u readings", (unsigned) meter_id, this->boot_, this->count_);
+  }
+  return found;
+}
+
+void ReadingHistory::add(HistoryRecord record) {
+  record.boot = this->boot_;
+  record.uptime_s = this->uptime_s();
+  this->push(record);
+  if (this->unflushed_ < HISTORY_RAM_RECORDS) {
+    this->unflushed_++;
+  }
+}
+
+void ReadingHistory::push(const HistoryRecord &record) {
+  this->head_ = (uint8_t) ((this->head_ + 1) % HISTORY_RAM_RECORDS);
+  this->records_[this->head_] = record;
+  if (this->count_ < HISTORY_RAM_RECORDS) {
+    this->count_++;
+  }
+}
+
+void ReadingHistory::flush(const HistoryCounters &counters) {
+  while (this->unflushed_ > 0) {
+    Page page;
+    memset(&page, 0, sizeof(page));
+    page.sequence = this->next_sequence_;
+    page.count = this->unflushed_ < HISTORY_PAGE_RECORDS ? this->unflushed_ : HISTORY_PAGE_RECORDS;
+    page.counters = counters;
+    for (uint8_t i = 0; i < page.count; i++) {
+      page.records[i] = this->at(this->unflushed_ - 1 - i);
+    }
+    if (!this->slots_[page.sequence % HISTORY_FLASH_SLOTS].save(&page)) {
+      ESP_LOGW(TAG, "Failed to save reading history");
+      return;
+    }
+    this->next_sequence_++;
+    this->flash_writes_++;
+    this->unflushed_ -= page.count;
+  }
+}
+
+uint32_t ReadingHistory::uptime_s() {
+  uint32_t now = millis();
+  if (now < this->last_millis_) {
+    this->millis_wraps_++;
+  }
+  this->last_millis_ = now;
+  return (uint32_t) ((((uint64_t) this->millis_wraps_ << 32) | now) / 1000);
+}
+
+}  // namespace multical21
+}  // namespace esphome
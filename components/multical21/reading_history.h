@@ -0,0 +1,93 @@
+// Multical21 ESPHome Component - Reading history
+//
+// The last readings of a meter are kept in a RAM ring of compact records and
+// written to flash in pages at a configurable interval, so they survive a
+// reboot and can be replayed after the Home Assistant or MQTT connection was
+// down. Each flush writes only the records added since the previous one, and
+// successive pages rotate over HISTORY_FLASH_SLOTS preference slots, so no
+// single slot takes every write. Together with the flush interval this bounds
+// flash wear to a few small writes per hour regardless of the telegram rate.
+
+#pragma once
+
+#include "esphome/core/preferences.h"
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+static const uint8_t HISTORY_RAM_RECORDS = 32;
+static const uint8_t HISTORY_PAGE_RECORDS = 8;
+static const uint8_t HISTORY_FLASH_SLOTS = 4;  // Flash keeps the last 4 pages (32 records)
+
+static const uint8_t HISTORY_TEMPERATURES_VALID = 0x01;
+
+// One reading, 16 bytes. Time is seconds of uptime within a numbered boot,
+// as the device has no clock of its own.
+struct HistoryRecord {
+  uint16_t boot;
+  uint16_t info_codes;
+  uint32_t uptime_s;
+  uint32_t total_l;
+  int8_t flow_temperature;
+  int8_t external_temperature;
+  uint8_t flags;
+  uint8_t reserved;
+};
+
+// Meter counters saved with every page, so they continue after a reboot
+struct HistoryCounters {
+  uint32_t frames_received;
+  uint32_t link_crc_errors;
+  uint32_t app_crc_errors;
+  uint32_t reading_count;
+};
+
+class ReadingHistory {
+ public:
+  // Restore the saved pages and bump the boot number. Returns false, leaving
+  // `counters` untouched, when nothing was saved for this meter yet.
+  bool load(uint32_t meter_id, HistoryCounters *counters);
+
+  // Append a reading stamped with the current boot and uptime
+  void add(HistoryRecord record);
+  // Write the records added since the last flush, one page per slot
+  void flush(const HistoryCounters &counters);
+
+  uint8_t size() const { return this->count_; }
+  uint8_t unflushed() const { return this->unflushed_; }
+  // `back` records before the newest; back < size()
+  const HistoryRecord &at(uint8_t back) const {
+    return this->records_[(this->head_ + HISTORY_RAM_RECORDS - back) % HISTORY_RAM_RECORDS];
+  }
+  uint16_t boot() const { return this->boot_; }
+  uint32_t flash_writes() const { return this->flash_writes_; }
+
+ protected:
+  struct Page {
+    uint32_t sequence;
+    uint8_t count;
+    uint8_t reserved[3];
+    HistoryCounters counters;
+    HistoryRecord records[HISTORY_PAGE_RECORDS];
+  };
+
+  void push(const HistoryRecord &record);
+  uint32_t uptime_s();
+
+  HistoryRecord records_[HISTORY_RAM_RECORDS]{};
+  uint8_t head_{HISTORY_RAM_RECORDS - 1};
+  uint8_t count_{0};
+  uint8_t unflushed_{0};
+  uint16_t boot_{0};
+  uint32_t next_sequence_{0};
+  uint32_t flash_writes_{0};
+  // millis() wraps after ~49 days; count the wraps to keep uptime monotonic
+  uint32_t last_millis_{0};
+  uint32_t millis_wraps_{0};
+  ESPPreferenceObject slots_[HISTORY_FLASH_SLOTS];
+  ESPPreferenceObject boot_pref_;
+};
+
+}  // namespace multical21
+}  // namespace esphome
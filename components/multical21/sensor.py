@@ -7,6 +7,8 @@ import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import sensor
 from esphome.const import (
+    DEVICE_CLASS_DURATION,
+    DEVICE_CLASS_SIGNAL_STRENGTH,
     DEVICE_CLASS_WATER,
     DEVICE_CLASS_TEMPERATURE,
     DEVICE_CLASS_VOLUME_FLOW_RATE,
@@ -16,11 +18,20 @@ from esphome.const import (
     STATE_CLASS_MEASUREMENT,
     UNIT_CELSIUS,
     UNIT_CUBIC_METER,
+    UNIT_DECIBEL_MILLIWATT,
+    UNIT_HOUR,
     UNIT_PERCENT,
 )
-from . import Multical21Component
+from . import (
+    CONF_METER,
+    multical21_ns,
+    CONF_MULTICAL21_ID,
+    Multical21Component,
+    Multical21Meter,
+    final_validate_meter_reference,
+    get_meter,
+)
 
-CONF_MULTICAL21_ID = "multical21_id"
 CONF_TOTAL_CONSUMPTION = "total_consumption"
 CONF_MONTH_START_VALUE = "month_start_value"
 CONF_WATER_TEMPERATURE = "water_temperature"
@@ -28,105 +39,444 @@ CONF_AMBIENT_TEMPERATURE = "ambient_temperature"
 CONF_CURRENT_FLOW = "current_flow"
 CONF_FRAMES_RECEIVED = "frames_received"
 CONF_CRC_ERRORS = "crc_errors"
+CONF_LINK_CRC_ERRORS = "link_crc_errors"
 CONF_SIGNAL_QUALITY = "signal_quality"
+CONF_DECRYPT_TIME = "decrypt_time"
+CONF_PROCESSING_TIME = "processing_time"
+CONF_ACCEPTED_FRAMES = "accepted_frames"
+CONF_FOREIGN_FRAMES = "foreign_frames"
+CONF_HISTORY_RECORDS = "history_records"
+CONF_HISTORY_FLASH_WRITES = "history_flash_writes"
+CONF_RSSI = "rssi"
+CONF_RSSI_MIN = "rssi_min"
+CONF_RSSI_MAX = "rssi_max"
+CONF_LQI = "lqi"
+CONF_MISSED_TELEGRAMS = "missed_telegrams"
+CONF_RX_DUTY_CYCLE = "rx_duty_cycle"
+CONF_PREDICTION_HIT_RATE = "prediction_hit_rate"
+CONF_FREQUENCY_OFFSET = "frequency_offset"
+CONF_FREQUENCY_CORRECTIONS = "frequency_corrections"
+CONF_RADIO1_ACCEPTED_FRAMES = "radio1_accepted_frames"
+CONF_RADIO2_ACCEPTED_FRAMES = "radio2_accepted_frames"
+CONF_DUPLICATE_FRAMES = "duplicate_frames"
+CONF_READING_QUEUE_HIGH_WATER = "reading_queue_high_water"
+CONF_READING_QUEUE_DROPS = "reading_queue_drops"
+CONF_CONTINUOUS_FLOW_DURATION = "continuous_flow_duration"
+CONF_PEAK_FLOW = "peak_flow"
+CONF_NIGHT_MIN_FLOW = "night_min_flow"
+CONF_REVERSE_FLOW_EVENTS = "reverse_flow_events"
+
+# Publish policy, accepted by every sensor
+CONF_ONLY_ON_CHANGE = "only_on_change"
+CONF_MIN_DELTA = "min_delta"
+CONF_MIN_INTERVAL = "min_interval"
+CONF_MAX_INTERVAL = "max_interval"
 
 # Unit constants not in esphome.const
 UNIT_LITERS_PER_HOUR = "L/h"
+UNIT_MICROSECONDS = "µs"
+UNIT_KILOHERTZ = "kHz"
 
 DEPENDENCIES = ["multical21"]
 
+PublishPolicy = multical21_ns.struct("PublishPolicy")
+
+PUBLISH_POLICY_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_ONLY_ON_CHANGE, default=True): cv.boolean,
+        cv.Optional(CONF_MIN_DELTA, default=0.0): cv.positive_float,
+        cv.Optional(CONF_MIN_INTERVAL, default="0s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_INTERVAL, default="0s"): cv.positive_time_period_milliseconds,
+    }
+)
+
+
+def policy_sensor_schema(**kwargs):
+    """A sensor schema that also takes the publish policy options."""
+    return sensor.sensor_schema(**kwargs).extend(PUBLISH_POLICY_SCHEMA)
+
+
+def publish_policy(config):
+    return cg.StructInitializer(
+        PublishPolicy,
+        ("only_on_change", config[CONF_ONLY_ON_CHANGE]),
+        ("min_delta", config[CONF_MIN_DELTA]),
+        ("min_interval_ms", config[CONF_MIN_INTERVAL].total_milliseconds),
+        ("max_interval_ms", config[CONF_MAX_INTERVAL].total_milliseconds),
+    )
+
+
 CONFIG_SCHEMA = cv.Schema(
     {
         cv.GenerateID(CONF_MULTICAL21_ID): cv.use_id(Multical21Component),
-        cv.Optional(CONF_TOTAL_CONSUMPTION): sensor.sensor_schema(
+        cv.Optional(CONF_METER): cv.use_id(Multical21Meter),
+        cv.Optional(CONF_TOTAL_CONSUMPTION): policy_sensor_schema(
             unit_of_measurement=UNIT_CUBIC_METER,
             icon="mdi:water",
             accuracy_decimals=3,
             device_class=DEVICE_CLASS_WATER,
             state_class=STATE_CLASS_TOTAL_INCREASING,
         ),
-        cv.Optional(CONF_MONTH_START_VALUE): sensor.sensor_schema(
+        cv.Optional(CONF_MONTH_START_VALUE): policy_sensor_schema(
             unit_of_measurement=UNIT_CUBIC_METER,
             icon="mdi:calendar-month",
             accuracy_decimals=3,
             device_class=DEVICE_CLASS_WATER,
             state_class=STATE_CLASS_TOTAL_INCREASING,
         ),
-        cv.Optional(CONF_WATER_TEMPERATURE): sensor.sensor_schema(
+        cv.Optional(CONF_WATER_TEMPERATURE): policy_sensor_schema(
             unit_of_measurement=UNIT_CELSIUS,
             icon="mdi:thermometer-water",
             accuracy_decimals=0,
             device_class=DEVICE_CLASS_TEMPERATURE,
             state_class=STATE_CLASS_MEASUREMENT,
         ),
-        cv.Optional(CONF_AMBIENT_TEMPERATURE): sensor.sensor_schema(
+        cv.Optional(CONF_AMBIENT_TEMPERATURE): policy_sensor_schema(
             unit_of_measurement=UNIT_CELSIUS,
             icon="mdi:thermometer",
             accuracy_decimals=0,
             device_class=DEVICE_CLASS_TEMPERATURE,
             state_class=STATE_CLASS_MEASUREMENT,
         ),
-        cv.Optional(CONF_CURRENT_FLOW): sensor.sensor_schema(
+        cv.Optional(CONF_CURRENT_FLOW): policy_sensor_schema(
             unit_of_measurement=UNIT_LITERS_PER_HOUR,
             icon="mdi:water-pump",
             accuracy_decimals=1,
             device_class=DEVICE_CLASS_VOLUME_FLOW_RATE,
             state_class=STATE_CLASS_MEASUREMENT,
         ),
-        cv.Optional(CONF_FRAMES_RECEIVED): sensor.sensor_schema(
+        cv.Optional(CONF_FRAMES_RECEIVED): policy_sensor_schema(
             icon=ICON_COUNTER,
             accuracy_decimals=0,
             state_class=STATE_CLASS_TOTAL_INCREASING,
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
-        cv.Optional(CONF_CRC_ERRORS): sensor.sensor_schema(
+        cv.Optional(CONF_CRC_ERRORS): policy_sensor_schema(
             icon="mdi:alert-circle-outline",
             accuracy_decimals=0,
             state_class=STATE_CLASS_TOTAL_INCREASING,
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
-        cv.Optional(CONF_SIGNAL_QUALITY): sensor.sensor_schema(
+        cv.Optional(CONF_LINK_CRC_ERRORS): policy_sensor_schema(
+            icon="mdi:signal-off",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_SIGNAL_QUALITY): policy_sensor_schema(
             unit_of_measurement=UNIT_PERCENT,
             icon="mdi:signal",
             accuracy_decimals=0,
             state_class=STATE_CLASS_MEASUREMENT,
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
+        cv.Optional(CONF_DECRYPT_TIME): policy_sensor_schema(
+            unit_of_measurement=UNIT_MICROSECONDS,
+            icon="mdi:timer-outline",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_PROCESSING_TIME): policy_sensor_schema(
+            unit_of_measurement=UNIT_MICROSECONDS,
+            icon="mdi:timer-outline",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_HISTORY_RECORDS): policy_sensor_schema(
+            icon="mdi:history",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_HISTORY_FLASH_WRITES): policy_sensor_schema(
+            icon="mdi:content-save-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # RSSI and LQI over the meter's last 16 frames
+        cv.Optional(CONF_RSSI): policy_sensor_schema(
+            unit_of_measurement=UNIT_DECIBEL_MILLIWATT,
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_SIGNAL_STRENGTH,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_RSSI_MIN): policy_sensor_schema(
+            unit_of_measurement=UNIT_DECIBEL_MILLIWATT,
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_SIGNAL_STRENGTH,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_RSSI_MAX): policy_sensor_schema(
+            unit_of_measurement=UNIT_DECIBEL_MILLIWATT,
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_SIGNAL_STRENGTH,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_LQI): policy_sensor_schema(
+            icon="mdi:signal-variant",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Telegrams the meter sent that never got through, from its access number
+        cv.Optional(CONF_MISSED_TELEGRAMS): policy_sensor_schema(
+            icon="mdi:email-remove-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Consumption analytics, see `analytics:` on the hub. Hours the water
+        # has run without stopping, the highest flow over the peak window, the
+        # lowest hourly flow of the last night and backflow episodes since boot.
+        cv.Optional(CONF_CONTINUOUS_FLOW_DURATION): policy_sensor_schema(
+            unit_of_measurement=UNIT_HOUR,
+            icon="mdi:timer-sand",
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_DURATION,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_PEAK_FLOW): policy_sensor_schema(
+            unit_of_measurement=UNIT_LITERS_PER_HOUR,
+            icon="mdi:chart-bell-curve",
+            accuracy_decimals=0,
+            device_class=DEVICE_CLASS_VOLUME_FLOW_RATE,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_NIGHT_MIN_FLOW): policy_sensor_schema(
+            unit_of_measurement=UNIT_LITERS_PER_HOUR,
+            icon="mdi:weather-night",
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_VOLUME_FLOW_RATE,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_REVERSE_FLOW_EVENTS): policy_sensor_schema(
+            icon="mdi:swap-horizontal",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+        ),
+        # Radio-level counters, independent of `meter:`
+        cv.Optional(CONF_ACCEPTED_FRAMES): policy_sensor_schema(
+            icon=ICON_COUNTER,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_FOREIGN_FRAMES): policy_sensor_schema(
+            icon="mdi:account-multiple-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Share of time the radio was powered, and telegrams inside predicted windows
+        cv.Optional(CONF_RX_DUTY_CYCLE): policy_sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            icon="mdi:sleep",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_PREDICTION_HIT_RATE): policy_sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            icon="mdi:target",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Receiver offset from the meters' carrier, and FSCTRL0 updates since boot
+        cv.Optional(CONF_FREQUENCY_OFFSET): policy_sensor_schema(
+            unit_of_measurement=UNIT_KILOHERTZ,
+            icon="mdi:sine-wave",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_FREQUENCY_CORRECTIONS): policy_sensor_schema(
+            icon=ICON_COUNTER,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # With `second_radio:`: frames each radio got through the link CRCs,
+        # and copies dropped because the other radio's was decoded first
+        cv.Optional(CONF_RADIO1_ACCEPTED_FRAMES): policy_sensor_schema(
+            icon="mdi:antenna",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_RADIO2_ACCEPTED_FRAMES): policy_sensor_schema(
+            icon="mdi:antenna",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_DUPLICATE_FRAMES): policy_sensor_schema(
+            icon="mdi:content-duplicate",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Most decoded readings waiting for loop() at once, and readings lost
+        # because the queue was full; with `receive_task:` these show how far
+        # the main loop falls behind
+        cv.Optional(CONF_READING_QUEUE_HIGH_WATER): policy_sensor_schema(
+            icon="mdi:tray-full",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_READING_QUEUE_DROPS): policy_sensor_schema(
+            icon="mdi:tray-remove",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
     }
 )
 
+FINAL_VALIDATE_SCHEMA = final_validate_meter_reference
+
 
 async def to_code(config):
-    parent = await cg.get_variable(config[CONF_MULTICAL21_ID])
+    meter = await get_meter(config)
 
     if CONF_TOTAL_CONSUMPTION in config:
         sens = await sensor.new_sensor(config[CONF_TOTAL_CONSUMPTION])
-        cg.add(parent.set_total_consumption_sensor(sens))
+        cg.add(meter.set_total_consumption_sensor(sens, publish_policy(config[CONF_TOTAL_CONSUMPTION])))
 
     if CONF_MONTH_START_VALUE in config:
         sens = await sensor.new_sensor(config[CONF_MONTH_START_VALUE])
-        cg.add(parent.set_month_start_sensor(sens))
+        cg.add(meter.set_month_start_sensor(sens, publish_policy(config[CONF_MONTH_START_VALUE])))
 
     if CONF_WATER_TEMPERATURE in config:
         sens = await sensor.new_sensor(config[CONF_WATER_TEMPERATURE])
-        cg.add(parent.set_water_temp_sensor(sens))
+        cg.add(meter.set_water_temp_sensor(sens, publish_policy(config[CONF_WATER_TEMPERATURE])))
 
     if CONF_AMBIENT_TEMPERATURE in config:
         sens = await sensor.new_sensor(config[CONF_AMBIENT_TEMPERATURE])
-        cg.add(parent.set_ambient_temp_sensor(sens))
+        cg.add(meter.set_ambient_temp_sensor(sens, publish_policy(config[CONF_AMBIENT_TEMPERATURE])))
 
     if CONF_CURRENT_FLOW in config:
         sens = await sensor.new_sensor(config[CONF_CURRENT_FLOW])
-        cg.add(parent.set_current_flow_sensor(sens))
+        cg.add(meter.set_current_flow_sensor(sens, publish_policy(config[CONF_CURRENT_FLOW])))
 
     if CONF_FRAMES_RECEIVED in config:
         sens = await sensor.new_sensor(config[CONF_FRAMES_RECEIVED])
-        cg.add(parent.set_frames_received_sensor(sens))
+        cg.add(meter.set_frames_received_sensor(sens, publish_policy(config[CONF_FRAMES_RECEIVED])))
 
     if CONF_CRC_ERRORS in config:
         sens = await sensor.new_sensor(config[CONF_CRC_ERRORS])
-        cg.add(parent.set_crc_errors_sensor(sens))
+        cg.add(meter.set_crc_errors_sensor(sens, publish_policy(config[CONF_CRC_ERRORS])))
+
+    if CONF_LINK_CRC_ERRORS in config:
+        sens = await sensor.new_sensor(config[CONF_LINK_CRC_ERRORS])
+        cg.add(meter.set_link_crc_errors_sensor(sens, publish_policy(config[CONF_LINK_CRC_ERRORS])))
 
     if CONF_SIGNAL_QUALITY in config:
         sens = await sensor.new_sensor(config[CONF_SIGNAL_QUALITY])
-        cg.add(parent.set_signal_quality_sensor(sens))
+        cg.add(meter.set_signal_quality_sensor(sens, publish_policy(config[CONF_SIGNAL_QUALITY])))
+
+    if CONF_DECRYPT_TIME in config:
+        sens = await sensor.new_sensor(config[CONF_DECRYPT_TIME])
+        cg.add(meter.set_decrypt_time_sensor(sens, publish_policy(config[CONF_DECRYPT_TIME])))
+
+    if CONF_PROCESSING_TIME in config:
+        sens = await sensor.new_sensor(config[CONF_PROCESSING_TIME])
+        cg.add(meter.set_processing_time_sensor(sens, publish_policy(config[CONF_PROCESSING_TIME])))
+
+    if CONF_HISTORY_RECORDS in config:
+        sens = await sensor.new_sensor(config[CONF_HISTORY_RECORDS])
+        cg.add(meter.set_history_records_sensor(sens, publish_policy(config[CONF_HISTORY_RECORDS])))
+
+    if CONF_HISTORY_FLASH_WRITES in config:
+        sens = await sensor.new_sensor(config[CONF_HISTORY_FLASH_WRITES])
+        cg.add(meter.set_history_flash_writes_sensor(sens, publish_policy(config[CONF_HISTORY_FLASH_WRITES])))
+
+    if CONF_RSSI in config:
+        sens = await sensor.new_sensor(config[CONF_RSSI])
+        cg.add(meter.set_rssi_sensor(sens, publish_policy(config[CONF_RSSI])))
+
+    if CONF_RSSI_MIN in config:
+        sens = await sensor.new_sensor(config[CONF_RSSI_MIN])
+        cg.add(meter.set_rssi_min_sensor(sens, publish_policy(config[CONF_RSSI_MIN])))
+
+    if CONF_RSSI_MAX in config:
+        sens = await sensor.new_sensor(config[CONF_RSSI_MAX])
+        cg.add(meter.set_rssi_max_sensor(sens, publish_policy(config[CONF_RSSI_MAX])))
+
+    if CONF_LQI in config:
+        sens = await sensor.new_sensor(config[CONF_LQI])
+        cg.add(meter.set_lqi_sensor(sens, publish_policy(config[CONF_LQI])))
+
+    if CONF_MISSED_TELEGRAMS in config:
+        sens = await sensor.new_sensor(config[CONF_MISSED_TELEGRAMS])
+        cg.add(meter.set_missed_telegrams_sensor(sens, publish_policy(config[CONF_MISSED_TELEGRAMS])))
+
+    if CONF_CONTINUOUS_FLOW_DURATION in config:
+        sens = await sensor.new_sensor(config[CONF_CONTINUOUS_FLOW_DURATION])
+        cg.add(
+            meter.set_continuous_flow_duration_sensor(sens, publish_policy(config[CONF_CONTINUOUS_FLOW_DURATION]))
+        )
+
+    if CONF_PEAK_FLOW in config:
+        sens = await sensor.new_sensor(config[CONF_PEAK_FLOW])
+        cg.add(meter.set_peak_flow_sensor(sens, publish_policy(config[CONF_PEAK_FLOW])))
+
+    if CONF_NIGHT_MIN_FLOW in config:
+        sens = await sensor.new_sensor(config[CONF_NIGHT_MIN_FLOW])
+        cg.add(meter.set_night_min_flow_sensor(sens, publish_policy(config[CONF_NIGHT_MIN_FLOW])))
+
+    if CONF_REVERSE_FLOW_EVENTS in config:
+        sens = await sensor.new_sensor(config[CONF_REVERSE_FLOW_EVENTS])
+        cg.add(meter.set_reverse_flow_events_sensor(sens, publish_policy(config[CONF_REVERSE_FLOW_EVENTS])))
+
+    parent = await cg.get_variable(config[CONF_MULTICAL21_ID])
+
+    if CONF_ACCEPTED_FRAMES in config:
+        sens = await sensor.new_sensor(config[CONF_ACCEPTED_FRAMES])
+        cg.add(parent.set_accepted_frames_sensor(sens, publish_policy(config[CONF_ACCEPTED_FRAMES])))
+
+    if CONF_FOREIGN_FRAMES in config:
+        sens = await sensor.new_sensor(config[CONF_FOREIGN_FRAMES])
+        cg.add(parent.set_foreign_frames_sensor(sens, publish_policy(config[CONF_FOREIGN_FRAMES])))
+
+    if CONF_RX_DUTY_CYCLE in config:
+        sens = await sensor.new_sensor(config[CONF_RX_DUTY_CYCLE])
+        cg.add(parent.set_rx_duty_cycle_sensor(sens, publish_policy(config[CONF_RX_DUTY_CYCLE])))
+
+    if CONF_PREDICTION_HIT_RATE in config:
+        sens = await sensor.new_sensor(config[CONF_PREDICTION_HIT_RATE])
+        cg.add(parent.set_prediction_hit_rate_sensor(sens, publish_policy(config[CONF_PREDICTION_HIT_RATE])))
+
+    if CONF_FREQUENCY_OFFSET in config:
+        sens = await sensor.new_sensor(config[CONF_FREQUENCY_OFFSET])
+        cg.add(parent.set_frequency_offset_sensor(sens, publish_policy(config[CONF_FREQUENCY_OFFSET])))
+
+    if CONF_FREQUENCY_CORRECTIONS in config:
+        sens = await sensor.new_sensor(config[CONF_FREQUENCY_CORRECTIONS])
+        cg.add(parent.set_frequency_corrections_sensor(sens, publish_policy(config[CONF_FREQUENCY_CORRECTIONS])))
+
+    for radio, key in enumerate((CONF_RADIO1_ACCEPTED_FRAMES, CONF_RADIO2_ACCEPTED_FRAMES)):
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(parent.set_radio_accepted_frames_sensor(radio, sens, publish_policy(config[key])))
+
+    if CONF_DUPLICATE_FRAMES in config:
+        sens = await sensor.new_sensor(config[CONF_DUPLICATE_FRAMES])
+        cg.add(parent.set_duplicate_frames_sensor(sens, publish_policy(config[CONF_DUPLICATE_FRAMES])))
+
+    if CONF_READING_QUEUE_HIGH_WATER in config:
+        sens = await sensor.new_sensor(config[CONF_READING_QUEUE_HIGH_WATER])
+        cg.add(
+            parent.set_reading_queue_high_water_sensor(sens, publish_policy(config[CONF_READING_QUEUE_HIGH_WATER]))
+        )
+
+    if CONF_READING_QUEUE_DROPS in config:
+        sens = await sensor.new_sensor(config[CONF_READING_QUEUE_DROPS])
+        cg.add(parent.set_reading_queue_drops_sensor(sens, publish_policy(config[CONF_READING_QUEUE_DROPS])))
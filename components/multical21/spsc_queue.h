@@ -0,0 +1,68 @@
+// Multical21 ESPHome Component - Reading queue
+//
+// Decoded readings go from frame processing to loop(), which publishes them.
+// With the receive task these are two threads, so the queue is lock-free for
+// exactly one producer and one consumer: each index is written by one side
+// only, and the release store that moves it publishes the slot it covers.
+// Nothing blocks or allocates; a reading that finds the queue full is dropped
+// and counted.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+template<typename T, uint8_t N> class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+ public:
+  // Producer: false, and counted as a drop, when the consumer is N behind
+  bool push(const T &item) {
+    uint32_t head = this->head_.load(std::memory_order_relaxed);
+    uint32_t depth = head - this->tail_.load(std::memory_order_acquire);
+    if (depth >= N) {
+      this->drops_.store(this->drops_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    this->slots_[head % N] = item;
+    this->head_.store(head + 1, std::memory_order_release);
+    if (depth + 1 > this->high_water_.load(std::memory_order_relaxed)) {
+      this->high_water_.store(depth + 1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer: the oldest item, or false when empty
+  bool pop(T *item) {
+    uint32_t tail = this->tail_.load(std::memory_order_relaxed);
+    if (tail == this->head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *item = this->slots_[tail % N];
+    this->tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side; a snapshot the other side may change straight after
+  uint32_t size() const {
+    return this->head_.load(std::memory_order_acquire) - this->tail_.load(std::memory_order_acquire);
+  }
+  static constexpr uint8_t capacity() { return N; }
+  // Most items ever waiting at once, and items push() turned away
+  uint32_t high_water() const { return this->high_water_.load(std::memory_order_relaxed); }
+  uint32_t drops() const { return this->drops_.load(std::memory_order_relaxed); }
+
+ protected:
+  T slots_[N]{};
+  // Free-running counts of pushes and pops; N divides 2^32, so they wrap cleanly
+  std::atomic<uint32_t> head_{0};        // Written by the producer only
+  std::atomic<uint32_t> tail_{0};        // Written by the consumer only
+  std::atomic<uint32_t> high_water_{0};  // Producer
+  std::atomic<uint32_t> drops_{0};       // Producer
+};
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,61 @@
+// Multical21 ESPHome Component - Frame pipeline stage timing
+//
+// Min/avg/max duration of one pipeline stage (FIFO drain, meter lookup,
+// decrypt, CRC, parse), measured with the CPU cycle counter. Reading the
+// counter costs a few cycles, so the stages stay instrumented in normal builds.
+
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+inline uint32_t stage_clock() { return arch_get_cpu_cycle_count(); }
+
+struct StageStats {
+  uint32_t min_cycles{UINT32_MAX};
+  uint32_t max_cycles{0};
+  uint32_t last_cycles{0};
+  uint64_t total_cycles{0};
+  uint32_t count{0};
+
+  // Record the stage that started at `start` (a stage_clock() value) and return now
+  uint32_t record_since(uint32_t start) {
+    uint32_t now = stage_clock();
+    this->record(now - start);  // Unsigned subtraction handles counter wrap
+    return now;
+  }
+
+  void record(uint32_t cycles) {
+    this->last_cycles = cycles;
+    this->total_cycles += cycles;
+    this->count++;
+    if (cycles < this->min_cycles) {
+      this->min_cycles = cycles;
+    }
+    if (cycles > this->max_cycles) {
+      this->max_cycles = cycles;
+    }
+  }
+
+  static float to_us(uint64_t cycles) { return cycles / (arch_get_cpu_freq_hz() / 1e6f); }
+  float min_us() const { return this->count > 0 ? to_us(this->min_cycles) : 0.0f; }
+  float avg_us() const { return this->count > 0 ? to_us(this->total_cycles / this->count) : 0.0f; }
+  float max_us() const { return to_us(this->max_cycles); }
+  float last_us() const { return to_us(this->last_cycles); }
+
+  void dump_config(const char *tag, const char *indent, const char *name) const {
+    if (this->count == 0) {
+      ESP_LOGCONFIG(tag, "%s%-9s -", indent, name);
+      return;
+    }
+    ESP_LOGCONFIG(tag, "%s%-9s min %.1f / avg %.1f / max %.1f us (%u frames)", indent, name, this->min_us(),
+                  this->avg_us(), this->max_us(), (unsigned) this->count);
+  }
+};
+
+}  // namespace multical21
+}  // namespace esphome
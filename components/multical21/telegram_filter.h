@@ -0,0 +1,89 @@
+// Multical21 ESPHome Component - Repeated telegram filter
+//
+// The meter counts its telegrams in the ELL access number (ACC), so the same
+// telegram heard twice - from a repeater, or from both radios of a diversity
+// receiver - carries the same ACC. Each meter remembers the last few telegrams
+// it decoded by ACC and a hash of the link header, and the hub drops a frame
+// that matches one before decrypting it. The hash leaves out the CC byte,
+// whose hop bits a repeater sets. Steps in the ACC between telegrams are
+// counted as missed telegrams: unlike the link CRC error rate, this also
+// covers telegrams the radio never synchronised on.
+
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+static const uint8_t TELEGRAM_FILTER_SIZE = 4;
+// Repeated copies come within seconds; an ACC takes 68 minutes to come round
+// again at 16 s intervals, so older entries are never a match
+static const uint32_t TELEGRAM_FILTER_MAX_AGE_MS = 60000;
+// A step back in the ACC, or one this large, is a meter reset rather than lost telegrams
+static const uint8_t TELEGRAM_MAX_ACC_GAP = 128;
+
+// Link header in front of the ciphertext: C, M, A, CI, CC, ACC, SN
+static const uint8_t FRAME_CIPHER_OFFSET = 16;
+// ELL communication control and access number, counting the meter's telegrams
+static const uint8_t FRAME_CC_OFFSET = 10;
+static const uint8_t FRAME_ACC_OFFSET = 11;
+
+// 32-bit FNV-1a over the link header of a payload, without the CC byte
+inline uint32_t telegram_header_hash(const uint8_t *payload, uint8_t length) {
+  uint32_t hash = 2166136261UL;
+  uint8_t end = length < FRAME_CIPHER_OFFSET ? length : FRAME_CIPHER_OFFSET;
+  for (uint8_t i = 0; i < end; i++) {
+    if (i != FRAME_CC_OFFSET) {
+      hash = (hash ^ payload[i]) * 16777619UL;
+    }
+  }
+  return hash;
+}
+
+class TelegramFilter {
+ public:
+  // A telegram with access number `acc` and header hash `hash` arrived at
+  // `now_ms` (millis()). Returns false if it is one already accepted.
+  bool accept(uint8_t acc, uint32_t hash, uint32_t now_ms) {
+    for (const Entry &entry : this->entries_) {
+      if (entry.used && entry.acc == acc && entry.hash == hash && now_ms - entry.ms < TELEGRAM_FILTER_MAX_AGE_MS) {
+        this->repeated_++;
+        return false;
+      }
+    }
+    if (this->seen_) {
+      uint8_t gap = (uint8_t) (acc - this->last_acc_);
+      if (gap > 1 && gap < TELEGRAM_MAX_ACC_GAP) {
+        this->missed_ += gap - 1;
+      }
+    }
+    this->seen_ = true;
+    this->last_acc_ = acc;
+    Entry &entry = this->entries_[this->next_];
+    entry = Entry{true, acc, hash, now_ms};
+    this->next_ = (uint8_t) ((this->next_ + 1) % TELEGRAM_FILTER_SIZE);
+    return true;
+  }
+
+  // Telegrams the ACC skipped, and copies dropped by accept()
+  uint32_t missed() const { return this->missed_; }
+  uint32_t repeated() const { return this->repeated_; }
+
+ protected:
+  struct Entry {
+    bool used;
+    uint8_t acc;
+    uint32_t hash;
+    uint32_t ms;
+  };
+  Entry entries_[TELEGRAM_FILTER_SIZE]{};
+  uint8_t next_{0};
+  bool seen_{false};
+  uint8_t last_acc_{0};
+  uint32_t missed_{0};
+  uint32_t repeated_{0};
+};
+
+}  // namespace multical21
+}  // namespace esphome
@@ -7,27 +7,45 @@ import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import text_sensor
 from esphome.const import ENTITY_CATEGORY_DIAGNOSTIC
-from . import Multical21Component
+from . import (
+    CONF_METER,
+    CONF_MULTICAL21_ID,
+    Multical21Component,
+    Multical21Meter,
+    final_validate_meter_reference,
+    get_meter,
+)
 
-CONF_MULTICAL21_ID = "multical21_id"
 CONF_LAST_UPDATE = "last_update"
+CONF_RSSI_HISTOGRAM = "rssi_histogram"
 
 DEPENDENCIES = ["multical21"]
 
 CONFIG_SCHEMA = cv.Schema(
     {
         cv.GenerateID(CONF_MULTICAL21_ID): cv.use_id(Multical21Component),
+        cv.Optional(CONF_METER): cv.use_id(Multical21Meter),
         cv.Optional(CONF_LAST_UPDATE): text_sensor.text_sensor_schema(
             icon="mdi:clock-outline",
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
+        cv.Optional(CONF_RSSI_HISTOGRAM): text_sensor.text_sensor_schema(
+            icon="mdi:chart-histogram",
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
     }
 )
 
+FINAL_VALIDATE_SCHEMA = final_validate_meter_reference
+
 
 async def to_code(config):
-    parent = await cg.get_variable(config[CONF_MULTICAL21_ID])
+    meter = await get_meter(config)
 
     if CONF_LAST_UPDATE in config:
         sens = await text_sensor.new_text_sensor(config[CONF_LAST_UPDATE])
-        cg.add(parent.set_last_update_sensor(sens))
+        cg.add(meter.set_last_update_sensor(sens))
+
+    if CONF_RSSI_HISTOGRAM in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_RSSI_HISTOGRAM])
+        cg.add(meter.set_rssi_histogram_sensor(sens))
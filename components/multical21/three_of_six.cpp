@@ -0,0 +1,117 @@
+// Multical21 ESPHome Component - 3-out-of-6 decoding for wM-Bus Mode T1
+// Compile-time tables and the triple-wise decode loops
+
+#include "three_of_six.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace multical21 {
+
+static constexpr ThreeOfSixNibbleTable THREE_OF_SIX_NIBBLES PROGMEM = make_three_of_six_nibble_table();
+static constexpr ThreeOfSixPairTable THREE_OF_SIX_PAIRS PROGMEM = make_three_of_six_pair_table();
+
+// Spot checks against EN 13757-4 table 10
+static_assert(THREE_OF_SIX_NIBBLES.nibble[0x16] == 0x0, "3-of-6 table generation");
+static_assert(THREE_OF_SIX_NIBBLES.nibble[0x29] == 0xF, "3-of-6 table generation");
+static_assert(THREE_OF_SIX_NIBBLES.nibble[0x00] == THREE_OF_SIX_INVALID_NIBBLE, "3-of-6 table generation");
+static_assert(THREE_OF_SIX_PAIRS.byte[(0x0D << 6) | 0x29] == 0x1F, "3-of-6 table generation");
+static_assert(THREE_OF_SIX_PAIRS.byte[0xFFF] == THREE_OF_SIX_INVALID_BYTE, "3-of-6 table generation");
+
+static inline uint8_t nibble_lookup(uint8_t symbol) {
+#ifdef USE_ESP8266
+  return progmem_read_byte(&THREE_OF_SIX_NIBBLES.nibble[symbol]);
+#else
+  return THREE_OF_SIX_NIBBLES.nibble[symbol];
+#endif
+}
+
+static inline uint16_t pair_lookup(uint16_t chips) {
+#ifdef USE_ESP8266
+  return progmem_read_uint16(&THREE_OF_SIX_PAIRS.byte[chips]);
+#else
+  return THREE_OF_SIX_PAIRS.byte[chips];
+#endif
+}
+
+template<> bool three_of_six_decode_with<false>(const uint8_t *in, size_t triples, uint8_t *out) {
+  for (; triples > 0; in += 3, out += 2, triples--) {
+    uint32_t chips = ((uint32_t) in[0] << 16) | ((uint32_t) in[1] << 8) | in[2];
+    uint8_t n0 = nibble_lookup((chips >> 18) & 0x3F);
+    uint8_t n1 = nibble_lookup((chips >> 12) & 0x3F);
+    uint8_t n2 = nibble_lookup((chips >> 6) & 0x3F);
+    uint8_t n3 = nibble_lookup(chips & 0x3F);
+    // Invalid entries have the high bits set, so one test covers all four
+    if ((n0 | n1 | n2 | n3) & 0xF0) {
+      return false;
+    }
+    out[0] = (uint8_t) ((n0 << 4) | n1);
+    out[1] = (uint8_t) ((n2 << 4) | n3);
+  }
+  return true;
+}
+
+template<> bool three_of_six_decode_with<true>(const uint8_t *in, size_t triples, uint8_t *out) {
+  for (; triples > 0; in += 3, out += 2, triples--) {
+    uint32_t chips = ((uint32_t) in[0] << 16) | ((uint32_t) in[1] << 8) | in[2];
+    uint16_t b0 = pair_lookup((uint16_t) (chips >> 12));
+    uint16_t b1 = pair_lookup((uint16_t) (chips & 0xFFF));
+    if ((b0 | b1) & THREE_OF_SIX_INVALID_BYTE) {
+      return false;
+    }
+    out[0] = (uint8_t) b0;
+    out[1] = (uint8_t) b1;
+  }
+  return true;
+}
+
+size_t ThreeOfSixStream::feed(const uint8_t *in, size_t length, uint8_t *out) {
+  if (!this->ok_) {
+    return 0;
+  }
+  size_t written = 0;
+  // Complete a triple split across the previous chunk
+  if (this->held_ > 0) {
+    while (this->held_ < 3 && length > 0) {
+      this->held_bytes_[this->held_++] = *in++;
+      length--;
+    }
+    if (this->held_ < 3) {
+      return 0;
+    }
+    this->held_ = 0;
+    if (!three_of_six_decode(this->held_bytes_, 1, out)) {
+      this->ok_ = false;
+      return 0;
+    }
+    written = 2;
+  }
+  size_t triples = length / 3;
+  if (!three_of_six_decode(in, triples, out + written)) {
+    this->ok_ = false;
+    return written;
+  }
+  written += triples * 2;
+  for (size_t i = triples * 3; i < length; i++) {
+    this->held_bytes_[this->held_++] = in[i];
+  }
+  return written;
+}
+
+size_t ThreeOfSixStream::finish(uint8_t *out) {
+  if (!this->ok_ || this->held_ < 2) {
+    return 0;
+  }
+  this->held_ = 0;
+  // 12 data chips; the postamble chips after them are not checked
+  uint8_t high = nibble_lookup(this->held_bytes_[0] >> 2);
+  uint8_t low = nibble_lookup((uint8_t) (((this->held_bytes_[0] & 0x03) << 4) | (this->held_bytes_[1] >> 4)));
+  if ((high | low) & 0xF0) {
+    this->ok_ = false;
+    return 0;
+  }
+  *out = (uint8_t) ((high << 4) | low);
+  return 1;
+}
+
+}  // namespace multical21
+}  // namespace esphome
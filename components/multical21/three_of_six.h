@@ -0,0 +1,105 @@
+// Multical21 ESPHome Component - 3-out-of-6 decoding for wM-Bus Mode T1
+//
+// Mode T sends every data nibble as a 6-chip symbol with three ones, high
+// nibble first (EN 13757-4), so 2 data bytes take 3 bytes on air. Decoding is
+// table-driven with the tables generated at compile time from the 16 code
+// words. The pair table maps 12 chips straight to a data byte (8 KiB of
+// uint16_t, one lookup per byte); the nibble table takes 64 bytes and one
+// lookup per nibble. ESP8266 keeps .rodata in RAM, so there the default is
+// the nibble table placed in flash; override with
+// -DMULTICAL21_3OF6_PAIR_TABLE=0|1.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef MULTICAL21_3OF6_PAIR_TABLE
+#ifdef USE_ESP8266
+#define MULTICAL21_3OF6_PAIR_TABLE 0
+#else
+#define MULTICAL21_3OF6_PAIR_TABLE 1
+#endif
+#endif
+
+namespace esphome {
+namespace multical21 {
+
+// Symbols for nibbles 0x0-0xF
+static constexpr uint8_t THREE_OF_SIX_CODES[16] = {0x16, 0x0D, 0x0E, 0x0B, 0x1C, 0x19, 0x1A, 0x13,
+                                                   0x2C, 0x25, 0x26, 0x23, 0x34, 0x31, 0x32, 0x29};
+// Table entries for chip patterns that are not a code word
+static const uint8_t THREE_OF_SIX_INVALID_NIBBLE = 0xFF;
+static const uint16_t THREE_OF_SIX_INVALID_BYTE = 0x100;
+
+// Bytes on air for `data_bytes` bytes of data. An odd count ends in half a
+// byte of data chips followed by postamble chips.
+constexpr uint16_t three_of_six_length(uint16_t data_bytes) { return (uint16_t) ((data_bytes * 3 + 1) / 2); }
+
+struct ThreeOfSixNibbleTable {
+  uint8_t nibble[64];  // Symbol -> nibble or THREE_OF_SIX_INVALID_NIBBLE
+};
+
+struct ThreeOfSixPairTable {
+  uint16_t byte[4096];  // Two symbols -> data byte or THREE_OF_SIX_INVALID_BYTE
+};
+
+constexpr ThreeOfSixNibbleTable make_three_of_six_nibble_table() {
+  ThreeOfSixNibbleTable table{};
+  for (int symbol = 0; symbol < 64; symbol++) {
+    table.nibble[symbol] = THREE_OF_SIX_INVALID_NIBBLE;
+  }
+  for (int nibble = 0; nibble < 16; nibble++) {
+    table.nibble[THREE_OF_SIX_CODES[nibble]] = (uint8_t) nibble;
+  }
+  return table;
+}
+
+constexpr ThreeOfSixPairTable make_three_of_six_pair_table() {
+  ThreeOfSixPairTable table{};
+  for (int chips = 0; chips < 4096; chips++) {
+    table.byte[chips] = THREE_OF_SIX_INVALID_BYTE;
+  }
+  for (int value = 0; value < 256; value++) {
+    table.byte[(THREE_OF_SIX_CODES[value >> 4] << 6) | THREE_OF_SIX_CODES[value & 0x0F]] = (uint16_t) value;
+  }
+  return table;
+}
+
+// Decode `triples` groups of 3 encoded bytes into 2 data bytes each. Returns
+// false at the first chip pattern that is not a code word. Provided for the
+// nibble (false) and pair (true) table; the linker only keeps the one used.
+template<bool PairTable> bool three_of_six_decode_with(const uint8_t *in, size_t triples, uint8_t *out);
+template<> bool three_of_six_decode_with<false>(const uint8_t *in, size_t triples, uint8_t *out);
+template<> bool three_of_six_decode_with<true>(const uint8_t *in, size_t triples, uint8_t *out);
+
+inline bool three_of_six_decode(const uint8_t *in, size_t triples, uint8_t *out) {
+  return three_of_six_decode_with<MULTICAL21_3OF6_PAIR_TABLE != 0>(in, triples, out);
+}
+
+// Decodes a frame chunk by chunk as it leaves the FIFO. Chunks need not be
+// multiples of 3 bytes: up to two bytes are held back for the next chunk.
+class ThreeOfSixStream {
+ public:
+  void start() {
+    this->held_ = 0;
+    this->ok_ = true;
+  }
+  // Decode the next `length` encoded bytes to `out`; returns the data bytes
+  // written, which follow the ones written by the previous call
+  size_t feed(const uint8_t *in, size_t length, uint8_t *out);
+  // After the last chunk of a frame with an odd data length: decode the data
+  // byte in the two held-back bytes to `out`. Returns the data bytes written.
+  size_t finish(uint8_t *out);
+
+  // No invalid symbol so far
+  bool ok() const { return this->ok_; }
+
+ protected:
+  uint8_t held_bytes_[3]{0};
+  uint8_t held_{0};
+  bool ok_{true};
+};
+
+}  // namespace multical21
+}  // namespace esphome
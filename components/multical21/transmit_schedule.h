@@ -0,0 +1,112 @@
+// Multical21 ESPHome Component - Transmit schedule prediction
+//
+// A Multical 21 sends its telegrams on a fixed cadence from its own clock, so
+// once a few arrivals have shown the interval, the time of every following
+// telegram is known to within the meter's jitter. Each meter learns its
+// interval and phase from arrival times; the hub uses the prediction to power
+// the radio down between receive windows of +/- guard around each expected
+// telegram. A schedule that misses too many windows in a row unlocks, which
+// puts the hub back into continuous RX until it has been learnt again.
+
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+// Plausible transmit intervals; Mode C1 meters send every 16 s
+static const uint32_t SCHEDULE_MIN_INTERVAL_MS = 2000;
+static const uint32_t SCHEDULE_MAX_INTERVAL_MS = 120000;
+// Arrivals that confirmed the learnt interval before windows are predicted
+static const uint8_t SCHEDULE_LOCK_CONFIRMATIONS = 2;
+// Lost telegrams bridged between two arrivals without relearning
+static const uint8_t SCHEDULE_MAX_SKIPPED = 8;
+
+class TransmitSchedule {
+ public:
+  // An arrival more than `guard_ms` off the prediction does not fit the
+  // schedule; `max_missed` windows in a row without a telegram unlock it
+  void configure(uint32_t guard_ms, uint8_t max_missed) {
+    this->guard_ms_ = guard_ms;
+    this->max_missed_ = max_missed;
+  }
+
+  // A telegram from this meter started arriving at `arrival_ms` (millis())
+  void add(uint32_t arrival_ms) {
+    bool was_locked = this->locked();
+    uint32_t delta = arrival_ms - this->anchor_ms_;
+    bool first = !this->anchored_;
+    this->anchored_ = true;
+    this->anchor_ms_ = arrival_ms;
+    if (first) {
+      return;
+    }
+
+    uint32_t periods = this->interval_ms_ > 0 ? (delta + this->interval_ms_ / 2) / this->interval_ms_ : 0;
+    int32_t error = (int32_t) (delta - periods * this->interval_ms_);
+    if (periods > 0 && periods <= SCHEDULE_MAX_SKIPPED && (uint32_t) (error < 0 ? -error : error) <= this->guard_ms_) {
+      // On schedule: follow slow clock drift, a quarter of the error at a time
+      this->interval_ms_ = (uint32_t) ((int32_t) this->interval_ms_ + error / (int32_t) (4 * periods));
+      if (this->confirmations_ < SCHEDULE_LOCK_CONFIRMATIONS) {
+        this->confirmations_++;
+      }
+      if (was_locked) {
+        this->hits_++;
+      }
+      this->missed_in_row_ = 0;
+    } else {
+      // First interval, or the meter's cadence or phase changed: start over
+      this->interval_ms_ = delta >= SCHEDULE_MIN_INTERVAL_MS && delta <= SCHEDULE_MAX_INTERVAL_MS ? delta : 0;
+      this->confirmations_ = 0;
+    }
+    this->next_ms_ = arrival_ms + this->interval_ms_;
+  }
+
+  // Count the windows that closed without a telegram up to `now_ms`. Returns
+  // true when that unlocked the schedule.
+  bool poll(uint32_t now_ms) {
+    while (this->locked() && (int32_t) (now_ms - (this->next_ms_ + this->guard_ms_)) > 0) {
+      this->misses_++;
+      this->next_ms_ += this->interval_ms_;
+      if (++this->missed_in_row_ >= this->max_missed_) {
+        this->confirmations_ = 0;
+        this->missed_in_row_ = 0;
+        this->fallbacks_++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool locked() const { return this->confirmations_ >= SCHEDULE_LOCK_CONFIRMATIONS; }
+  uint32_t interval_ms() const { return this->interval_ms_; }
+  // Milliseconds until the next window opens; 0 while it is open. Only
+  // meaningful while locked and polled up to `now_ms`.
+  uint32_t until_window(uint32_t now_ms) const {
+    int32_t until = (int32_t) (this->next_ms_ - this->guard_ms_ - now_ms);
+    return until > 0 ? (uint32_t) until : 0;
+  }
+
+  // Telegrams that arrived inside a predicted window, windows that passed
+  // without one, and how often misses sent the hub back to continuous RX
+  uint32_t hits() const { return this->hits_; }
+  uint32_t misses() const { return this->misses_; }
+  uint32_t fallbacks() const { return this->fallbacks_; }
+
+ protected:
+  uint32_t guard_ms_{250};
+  uint8_t max_missed_{3};
+  bool anchored_{false};
+  uint32_t anchor_ms_{0};    // Last arrival
+  uint32_t interval_ms_{0};  // 0 until two arrivals a plausible interval apart
+  uint32_t next_ms_{0};      // Next expected arrival
+  uint8_t confirmations_{0};
+  uint8_t missed_in_row_{0};
+  uint32_t hits_{0};
+  uint32_t misses_{0};
+  uint32_t fallbacks_{0};
+};
+
+}  // namespace multical21
+}  // namespace esphome
@@ -0,0 +1,102 @@
+// Multical21 ESPHome Component - wM-Bus data link layer
+// Block CRC validation and stripping for frame formats A and B
+
+#include "wmbus_link.h"
+#include <cstring>
+
+namespace esphome {
+namespace multical21 {
+
+uint16_t link_frame_bytes(LinkFrameFormat format, uint8_t l_field) {
+  if (format == FRAME_FORMAT_B) {
+    return l_field;
+  }
+  // Block 1 holds 9 bytes after L; the rest go in 16-byte blocks
+  uint16_t after_first = l_field > FORMAT_A_FIRST_BLOCK - 1 ? l_field - (FORMAT_A_FIRST_BLOCK - 1) : 0;
+  uint16_t blocks = 1 + (after_first + FORMAT_A_BLOCK - 1) / FORMAT_A_BLOCK;
+  return l_field + blocks * LINK_CRC_BYTES;
+}
+
+void LinkCrcStream::start(LinkFrameFormat format, uint8_t *frame) {
+  uint8_t l_field = frame[0];
+  this->frame_ = frame;
+  this->format_ = format;
+  this->read_ = 1;
+  this->write_ = 1;
+  this->crc_bytes_ = 0;
+  this->blocks_checked_ = 0;
+  this->crc_ = crc16_en13757_update(CRC16_EN13757_INIT, frame, 1);  // Block 1 covers the L-field too
+
+  if (format == FRAME_FORMAT_A) {
+    this->ok_ = l_field >= FORMAT_A_FIRST_BLOCK - 1;
+    this->data_remaining_ = l_field;
+    this->block_remaining_ = FORMAT_A_FIRST_BLOCK - 1;
+  } else if (l_field + 1 <= FORMAT_B_FIRST_BLOCKS + LINK_CRC_BYTES) {
+    // Blocks 1-2 only: one CRC at the very end
+    this->ok_ = l_field > LINK_CRC_BYTES;
+    this->data_remaining_ = l_field - LINK_CRC_BYTES;
+    this->block_remaining_ = this->data_remaining_;
+  } else {
+    // Block 3 follows the first CRC and needs at least one data byte
+    this->ok_ = l_field + 1 > FORMAT_B_FIRST_BLOCKS + 2 * LINK_CRC_BYTES;
+    this->data_remaining_ = l_field - 2 * LINK_CRC_BYTES;
+    this->block_remaining_ = FORMAT_B_FIRST_BLOCKS - 1;
+  }
+  if (!this->ok_) {
+    this->data_remaining_ = 0;
+    this->block_remaining_ = 0;
+  }
+}
+
+void LinkCrcStream::feed(size_t length) {
+  uint16_t end = this->read_ + length;
+  while (this->ok_ && this->read_ < end) {
+    if (this->block_remaining_ > 0) {
+      // Data: fold the whole run into the CRC and move it over earlier CRCs
+      uint8_t run = (end - this->read_ < this->block_remaining_) ? end - this->read_ : this->block_remaining_;
+      this->crc_ = crc16_en13757_update(this->crc_, this->frame_ + this->read_, run);
+      if (this->write_ != this->read_) {
+        memmove(this->frame_ + this->write_, this->frame_ + this->read_, run);
+      }
+      this->read_ += run;
+      this->write_ += run;
+      this->block_remaining_ -= run;
+      this->data_remaining_ -= run;
+      continue;
+    }
+
+    // CRC, MSB first
+    uint16_t expected = crc16_en13757_final(this->crc_);
+    uint8_t byte = this->frame_[this->read_++];
+    if (byte != (this->crc_bytes_ == 0 ? (uint8_t) (expected >> 8) : (uint8_t) expected)) {
+      this->ok_ = false;
+      break;
+    }
+    if (++this->crc_bytes_ == LINK_CRC_BYTES) {
+      this->crc_bytes_ = 0;
+      this->blocks_checked_++;
+      this->crc_ = CRC16_EN13757_INIT;
+      // Format A continues in 16-byte blocks, format B block 3 takes the rest
+      uint8_t next = this->format_ == FRAME_FORMAT_A ? FORMAT_A_BLOCK : this->data_remaining_;
+      this->block_remaining_ = this->data_remaining_ < next ? this->data_remaining_ : next;
+    }
+  }
+}
+
+uint8_t LinkCrcStream::data_length() const {
+  if (!this->ok_ || this->data_remaining_ > 0 || this->block_remaining_ > 0 || this->crc_bytes_ > 0 ||
+      this->blocks_checked_ == 0) {
+    return 0;
+  }
+  return this->write_ - 1;
+}
+
+uint8_t strip_link_crcs(LinkFrameFormat format, uint8_t *frame) {
+  LinkCrcStream stream;
+  stream.start(format, frame);
+  stream.feed(link_frame_bytes(format, frame[0]));
+  return stream.data_length();
+}
+
+}  // namespace multical21
+}  // namespace esphome
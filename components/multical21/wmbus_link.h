@@ -0,0 +1,77 @@
+// Multical21 ESPHome Component - wM-Bus data link layer
+//
+// Frame formats A and B (EN 13757-4) and their block CRCs. Both carry the same
+// data; they differ in where the CRCs sit:
+//
+//   Format A: L counts data bytes only. Block 1 is L, C, M, A (10 bytes), then
+//             16-byte blocks and a shorter last block, each followed by a CRC.
+//   Format B: L counts the CRCs too. Blocks 1-2 are up to 126 bytes including L
+//             with one CRC, an optional block 3 carries the rest and a CRC.
+//
+// CRCs cover every byte of their block, L-field included, and are sent MSB first.
+
+#pragma once
+
+#include "crc16.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace multical21 {
+
+// Second sync byte after the 0x54 in Mode C: selects the frame format
+static const uint8_t WMBUS_FORMAT_A_SYNC = 0xCD;
+static const uint8_t WMBUS_FORMAT_B_SYNC = 0x3D;
+
+static const uint8_t LINK_CRC_BYTES = 2;
+static const uint8_t FORMAT_A_FIRST_BLOCK = 10;  // L, C, M, A
+static const uint8_t FORMAT_A_BLOCK = 16;
+static const uint8_t FORMAT_B_FIRST_BLOCKS = 126;  // L through the end of block 2
+
+// Largest frame on air after the sync bytes: format A with L = 255 (17 blocks)
+static const uint16_t MAX_LINK_FRAME_LENGTH = 1 + 255 + 17 * LINK_CRC_BYTES;
+
+enum LinkFrameFormat : uint8_t {
+  FRAME_FORMAT_A,
+  FRAME_FORMAT_B,
+};
+
+// Bytes on air after the L-field, CRCs included
+uint16_t link_frame_bytes(LinkFrameFormat format, uint8_t l_field);
+
+// Checks block CRCs while a frame is still arriving and strips them in place.
+// The frame buffer holds the L-field at [0]; bytes received after it are
+// appended at frame + 1 and passed to feed(), and their data bytes move down
+// over the CRCs so the payload ends up contiguous at frame + 1.
+class LinkCrcStream {
+ public:
+  void start(LinkFrameFormat format, uint8_t *frame);
+  // Consume the next `length` bytes, already stored after the ones fed before
+  void feed(size_t length);
+
+  // No block failed so far (a frame with an impossible L-field never passes)
+  bool ok() const { return this->ok_; }
+  uint8_t blocks_checked() const { return this->blocks_checked_; }
+  // Data length after stripping, or 0 unless every block arrived and passed
+  uint8_t data_length() const;
+
+ protected:
+  uint8_t *frame_{nullptr};
+  LinkFrameFormat format_{FRAME_FORMAT_B};
+  uint16_t read_{1};   // Next received byte to consume
+  uint16_t write_{1};  // Where its data byte goes
+  uint16_t crc_{CRC16_EN13757_INIT};
+  uint8_t block_remaining_{0};  // Data bytes left in the current block
+  uint8_t data_remaining_{0};   // Data bytes left in the frame
+  uint8_t crc_bytes_{0};        // CRC bytes of the current block seen so far
+  uint8_t blocks_checked_{0};
+  bool ok_{false};
+};
+
+// Check every block CRC of a complete `frame` (L-field first, link_frame_bytes()
+// after it) and strip the CRCs in place. Returns the data length, or 0 if a
+// block fails its CRC.
+uint8_t strip_link_crcs(LinkFrameFormat format, uint8_t *frame);
+
+}  // namespace multical21
+}  // namespace esphome
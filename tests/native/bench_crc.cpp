@@ -0,0 +1,50 @@
+// CRC16 EN13757 variants: byte-wise table vs slicing-by-4/8, on a format A
+// data block (16 bytes), a full format B block (126 bytes) and a maximum
+// length frame (255 bytes). Pick MULTICAL21_CRC_SLICES for a target from
+// these, keeping in mind each extra slice costs 512 bytes of table.
+
+#include <benchmark/benchmark.h>
+
+#include "crc16.h"
+
+#include <vector>
+
+using namespace esphome::multical21;
+
+template<size_t Slices> static void BM_Crc16(benchmark::State &state) {
+  std::vector<uint8_t> data((size_t) state.range(0));
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t) (i * 37 + 11);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(crc16_en13757_update_sliced<Slices>(CRC16_EN13757_INIT, data.data(), data.size()));
+  }
+  state.SetBytesProcessed((int64_t) state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Crc16, 1)->Arg(16)->Arg(126)->Arg(255);
+BENCHMARK_TEMPLATE(BM_Crc16, 4)->Arg(16)->Arg(126)->Arg(255);
+BENCHMARK_TEMPLATE(BM_Crc16, 8)->Arg(16)->Arg(126)->Arg(255);
+
+// The receive path feeds the CRC in FIFO-sized chunks; check that the
+// incremental API does not give the gain back
+template<size_t Slices> static void BM_Crc16Chunked(benchmark::State &state) {
+  std::vector<uint8_t> data(255);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t) (i * 37 + 11);
+  }
+  size_t chunk = (size_t) state.range(0);
+  for (auto _ : state) {
+    uint16_t crc = CRC16_EN13757_INIT;
+    for (size_t pos = 0; pos < data.size(); pos += chunk) {
+      size_t n = data.size() - pos < chunk ? data.size() - pos : chunk;
+      crc = crc16_en13757_update_sliced<Slices>(crc, data.data() + pos, n);
+    }
+    benchmark::DoNotOptimize(crc16_en13757_final(crc));
+  }
+  state.SetBytesProcessed((int64_t) state.iterations() * 255);
+}
+BENCHMARK_TEMPLATE(BM_Crc16Chunked, 1)->Arg(31);
+BENCHMARK_TEMPLATE(BM_Crc16Chunked, 4)->Arg(31);
+BENCHMARK_TEMPLATE(BM_Crc16Chunked, 8)->Arg(31);
+
+BENCHMARK_MAIN();
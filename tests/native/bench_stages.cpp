@@ -0,0 +1,149 @@
+// Per-stage host benchmarks for the frame pipeline: meter lookup, link CRC,
+// AES-CTR decrypt, application CRC and parse, for compact (0x79) and long (0x78)
+// frames. Time is ns/frame; the frames/s counter is the same number inverted.
+
+#include "harness.h"
+#include "telegram_builder.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+using namespace multical21_test;
+using esphome::multical21::crc16_en13757;
+using esphome::multical21::MAX_FRAME_LENGTH;
+using esphome::multical21::MeterReading;
+
+// Expose the protected stage functions to the benchmarks
+class StageMeter : public Multical21Meter {
+ public:
+  using Multical21Meter::aes_ctr_decrypt;
+  using Multical21Meter::decrypt_frame;
+  using Multical21Meter::parse_meter_data;
+};
+
+class StageHub : public Multical21Component {
+ public:
+  using Multical21Component::check_meter_id;
+};
+
+enum FrameKind { COMPACT, LONG };
+
+static std::vector<uint8_t> make_frame(FrameKind kind) {
+  TelegramBuilder builder;
+  return kind == COMPACT ? builder.compact(1234567, 1230000, 12, 21) : builder.long_frame(1234567, 1230000, 12, 21);
+}
+
+static std::vector<uint8_t> make_plaintext(FrameKind kind) {
+  auto plain = kind == COMPACT ? TelegramBuilder::compact_plaintext(1234567, 1230000, 12, 21)
+                               : TelegramBuilder::long_plaintext(1234567, 1230000, 12, 21);
+  TelegramBuilder::seal_plaintext(plain);
+  return plain;
+}
+
+struct StageFixture {
+  StageMeter meter;
+  MeterSensors sensors;
+
+  StageFixture() {
+    this->meter.set_meter_id("76348799");
+    this->meter.set_key("28F64A24988064A079AA2C807D6102AE");
+    this->sensors.attach(&this->meter);
+  }
+};
+
+static void set_frame_rate(benchmark::State &state) {
+  state.counters["frames/s"] = benchmark::Counter((double) state.iterations(), benchmark::Counter::kIsRate);
+}
+
+// Dispatch: binary search over N registered meters
+static void BM_CheckMeterId(benchmark::State &state) {
+  StageHub hub;
+  std::vector<std::unique_ptr<Multical21Meter>> meters;
+  char id[9];
+  for (int64_t i = 0; i < state.range(0); i++) {
+    meters.emplace_back(new Multical21Meter());
+    snprintf(id, sizeof(id), "%08X", (unsigned) (0x76348799 - state.range(0) / 2 + i));
+    meters.back()->set_meter_id(id);
+    hub.register_meter(meters.back().get());
+  }
+  auto frame = make_frame(COMPACT);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(hub.check_meter_id(frame.data() + 1));
+  }
+  set_frame_rate(state);
+}
+BENCHMARK(BM_CheckMeterId)->Arg(1)->Arg(4)->Arg(32);
+
+// Link layer: block CRC check and in-place strip of the raw frame
+static void BM_StripLinkCrcs(benchmark::State &state) {
+  auto frame = make_frame((FrameKind) state.range(0));
+  std::vector<uint8_t> work(frame.size());
+  for (auto _ : state) {
+    std::copy(frame.begin(), frame.end(), work.begin());
+    benchmark::DoNotOptimize(esphome::multical21::strip_link_crcs(esphome::multical21::FRAME_FORMAT_B, work.data()));
+  }
+  set_frame_rate(state);
+}
+BENCHMARK(BM_StripLinkCrcs)->Arg(COMPACT)->Arg(LONG);
+
+// AES-CTR decrypt of the payload
+static void BM_AesCtrDecrypt(benchmark::State &state) {
+  StageFixture f;
+  auto frame = make_frame((FrameKind) state.range(0));
+  const uint8_t *payload = frame.data() + 1;
+  uint8_t cipher_length = frame[0] - 2 - esphome::multical21::FRAME_CIPHER_OFFSET;
+  uint8_t iv[16] = {0};
+  memcpy(iv, &payload[1], 8);
+  iv[8] = payload[10];
+  memcpy(&iv[9], &payload[12], 4);
+  uint8_t plain[MAX_FRAME_LENGTH];
+  for (auto _ : state) {
+    f.meter.aes_ctr_decrypt(&payload[16], plain, cipher_length, iv);
+    benchmark::DoNotOptimize(plain);
+  }
+  set_frame_rate(state);
+}
+BENCHMARK(BM_AesCtrDecrypt)->Arg(COMPACT)->Arg(LONG);
+
+// Application CRC over the decrypted payload
+static void BM_Crc16(benchmark::State &state) {
+  StageFixture f;
+  auto plain = make_plaintext((FrameKind) state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(crc16_en13757(plain.data() + 2, plain.size() - 2));
+  }
+  set_frame_rate(state);
+  state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) (plain.size() - 2));
+}
+BENCHMARK(BM_Crc16)->Arg(COMPACT)->Arg(LONG);
+
+// Parse: frame type, CRC check, field extraction and sensor publish
+static void BM_ParseMeterData(benchmark::State &state) {
+  StageFixture f;
+  auto plain = make_plaintext((FrameKind) state.range(0));
+  MeterReading reading;
+  for (auto _ : state) {
+    if (f.meter.parse_meter_data(plain.data(), (uint8_t) plain.size(), &reading)) {
+      f.meter.publish_reading(reading);
+    }
+  }
+  set_frame_rate(state);
+}
+BENCHMARK(BM_ParseMeterData)->Arg(COMPACT)->Arg(LONG);
+
+// decrypt_frame(): IV build, decrypt and parse; no publishing, which is left
+// to loop()
+static void BM_DecryptFrame(benchmark::State &state) {
+  StageFixture f;
+  auto frame = make_frame((FrameKind) state.range(0));
+  uint8_t plain[MAX_FRAME_LENGTH];
+  MeterReading reading;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(f.meter.decrypt_frame(frame.data() + 1, frame[0] - 2, plain, &reading));
+  }
+  set_frame_rate(state);
+}
+BENCHMARK(BM_DecryptFrame)->Arg(COMPACT)->Arg(LONG);
+
+BENCHMARK_MAIN();
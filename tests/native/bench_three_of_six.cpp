@@ -0,0 +1,57 @@
+// 3-out-of-6 decoding for Mode T1: nibble table (64 bytes, 4 lookups per
+// triple) vs pair table (8 KiB, 2 lookups per triple), on a compact frame
+// (about 30 data bytes), a long frame and a maximum length frame. The chunked
+// variant feeds FIFO-sized pieces through ThreeOfSixStream as the receive
+// path does. Pick MULTICAL21_3OF6_PAIR_TABLE for a target from these.
+
+#include <benchmark/benchmark.h>
+
+#include "telegram_builder.h"
+#include "three_of_six.h"
+
+#include <vector>
+
+using namespace esphome::multical21;
+using multical21_test::TelegramBuilder;
+
+static std::vector<uint8_t> encoded_frame(size_t data_bytes) {
+  std::vector<uint8_t> data(data_bytes);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t) (i * 37 + 11);
+  }
+  return TelegramBuilder::three_of_six(data);
+}
+
+template<bool PairTable> static void BM_ThreeOfSix(benchmark::State &state) {
+  auto chips = encoded_frame((size_t) state.range(0));
+  std::vector<uint8_t> out((size_t) state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(three_of_six_decode_with<PairTable>(chips.data(), chips.size() / 3, out.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed((int64_t) state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_ThreeOfSix, false)->Arg(30)->Arg(66)->Arg(290);
+BENCHMARK_TEMPLATE(BM_ThreeOfSix, true)->Arg(30)->Arg(66)->Arg(290);
+
+// Chunks that do not divide into triples exercise the held-back bytes
+static void BM_ThreeOfSixStream(benchmark::State &state) {
+  auto chips = encoded_frame(290);
+  std::vector<uint8_t> out(290);
+  size_t chunk = (size_t) state.range(0);
+  ThreeOfSixStream stream;
+  for (auto _ : state) {
+    stream.start();
+    size_t written = 0;
+    for (size_t pos = 0; pos < chips.size(); pos += chunk) {
+      size_t n = chips.size() - pos < chunk ? chips.size() - pos : chunk;
+      written += stream.feed(chips.data() + pos, n, out.data() + written);
+    }
+    written += stream.finish(out.data() + written);
+    benchmark::DoNotOptimize(written);
+  }
+  state.SetBytesProcessed((int64_t) state.iterations() * 290);
+}
+BENCHMARK(BM_ThreeOfSixStream)->Arg(31)->Arg(63);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,140 @@
+// Replay a raw frame capture through the component on the simulated CC1101.
+//
+//   replay_capture <capture.bin | device.log> [METER_ID:KEY ...] [--back-to-back]
+//
+// The capture is a file in the capture format (capture.h) or a device log
+// containing a dump_capture() output. Frames go on the air at their recorded
+// arrival times with their recorded RSSI/LQI, or back to back to measure
+// throughput, and what the receiver makes of each is compared with the
+// outcome recorded on the device. Without meters the test meter is used.
+
+#include "capture_file.h"
+#include "harness.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+
+using namespace multical21_test;
+using esphome::multical21::CAPTURE_OUTCOMES;
+using esphome::multical21::capture_outcome_to_string;
+
+static const uint64_t BACK_TO_BACK_GAP_US = 2000;
+
+// Outcomes this build does not know are counted together in the last slot
+static uint8_t outcome_slot(uint8_t outcome) { return outcome < CAPTURE_OUTCOMES ? outcome : (uint8_t) CAPTURE_OUTCOMES; }
+
+int main(int argc, char **argv) {
+  std::string path;
+  std::vector<std::pair<std::string, std::string>> meters;
+  bool back_to_back = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto colon = arg.find(':');
+    if (arg == "--back-to-back") {
+      back_to_back = true;
+    } else if (colon != std::string::npos) {
+      meters.emplace_back(arg.substr(0, colon), arg.substr(colon + 1));
+    } else if (path.empty()) {
+      path = arg;
+    } else {
+      path.clear();
+      break;
+    }
+  }
+  if (path.empty()) {
+    fprintf(stderr, "usage: %s <capture.bin | device.log> [METER_ID:KEY ...] [--back-to-back]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<CapturedFrame> frames;
+  if (!load_capture(path, &frames)) {
+    fprintf(stderr, "%s: not a capture file and no capture dump found\n", path.c_str());
+    return 1;
+  }
+  if (frames.empty()) {
+    printf("Capture is empty\n");
+    return 0;
+  }
+
+  std::unique_ptr<Harness> harness =
+      meters.empty() ? std::make_unique<Harness>()
+                     : std::make_unique<Harness>(true, meters[0].first.c_str(), meters[0].second.c_str());
+  Harness &h = *harness;
+  std::deque<Multical21Meter> extra_meters;
+  for (size_t i = 1; i < meters.size(); i++) {
+    extra_meters.emplace_back();
+    extra_meters.back().set_meter_id(meters[i].first.c_str());
+    extra_meters.back().set_key(meters[i].second.c_str());
+    h.hub.register_meter(&extra_meters.back());
+  }
+  // A T1 capture needs the receiver in T1
+  if (frames[0].format_sync == esphome::multical21::CAPTURE_FORMAT_T1) {
+    h.hub.set_radio_profile(esphome::multical21::RADIO_PROFILE_T1);
+  }
+  // Capture the replay too, to compare outcomes frame by frame
+  h.hub.set_capture_buffer_size(frames.size() *
+                                 (CAPTURE_RECORD_HEADER_BYTES + esphome::multical21::CAPTURE_MAX_FRAME_LENGTH));
+  h.setup();
+
+  // Arrival times are 32-bit micros(); summing the differences survives a wrap
+  uint64_t start_us = esphome::host::now_us() + 5000;
+  uint64_t air_us = start_us;
+  for (size_t i = 0; i < frames.size(); i++) {
+    const CapturedFrame &frame = frames[i];
+    if (i > 0) {
+      air_us += back_to_back ? (frames[i - 1].bytes.size() + 2) * SimulatedCC1101::AIR_BYTE_US + BACK_TO_BACK_GAP_US
+                             : (uint32_t) (frame.arrival_us - frames[i - 1].arrival_us);
+    }
+    h.radio.set_signal(frame.rssi, frame.lqi);
+    h.radio.transmit(frame.bytes, air_us, frame.format_sync);
+  }
+
+  auto wall_start = std::chrono::steady_clock::now();
+  h.run_until_air_idle(air_us - start_us + 10000000);
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+  std::vector<uint8_t> file(h.hub.get_capture().file_size());
+  h.hub.get_capture().read(0, file.data(), file.size());
+  std::vector<CapturedFrame> replayed;
+  parse_capture(file, &replayed);
+
+  uint32_t recorded_counts[CAPTURE_OUTCOMES + 1] = {0};
+  uint32_t replayed_counts[CAPTURE_OUTCOMES + 1] = {0};
+  for (const auto &frame : frames) {
+    recorded_counts[outcome_slot(frame.outcome)]++;
+  }
+  for (const auto &frame : replayed) {
+    replayed_counts[outcome_slot(frame.outcome)]++;
+  }
+
+  printf("%-16s %10s %10s\n", "outcome", "recorded", "replayed");
+  for (uint8_t outcome = 0; outcome <= CAPTURE_OUTCOMES; outcome++) {
+    if (recorded_counts[outcome] > 0 || replayed_counts[outcome] > 0) {
+      printf("%-16s %10u %10u\n", capture_outcome_to_string(outcome), recorded_counts[outcome],
+             replayed_counts[outcome]);
+    }
+  }
+  printf("%-16s %10s %10u\n", "not heard", "", h.radio.missed_telegrams());
+
+  // Frame by frame, as long as the replay heard the same sequence of frames
+  uint32_t differences = 0;
+  if (replayed.size() == frames.size()) {
+    for (size_t i = 0; i < frames.size(); i++) {
+      if (frames[i].outcome != replayed[i].outcome) {
+        printf("frame %zu: recorded %s, replayed %s\n", i, capture_outcome_to_string(frames[i].outcome),
+               capture_outcome_to_string(replayed[i].outcome));
+        differences++;
+      }
+    }
+  }
+
+  double air_s = (double) (air_us - start_us) / 1e6;
+  printf("\n%zu frames over %.1f s of air time, replayed in %.3f s (%.0f frames/s)\n", frames.size(), air_s, wall_s,
+         wall_s > 0 ? frames.size() / wall_s : 0.0);
+  printf("Frames accepted: %u, for other meters: %u, link CRC errors: %u\n", h.hub.accepted_frames_,
+         h.hub.foreign_frames_, h.hub.link_crc_errors_);
+  return differences == 0 ? 0 : 1;
+}
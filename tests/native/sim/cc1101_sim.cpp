@@ -0,0 +1,380 @@
+// Simulated CC1101 for host tests and benchmarks
+
+#include "cc1101_sim.h"
+
+#include <cctype>
+#include <fstream>
+
+namespace multical21_sim {
+
+using esphome::host::advance_us;
+using esphome::host::now_us;
+
+// Register addresses and values used by the model
+static const uint8_t REG_IOCFG0 = 0x02;
+static const uint8_t REG_PKTLEN = 0x06;
+static const uint8_t REG_PKTCTRL1 = 0x07;
+static const uint8_t REG_PKTCTRL0 = 0x08;
+static const uint8_t REG_FSCTRL0 = 0x0C;
+static const uint8_t REG_MCSM1 = 0x17;
+static const uint8_t REG_MCSM0 = 0x18;
+static const uint8_t FIFO_ADDRESS = 0x3F;
+static const uint8_t PKTCTRL1_APPEND_STATUS = 0x04;
+static const uint8_t LQI_CRC_OK = 0x80;
+
+static const uint8_t MARC_SLEEP = 0x00;
+static const uint8_t MARC_IDLE = 0x01;
+static const uint8_t MARC_STARTCAL = 0x08;
+static const uint8_t MARC_RX = 0x0D;
+static const uint8_t MARC_RXFIFO_OVERFLOW = 0x11;
+
+static const uint32_t CALIBRATION_US = 720;
+static const uint32_t RESET_READY_US = 150;  // CHIP_RDYn high after SRES
+static const uint32_t WAKE_READY_US = 150;   // Crystal start-up after SLEEP
+// FSTEST, PTEST, AGCTEST and TEST2-0 lose their values in SLEEP
+static const uint8_t FIRST_UNRETAINED_REG = 0x29;
+static const uint8_t LAST_UNRETAINED_REG = 0x2E;
+static const uint32_t RX_SETTLING_US = 90;
+
+bool SimGdo0Pin::digital_read() {
+  this->radio_->tick();
+  return this->radio_->gdo0_level();
+}
+
+void SimGdo0Pin::attach_interrupt(void (*func)(void *), void *arg, esphome::gpio::InterruptType type) const {
+  this->isr_ = func;
+  this->isr_arg_ = arg;
+  this->isr_type_ = type;
+}
+
+SimulatedCC1101::SimulatedCC1101() : gdo0_(this) { this->reset_registers(); }
+
+void SimulatedCC1101::reset_registers() {
+  for (auto &reg : this->regs_) {
+    reg = 0x00;
+  }
+  // Datasheet reset values for the registers the model interprets
+  this->regs_[0x00] = 0x29;  // IOCFG2
+  this->regs_[0x01] = 0x2E;  // IOCFG1
+  this->regs_[REG_IOCFG0] = 0x3F;
+  this->regs_[0x03] = 0x07;  // FIFOTHR
+  this->regs_[REG_PKTLEN] = 0xFF;
+  this->regs_[REG_PKTCTRL1] = 0x04;
+  this->regs_[REG_PKTCTRL0] = 0x45;
+  this->regs_[REG_MCSM1] = 0x30;
+  this->regs_[REG_MCSM0] = 0x04;
+  this->marcstate_ = MARC_IDLE;
+  this->state_ready_us_ = 0;
+  this->fifo_.clear();
+  this->receiving_ = false;
+  this->set_gdo0(false);
+}
+
+void SimulatedCC1101::select() {
+  this->selected_ = true;
+  this->have_header_ = false;
+  // Pulling CSn low wakes the chip from SLEEP; it is ready once the crystal runs
+  if (this->marcstate_ == MARC_SLEEP) {
+    this->marcstate_ = MARC_IDLE;
+    this->sleep_us_ += now_us() - this->sleep_start_us_;
+    this->chip_ready_us_ = now_us() + WAKE_READY_US;
+  }
+}
+
+void SimulatedCC1101::deselect() {
+  this->selected_ = false;
+  this->have_header_ = false;
+}
+
+uint8_t SimulatedCC1101::status_byte() const {
+  uint8_t state;
+  switch (this->marcstate_) {
+    case MARC_RX:
+      state = 1;
+      break;
+    case MARC_STARTCAL:
+      state = 4;
+      break;
+    case MARC_RXFIFO_OVERFLOW:
+      state = 6;
+      break;
+    default:
+      state = 0;
+      break;
+  }
+  uint8_t available = this->fifo_.size() > 15 ? 15 : (uint8_t) this->fifo_.size();
+  uint8_t chip_rdyn = now_us() < this->chip_ready_us_ ? 0x80 : 0x00;
+  return (uint8_t) (chip_rdyn | (state << 4) | available);
+}
+
+uint8_t SimulatedCC1101::transfer(uint8_t data) {
+  advance_us(SPI_BYTE_US);
+  this->spi_bytes_++;
+  this->tick();
+
+  if (!this->have_header_) {
+    uint8_t status = this->status_byte();
+    this->header_ = data;
+    this->address_ = data & 0x3F;
+    this->have_header_ = true;
+    bool burst = data & 0x40;
+    // Header bytes 0x30-0x3D without the burst bit are command strobes
+    if (this->address_ >= 0x30 && this->address_ <= 0x3D && !burst) {
+      this->strobe(this->address_);
+      this->have_header_ = false;
+    }
+    return status;
+  }
+
+  bool read = this->header_ & 0x80;
+  bool burst = this->header_ & 0x40;
+
+  if (this->address_ == FIFO_ADDRESS) {
+    return read ? this->fifo_pop() : this->status_byte();
+  }
+
+  uint8_t value;
+  if (read) {
+    value = (this->address_ >= 0x30 && burst) ? this->read_status_register(this->address_)
+                                               : this->regs_[this->address_];
+  } else {
+    value = this->status_byte();
+    if (this->address_ < 0x30) {
+      this->regs_[this->address_] = data;
+    }
+  }
+
+  if (burst && this->address_ < 0x30) {
+    this->address_++;
+  } else {
+    this->have_header_ = false;
+  }
+  return value;
+}
+
+uint8_t SimulatedCC1101::read_status_register(uint8_t address) {
+  switch (address) {
+    case 0x30:  // PARTNUM
+      return 0x00;
+    case 0x31:  // VERSION
+      return 0x14;
+    case 0x32:  // FREQEST: carrier offset from the programmed frequency
+      return (uint8_t) (this->current_.frequency_offset - (int8_t) this->regs_[REG_FSCTRL0]);
+    case 0x33:  // LQI of the last packet
+      return this->current_.lqi | LQI_CRC_OK;
+    case 0x34:  // RSSI
+      return this->current_.rssi;
+    case 0x35:  // MARCSTATE
+      return this->marcstate_;
+    case 0x38:  // PKTSTATUS: GDO0 in bit 0
+      return this->gdo0_level_ ? 0x01 : 0x00;
+    case 0x3B: {  // RXBYTES
+      uint8_t count = this->fifo_.size() > 0x7F ? 0x7F : (uint8_t) this->fifo_.size();
+      return (uint8_t) ((this->marcstate_ == MARC_RXFIFO_OVERFLOW ? 0x80 : 0x00) | count);
+    }
+    default:
+      return 0x00;
+  }
+}
+
+void SimulatedCC1101::strobe(uint8_t command) {
+  switch (command) {
+    case 0x30:  // SRES
+      this->reset_registers();
+      this->chip_ready_us_ = now_us() + RESET_READY_US;
+      break;
+    case 0x33:  // SCAL
+      if (this->marcstate_ == MARC_IDLE) {
+        this->marcstate_ = MARC_STARTCAL;
+        this->pending_state_ = MARC_IDLE;
+        this->state_ready_us_ = now_us() + CALIBRATION_US;
+      }
+      break;
+    case 0x34:  // SRX
+      if (this->marcstate_ == MARC_IDLE) {
+        // FS_AUTOCAL=01: calibrate on every IDLE -> RX transition
+        bool autocal = ((this->regs_[REG_MCSM0] >> 4) & 0x03) == 0x01;
+        this->marcstate_ = MARC_STARTCAL;
+        this->pending_state_ = MARC_RX;
+        this->state_ready_us_ = now_us() + (autocal ? CALIBRATION_US : RX_SETTLING_US);
+      }
+      break;
+    case 0x36:  // SIDLE
+      this->receiving_ = false;
+      this->marcstate_ = MARC_IDLE;
+      this->state_ready_us_ = 0;
+      this->set_gdo0(false);
+      break;
+    case 0x39:  // SPWD
+      if (this->marcstate_ == MARC_IDLE) {
+        this->marcstate_ = MARC_SLEEP;
+        this->sleep_start_us_ = now_us();
+        this->sleeps_++;
+        for (uint8_t reg = FIRST_UNRETAINED_REG; reg <= LAST_UNRETAINED_REG; reg++) {
+          this->regs_[reg] = 0x00;
+        }
+      }
+      break;
+    case 0x3A:  // SFRX
+      if (this->marcstate_ == MARC_IDLE || this->marcstate_ == MARC_RXFIFO_OVERFLOW) {
+        this->fifo_.clear();
+        this->marcstate_ = MARC_IDLE;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void SimulatedCC1101::set_gdo0(bool level) {
+  if (level == this->gdo0_level_) {
+    return;
+  }
+  this->gdo0_level_ = level;
+  auto type = this->gdo0_.isr_type_;
+  bool fire = level ? (type & esphome::gpio::INTERRUPT_RISING_EDGE) : (type & esphome::gpio::INTERRUPT_FALLING_EDGE);
+  if (fire && this->gdo0_.isr_ != nullptr) {
+    this->gdo0_.isr_(this->gdo0_.isr_arg_);
+  }
+}
+
+void SimulatedCC1101::end_packet() {
+  // PKTCTRL1.APPEND_STATUS: RSSI, then CRC_OK (set, CRC checking is off) and LQI
+  if ((this->regs_[REG_PKTCTRL1] & PKTCTRL1_APPEND_STATUS) && this->fifo_.size() + 2 <= FIFO_SIZE) {
+    this->fifo_.push_back(this->current_.rssi);
+    this->fifo_.push_back(this->current_.lqi | LQI_CRC_OK);
+  }
+  this->receiving_ = false;
+  this->set_gdo0(false);
+  // MCSM1.RXOFF_MODE: 3 = stay in RX, anything else modelled as IDLE
+  if (((this->regs_[REG_MCSM1] >> 2) & 0x03) != 0x03) {
+    this->marcstate_ = MARC_IDLE;
+  }
+}
+
+uint8_t SimulatedCC1101::fifo_pop() {
+  if (this->fifo_.empty()) {
+    return 0x00;
+  }
+  uint8_t value = this->fifo_.front();
+  this->fifo_.pop_front();
+  return value;
+}
+
+void SimulatedCC1101::transmit(const std::vector<uint8_t> &frame, uint64_t start_us, uint8_t format_sync) {
+  Transmission t;
+  t.bytes.reserve(frame.size() + 2);
+  if (format_sync != 0x00) {
+    t.bytes.push_back(0x54);
+    t.bytes.push_back(format_sync);
+  }
+  t.bytes.insert(t.bytes.end(), frame.begin(), frame.end());
+  t.start_us = start_us;
+  t.rssi = this->rssi_;
+  t.lqi = this->lqi_;
+  t.frequency_offset = this->frequency_offset_;
+  this->air_.push_back(std::move(t));
+}
+
+size_t SimulatedCC1101::transmit_file(const std::string &path, uint64_t start_us, uint64_t interval_us) {
+  std::ifstream file(path);
+  std::string line;
+  size_t count = 0;
+  while (std::getline(file, line)) {
+    auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+    auto frame = parse_hex(line);
+    if (frame.empty()) {
+      continue;
+    }
+    this->transmit(frame, start_us + count * interval_us);
+    count++;
+  }
+  return count;
+}
+
+void SimulatedCC1101::tick() {
+  uint64_t now = now_us();
+
+  if (this->state_ready_us_ != 0 && now >= this->state_ready_us_) {
+    // Pending calibration / settling finished: SCAL returns to IDLE, SRX continues to RX
+    this->state_ready_us_ = 0;
+    this->marcstate_ = this->pending_state_;
+  }
+
+  // State only changes on SPI traffic, which ticks first, so between two
+  // ticks the air can be replayed in order: finish the packet in progress up
+  // to the next telegram's start, then decide whether that one is heard.
+  while (!this->air_.empty() && this->air_.front().start_us <= now) {
+    this->deliver_until(this->air_.front().start_us);
+    Transmission t = std::move(this->air_.front());
+    this->air_.pop_front();
+    if (this->marcstate_ != MARC_RX || this->receiving_) {
+      this->missed_++;
+      continue;
+    }
+    int residual = t.frequency_offset - (int8_t) this->regs_[REG_FSCTRL0];
+    if (residual > FOC_RANGE_STEPS || residual < -FOC_RANGE_STEPS) {
+      t.bytes.back() ^= 0x01;
+    }
+    this->current_ = std::move(t);
+    this->receiving_ = true;
+    this->received_bytes_ = 0;
+    this->packet_start_us_ = this->current_.start_us;
+    this->set_gdo0(true);  // Sync word detected
+  }
+  this->deliver_until(now);
+}
+
+// Push every byte of the current packet that has fully arrived by `time_us`
+void SimulatedCC1101::deliver_until(uint64_t time_us) {
+  if (!this->receiving_ || time_us < this->packet_start_us_) {
+    return;
+  }
+  size_t due = (size_t) ((time_us - this->packet_start_us_) / AIR_BYTE_US);
+  while (this->receiving_ && this->received_bytes_ < due) {
+    if (this->fifo_.size() >= FIFO_SIZE) {
+      this->overflows_++;
+      this->receiving_ = false;
+      this->marcstate_ = MARC_RXFIFO_OVERFLOW;
+      this->set_gdo0(false);
+      return;
+    }
+    // Past the end of the transmission an infinite-length packet keeps
+    // filling the FIFO with noise until the radio is told to stop
+    uint8_t byte = this->received_bytes_ < this->current_.bytes.size() ? this->current_.bytes[this->received_bytes_]
+                                                                       : 0x00;
+    this->fifo_.push_back(byte);
+    this->received_bytes_++;
+
+    bool fixed_length = (this->regs_[REG_PKTCTRL0] & 0x03) == 0x00;
+    if (fixed_length && (this->received_bytes_ & 0xFF) == this->regs_[REG_PKTLEN]) {
+      this->end_packet();
+    }
+  }
+}
+
+std::vector<uint8_t> parse_hex(const std::string &hex) {
+  std::vector<uint8_t> bytes;
+  int high = -1;
+  for (char c : hex) {
+    if (isspace((unsigned char) c) || c == '_') {
+      continue;
+    }
+    if (!isxdigit((unsigned char) c)) {
+      return {};
+    }
+    int value = isdigit((unsigned char) c) ? c - '0' : (tolower((unsigned char) c) - 'a' + 10);
+    if (high < 0) {
+      high = value;
+    } else {
+      bytes.push_back((uint8_t) ((high << 4) | value));
+      high = -1;
+    }
+  }
+  return bytes;
+}
+
+}  // namespace multical21_sim
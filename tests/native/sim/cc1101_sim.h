@@ -0,0 +1,152 @@
+// Simulated CC1101 for host tests and benchmarks.
+//
+// Models the parts of the chip the component relies on: the register file,
+// status registers, the 64-byte RX FIFO filled at the over-the-air byte rate,
+// MARCSTATE transitions for the strobes, SLEEP and waking up on CSn,
+// fixed/infinite packet length handling with appended packet status, and the
+// GDO0 sync line. Time comes from the host clock in esphome/core/hal.h, which
+// advances with every simulated SPI byte.
+
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "radio_transport.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace multical21_sim {
+
+using esphome::multical21::RadioTransport;
+
+class SimulatedCC1101;
+
+// GDO0 as seen by the ESP: high from sync word to end of packet (IOCFG0=0x06)
+class SimGdo0Pin : public esphome::InternalGPIOPin {
+ public:
+  explicit SimGdo0Pin(SimulatedCC1101 *radio) : radio_(radio) {}
+  void setup() override {}
+  bool digital_read() override;
+
+ protected:
+  friend class SimulatedCC1101;
+  void attach_interrupt(void (*func)(void *), void *arg, esphome::gpio::InterruptType type) const override;
+
+  SimulatedCC1101 *radio_;
+  mutable void (*isr_)(void *){nullptr};
+  mutable void *isr_arg_{nullptr};
+  mutable esphome::gpio::InterruptType isr_type_{esphome::gpio::INTERRUPT_RISING_EDGE};
+};
+
+class SimulatedCC1101 : public RadioTransport {
+ public:
+  static const uint8_t FIFO_SIZE = 64;
+  static const uint32_t SPI_BYTE_US = 8;   // 1 MHz SPI clock
+  static const uint32_t AIR_BYTE_US = 80;  // ~100 kbps Mode C1
+
+  SimulatedCC1101();
+
+  // RadioTransport
+  void select() override;
+  void deselect() override;
+  uint8_t transfer(uint8_t data) override;
+
+  // Put a telegram on the air at `start_us` (host clock). `frame` starts with
+  // the L-field; the 0x54 and format byte (0x3D: format B, 0xCD: format A)
+  // following the sync word are added here. Format byte 0x00 sends a Mode T1
+  // telegram, already 3-out-of-6 encoded, with nothing in front of it.
+  void transmit(const std::vector<uint8_t> &frame, uint64_t start_us, uint8_t format_sync = 0x3D);
+  // RSSI and LQI (raw register values) of telegrams transmitted from now on,
+  // appended to each packet with PKTCTRL1.APPEND_STATUS
+  void set_signal(uint8_t rssi, uint8_t lqi) {
+    this->rssi_ = rssi;
+    this->lqi_ = lqi;
+  }
+  // Carrier offset of telegrams transmitted from now on, in FSCTRL0 steps
+  // (~1.6 kHz), e.g. from crystal error. Reported in FREQEST relative to
+  // FSCTRL0; a residual beyond FOC_RANGE_STEPS corrupts the telegram's last byte.
+  static const int8_t FOC_RANGE_STEPS = 8;
+  void set_frequency_offset(int8_t steps) { this->frequency_offset_ = steps; }
+  // Load telegrams from a text file: one hex frame per line, '#' comments.
+  // They are transmitted `interval_us` apart starting at `start_us`.
+  size_t transmit_file(const std::string &path, uint64_t start_us, uint64_t interval_us);
+  bool air_idle() const { return this->air_.empty() && !this->receiving_; }
+
+  // Bring the simulation up to the current host clock
+  void tick();
+
+  SimGdo0Pin *gdo0() { return &this->gdo0_; }
+  bool gdo0_level() const { return this->gdo0_level_; }
+  uint8_t marcstate() const { return this->marcstate_; }
+  uint8_t reg(uint8_t address) const { return this->regs_[address & 0x3F]; }
+
+  // Telegrams that started while the radio was not listening or was busy
+  uint32_t missed_telegrams() const { return this->missed_; }
+  uint32_t overflows() const { return this->overflows_; }
+  uint32_t spi_bytes() const { return this->spi_bytes_; }
+  // Time spent in SLEEP (SPWD until CSn is pulled low again), and how often
+  uint64_t sleep_us() const {
+    return this->sleep_us_ + (this->marcstate_ == 0x00 ? esphome::host::now_us() - this->sleep_start_us_ : 0);
+  }
+  uint32_t sleeps() const { return this->sleeps_; }
+
+ protected:
+  struct Transmission {
+    std::vector<uint8_t> bytes;  // Everything after the sync word
+    uint64_t start_us{0};
+    uint8_t rssi{0};
+    uint8_t lqi{0};
+    int8_t frequency_offset{0};
+  };
+
+  void reset_registers();
+  void strobe(uint8_t command);
+  uint8_t status_byte() const;
+  uint8_t read_status_register(uint8_t address);
+  void set_gdo0(bool level);
+  void end_packet();
+  void deliver_until(uint64_t time_us);
+  uint8_t fifo_pop();
+
+  uint8_t regs_[0x3F]{0};
+  uint8_t marcstate_{0x01};  // IDLE
+  uint64_t state_ready_us_{0};  // Pending calibration/settling completes at this time
+  uint8_t pending_state_{0x01};  // MARCSTATE entered when it does
+  uint64_t chip_ready_us_{0};    // CHIP_RDYn is high until this time
+
+  std::deque<uint8_t> fifo_;
+  std::deque<Transmission> air_;
+
+  // Packet currently being received
+  bool receiving_{false};
+  Transmission current_;
+  size_t received_bytes_{0};  // Bytes after sync delivered so far
+  uint64_t packet_start_us_{0};
+
+  // SPI transaction state
+  bool selected_{false};
+  bool have_header_{false};
+  uint8_t header_{0};
+  uint8_t address_{0};
+
+  SimGdo0Pin gdo0_;
+  bool gdo0_level_{false};
+
+  uint8_t rssi_{0};
+  uint8_t lqi_{0};
+  int8_t frequency_offset_{0};
+
+  uint32_t missed_{0};
+  uint32_t overflows_{0};
+  uint32_t spi_bytes_{0};
+  uint64_t sleep_start_us_{0};
+  uint64_t sleep_us_{0};
+  uint32_t sleeps_{0};
+};
+
+// Parse a hex string (whitespace allowed) into bytes
+std::vector<uint8_t> parse_hex(const std::string &hex);
+
+}  // namespace multical21_sim
@@ -0,0 +1,18 @@
+// Host stand-in for the API server: only the connection state, which tests
+// toggle to simulate Home Assistant going away and coming back
+#pragma once
+
+namespace esphome {
+namespace api {
+
+class APIServer {
+ public:
+  bool is_connected() const { return this->connected; }
+
+  bool connected{true};
+};
+
+extern APIServer *global_api_server;
+
+}  // namespace api
+}  // namespace esphome
@@ -0,0 +1,27 @@
+// Host stand-in for esphome/components/binary_sensor/binary_sensor.h
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  // Like ESPHome, a state equal to the last one is not sent again
+  void publish_state(bool state) {
+    if (this->has_state && state == this->state) {
+      return;
+    }
+    this->state = state;
+    this->has_state = true;
+    this->publish_count++;
+  }
+
+  bool state{false};
+  bool has_state{false};
+  uint32_t publish_count{0};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
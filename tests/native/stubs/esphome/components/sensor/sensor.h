@@ -0,0 +1,23 @@
+// Host stand-in for esphome/components/sensor/sensor.h
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    this->has_state = true;
+    this->publish_count++;
+  }
+
+  float state{0.0f};
+  bool has_state{false};
+  uint32_t publish_count{0};
+};
+
+}  // namespace sensor
+}  // namespace esphome
@@ -0,0 +1,24 @@
+// Host stand-in for esphome/components/spi/spi.h. The bus itself is never
+// used on host: tests route radio traffic through RadioTransport instead.
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace spi {
+
+enum BitOrder { BIT_ORDER_MSB_FIRST };
+enum ClockPolarity { CLOCK_POLARITY_LOW };
+enum ClockPhase { CLOCK_PHASE_LEADING };
+enum DataRate { DATA_RATE_1MHZ };
+
+template<BitOrder BIT_ORDER, ClockPolarity CPOL, ClockPhase CPHA, DataRate DATA_RATE> class SPIDevice {
+ public:
+  void spi_setup() {}
+  void enable() {}
+  void disable() {}
+  uint8_t transfer_byte(uint8_t data) { return 0xFF; }
+};
+
+}  // namespace spi
+}  // namespace esphome
@@ -0,0 +1,22 @@
+// Host stand-in for esphome/components/text_sensor/text_sensor.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    this->publish_count++;
+  }
+
+  std::string state;
+  uint32_t publish_count{0};
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
@@ -0,0 +1,26 @@
+// Host stand-in for esphome/components/time/real_time_clock.h: local time is
+// whatever the test sets
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+struct ESPTime {
+  uint8_t hour{0};
+  bool valid{false};
+
+  bool is_valid() const { return this->valid; }
+};
+
+namespace time {
+
+class RealTimeClock {
+ public:
+  ESPTime now() { return this->local; }
+
+  ESPTime local;
+};
+
+}  // namespace time
+}  // namespace esphome
@@ -0,0 +1,3 @@
+// Host stand-in for the defines.h ESPHome generates from the configuration.
+// Empty: host builds set what they need on the compiler command line.
+#pragma once
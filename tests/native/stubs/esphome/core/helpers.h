@@ -0,0 +1,42 @@
+// Host stand-in for esphome/core/helpers.h
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace esphome {
+
+// FNV-1 hash, used by components to derive preference keys
+inline uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= (uint8_t) c;
+  }
+  return hash;
+}
+
+// FreeRTOS mutex on the device; a std::mutex on the host
+class Mutex {
+ public:
+  void lock() { this->mutex_.lock(); }
+  bool try_lock() { return this->mutex_.try_lock(); }
+  void unlock() { this->mutex_.unlock(); }
+
+ private:
+  std::mutex mutex_;
+};
+
+class LockGuard {
+ public:
+  explicit LockGuard(Mutex &mutex) : mutex_(mutex) { this->mutex_.lock(); }
+  ~LockGuard() { this->mutex_.unlock(); }
+  LockGuard(const LockGuard &) = delete;
+  LockGuard &operator=(const LockGuard &) = delete;
+
+ private:
+  Mutex &mutex_;
+};
+
+}  // namespace esphome
@@ -0,0 +1,19 @@
+// Host stand-in for esphome/core/log.h. Messages are printed when
+// esphome::host::log_level is at least the message level.
+#pragma once
+
+namespace esphome {
+namespace host {
+enum LogLevel { LOG_NONE = 0, LOG_ERROR, LOG_WARN, LOG_INFO, LOG_CONFIG, LOG_DEBUG, LOG_VERBOSE };
+extern int log_level;
+void log_printf(int level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+}  // namespace host
+}  // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::host::log_printf(::esphome::host::LOG_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::host::log_printf(::esphome::host::LOG_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::host::log_printf(::esphome::host::LOG_INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::host::log_printf(::esphome::host::LOG_CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::host::log_printf(::esphome::host::LOG_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::host::log_printf(::esphome::host::LOG_VERBOSE, tag, __VA_ARGS__)
+#define LOG_PIN(prefix, pin)
@@ -0,0 +1,54 @@
+// Host stand-in for esphome/core/preferences.h: preferences kept in memory for
+// the life of the test process, so a test can "reboot" by building a new
+// component and loading what the previous one saved.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace esphome {
+
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  explicit ESPPreferenceObject(std::vector<uint8_t> *store) : store_(store) {}
+
+  template<typename T> bool save(const T *src) {
+    if (this->store_ == nullptr) {
+      return false;
+    }
+    this->store_->assign(reinterpret_cast<const uint8_t *>(src), reinterpret_cast<const uint8_t *>(src) + sizeof(T));
+    return true;
+  }
+
+  template<typename T> bool load(T *dest) {
+    if (this->store_ == nullptr || this->store_->size() != sizeof(T)) {
+      return false;
+    }
+    memcpy(dest, this->store_->data(), sizeof(T));
+    return true;
+  }
+
+ protected:
+  std::vector<uint8_t> *store_{nullptr};
+};
+
+class ESPPreferences {
+ public:
+  ESPPreferenceObject make_preference(size_t length, uint32_t type, bool in_flash);
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash = false) {
+    return this->make_preference(sizeof(T), type, in_flash);
+  }
+  bool sync() { return true; }
+};
+
+extern ESPPreferences *global_preferences;
+
+namespace host {
+// Forget everything saved, like erasing flash
+void clear_preferences();
+}  // namespace host
+
+}  // namespace esphome
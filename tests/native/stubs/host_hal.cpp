@@ -0,0 +1,62 @@
+// Host implementations of the esphome/core hal and log stand-ins
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/api/api_server.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+namespace esphome {
+
+namespace host {
+
+static uint64_t clock_us = 0;
+
+uint64_t now_us() { return clock_us; }
+void advance_us(uint64_t us) { clock_us += us; }
+void reset_clock(uint64_t us) { clock_us = us; }
+
+int log_level = getenv("MULTICAL21_LOG") != nullptr ? atoi(getenv("MULTICAL21_LOG")) : LOG_NONE;
+
+void log_printf(int level, const char *tag, const char *format, ...) {
+  if (level > log_level) {
+    return;
+  }
+  static const char LEVEL_CHARS[] = "-EWICDV";
+  fprintf(stderr, "[%c][%s] ", LEVEL_CHARS[level], tag);
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+static std::map<uint32_t, std::vector<uint8_t>> preference_store;
+
+void clear_preferences() { preference_store.clear(); }
+
+}  // namespace host
+
+static api::APIServer host_api_server;
+api::APIServer *api::global_api_server = &host_api_server;
+
+static ESPPreferences host_preferences;
+ESPPreferences *global_preferences = &host_preferences;
+
+ESPPreferenceObject ESPPreferences::make_preference(size_t length, uint32_t type, bool in_flash) {
+  return ESPPreferenceObject(&host::preference_store[type]);
+}
+
+uint32_t millis() { return (uint32_t) (host::clock_us / 1000); }
+uint32_t micros() { return (uint32_t) host::clock_us; }
+void delay(uint32_t ms) { host::clock_us += (uint64_t) ms * 1000; }
+void delayMicroseconds(uint32_t us) { host::clock_us += us; }
+
+// A nominal 160 MHz core driven by the virtual clock
+uint32_t arch_get_cpu_freq_hz() { return 160000000u; }
+uint32_t arch_get_cpu_cycle_count() { return (uint32_t) (host::clock_us * 160u); }
+
+}  // namespace esphome
@@ -0,0 +1,58 @@
+// Host stand-in for the PSA Crypto API subset used by the component,
+// backed by OpenSSL (see host_psa.cpp).
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int32_t psa_status_t;
+typedef uint32_t psa_key_id_t;
+typedef psa_key_id_t psa_key_handle_t;
+typedef uint32_t psa_algorithm_t;
+typedef uint16_t psa_key_type_t;
+typedef uint32_t psa_key_usage_t;
+
+#define PSA_SUCCESS ((psa_status_t) 0)
+#define PSA_ERROR_GENERIC_ERROR ((psa_status_t) -132)
+#define PSA_ERROR_NOT_SUPPORTED ((psa_status_t) -134)
+#define PSA_ERROR_INVALID_ARGUMENT ((psa_status_t) -135)
+#define PSA_ERROR_INVALID_HANDLE ((psa_status_t) -136)
+#define PSA_ERROR_BAD_STATE ((psa_status_t) -137)
+
+#define PSA_ALG_CTR ((psa_algorithm_t) 0x04c01000)
+#define PSA_ALG_ECB_NO_PADDING ((psa_algorithm_t) 0x04404400)
+#define PSA_KEY_TYPE_AES ((psa_key_type_t) 0x2400)
+#define PSA_KEY_USAGE_ENCRYPT ((psa_key_usage_t) 0x00000100)
+#define PSA_KEY_USAGE_DECRYPT ((psa_key_usage_t) 0x00000200)
+
+struct psa_key_attributes_t {
+  psa_key_usage_t usage;
+  psa_algorithm_t alg;
+  psa_key_type_t type;
+  size_t bits;
+};
+#define PSA_KEY_ATTRIBUTES_INIT \
+  { 0, 0, 0, 0 }
+
+psa_status_t psa_crypto_init();
+void psa_set_key_usage_flags(psa_key_attributes_t *attributes, psa_key_usage_t usage);
+void psa_set_key_algorithm(psa_key_attributes_t *attributes, psa_algorithm_t alg);
+void psa_set_key_type(psa_key_attributes_t *attributes, psa_key_type_t type);
+void psa_set_key_bits(psa_key_attributes_t *attributes, size_t bits);
+void psa_reset_key_attributes(psa_key_attributes_t *attributes);
+psa_status_t psa_import_key(const psa_key_attributes_t *attributes, const uint8_t *data, size_t data_length,
+                            psa_key_id_t *key);
+psa_status_t psa_destroy_key(psa_key_id_t key);
+// Multipart cipher operation; `ctx` is the OpenSSL context while one is set up
+struct psa_cipher_operation_t {
+  void *ctx;
+};
+#define PSA_CIPHER_OPERATION_INIT \
+  { nullptr }
+
+psa_status_t psa_cipher_encrypt_setup(psa_cipher_operation_t *operation, psa_key_id_t key, psa_algorithm_t alg);
+psa_status_t psa_cipher_update(psa_cipher_operation_t *operation, const uint8_t *input, size_t input_length,
+                               uint8_t *output, size_t output_size, size_t *output_length);
+psa_status_t psa_cipher_finish(psa_cipher_operation_t *operation, uint8_t *output, size_t output_size,
+                               size_t *output_length);
+psa_status_t psa_cipher_abort(psa_cipher_operation_t *operation);
@@ -0,0 +1,102 @@
+// Reading captures written by the component's CaptureRing (capture.h), either
+// as a binary capture file or from a device log holding a capture dump.
+
+#pragma once
+
+#include "capture.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace multical21_test {
+
+using esphome::multical21::CAPTURE_MAGIC;
+using esphome::multical21::CAPTURE_RECORD_HEADER_BYTES;
+
+struct CapturedFrame {
+  uint32_t arrival_us{0};
+  uint8_t rssi{0};
+  uint8_t lqi{0};
+  uint8_t format_sync{0};
+  uint8_t outcome{0};
+  std::vector<uint8_t> bytes;  // L-field first, block CRCs included
+};
+
+// The capture file in a log: the hex after "capture: " on each line following
+// the last "capture begin". Log prefixes and colour codes are skipped.
+inline std::vector<uint8_t> capture_from_log(const std::string &log) {
+  std::vector<uint8_t> file;
+  std::istringstream in(log);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.find("capture begin") != std::string::npos) {
+      file.clear();
+      continue;
+    }
+    auto marker = line.find("capture: ");
+    if (marker == std::string::npos) {
+      continue;
+    }
+    int high = -1;
+    for (size_t i = marker + 9; i < line.size() && isxdigit((unsigned char) line[i]); i++) {
+      int value = isdigit((unsigned char) line[i]) ? line[i] - '0' : tolower((unsigned char) line[i]) - 'a' + 10;
+      if (high < 0) {
+        high = value;
+      } else {
+        file.push_back((uint8_t) ((high << 4) | value));
+        high = -1;
+      }
+    }
+  }
+  return file;
+}
+
+// Split a capture file into frames. False on a bad magic or a truncated record.
+inline bool parse_capture(const std::vector<uint8_t> &file, std::vector<CapturedFrame> *frames) {
+  if (file.size() < sizeof(CAPTURE_MAGIC) || memcmp(file.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+    return false;
+  }
+  size_t pos = sizeof(CAPTURE_MAGIC);
+  while (pos < file.size()) {
+    if (file.size() - pos < CAPTURE_RECORD_HEADER_BYTES) {
+      return false;
+    }
+    const uint8_t *header = &file[pos];
+    CapturedFrame frame;
+    frame.arrival_us = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t) header[3] << 24);
+    frame.rssi = header[4];
+    frame.lqi = header[5];
+    frame.format_sync = header[6];
+    frame.outcome = header[7];
+    size_t length = header[8] | (header[9] << 8);
+    pos += CAPTURE_RECORD_HEADER_BYTES;
+    if (file.size() - pos < length) {
+      return false;
+    }
+    frame.bytes.assign(file.begin() + pos, file.begin() + pos + length);
+    pos += length;
+    frames->push_back(std::move(frame));
+  }
+  return true;
+}
+
+// Load a binary capture file, or a text log containing a capture dump
+inline bool load_capture(const std::string &path, std::vector<CapturedFrame> *frames) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (file.size() < sizeof(CAPTURE_MAGIC) || memcmp(file.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+    file = capture_from_log(std::string(file.begin(), file.end()));
+  }
+  return parse_capture(file, frames);
+}
+
+}  // namespace multical21_test
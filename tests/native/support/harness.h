@@ -0,0 +1,160 @@
+// A Multical21Component wired to a simulated CC1101, with one meter and its
+// sensors, plus a main loop driven by the host clock.
+
+#pragma once
+
+#include "cc1101_sim.h"
+#include "multical21.h"
+#include "esphome/components/api/api_server.h"
+
+#include <memory>
+
+namespace multical21_test {
+
+using esphome::multical21::Multical21Component;
+using esphome::multical21::Multical21Meter;
+using multical21_sim::SimulatedCC1101;
+
+// Exposes the hub's internal counters to tests
+class TestHub : public Multical21Component {
+ public:
+  using Multical21Component::accepted_frames_;
+  using Multical21Component::duplicate_frames_;
+  using Multical21Component::fifo_overflows_;
+  using Multical21Component::foreign_frames_;
+  using Multical21Component::link_crc_errors_;
+  using Multical21Component::publish_readings;
+  using Multical21Component::radios_;
+  using Multical21Component::readings_;
+  using Multical21Component::rearms_;
+  using Multical21Component::service_radios;
+  using Multical21Component::wakeups_;
+};
+
+struct MeterSensors {
+  esphome::sensor::Sensor total;
+  esphome::sensor::Sensor month_start;
+  esphome::sensor::Sensor water_temp;
+  esphome::sensor::Sensor ambient_temp;
+  esphome::sensor::Sensor flow;
+  esphome::sensor::Sensor frames_received;
+  esphome::sensor::Sensor crc_errors;
+  esphome::sensor::Sensor link_crc_errors;
+  esphome::sensor::Sensor signal_quality;
+  esphome::sensor::Sensor decrypt_time;
+  esphome::sensor::Sensor processing_time;
+  esphome::sensor::Sensor rssi;
+  esphome::sensor::Sensor rssi_min;
+  esphome::sensor::Sensor rssi_max;
+  esphome::sensor::Sensor lqi;
+  esphome::sensor::Sensor missed_telegrams;
+  esphome::sensor::Sensor continuous_flow_duration;
+  esphome::sensor::Sensor peak_flow;
+  esphome::sensor::Sensor night_min_flow;
+  esphome::sensor::Sensor reverse_flow_events;
+  esphome::binary_sensor::BinarySensor dry;
+  esphome::binary_sensor::BinarySensor reverse_flow;
+  esphome::binary_sensor::BinarySensor leak;
+  esphome::binary_sensor::BinarySensor burst;
+  esphome::text_sensor::TextSensor last_update;
+  esphome::text_sensor::TextSensor rssi_histogram;
+
+  void attach(Multical21Meter *meter) {
+    meter->set_total_consumption_sensor(&this->total);
+    meter->set_month_start_sensor(&this->month_start);
+    meter->set_water_temp_sensor(&this->water_temp);
+    meter->set_ambient_temp_sensor(&this->ambient_temp);
+    meter->set_current_flow_sensor(&this->flow);
+    meter->set_frames_received_sensor(&this->frames_received);
+    meter->set_crc_errors_sensor(&this->crc_errors);
+    meter->set_link_crc_errors_sensor(&this->link_crc_errors);
+    meter->set_signal_quality_sensor(&this->signal_quality);
+    meter->set_decrypt_time_sensor(&this->decrypt_time);
+    meter->set_processing_time_sensor(&this->processing_time);
+    meter->set_last_update_sensor(&this->last_update);
+    meter->set_rssi_sensor(&this->rssi);
+    meter->set_rssi_min_sensor(&this->rssi_min);
+    meter->set_rssi_max_sensor(&this->rssi_max);
+    meter->set_lqi_sensor(&this->lqi);
+    meter->set_missed_telegrams_sensor(&this->missed_telegrams);
+    meter->set_rssi_histogram_sensor(&this->rssi_histogram);
+    meter->set_continuous_flow_duration_sensor(&this->continuous_flow_duration);
+    meter->set_peak_flow_sensor(&this->peak_flow);
+    meter->set_night_min_flow_sensor(&this->night_min_flow);
+    meter->set_reverse_flow_events_sensor(&this->reverse_flow_events);
+    meter->set_dry_sensor(&this->dry);
+    meter->set_reverse_flow_sensor(&this->reverse_flow);
+    meter->set_leak_sensor(&this->leak);
+    meter->set_burst_sensor(&this->burst);
+  }
+};
+
+struct Harness {
+  // ESPHome calls loop() roughly every few milliseconds when idle
+  static const uint32_t LOOP_INTERVAL_US = 1000;
+
+  SimulatedCC1101 radio;
+  SimulatedCC1101 radio2;  // Only on the air after use_second_radio()
+  TestHub hub;
+  Multical21Meter meter;
+  MeterSensors sensors;
+
+  explicit Harness(bool use_interrupt = true, const char *meter_id = "76348799",
+                   const char *key = "28F64A24988064A079AA2C807D6102AE") {
+    esphome::host::reset_clock();
+    esphome::api::global_api_server->connected = true;
+    this->hub.set_transport(&this->radio);
+    this->hub.set_gdo0_pin(this->radio.gdo0());
+    if (use_interrupt) {
+      this->hub.set_gdo0_isr_pin(this->radio.gdo0());
+    }
+    this->meter.set_meter_id(meter_id);
+    this->meter.set_key(key);
+    this->sensors.attach(&this->meter);
+    this->hub.register_meter(&this->meter);
+  }
+
+  // Diversity receive: radio2 becomes the hub's second radio. Call before setup().
+  void use_second_radio(bool use_interrupt = true) {
+    this->hub.set_second_radio(&this->radio2, this->radio2.gdo0(), use_interrupt ? this->radio2.gdo0() : nullptr);
+  }
+
+  void setup() {
+    this->hub.setup();
+    this->run_for(10000);  // Let reset, calibration and RX entry complete from loop()
+  }
+
+  // Advance the host clock, running the main loop every LOOP_INTERVAL_US
+  void run_for(uint64_t duration_us) {
+    uint64_t end = esphome::host::now_us() + duration_us;
+    while (esphome::host::now_us() < end) {
+      esphome::host::advance_us(LOOP_INTERVAL_US);
+      this->radio.tick();
+      this->radio2.tick();
+      this->hub.loop();
+    }
+  }
+
+  // Advance the host clock running frame processing only, as the receive task
+  // does while loop() is held up
+  void service_for(uint64_t duration_us) {
+    uint64_t end = esphome::host::now_us() + duration_us;
+    while (esphome::host::now_us() < end) {
+      esphome::host::advance_us(LOOP_INTERVAL_US);
+      this->radio.tick();
+      this->radio2.tick();
+      this->hub.service_radios();
+    }
+  }
+
+  // Run until every queued telegram has been received (or missed)
+  void run_until_air_idle(uint64_t limit_us = 600000000) {
+    uint64_t end = esphome::host::now_us() + limit_us;
+    while (!(this->radio.air_idle() && this->radio2.air_idle()) && esphome::host::now_us() < end) {
+      this->run_for(LOOP_INTERVAL_US);
+    }
+    this->run_for(10 * LOOP_INTERVAL_US);
+  }
+};
+
+}  // namespace multical21_test
@@ -0,0 +1,244 @@
+// Builds encrypted Multical 21 Mode C1 and T1 telegrams for host tests.
+//
+// Deliberately independent of the component: CRCs are computed bit by bit and
+// the CTR keystream comes straight from OpenSSL, so a test passing means the
+// component agrees with a second implementation, not with itself.
+
+#pragma once
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace multical21_test {
+
+inline uint16_t crc16_en13757_bitwise(const uint8_t *data, size_t length) {
+  uint16_t crc = 0x0000;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t) data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x3D65) : (uint16_t) (crc << 1);
+    }
+  }
+  return (uint16_t) ~crc;
+}
+
+inline std::vector<uint8_t> bytes_from_hex(const std::string &hex) {
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+    out.push_back((uint8_t) std::stoi(hex.substr(i, 2), nullptr, 16));
+  }
+  return out;
+}
+
+struct TelegramBuilder {
+  uint32_t meter_id{0x76348799};
+  std::string key{"28F64A24988064A079AA2C807D6102AE"};
+  uint8_t cc{0x20};
+  uint8_t acc{0x91};
+  uint32_t sn{0x21AC7CD3};
+  bool format_a{false};  // Link layer frame format; Multical 21 sends format B
+  bool mode_t1{false};   // 3-out-of-6 encoded for Mode T1, always format A
+
+  // Record data of the Multical 21 default data set: info codes, total and
+  // target volume in litres, flow and external temperature in degrees C
+  static std::vector<uint8_t> record_data(uint32_t total_l, uint32_t target_l, uint8_t flow_temp,
+                                          uint8_t ambient_temp, uint16_t info = 0) {
+    std::vector<uint8_t> data = {(uint8_t) info, (uint8_t) (info >> 8)};
+    for (uint32_t volume : {total_l, target_l}) {
+      for (int i = 0; i < 4; i++) {
+        data.push_back((uint8_t) (volume >> (8 * i)));
+      }
+    }
+    data.push_back(flow_temp);
+    data.push_back(ambient_temp);
+    return data;
+  }
+
+  // DIF/VIF bytes of that data set; its CRC is the compact frame signature
+  static std::vector<uint8_t> default_format() { return bytes_from_hex("02FF2004134413615B6167"); }
+
+  // Long frame (CI=0x78) plaintext: DIF/VIF records around `data`, split per `format`
+  static std::vector<uint8_t> long_plaintext(const std::vector<uint8_t> &format, const std::vector<uint8_t> &data) {
+    static const uint8_t DATA_LENGTH[16] = {0, 1, 2, 3, 4, 4, 6, 8, 0, 1, 2, 3, 4, 0, 6, 0};
+    std::vector<uint8_t> plain = {0x00, 0x00, 0x78};
+    size_t f = 0, d = 0;
+    while (f < format.size()) {
+      uint8_t dif = format[f];
+      plain.push_back(format[f++]);
+      uint8_t last = dif;
+      while (last & 0x80) {
+        plain.push_back(last = format[f++]);
+      }
+      plain.push_back(last = format[f++]);  // VIF
+      while (last & 0x80) {
+        plain.push_back(last = format[f++]);
+      }
+      for (uint8_t n = 0; n < DATA_LENGTH[dif & 0x0F]; n++) {
+        plain.push_back(data[d++]);
+      }
+    }
+    return plain;
+  }
+
+  static std::vector<uint8_t> long_plaintext(uint32_t total_l, uint32_t target_l, uint8_t flow_temp,
+                                             uint8_t ambient_temp) {
+    return long_plaintext(default_format(), record_data(total_l, target_l, flow_temp, ambient_temp));
+  }
+
+  // Compact frame (CI=0x79) plaintext: format signature, data CRC, record data
+  static std::vector<uint8_t> compact_plaintext(const std::vector<uint8_t> &format,
+                                                const std::vector<uint8_t> &data) {
+    uint16_t signature = crc16_en13757_bitwise(format.data(), format.size());
+    auto records = long_plaintext(format, data);
+    uint16_t data_crc = crc16_en13757_bitwise(records.data() + 3, records.size() - 3);
+    // reserve() + push_back rather than insert() after an initializer list:
+    // GCC 12 reports a false -Warray-bounds on the latter
+    std::vector<uint8_t> plain;
+    plain.reserve(7 + data.size());
+    for (uint8_t b : {(uint8_t) 0x00, (uint8_t) 0x00, (uint8_t) 0x79, (uint8_t) signature,
+                      (uint8_t) (signature >> 8), (uint8_t) data_crc, (uint8_t) (data_crc >> 8)}) {
+      plain.push_back(b);
+    }
+    for (uint8_t b : data) {
+      plain.push_back(b);
+    }
+    return plain;
+  }
+
+  static std::vector<uint8_t> compact_plaintext(uint32_t total_l, uint32_t target_l, uint8_t flow_temp,
+                                                uint8_t ambient_temp, uint16_t info = 0) {
+    return compact_plaintext(default_format(), record_data(total_l, target_l, flow_temp, ambient_temp, info));
+  }
+
+  // Fill in the application CRC (bytes 0-1) over everything after it
+  static void seal_plaintext(std::vector<uint8_t> &plain) {
+    uint16_t crc = crc16_en13757_bitwise(plain.data() + 2, plain.size() - 2);
+    plain[0] = (uint8_t) crc;
+    plain[1] = (uint8_t) (crc >> 8);
+  }
+
+  // Append a block CRC over `block` to `out`, MSB first
+  static void append_block(std::vector<uint8_t> &out, const uint8_t *block, size_t length) {
+    uint16_t crc = crc16_en13757_bitwise(block, length);
+    out.insert(out.end(), block, block + length);
+    out.push_back((uint8_t) (crc >> 8));
+    out.push_back((uint8_t) crc);
+  }
+
+  // Format A: L counts data only; 10-byte first block, then 16-byte blocks
+  static std::vector<uint8_t> frame_format_a(const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> all;
+    all.push_back((uint8_t) data.size());
+    all.insert(all.end(), data.begin(), data.end());
+    std::vector<uint8_t> frame;
+    append_block(frame, all.data(), 10);
+    for (size_t pos = 10; pos < all.size(); pos += 16) {
+      append_block(frame, all.data() + pos, std::min<size_t>(16, all.size() - pos));
+    }
+    return frame;
+  }
+
+  // Format B: L counts the CRCs; one CRC after byte 126, another at the end
+  static std::vector<uint8_t> frame_format_b(const std::vector<uint8_t> &data) {
+    size_t crcs = data.size() + 1 + 2 > 128 ? 2 : 1;
+    std::vector<uint8_t> all;
+    all.push_back((uint8_t) (data.size() + 2 * crcs));
+    all.insert(all.end(), data.begin(), data.end());
+    std::vector<uint8_t> frame;
+    if (crcs == 1) {
+      append_block(frame, all.data(), all.size());
+    } else {
+      append_block(frame, all.data(), 126);
+      append_block(frame, all.data() + 126, all.size() - 126);
+    }
+    return frame;
+  }
+
+  // Mode T chips for `frame`: 6 per nibble, high nibble first, then "01"
+  // postamble chips to fill the last byte when the length is odd
+  static std::vector<uint8_t> three_of_six(const std::vector<uint8_t> &frame) {
+    static const uint8_t CODES[16] = {0x16, 0x0D, 0x0E, 0x0B, 0x1C, 0x19, 0x1A, 0x13,
+                                      0x2C, 0x25, 0x26, 0x23, 0x34, 0x31, 0x32, 0x29};
+    std::vector<uint8_t> chips;
+    uint32_t bits = 0;
+    int count = 0;
+    for (uint8_t byte : frame) {
+      for (uint8_t nibble : {(uint8_t) (byte >> 4), (uint8_t) (byte & 0x0F)}) {
+        bits = (bits << 6) | CODES[nibble];
+        count += 6;
+        while (count >= 8) {
+          count -= 8;
+          chips.push_back((uint8_t) (bits >> count));
+        }
+      }
+    }
+    if (count > 0) {
+      chips.push_back((uint8_t) ((bits << (8 - count)) | (0x55 >> count)));
+    }
+    return chips;
+  }
+
+  // Second sync byte the radio puts in front of the L-field; none in T1
+  uint8_t format_sync() const {
+    if (this->mode_t1) {
+      return 0x00;
+    }
+    return this->format_a ? 0xCD : 0x3D;
+  }
+
+  // Encrypt `plain` and wrap it in the link layer. Returns the frame as the
+  // radio delivers it after the sync bytes: L-field, header, cipher, with the
+  // block CRCs of the selected frame format, encoded in T1.
+  std::vector<uint8_t> build(const std::vector<uint8_t> &plain) const {
+    std::vector<uint8_t> header = {
+        0x44,                                                         // C
+        0x2D,       0x2C,                                             // M: Kamstrup
+        (uint8_t) meter_id, (uint8_t) (meter_id >> 8), (uint8_t) (meter_id >> 16), (uint8_t) (meter_id >> 24),
+        0x1B,                                                         // Version
+        0x16,                                                         // Device type: cold water
+        0x8D,                                                         // CI: extended link layer
+        cc,         acc,
+        (uint8_t) sn, (uint8_t) (sn >> 8), (uint8_t) (sn >> 16), (uint8_t) (sn >> 24),
+    };
+
+    uint8_t iv[16] = {0};
+    memcpy(iv, &header[1], 8);
+    iv[8] = cc;
+    memcpy(&iv[9], &header[12], 4);
+
+    std::vector<uint8_t> cipher(plain.size());
+    auto key_bytes = bytes_from_hex(this->key);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_len = 0;
+    EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), nullptr, key_bytes.data(), iv);
+    EVP_EncryptUpdate(ctx, cipher.data(), &out_len, plain.data(), (int) plain.size());
+    EVP_CIPHER_CTX_free(ctx);
+
+    std::vector<uint8_t> data = header;
+    data.insert(data.end(), cipher.begin(), cipher.end());
+    if (this->mode_t1) {
+      return three_of_six(frame_format_a(data));
+    }
+    return this->format_a ? frame_format_a(data) : frame_format_b(data);
+  }
+
+  std::vector<uint8_t> compact(uint32_t total_l, uint32_t target_l, uint8_t flow_temp, uint8_t ambient_temp,
+                               uint16_t info = 0) const {
+    auto plain = compact_plaintext(total_l, target_l, flow_temp, ambient_temp, info);
+    seal_plaintext(plain);
+    return this->build(plain);
+  }
+
+  std::vector<uint8_t> long_frame(uint32_t total_l, uint32_t target_l, uint8_t flow_temp, uint8_t ambient_temp) const {
+    auto plain = long_plaintext(total_l, target_l, flow_temp, ambient_temp);
+    seal_plaintext(plain);
+    return this->build(plain);
+  }
+};
+
+}  // namespace multical21_test
@@ -0,0 +1,1924 @@
+// Host tests: the real receive/decrypt/parse pipeline against a simulated CC1101
+
+#include "capture_file.h"
+#include "harness.h"
+#include "telegram_builder.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace multical21_test;
+
+static const uint8_t MARCSTATE_RX = 0x0D;
+static const uint64_t TELEGRAM_INTERVAL_US = 16000000;  // Multical 21 sends every ~16 s
+
+TEST(Setup, RadioConfiguredAndListening) {
+  Harness h;
+  h.setup();
+  EXPECT_FALSE(h.hub.is_failed());
+  EXPECT_EQ(h.radio.marcstate(), MARCSTATE_RX);
+  EXPECT_EQ(h.radio.reg(0x04), 0x54);  // SYNC1
+  EXPECT_EQ(h.radio.reg(0x05), 0x3D);  // SYNC0
+  EXPECT_EQ(h.radio.reg(0x02), 0x06);  // IOCFG0: GDO0 = sync / end of packet
+  EXPECT_EQ(h.radio.reg(0x08), 0x02);  // PKTCTRL0: infinite length until the L-field is known
+}
+
+TEST(Setup, SetupAndLoopDoNotBlock) {
+  Harness h;
+  uint64_t start = esphome::host::now_us();
+  h.hub.setup();
+  // SRES only: no 10 ms reset delay, no register-by-register configuration
+  EXPECT_LT(esphome::host::now_us() - start, 100u);
+
+  // Reset, configure, calibrate and enter RX over a few loop() calls, none
+  // of which waits on the radio
+  int loops = 0;
+  while (h.radio.marcstate() != MARCSTATE_RX && loops < 20) {
+    esphome::host::advance_us(Harness::LOOP_INTERVAL_US);
+    uint64_t before = esphome::host::now_us();
+    h.hub.loop();
+    EXPECT_LT(esphome::host::now_us() - before, 1000u);
+    loops++;
+  }
+  EXPECT_EQ(h.radio.marcstate(), MARCSTATE_RX);
+  EXPECT_LE(loops, 4);
+}
+
+TEST(Pipeline, CompactFrameDecodedAndPublished) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  h.radio.transmit(builder.compact(1234567, 1230000, 12, 21), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+
+  ASSERT_TRUE(h.sensors.total.has_state);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.567f);
+  EXPECT_FLOAT_EQ(h.sensors.month_start.state, 1230.0f);
+  EXPECT_FLOAT_EQ(h.sensors.water_temp.state, 12.0f);
+  EXPECT_FLOAT_EQ(h.sensors.ambient_temp.state, 21.0f);
+  EXPECT_EQ(h.sensors.last_update.publish_count, 1u);
+}
+
+TEST(Pipeline, PollingModeDecodes) {
+  Harness h(false);
+  h.setup();
+  TelegramBuilder builder;
+  h.radio.transmit(builder.compact(42000, 40000, 9, 18), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+
+  ASSERT_TRUE(h.sensors.total.has_state);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 42.0f);
+}
+
+TEST(Pipeline, RadioReturnsToRxAfterEachFrame) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 5; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(1000 + i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.radio.missed_telegrams(), 0u);
+  EXPECT_EQ(h.radio.overflows(), 0u);
+  EXPECT_EQ(h.radio.marcstate(), MARCSTATE_RX);
+  EXPECT_EQ(h.sensors.total.publish_count, 5u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1.004f);
+}
+
+TEST(ContinuousRx, NoRearmBetweenFrames) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 5; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(1000 + i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.sensors.total.publish_count, 5u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_EQ(h.radio.reg(0x17) & 0x0C, 0x0C);  // MCSM1 RXOFF_MODE = stay in RX
+}
+
+TEST(ContinuousRx, BackToBackTelegramsBothReceived) {
+  Harness h;
+  h.setup();
+  TelegramBuilder neighbour;
+  neighbour.meter_id = 0x12345678;
+  TelegramBuilder ours;
+  auto first = neighbour.compact(5000, 4000, 10, 20);
+  auto second = ours.compact(1234567, 1230000, 12, 21);
+  // The second sync arrives 200 us after the first telegram ends
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(first, start);
+  h.radio.transmit(second, start + (first.size() + 2) * SimulatedCC1101::AIR_BYTE_US + 200);
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.radio.missed_telegrams(), 0u);
+  EXPECT_EQ(h.hub.foreign_frames_, 1u);
+  EXPECT_TRUE(h.sensors.total.has_state);
+}
+
+TEST(ContinuousRx, OverflowDuringFrameRecovers) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(builder.compact(1000, 0, 10, 20), start);
+  h.radio.transmit(builder.compact(2000, 0, 10, 20), start + TELEGRAM_INTERVAL_US);
+
+  // Another component holds the main loop for 20 ms while the first frame arrives
+  esphome::host::advance_us(30000);
+  h.radio.tick();
+  EXPECT_EQ(h.radio.overflows(), 1u);
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.fifo_overflows_, 1u);
+  EXPECT_EQ(h.hub.rearms_, 1u);
+  EXPECT_EQ(h.sensors.total.publish_count, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 2.0f);
+}
+
+TEST(ContinuousRx, OverflowWithoutEdgeCaughtByHealthCheck) {
+  Harness h(false);  // Polling: GDO0 is already low again once the FIFO overflows
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(builder.compact(1000, 0, 10, 20), start);
+  h.radio.transmit(builder.compact(2000, 0, 10, 20), start + TELEGRAM_INTERVAL_US);
+
+  esphome::host::advance_us(30000);
+  h.radio.tick();
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.fifo_overflows_, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 2.0f);
+}
+
+TEST(Pipeline, ForeignMeterIgnored) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  builder.meter_id = 0x12345678;
+  h.radio.transmit(builder.compact(5000, 4000, 10, 20), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  EXPECT_FALSE(h.sensors.total.has_state);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 0.0f);
+}
+
+TEST(MeterDispatch, SeveralMetersOnOneRadio) {
+  Harness h;
+  // Registered out of order, around the harness meter 76348799
+  Multical21Meter high, low;
+  MeterSensors high_sensors, low_sensors;
+  high.set_meter_id("FFFFFFFE");
+  high.set_key("000102030405060708090A0B0C0D0E0F");
+  high_sensors.attach(&high);
+  low.set_meter_id("00000001");
+  low.set_key("28F64A24988064A079AA2C807D6102AE");
+  low_sensors.attach(&low);
+  h.hub.register_meter(&high);
+  h.hub.register_meter(&low);
+  h.setup();
+
+  TelegramBuilder to_high;
+  to_high.meter_id = 0xFFFFFFFE;
+  to_high.key = "000102030405060708090A0B0C0D0E0F";
+  TelegramBuilder to_low;
+  to_low.meter_id = 0x00000001;
+  TelegramBuilder to_harness;
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(to_high.compact(1000, 900, 10, 20), start);
+  h.radio.transmit(to_low.compact(2000, 1900, 11, 21), start + TELEGRAM_INTERVAL_US);
+  h.radio.transmit(to_harness.compact(3000, 2900, 12, 22), start + 2 * TELEGRAM_INTERVAL_US);
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.accepted_frames_, 3u);
+  EXPECT_EQ(h.hub.foreign_frames_, 0u);
+  // Each telegram decrypted with its own meter's key and published to its sensors only
+  EXPECT_EQ(high_sensors.total.publish_count, 1u);
+  EXPECT_FLOAT_EQ(high_sensors.total.state, 1.0f);
+  EXPECT_EQ(low_sensors.total.publish_count, 1u);
+  EXPECT_FLOAT_EQ(low_sensors.total.state, 2.0f);
+  EXPECT_EQ(h.sensors.total.publish_count, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 3.0f);
+}
+
+TEST(MeterDispatch, UnknownIdsRejected) {
+  Harness h;
+  Multical21Meter high, duplicate;
+  MeterSensors high_sensors, duplicate_sensors;
+  high.set_meter_id("FFFFFFFE");
+  high.set_key("28F64A24988064A079AA2C807D6102AE");
+  high_sensors.attach(&high);
+  duplicate.set_meter_id("76348799");
+  duplicate.set_key("28F64A24988064A079AA2C807D6102AE");
+  duplicate_sensors.attach(&duplicate);
+  h.hub.register_meter(&high);
+  h.hub.register_meter(&duplicate);  // Ignored: the harness meter has this ID
+  h.setup();
+
+  // Below, between and above the registered IDs, then one that is registered
+  uint64_t start = esphome::host::now_us() + 5000;
+  uint32_t ids[] = {0x00000000, 0x76348798, 0x76348800, 0xFFFFFFFF, 0x76348799};
+  for (uint32_t id : ids) {
+    TelegramBuilder builder;
+    builder.meter_id = id;
+    h.radio.transmit(builder.compact(1234567, 1230000, 12, 21), start);
+    start += TELEGRAM_INTERVAL_US;
+  }
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.foreign_frames_, 4u);
+  EXPECT_EQ(h.hub.accepted_frames_, 1u);
+  EXPECT_EQ(h.sensors.total.publish_count, 1u);
+  EXPECT_FALSE(high_sensors.total.has_state);
+  EXPECT_FALSE(duplicate_sensors.total.has_state);
+}
+
+TEST(EarlyReject, ForeignFrameDroppedAfterId) {
+  TelegramBuilder ours;
+  TelegramBuilder neighbour;
+  neighbour.meter_id = 0x12345678;
+
+  Harness accepted;
+  accepted.setup();
+  uint32_t spi_before = accepted.radio.spi_bytes();
+  accepted.radio.transmit(ours.compact(5000, 4000, 10, 20), esphome::host::now_us() + 5000);
+  accepted.run_until_air_idle();
+  uint32_t accepted_spi = accepted.radio.spi_bytes() - spi_before;
+
+  Harness rejected;
+  rejected.setup();
+  spi_before = rejected.radio.spi_bytes();
+  rejected.radio.transmit(neighbour.compact(5000, 4000, 10, 20), esphome::host::now_us() + 5000);
+  rejected.run_until_air_idle();
+  uint32_t rejected_spi = rejected.radio.spi_bytes() - spi_before;
+
+  EXPECT_EQ(accepted.hub.accepted_frames_, 1u);
+  EXPECT_EQ(rejected.hub.accepted_frames_, 0u);
+  EXPECT_EQ(rejected.hub.foreign_frames_, 1u);
+  // A deliberate abort, not a fault re-arm
+  EXPECT_EQ(rejected.hub.rearms_, 0u);
+  EXPECT_LT(rejected_spi, accepted_spi);
+  EXPECT_EQ(rejected.radio.marcstate(), MARCSTATE_RX);
+}
+
+TEST(EarlyReject, ReceiverBackBeforeForeignFrameEnds) {
+  Harness h;
+  h.setup();
+  TelegramBuilder neighbour;
+  neighbour.meter_id = 0x12345678;
+  TelegramBuilder ours;
+  // A long foreign telegram, and ours starting 3 ms before it would have ended
+  auto foreign = neighbour.build(std::vector<uint8_t>(120, 0x00));
+  uint64_t start = esphome::host::now_us() + 5000;
+  uint64_t foreign_end = start + (foreign.size() + 2) * SimulatedCC1101::AIR_BYTE_US;
+  h.radio.transmit(foreign, start);
+  h.radio.transmit(ours.compact(1234567, 1230000, 12, 21), foreign_end - 3000);
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.foreign_frames_, 1u);
+  EXPECT_TRUE(h.sensors.total.has_state);
+}
+
+TEST(LinkLayer, CorruptedFrameDroppedBeforeDecrypt) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  auto frame = builder.compact(1234567, 1230000, 12, 21);
+  frame[1 + 16 + 10] ^= 0x01;  // Flip a bit in the encrypted total
+  h.radio.transmit(frame, esphome::host::now_us() + 5000);
+  h.radio.transmit(builder.compact(1234590, 1230000, 12, 21), esphome::host::now_us() + 5000 + TELEGRAM_INTERVAL_US);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  EXPECT_EQ(h.hub.link_crc_errors_, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.link_crc_errors.state, 1.0f);
+  EXPECT_FLOAT_EQ(h.sensors.crc_errors.state, 0.0f);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 1.0f);
+  EXPECT_FLOAT_EQ(h.sensors.signal_quality.state, 50.0f);
+  // Only the good frame was decrypted
+  EXPECT_EQ(h.sensors.total.publish_count, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.590f);
+}
+
+TEST(LinkLayer, WrongKeyIsAnApplicationCrcError) {
+  Harness h(true, "76348799", "00000000000000000000000000000000");
+  h.setup();
+  TelegramBuilder builder;
+  h.radio.transmit(builder.compact(1234567, 1230000, 12, 21), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  EXPECT_FALSE(h.sensors.total.has_state);
+  EXPECT_FLOAT_EQ(h.sensors.crc_errors.state, 1.0f);
+  EXPECT_FLOAT_EQ(h.sensors.link_crc_errors.state, 0.0f);
+  // The radio link itself is fine
+  EXPECT_FLOAT_EQ(h.sensors.signal_quality.state, 100.0f);
+}
+
+TEST(LinkLayer, FormatAFrameReceived) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  builder.format_a = true;
+  h.radio.transmit(builder.long_frame(1234567, 1230000, 12, 21), esphome::host::now_us() + 5000,
+                   builder.format_sync());
+  h.run_until_air_idle();
+
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.567f);
+  EXPECT_FLOAT_EQ(h.sensors.ambient_temp.state, 21.0f);
+  EXPECT_EQ(h.hub.link_crc_errors_, 0u);
+}
+
+TEST(LinkLayer, FormatAFullSizeFrameReceived) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  builder.format_a = true;
+  // L = 255: 17 blocks, 290 bytes from the L-field to the last CRC
+  auto plain = TelegramBuilder::compact_plaintext(1234567, 1230000, 12, 21);
+  plain.resize(255 - 16, 0x2F);
+  TelegramBuilder::seal_plaintext(plain);
+  auto frame = builder.build(plain);
+  ASSERT_EQ(frame.size(), 290u);
+  h.radio.transmit(frame, esphome::host::now_us() + 5000, builder.format_sync());
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.accepted_frames_, 1u);
+  EXPECT_EQ(h.hub.link_crc_errors_, 0u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.567f);
+}
+
+TEST(LinkLayer, FormatAHeaderCrcCheckedBeforeId) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  builder.format_a = true;
+  auto frame = builder.compact(1234567, 1230000, 12, 21);
+  frame[4] ^= 0x10;  // Corrupt the meter ID inside block 1
+  h.radio.transmit(frame, esphome::host::now_us() + 5000, builder.format_sync());
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.link_crc_errors_, 1u);
+  EXPECT_EQ(h.hub.foreign_frames_, 0u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+}
+
+TEST(LinkLayer, FormatBThreeBlockFrameReceived) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  // Pad a compact frame past 126 bytes so format B needs a third block
+  auto plain = TelegramBuilder::compact_plaintext(1234567, 1230000, 12, 21);
+  plain.resize(150, 0x2F);
+  TelegramBuilder::seal_plaintext(plain);
+  auto frame = builder.build(plain);
+  ASSERT_GT(frame.size(), 128u);
+  h.radio.transmit(frame, esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.567f);
+  EXPECT_EQ(h.hub.link_crc_errors_, 0u);
+}
+
+TEST(LinkLayer, FrameLongerThanPacketCounterReceived) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  builder.format_a = true;
+  // L counts the 16 header bytes and the plaintext; with its block CRCs the
+  // frame takes more FIFO bytes than the 8-bit packet counter can count
+  auto plain = TelegramBuilder::compact_plaintext(1234567, 1230000, 12, 21);
+  plain.resize(240 - 16, 0x2F);
+  TelegramBuilder::seal_plaintext(plain);
+  auto first = builder.build(plain);
+  ASSERT_EQ(first[0], 240);
+  ASSERT_GT(first.size() + 1, 256u);
+  builder.acc++;
+  auto second = builder.compact(1234590, 1230000, 12, 21);
+  // Right behind it: the radio must end the first packet at its last byte
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(first, start, builder.format_sync());
+  h.radio.transmit(second, start + (first.size() + 2) * SimulatedCC1101::AIR_BYTE_US + 200, builder.format_sync());
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.radio.missed_telegrams(), 0u);
+  EXPECT_EQ(h.hub.accepted_frames_, 2u);
+  EXPECT_EQ(h.hub.link_crc_errors_, 0u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_EQ(h.sensors.total.publish_count, 2u);
+  EXPECT_EQ(h.radio.reg(0x08) & 0x03, 0x02);  // PKTCTRL0 back to infinite length
+}
+
+TEST(Crc16, SlicedVariantsMatchBitwise) {
+  using esphome::multical21::crc16_en13757_update_sliced;
+  std::vector<uint8_t> data(300);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t) (i * 37 + 11);
+  }
+  for (size_t length = 0; length <= data.size(); length++) {
+    uint16_t expected = (uint16_t) ~crc16_en13757_bitwise(data.data(), length);
+    ASSERT_EQ(crc16_en13757_update_sliced<1>(0, data.data(), length), expected) << length;
+    ASSERT_EQ(crc16_en13757_update_sliced<4>(0, data.data(), length), expected) << length;
+    ASSERT_EQ(crc16_en13757_update_sliced<8>(0, data.data(), length), expected) << length;
+  }
+}
+
+TEST(Crc16, IncrementalMatchesOneShot) {
+  using namespace esphome::multical21;
+  std::vector<uint8_t> data(255);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t) (i ^ 0x5A);
+  }
+  for (size_t chunk : {1u, 3u, 7u, 16u, 31u, 64u}) {
+    uint16_t crc = CRC16_EN13757_INIT;
+    for (size_t pos = 0; pos < data.size(); pos += chunk) {
+      crc = crc16_en13757_update(crc, data.data() + pos, std::min(chunk, data.size() - pos));
+    }
+    EXPECT_EQ(crc16_en13757_final(crc), crc16_en13757(data.data(), data.size())) << chunk;
+  }
+  EXPECT_EQ(crc16_en13757(data.data(), data.size()), crc16_en13757_bitwise(data.data(), data.size()));
+}
+
+TEST(LinkLayer, StreamedInChunks) {
+  using namespace esphome::multical21;
+  std::vector<uint8_t> payload(180);
+  for (size_t i = 0; i < payload.size(); i++) {
+    payload[i] = (uint8_t) (i * 3);
+  }
+  for (bool format_a : {false, true}) {
+    auto format = format_a ? FRAME_FORMAT_A : FRAME_FORMAT_B;
+    for (size_t chunk : {1u, 2u, 5u, 17u, 63u}) {
+      auto frame = format_a ? TelegramBuilder::frame_format_a(payload) : TelegramBuilder::frame_format_b(payload);
+      LinkCrcStream stream;
+      stream.start(format, frame.data());
+      for (size_t pos = 1; pos < frame.size(); pos += chunk) {
+        stream.feed(std::min(chunk, frame.size() - pos));
+      }
+      ASSERT_TRUE(stream.ok()) << chunk;
+      ASSERT_EQ(stream.data_length(), payload.size()) << chunk;
+      EXPECT_TRUE(std::equal(payload.begin(), payload.end(), frame.begin() + 1)) << chunk;
+    }
+  }
+}
+
+TEST(LinkLayer, CorruptedBlockStopsDrain) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  builder.format_a = true;
+  auto plain = TelegramBuilder::long_plaintext(1234567, 1230000, 12, 21);
+  plain.resize(120, 0x2F);
+  TelegramBuilder::seal_plaintext(plain);
+  auto good = builder.build(plain);
+  auto bad = good;
+  bad[14] ^= 0x01;  // Second block
+
+  uint32_t spi_before = h.radio.spi_bytes();
+  h.radio.transmit(bad, esphome::host::now_us() + 5000, builder.format_sync());
+  h.run_until_air_idle();
+  uint32_t bad_spi = h.radio.spi_bytes() - spi_before;
+  EXPECT_EQ(h.hub.link_crc_errors_, 1u);
+
+  spi_before = h.radio.spi_bytes();
+  h.radio.transmit(good, esphome::host::now_us() + 5000, builder.format_sync());
+  h.run_until_air_idle();
+  uint32_t good_spi = h.radio.spi_bytes() - spi_before;
+  EXPECT_TRUE(h.sensors.total.has_state);
+  // The corrupted frame was dropped without reading most of it
+  EXPECT_LT(bad_spi + 60, good_spi);
+}
+
+TEST(LinkLayer, StripLinkCrcs) {
+  using esphome::multical21::FRAME_FORMAT_A;
+  using esphome::multical21::FRAME_FORMAT_B;
+  using esphome::multical21::link_frame_bytes;
+  using esphome::multical21::strip_link_crcs;
+
+  std::vector<uint8_t> data(200);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t) i;
+  }
+  for (size_t size : {17u, 25u, 26u, 100u, 123u, 130u, 200u}) {
+    std::vector<uint8_t> payload(data.begin(), data.begin() + size);
+    for (bool format_a : {false, true}) {
+      auto frame = format_a ? TelegramBuilder::frame_format_a(payload) : TelegramBuilder::frame_format_b(payload);
+      auto format = format_a ? FRAME_FORMAT_A : FRAME_FORMAT_B;
+      ASSERT_EQ(link_frame_bytes(format, frame[0]), frame.size() - 1) << size << " format_a " << format_a;
+      ASSERT_EQ(strip_link_crcs(format, frame.data()), size) << size << " format_a " << format_a;
+      EXPECT_TRUE(std::equal(payload.begin(), payload.end(), frame.begin() + 1));
+
+      frame = format_a ? TelegramBuilder::frame_format_a(payload) : TelegramBuilder::frame_format_b(payload);
+      frame[frame.size() - 3] ^= 0x80;  // Last data byte
+      EXPECT_EQ(strip_link_crcs(format, frame.data()), 0u) << size << " format_a " << format_a;
+    }
+  }
+}
+
+TEST(ThreeOfSix, BothTablesDecodeEncoderOutput) {
+  using esphome::multical21::three_of_six_decode_with;
+  std::vector<uint8_t> data(256);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t) i;
+  }
+  auto chips = TelegramBuilder::three_of_six(data);
+  ASSERT_EQ(chips.size(), 384u);
+  std::vector<uint8_t> nibbles(256);
+  std::vector<uint8_t> pairs(256);
+  ASSERT_TRUE(three_of_six_decode_with<false>(chips.data(), 128, nibbles.data()));
+  ASSERT_TRUE(three_of_six_decode_with<true>(chips.data(), 128, pairs.data()));
+  EXPECT_EQ(nibbles, data);
+  EXPECT_EQ(pairs, data);
+
+  // Every chip of the last triple flipped in turn gives a non-code word
+  for (int bit = 0; bit < 24; bit++) {
+    auto bad = chips;
+    bad[381 + bit / 8] ^= (uint8_t) (0x80 >> (bit % 8));
+    EXPECT_FALSE(three_of_six_decode_with<false>(bad.data(), 128, nibbles.data())) << bit;
+    EXPECT_FALSE(three_of_six_decode_with<true>(bad.data(), 128, pairs.data())) << bit;
+  }
+}
+
+TEST(ThreeOfSix, StreamedInChunks) {
+  using namespace esphome::multical21;
+  for (size_t size : {20u, 21u, 255u}) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+      data[i] = (uint8_t) (i * 7 + 3);
+    }
+    auto chips = TelegramBuilder::three_of_six(data);
+    ASSERT_EQ(chips.size(), three_of_six_length(size));
+    for (size_t chunk : {1u, 2u, 4u, 31u, 63u}) {
+      std::vector<uint8_t> out(size + 1);
+      ThreeOfSixStream stream;
+      stream.start();
+      size_t written = 0;
+      for (size_t pos = 0; pos < chips.size(); pos += chunk) {
+        written += stream.feed(chips.data() + pos, std::min(chunk, chips.size() - pos), out.data() + written);
+      }
+      written += stream.finish(out.data() + written);
+      ASSERT_TRUE(stream.ok()) << size << " chunk " << chunk;
+      ASSERT_EQ(written, size) << chunk;
+      EXPECT_TRUE(std::equal(data.begin(), data.end(), out.begin())) << size << " chunk " << chunk;
+    }
+  }
+}
+
+TEST(ModeT1, FramesReceivedAndDecoded) {
+  Harness h;
+  h.hub.set_radio_profile(esphome::multical21::RADIO_PROFILE_T1);
+  h.hub.set_capture_buffer_size(4096);
+  h.setup();
+  EXPECT_EQ(h.radio.marcstate(), MARCSTATE_RX);
+  EXPECT_EQ(h.radio.reg(0x12), 0x05);  // MDMCFG2: 2-FSK, 15/16 sync bits
+  EXPECT_EQ(h.radio.reg(0x15), 0x50);  // DEVIATN
+
+  TelegramBuilder builder;
+  builder.mode_t1 = true;
+  auto long_frame = builder.long_frame(1234567, 1230000, 12, 21);
+  builder.acc++;
+  auto compact = builder.compact(1234590, 1230000, 12, 21);
+  // One odd and one even number of data bytes, i.e. with and without postamble chips
+  ASSERT_NE(long_frame.size() % 3 == 0, compact.size() % 3 == 0);
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(long_frame, start, builder.format_sync());
+  h.radio.transmit(compact, start + TELEGRAM_INTERVAL_US, builder.format_sync());
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.accepted_frames_, 2u);
+  EXPECT_EQ(h.hub.link_crc_errors_, 0u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_EQ(h.sensors.total.publish_count, 2u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.590f);
+
+  // Captured as received, chips and all
+  std::vector<uint8_t> file(h.hub.get_capture().file_size());
+  h.hub.get_capture().read(0, file.data(), file.size());
+  std::vector<CapturedFrame> frames;
+  ASSERT_TRUE(parse_capture(file, &frames));
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].format_sync, esphome::multical21::CAPTURE_FORMAT_T1);
+  EXPECT_EQ(frames[0].bytes, long_frame);
+  EXPECT_EQ(frames[1].bytes, compact);
+}
+
+TEST(ModeT1, LongFrameReceived) {
+  Harness h;
+  h.hub.set_radio_profile(esphome::multical21::RADIO_PROFILE_T1);
+  h.setup();
+  TelegramBuilder builder;
+  builder.mode_t1 = true;
+  // Three chip bytes per two data bytes take this frame well past 256 FIFO bytes
+  auto plain = TelegramBuilder::compact_plaintext(1234567, 1230000, 12, 21);
+  plain.resize(200 - 16, 0x2F);
+  TelegramBuilder::seal_plaintext(plain);
+  auto first = builder.build(plain);
+  ASSERT_GT(first.size(), 256u + 64u);
+  builder.acc++;
+  auto second = builder.compact(1234590, 1230000, 12, 21);
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(first, start, builder.format_sync());
+  h.radio.transmit(second, start + (first.size() + 2) * SimulatedCC1101::AIR_BYTE_US + 200, builder.format_sync());
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.radio.missed_telegrams(), 0u);
+  EXPECT_EQ(h.hub.accepted_frames_, 2u);
+  EXPECT_EQ(h.hub.link_crc_errors_, 0u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.590f);
+}
+
+TEST(ModeT1, InvalidSymbolDropsFrameLikeLinkCrc) {
+  Harness h;
+  h.hub.set_radio_profile(esphome::multical21::RADIO_PROFILE_T1);
+  h.setup();
+  TelegramBuilder builder;
+  builder.mode_t1 = true;
+  auto good = builder.compact(1234567, 1230000, 12, 21);
+  auto bad = good;
+  bad[30] = 0xFF;  // Six ones in a row: no code word
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(bad, start, builder.format_sync());
+  h.radio.transmit(good, start + TELEGRAM_INTERVAL_US, builder.format_sync());
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.link_crc_errors_, 1u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_EQ(h.hub.accepted_frames_, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.567f);
+}
+
+TEST(Pipeline, RecordedTelegramFile) {
+  Harness h;
+  h.setup();
+  size_t count = h.radio.transmit_file(MULTICAL21_TELEGRAM_DIR "/multical21_c1.hex", esphome::host::now_us() + 5000,
+                                       TELEGRAM_INTERVAL_US);
+  ASSERT_EQ(count, 4u);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  EXPECT_EQ(h.radio.missed_telegrams(), 0u);
+  // Three telegrams are addressed to this meter, the fourth to a neighbour
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 3.0f);
+  EXPECT_EQ(h.sensors.total.publish_count, 3u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.590f);
+}
+
+TEST(Meter, HandleFrameWithoutRadio) {
+  Multical21Meter meter;
+  MeterSensors sensors;
+  meter.set_meter_id("76348799");
+  meter.set_key("28F64A24988064A079AA2C807D6102AE");
+  sensors.attach(&meter);
+
+  TelegramBuilder builder;
+  auto frame = builder.compact(7654321, 7000000, 8, 19);
+  uint8_t scratch[esphome::multical21::MAX_FRAME_LENGTH];
+  // The hub hands the meter everything after the L-field, link CRC stripped
+  EXPECT_TRUE(meter.handle_frame(frame.data() + 1, frame[0] - 2, scratch));
+  EXPECT_FLOAT_EQ(sensors.total.state, 7654.321f);
+  EXPECT_FLOAT_EQ(sensors.water_temp.state, 8.0f);
+}
+
+TEST(Meter, FrameWithoutKeyNotParsed) {
+  Multical21Meter meter;
+  MeterSensors sensors;
+  meter.set_meter_id("76348799");
+  sensors.attach(&meter);
+
+  TelegramBuilder builder;
+  auto frame = builder.compact(7654321, 7000000, 8, 19);
+  uint8_t scratch[esphome::multical21::MAX_FRAME_LENGTH];
+  // A decrypt error only: no plaintext to fail the application CRC
+  EXPECT_FALSE(meter.handle_frame(frame.data() + 1, frame[0] - 2, scratch));
+  meter.publish_diagnostics(meter.diagnostics());
+  EXPECT_FLOAT_EQ(sensors.crc_errors.state, 0.0f);
+  EXPECT_FALSE(sensors.total.has_state);
+}
+
+TEST(Meter, ConsecutiveTelegramsEachDecryptedWithTheirOwnIv) {
+  Multical21Meter meter;
+  MeterSensors sensors;
+  meter.set_meter_id("76348799");
+  meter.set_key("28F64A24988064A079AA2C807D6102AE");
+  sensors.attach(&meter);
+
+  // As a Multical 21 sends them: CC stays 0x20, ACC (not in the IV) steps,
+  // SN (in the IV) changes
+  TelegramBuilder builder;
+  uint8_t scratch[esphome::multical21::MAX_FRAME_LENGTH];
+  for (uint32_t i = 0; i < 5; i++) {
+    builder.acc++;
+    builder.sn += 0x10;
+    auto frame = builder.compact(1234567 + i, 1230000, 12, 21);
+    EXPECT_TRUE(meter.handle_frame(frame.data() + 1, frame[0] - 2, scratch));
+    EXPECT_FLOAT_EQ(sensors.total.state, (1234567 + i) / 1000.0f);
+  }
+  EXPECT_EQ(sensors.total.publish_count, 5u);
+  meter.publish_diagnostics(meter.diagnostics());
+  EXPECT_FLOAT_EQ(sensors.crc_errors.state, 0.0f);
+}
+
+TEST(Records, ReferenceLongFrame) {
+  using namespace esphome::multical21;
+  // Decrypted reference telegram from wmbusmeters
+  auto plain = bytes_from_hex("576C7802FF207100041308190000441308190000615B7F616713");
+  uint8_t format[MAX_FORMAT_BYTES], data[MAX_RECORD_DATA], format_length, data_length;
+  ASSERT_TRUE(split_records(plain.data() + LONG_RECORDS_START, plain.size() - LONG_RECORDS_START, format,
+                            &format_length, data, &data_length));
+  EXPECT_EQ(std::vector<uint8_t>(format, format + format_length), TelegramBuilder::default_format());
+  EXPECT_EQ(crc16_en13757(format, format_length), 0xA8ED);
+
+  RecordLayout layout;
+  ASSERT_TRUE(build_record_layout(format, format_length, &layout));
+  EXPECT_EQ(layout.data_length, data_length);
+  EXPECT_EQ(layout.info_codes.raw(data), 0x0071);
+  EXPECT_FLOAT_EQ(layout.total_volume.value(data), 6.408f);
+  EXPECT_FLOAT_EQ(layout.target_volume.value(data), 6.408f);
+  EXPECT_FLOAT_EQ(layout.flow_temperature.value(data), 127.0f);
+  EXPECT_FLOAT_EQ(layout.external_temperature.value(data), 19.0f);
+  EXPECT_FALSE(layout.max_flow.present());
+}
+
+TEST(Records, SignedBcdAndUnsupportedFields) {
+  using namespace esphome::multical21;
+  RecordLayout layout;
+  // Total as 8-digit BCD in litres, external temperature as signed 8-bit
+  auto format = bytes_from_hex("0C136167");
+  ASSERT_TRUE(build_record_layout(format.data(), format.size(), &layout));
+  uint8_t data[] = {0x67, 0x45, 0x23, 0x01, 0xF6};
+  EXPECT_EQ(layout.data_length, 5);
+  EXPECT_EQ(layout.total_volume.raw(data), 1234567);
+  EXPECT_FLOAT_EQ(layout.external_temperature.value(data), -10.0f);
+
+  // Variable length data cannot be laid out at fixed offsets
+  format = bytes_from_hex("0D13");
+  EXPECT_FALSE(build_record_layout(format.data(), format.size(), &layout));
+  // Truncated VIF extension
+  format = bytes_from_hex("0493");
+  EXPECT_FALSE(build_record_layout(format.data(), format.size(), &layout));
+}
+
+TEST(Records, CompactFrameUsesFormatLearntFromLongFrame) {
+  esphome::host::clear_preferences();
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  // Volumes in 10 L units and an extra max flow record: a different signature
+  auto format = bytes_from_hex("02FF2004144414615B6167123B");
+  auto data = TelegramBuilder::record_data(123456, 123000, 12, 21);
+  data.push_back(0x20);
+  data.push_back(0x03);
+
+  auto compact = TelegramBuilder::compact_plaintext(format, data);
+  TelegramBuilder::seal_plaintext(compact);
+  h.radio.transmit(builder.build(compact), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+  // Unknown signature: received, but nothing to decode it with yet
+  EXPECT_FALSE(h.sensors.total.has_state);
+  EXPECT_EQ(h.meter.get_unknown_formats(), 1u);
+
+  auto long_plain = TelegramBuilder::long_plaintext(format, data);
+  TelegramBuilder::seal_plaintext(long_plain);
+  builder.acc++;
+  h.radio.transmit(builder.build(long_plain), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.56f);
+
+  data[2] = 0x41;  // Total + 1 (10 L)
+  compact = TelegramBuilder::compact_plaintext(format, data);
+  TelegramBuilder::seal_plaintext(compact);
+  builder.acc++;
+  h.radio.transmit(builder.build(compact), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.57f);
+  EXPECT_FLOAT_EQ(h.sensors.month_start.state, 1230.0f);
+  EXPECT_EQ(h.sensors.total.publish_count, 2u);
+  EXPECT_EQ(h.meter.get_unknown_formats(), 1u);
+}
+
+TEST(Records, LearntFormatSurvivesReboot) {
+  esphome::host::clear_preferences();
+  auto format = bytes_from_hex("02FF2004144414615B6167");
+  auto data = TelegramBuilder::record_data(123456, 123000, 12, 21);
+  TelegramBuilder builder;
+  {
+    Harness h;
+    h.setup();
+    auto long_plain = TelegramBuilder::long_plaintext(format, data);
+    TelegramBuilder::seal_plaintext(long_plain);
+    h.radio.transmit(builder.build(long_plain), esphome::host::now_us() + 5000);
+    h.run_until_air_idle();
+    ASSERT_TRUE(h.sensors.total.has_state);
+  }
+
+  // Fresh component, preferences kept: the first compact frame decodes
+  Harness h;
+  h.setup();
+  auto compact = TelegramBuilder::compact_plaintext(format, data);
+  TelegramBuilder::seal_plaintext(compact);
+  builder.acc++;
+  h.radio.transmit(builder.build(compact), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.56f);
+  EXPECT_EQ(h.meter.get_unknown_formats(), 0u);
+}
+
+TEST(Records, FormatCacheIsBounded) {
+  using namespace esphome::multical21;
+  FormatCache cache;
+  ASSERT_EQ(cache.size(), 1u);  // The Multical 21 default format
+  ASSERT_NE(cache.find(0xA8ED), nullptr);
+
+  // Same records with different volume exponents: five distinct formats
+  std::vector<uint16_t> signatures;
+  for (uint8_t vif = 0x10; vif < 0x15; vif++) {
+    uint8_t format[] = {0x04, vif, 0x61, 0x5B};
+    const RecordLayout *layout = cache.learn(format, sizeof(format));
+    ASSERT_NE(layout, nullptr);
+    EXPECT_EQ(layout->total_volume.exponent, vif - 0x16);
+    signatures.push_back(layout->signature);
+    cache.find(0xA8ED);  // Keep the default in use
+  }
+  EXPECT_EQ(cache.size(), FORMAT_CACHE_SIZE);
+  EXPECT_NE(cache.find(0xA8ED), nullptr);
+  EXPECT_NE(cache.find(signatures.back()), nullptr);
+  // The least recently used learnt formats made room
+  EXPECT_EQ(cache.find(signatures[0]), nullptr);
+  EXPECT_EQ(cache.find(signatures[1]), nullptr);
+}
+
+TEST(Flow, EstimatedOverRecentReadings) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  // 2 L per telegram at a 16 s cadence = 450 L/h; the fourth telegram is lost
+  for (int i = 0; i < 8; i++) {
+    builder.acc++;
+    if (i != 3) {
+      h.radio.transmit(builder.compact(50000 + 2 * i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+    }
+  }
+  h.run_until_air_idle();
+
+  ASSERT_TRUE(h.sensors.flow.has_state);
+  EXPECT_NEAR(h.sensors.flow.state, 450.0f, 1.0f);
+}
+
+TEST(Flow, WindowWrapAndReset) {
+  esphome::multical21::FlowEstimator flow;
+  uint32_t dlph = 0;
+  uint32_t t = 0xFFFFFFFFu - 20000;  // millis() wraps between the samples
+  flow.add(t, 1000);
+  EXPECT_FALSE(flow.flow_decilitres_per_hour(&dlph));
+  flow.add(t + 16000, 1001);
+  ASSERT_TRUE(flow.flow_decilitres_per_hour(&dlph));
+  EXPECT_EQ(dlph, 2250u);  // 1 L in 16 s
+  flow.add(t + 32000, 1001);
+  ASSERT_TRUE(flow.flow_decilitres_per_hour(&dlph));
+  EXPECT_EQ(dlph, 1125u);  // Averaged over both intervals
+
+  // Only the last two minutes count
+  for (int i = 3; i < 12; i++) {
+    flow.add(t + 16000 * i, 1001);
+  }
+  ASSERT_TRUE(flow.flow_decilitres_per_hour(&dlph));
+  EXPECT_EQ(dlph, 0u);
+
+  // A total going backwards starts over
+  flow.add(t + 16000 * 12, 10);
+  EXPECT_FALSE(flow.flow_decilitres_per_hour(&dlph));
+}
+
+TEST(Flow, LargeTotalsKeepLitreResolution) {
+  using namespace esphome::multical21;
+  RecordLayout layout;
+  auto format = bytes_from_hex("0413");
+  ASSERT_TRUE(build_record_layout(format.data(), format.size(), &layout));
+  uint8_t data[] = {0x01, 0x00, 0x00, 0x01};  // 16 777 217 L, not representable as a float
+  EXPECT_EQ(layout.total_volume.scaled(data, -3), 16777217);
+  // Volumes in 10 L units scale up exactly
+  format = bytes_from_hex("0414");
+  ASSERT_TRUE(build_record_layout(format.data(), format.size(), &layout));
+  EXPECT_EQ(layout.total_volume.scaled(data, -3), 167772170);
+}
+
+TEST(Analytics, ContinuousFlowEndsOnStillInterval) {
+  esphome::multical21::ConsumptionAnalytics analytics;
+  uint32_t t = 0xFFFFFFFFu - 600000;  // millis() wraps during the run
+  uint32_t total = 1000;
+  analytics.add(t, total, 0, false, 0, -1);
+  EXPECT_FALSE(analytics.flowing());
+
+  // A litre every other telegram for an hour: one run, from the reading before the first litre
+  for (int i = 1; i <= 225; i++) {
+    total += i % 2;
+    analytics.add(t + 16000 * i, total, 0, false, 0, -1);
+  }
+  EXPECT_TRUE(analytics.flowing());
+  EXPECT_EQ(analytics.continuous_flow_ms(), 225u * 16000u);
+
+  // Still for less than the zero-flow interval (15 min) does not end it
+  uint32_t last_litre = t + 16000 * 225;
+  analytics.add(last_litre + 14 * 60000, total, 0, false, 0, -1);
+  EXPECT_TRUE(analytics.flowing());
+  analytics.add(last_litre + 15 * 60000, total, 0, false, 0, -1);
+  EXPECT_FALSE(analytics.flowing());
+  EXPECT_EQ(analytics.continuous_flow_ms(), 0u);
+
+  // The next litre starts a new run
+  analytics.add(last_litre + 15 * 60000 + 16000, total + 1, 0, false, 0, -1);
+  EXPECT_EQ(analytics.continuous_flow_ms(), 16000u);
+}
+
+TEST(Analytics, PeakFlowWindowAndReverseEvents) {
+  using namespace esphome::multical21;
+  ConsumptionAnalytics analytics;
+  analytics.configure(AnalyticsConfig{15 * 60000, 3600000, 2, 5});  // Peak over the last hour
+  uint32_t t = 0;
+  analytics.add(t, 5000, 0, true, 4500, -1);
+  analytics.add(t += 16000, 5001, 0, true, 18000, -1);
+  analytics.add(t += 16000, 5002, 0, true, 9000, -1);
+  EXPECT_EQ(analytics.peak_flow_lph(), 1800u);
+  // An hour later the burst has left the window
+  for (int i = 0; i < 240; i++) {
+    analytics.add(t += 16000, 5002, 0, true, 300, -1);
+  }
+  EXPECT_EQ(analytics.peak_flow_lph(), 30u);
+
+  // The total stepping back, then the meter's flag for the same episode: one event
+  analytics.add(t += 16000, 5000, 0, true, 0, -1);
+  EXPECT_EQ(analytics.reverse_events(), 1u);
+  analytics.add(t += 16000, 5000, INFO_CODE_REVERSE, true, 0, -1);
+  analytics.add(t += 16000, 5000, 0, true, 0, -1);
+  EXPECT_EQ(analytics.reverse_events(), 1u);
+  analytics.add(t += 16000, 5000, INFO_CODE_REVERSE | (1 << INFO_CODE_REVERSE_SHIFT), true, 0, -1);
+  EXPECT_EQ(analytics.reverse_events(), 2u);
+  // A meter reset is not water flowing back
+  analytics.add(t += 16000, 10, 0, true, 0, -1);
+  EXPECT_EQ(analytics.reverse_events(), 2u);
+}
+
+TEST(Analytics, NightMinimumFlowNeedsLocalTime) {
+  esphome::multical21::ConsumptionAnalytics analytics;  // Night 02:00-05:00
+  uint32_t dlph;
+  uint32_t t = 0;
+  uint32_t total = 0;
+  // Without a time source there is no night
+  for (int i = 0; i < 900; i++) {
+    analytics.add(t += 16000, total, 0, false, 0, -1);
+  }
+  EXPECT_FALSE(analytics.night_min_flow_dlph(&dlph));
+
+  // From 01:00 to 06:00: a dripping tap of 6 L/h, and 40 L more in the hour after 03:00
+  for (int minute = 60; minute < 360; minute++) {
+    if (minute % 10 == 0) {
+      total++;
+    }
+    if (minute > 180 && minute <= 220) {
+      total++;
+    }
+    analytics.add(t += 60000, total, 0, false, 0, (int8_t) (minute / 60));
+    if (minute < 300) {
+      EXPECT_FALSE(analytics.night_min_flow_dlph(&dlph));
+    }
+  }
+  ASSERT_TRUE(analytics.night_min_flow_dlph(&dlph));
+  EXPECT_EQ(dlph, 60u);
+}
+
+TEST(Analytics, InfoFlagsPublishedAsBinarySensors) {
+  using namespace esphome::multical21;
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  // Dry for 22-31 days, as in the wmbusmeters reference telegram
+  builder.acc++;
+  h.radio.transmit(builder.compact(1000, 0, 10, 20, 0x0071), start);
+  h.run_until_air_idle();
+  EXPECT_TRUE(h.sensors.dry.state);
+  EXPECT_FALSE(h.sensors.leak.state);
+  EXPECT_EQ(h.meter.get_analytics().info_codes(), 0x0071);
+
+  // Water back, leaking for 1-8 hours
+  builder.acc++;
+  h.radio.transmit(builder.compact(1001, 0, 10, 20, INFO_CODE_LEAK | (1 << INFO_CODE_LEAK_SHIFT)),
+                   start + TELEGRAM_INTERVAL_US);
+  builder.acc++;
+  h.radio.transmit(builder.compact(1002, 0, 10, 20, INFO_CODE_LEAK | (1 << INFO_CODE_LEAK_SHIFT)),
+                   start + 2 * TELEGRAM_INTERVAL_US);
+  h.run_until_air_idle();
+  EXPECT_FALSE(h.sensors.dry.state);
+  EXPECT_TRUE(h.sensors.leak.state);
+  EXPECT_FALSE(h.sensors.burst.state);
+  EXPECT_FALSE(h.sensors.reverse_flow.state);
+  EXPECT_EQ(h.sensors.leak.publish_count, 2u);  // Off, then on; the repeat is not sent
+
+  // The analytics sensors follow the readings
+  ASSERT_TRUE(h.sensors.continuous_flow_duration.has_state);
+  EXPECT_NEAR(h.sensors.continuous_flow_duration.state, 32.0f / 3600.0f, 0.001f);
+  EXPECT_TRUE(h.sensors.peak_flow.has_state);
+  EXPECT_EQ(h.sensors.reverse_flow_events.state, 0.0f);
+  EXPECT_FALSE(h.sensors.night_min_flow.has_state);
+}
+
+TEST(History, CountersAndReadingsSurviveReboot) {
+  esphome::host::clear_preferences();
+  TelegramBuilder builder;
+  {
+    Harness h;
+    h.meter.set_history_flush_interval(60000);
+    h.setup();
+    uint64_t start = esphome::host::now_us() + 5000;
+    for (int i = 0; i < 3; i++) {
+      builder.acc++;
+      h.radio.transmit(builder.compact(5000 + i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+    }
+    h.run_until_air_idle();
+    h.hub.update();
+    EXPECT_EQ(h.meter.get_history().unflushed(), 3u);  // Batched until the interval has passed
+    h.run_for(60000000);
+    h.hub.update();
+    EXPECT_EQ(h.meter.get_history().unflushed(), 0u);
+    EXPECT_EQ(h.meter.get_history().flash_writes(), 2u);  // Boot number and one page
+  }
+
+  Harness h;
+  h.setup();
+  const auto &history = h.meter.get_history();
+  EXPECT_EQ(history.boot(), 2u);
+  ASSERT_EQ(history.size(), 3u);
+  EXPECT_EQ(history.at(0).total_l, 5002u);
+  EXPECT_EQ(history.at(2).total_l, 5000u);
+  EXPECT_EQ(history.at(0).boot, 1u);
+  h.hub.update();
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 3.0f);
+}
+
+TEST(History, ReplayedAfterReconnect) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  esphome::api::global_api_server->connected = false;
+  h.hub.update();
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 3; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(7000 + i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+  EXPECT_EQ(h.sensors.total.publish_count, 3u);
+
+  esphome::api::global_api_server->connected = true;
+  h.hub.update();
+  // Every reading taken while disconnected is published again, oldest first
+  EXPECT_EQ(h.sensors.total.publish_count, 6u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 7.002f);
+  h.hub.update();
+  EXPECT_EQ(h.sensors.total.publish_count, 6u);
+}
+
+TEST(History, PagesRotateOverSlots) {
+  using namespace esphome::multical21;
+  esphome::host::clear_preferences();
+  HistoryCounters counters{};
+  ReadingHistory history;
+  history.load(0x12345678, &counters);
+  for (uint32_t i = 0; i < 40; i++) {
+    HistoryRecord record{};
+    record.total_l = i;
+    history.add(record);
+    if (i % 10 == 9) {
+      counters.reading_count = i + 1;
+      history.flush(counters);
+    }
+  }
+  // 10 records per flush = two pages each, plus the boot number
+  EXPECT_EQ(history.flash_writes(), 1u + 8u);
+
+  ReadingHistory restored;
+  HistoryCounters restored_counters{};
+  ASSERT_TRUE(restored.load(0x12345678, &restored_counters));
+  EXPECT_EQ(restored_counters.reading_count, 40u);
+  // Four slots hold the last four pages: 8 + 2 + 8 + 2 records
+  ASSERT_EQ(restored.size(), 20u);
+  EXPECT_EQ(restored.at(0).total_l, 39u);
+  EXPECT_EQ(restored.at(19).total_l, 20u);
+  EXPECT_EQ(restored.boot(), 2u);
+}
+
+static std::vector<CapturedFrame> captured_frames(const Harness &h) {
+  std::vector<uint8_t> file(h.hub.get_capture().file_size());
+  h.hub.get_capture().read(0, file.data(), file.size());
+  std::vector<CapturedFrame> frames;
+  EXPECT_TRUE(parse_capture(file, &frames));
+  return frames;
+}
+
+TEST(Capture, RawFramesWithSignalAndOutcome) {
+  using namespace esphome::multical21;
+  Harness h;
+  h.hub.set_capture_buffer_size(4096);
+  h.setup();
+  TelegramBuilder ours;
+  TelegramBuilder neighbour;
+  neighbour.meter_id = 0x12345678;
+  auto good = ours.compact(1234567, 1230000, 12, 21);
+  auto foreign = neighbour.compact(5000, 4000, 10, 20);
+  auto corrupted = ours.compact(1234590, 1230000, 12, 21);
+  corrupted[1 + 16 + 10] ^= 0x01;
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.set_signal(0xD2, 0x2A);
+  h.radio.transmit(good, start);
+  h.radio.transmit(foreign, start + TELEGRAM_INTERVAL_US);
+  h.radio.transmit(corrupted, start + 2 * TELEGRAM_INTERVAL_US);
+  h.run_until_air_idle();
+
+  auto frames = captured_frames(h);
+  ASSERT_EQ(frames.size(), 3u);
+  // As received: L-field first, block CRCs still in place
+  EXPECT_EQ(frames[0].outcome, CAPTURE_DECODED);
+  EXPECT_EQ(frames[0].bytes, good);
+  EXPECT_EQ(frames[0].format_sync, WMBUS_FORMAT_B_SYNC);
+  EXPECT_EQ(frames[0].rssi, 0xD2);
+  EXPECT_EQ(frames[0].lqi, 0x80 | 0x2A);  // CRC_OK and LQI, as appended by the radio
+  // Read up to the meter ID only
+  EXPECT_EQ(frames[1].outcome, CAPTURE_FOREIGN);
+  EXPECT_EQ(frames[1].bytes, std::vector<uint8_t>(foreign.begin(), foreign.begin() + 1 + 7));
+  EXPECT_EQ(frames[2].outcome, CAPTURE_LINK_CRC);
+  EXPECT_EQ(frames[2].bytes, std::vector<uint8_t>(corrupted.begin(), corrupted.begin() + frames[2].bytes.size()));
+  // Arrival times are the sync edges, one telegram interval apart
+  EXPECT_NEAR((double) (frames[1].arrival_us - frames[0].arrival_us), (double) TELEGRAM_INTERVAL_US, 2000.0);
+}
+
+TEST(Capture, RingKeepsNewestFrames) {
+  Harness h;
+  h.hub.set_capture_buffer_size(200);
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  std::vector<uint8_t> last;
+  for (int i = 0; i < 10; i++) {
+    builder.acc++;
+    last = builder.compact(1000 + i, 0, 10, 20);
+    h.radio.transmit(last, start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+
+  const auto &capture = h.hub.get_capture();
+  EXPECT_LE(capture.file_size(), 8u + 200u);
+  EXPECT_EQ(capture.records() + capture.overwritten(), 10u);
+  auto frames = captured_frames(h);
+  ASSERT_EQ(frames.size(), capture.records());
+  EXPECT_EQ(frames.back().bytes, last);
+}
+
+TEST(Capture, LogDumpReplaysToSameOutcomes) {
+  using namespace esphome::multical21;
+  std::vector<uint8_t> file;
+  {
+    Harness h;
+    h.hub.set_capture_buffer_size(4096);
+    h.setup();
+    TelegramBuilder ours;
+    TelegramBuilder neighbour;
+    neighbour.meter_id = 0x12345678;
+    auto corrupted = ours.compact(2000, 0, 10, 20);
+    corrupted[20] ^= 0x80;
+    uint64_t start = esphome::host::now_us() + 5000;
+    h.radio.transmit(ours.compact(1000, 0, 10, 20), start);
+    h.radio.transmit(neighbour.compact(5000, 4000, 10, 20), start + 3000000);
+    h.radio.transmit(corrupted, start + 7000000);
+    ours.acc++;
+    h.radio.transmit(ours.compact(3000, 0, 10, 20), start + 9000000);
+    h.run_until_air_idle();
+    file.resize(h.hub.get_capture().file_size());
+    h.hub.get_capture().read(0, file.data(), file.size());
+  }
+
+  // A device log with an older dump before it, as dump_capture() prints it
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  std::string log = "[12:00:01][I][multical21.capture:120]: capture begin: 1 frames, 9 bytes, 0 overwritten\n"
+                    "[12:00:01][I][multical21.capture:131]: capture: 4D43323143415001\n"
+                    "[12:05:00][I][multical21.capture:120]: capture begin: 4 frames\n";
+  for (size_t offset = 0; offset < file.size(); offset += CAPTURE_DUMP_LINE_BYTES) {
+    log += "\033[0;32m[12:05:00][I][multical21.capture:131]: capture: ";
+    for (size_t i = offset; i < file.size() && i < offset + CAPTURE_DUMP_LINE_BYTES; i++) {
+      log += HEX_DIGITS[file[i] >> 4];
+      log += HEX_DIGITS[file[i] & 0x0F];
+    }
+    log += "\033[0m\n";
+  }
+  log += "[12:05:00][I][multical21.capture:136]: capture end\n";
+
+  std::vector<CapturedFrame> recorded;
+  ASSERT_TRUE(parse_capture(capture_from_log(log), &recorded));
+  ASSERT_EQ(recorded.size(), 4u);
+
+  Harness h;
+  h.hub.set_capture_buffer_size(4096);
+  h.setup();
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (const auto &frame : recorded) {
+    h.radio.transmit(frame.bytes, start + (uint32_t) (frame.arrival_us - recorded[0].arrival_us), frame.format_sync);
+  }
+  h.run_until_air_idle();
+  auto replayed = captured_frames(h);
+  ASSERT_EQ(replayed.size(), recorded.size());
+  for (size_t i = 0; i < recorded.size(); i++) {
+    EXPECT_EQ(replayed[i].outcome, recorded[i].outcome) << "frame " << i;
+  }
+  EXPECT_EQ(recorded[0].outcome, CAPTURE_DECODED);
+  EXPECT_EQ(recorded[1].outcome, CAPTURE_FOREIGN);
+  EXPECT_EQ(recorded[2].outcome, CAPTURE_LINK_CRC);
+  EXPECT_EQ(recorded[3].outcome, CAPTURE_DECODED);
+}
+
+TEST(LinkQuality, RssiAndLqiFromAppendedStatus) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  // RSSI register: dBm = (int8) raw / 2 - 74
+  h.radio.set_signal(0xF4, 5);  // -80 dBm
+  h.radio.transmit(builder.compact(1000, 0, 10, 20), start);
+  builder.acc++;
+  h.radio.set_signal(0x08, 9);  // -70 dBm
+  h.radio.transmit(builder.compact(1001, 0, 10, 20), start + TELEGRAM_INTERVAL_US);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  // The status bytes are read with the frame, so the receiver stays in RX
+  EXPECT_EQ(h.sensors.frames_received.state, 2.0f);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_FLOAT_EQ(h.sensors.rssi.state, -75.0f);
+  EXPECT_FLOAT_EQ(h.sensors.rssi_min.state, -80.0f);
+  EXPECT_FLOAT_EQ(h.sensors.rssi_max.state, -70.0f);
+  EXPECT_FLOAT_EQ(h.sensors.lqi.state, 7.0f);
+  EXPECT_EQ(h.sensors.rssi_histogram.state,
+            "<-110: 0, -110: 0, -100: 0, -90: 0, -80: 1, -70: 1, -60: 0, -50: 0");
+  EXPECT_FLOAT_EQ(h.meter.get_link_quality().last_rssi_dbm(), -70.0f);
+}
+
+TEST(LinkQuality, FrameDroppedOnLinkCrcStillMeasured) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  auto frame = builder.compact(1234567, 1230000, 12, 21);
+  frame[1 + 16 + 10] ^= 0x01;
+  h.radio.set_signal(0xD0, 40);  // -98 dBm
+  h.radio.transmit(frame, esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+
+  const auto &link = h.meter.get_link_quality();
+  EXPECT_EQ(h.hub.link_crc_errors_, 1u);
+  ASSERT_EQ(link.frames(), 1u);
+  EXPECT_FLOAT_EQ(link.last_rssi_dbm(), -98.0f);
+  EXPECT_EQ(link.last_lqi(), 40u);
+}
+
+TEST(LinkQuality, WindowAndHistogramBounds) {
+  using namespace esphome::multical21;
+  LinkQuality link;
+  link.add(0x80, 0x80);  // Weakest reading: -138 dBm
+  for (int i = 0; i < LINK_WINDOW; i++) {
+    link.add(0x7F, 10);  // Strongest: -10.5 dBm
+  }
+  link.add(0x00, 0xFF);  // -74 dBm, LQI without CRC_OK is 127
+  EXPECT_EQ(link.frames(), (uint32_t) LINK_WINDOW + 2);
+  // The -138 dBm reading has left the window but stays in the histogram
+  EXPECT_FLOAT_EQ(link.min_rssi_dbm(), -74.0f);
+  EXPECT_FLOAT_EQ(link.max_rssi_dbm(), -10.5f);
+  EXPECT_FLOAT_EQ(link.avg_lqi(), (10.0f * (LINK_WINDOW - 1) + 127.0f) / LINK_WINDOW);
+  EXPECT_EQ(link.bin(0), 1u);
+  EXPECT_EQ(link.bin(4), 1u);
+  EXPECT_EQ(link.bin(RSSI_BINS - 1), (uint32_t) LINK_WINDOW);
+}
+
+TEST(DutyCycle, ScheduleLearntFromArrivals) {
+  using esphome::multical21::TransmitSchedule;
+  TransmitSchedule schedule;
+  schedule.configure(200, 3);
+  uint32_t t = 0xFFFFFFFFu - 30000;  // millis() wraps while learning
+  schedule.add(t);
+  schedule.add(t + 16000);
+  EXPECT_FALSE(schedule.locked());
+  schedule.add(t + 32050);  // Jitter inside the guard confirms the interval
+  schedule.add(t + 47980);
+  ASSERT_TRUE(schedule.locked());
+  EXPECT_NEAR(schedule.interval_ms(), 16000u, 20u);
+  EXPECT_EQ(schedule.hits(), 0u);  // Predictions count from the lock on
+
+  // Window opens a guard before the next expected telegram
+  uint32_t next = t + 47980 + schedule.interval_ms();
+  EXPECT_EQ(schedule.until_window(t + 50000), next - 200 - (t + 50000));
+  EXPECT_EQ(schedule.until_window(next - 100), 0u);
+
+  // A lost telegram is one missed window; the next arrival is still a hit
+  EXPECT_FALSE(schedule.poll(next + 201));
+  EXPECT_EQ(schedule.misses(), 1u);
+  schedule.add(next + schedule.interval_ms() + 30);
+  EXPECT_TRUE(schedule.locked());
+  EXPECT_EQ(schedule.hits(), 1u);
+
+  // Three windows in a row without a telegram unlock the schedule
+  uint32_t now = next + schedule.interval_ms();
+  EXPECT_TRUE(schedule.poll(now + 3 * schedule.interval_ms() + 1000));
+  EXPECT_FALSE(schedule.locked());
+  EXPECT_EQ(schedule.misses(), 4u);
+  EXPECT_EQ(schedule.fallbacks(), 1u);
+}
+
+// A meter that sends every 16 s with up to 60 ms of jitter
+static void transmit_on_schedule(Harness &h, TelegramBuilder &builder, uint64_t start, int count) {
+  static const int32_t JITTER_MS[] = {0, 40, -30, 60, -50, 10, -20, 30};
+  for (int i = 0; i < count; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(1000 + i, 0, 10, 20),
+                     start + i * TELEGRAM_INTERVAL_US + JITTER_MS[i % 8] * 1000);
+  }
+}
+
+TEST(DutyCycle, RadioSleepsBetweenWindows) {
+  Harness h;
+  esphome::sensor::Sensor duty_cycle;
+  esphome::sensor::Sensor hit_rate;
+  h.hub.set_rx_duty_cycle_sensor(&duty_cycle);
+  h.hub.set_prediction_hit_rate_sensor(&hit_rate);
+  h.hub.set_duty_cycle(200, 3);
+  h.setup();
+  TelegramBuilder builder;
+  transmit_on_schedule(h, builder, esphome::host::now_us() + 5000, 30);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  // Continuous RX while learning, then only the windows: nothing is lost
+  EXPECT_EQ(h.radio.missed_telegrams(), 0u);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 30.0f);
+  EXPECT_EQ(h.meter.get_schedule().hits(), 26u);
+  EXPECT_EQ(h.meter.get_schedule().misses(), 0u);
+  EXPECT_FLOAT_EQ(hit_rate.state, 100.0f);
+
+  // 48 of the radio's ~464 s are before the lock; after it, about 460 ms
+  // of every 16 s. Both the hub and the chip see the same RX-on time.
+  uint64_t elapsed_us = esphome::host::now_us();
+  double sim_duty = 100.0 * (elapsed_us - h.radio.sleep_us()) / elapsed_us;
+  EXPECT_LT(sim_duty, 13.0);
+  EXPECT_NEAR(duty_cycle.state, sim_duty, 0.5);
+  EXPECT_EQ(h.radio.sleeps(), h.hub.wakeups_ + (h.radio.marcstate() == 0x00 ? 1u : 0u));
+
+  // The registers lost in SLEEP are restored on every wake-up
+  for (int i = 0; i < 20000 && h.radio.marcstate() != MARCSTATE_RX; i++) {
+    h.run_for(Harness::LOOP_INTERVAL_US);
+  }
+  EXPECT_EQ(h.radio.marcstate(), MARCSTATE_RX);
+  EXPECT_GT(h.hub.wakeups_, 25u);
+  EXPECT_EQ(h.radio.reg(0x2C), 0x81);  // TEST2
+  EXPECT_EQ(h.radio.reg(0x2E), 0x09);  // TEST0
+}
+
+TEST(DutyCycle, FallsBackToContinuousRxAfterMissedWindows) {
+  Harness h;
+  h.hub.set_duty_cycle(200, 3);
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  transmit_on_schedule(h, builder, start, 6);
+  // The meter's clock jumps by 5 s: the old windows stay empty, and the
+  // radio sleeps through the telegrams until the third empty window
+  transmit_on_schedule(h, builder, start + 6 * TELEGRAM_INTERVAL_US + 5000000, 10);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  const auto &schedule = h.meter.get_schedule();
+  EXPECT_EQ(schedule.fallbacks(), 1u);
+  EXPECT_EQ(schedule.misses(), 3u);
+  EXPECT_EQ(h.radio.missed_telegrams(), 2u);
+  // Relearnt in continuous RX and locked to the new phase
+  EXPECT_TRUE(schedule.locked());
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 14.0f);
+  EXPECT_GT(schedule.hits(), 5u);
+}
+
+TEST(DutyCycle, ContinuousWithoutDutyCycle) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  transmit_on_schedule(h, builder, esphome::host::now_us() + 5000, 6);
+  h.run_until_air_idle();
+
+  // The schedule is still learnt, but the radio never sleeps
+  EXPECT_TRUE(h.meter.get_schedule().locked());
+  EXPECT_EQ(h.radio.sleeps(), 0u);
+  EXPECT_EQ(h.radio.marcstate(), MARCSTATE_RX);
+}
+
+TEST(FrequencyOffset, FilteredBeforeCorrecting) {
+  using namespace esphome::multical21;
+  FrequencyTracker tracker;
+  // FREQEST is two's complement: 0xF6 = -10 steps
+  for (int i = 0; i < FREQ_TRACK_MIN_FRAMES; i++) {
+    EXPECT_FALSE(tracker.add(0xF6));
+  }
+  EXPECT_TRUE(tracker.add(0xF6));
+  EXPECT_EQ(tracker.applied(), -10);
+  EXPECT_NEAR(tracker.offset_khz(), -10 * FREQ_STEP_KHZ, 0.01f);
+
+  // Measured against the new FSCTRL0: a one-step wobble is not corrected
+  EXPECT_FALSE(tracker.add(0x01));
+  EXPECT_FALSE(tracker.add(0x00));
+  EXPECT_EQ(tracker.corrections(), 1u);
+  // Nor is an estimate no crystal could explain
+  EXPECT_FALSE(tracker.add(0x7F));
+  EXPECT_EQ(tracker.rejected(), 1u);
+  EXPECT_EQ(tracker.applied(), -10);
+}
+
+TEST(FrequencyOffset, CorrectedAndLinkCrcErrorsStop) {
+  esphome::host::clear_preferences();
+  Harness h;
+  esphome::sensor::Sensor offset;
+  esphome::sensor::Sensor corrections;
+  h.hub.set_frequency_offset_sensor(&offset);
+  h.hub.set_frequency_corrections_sensor(&corrections);
+  h.setup();
+  // ~19 kHz of crystal error, beyond what FOC pulls in during the preamble
+  h.radio.set_frequency_offset(12);
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 10; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(1000 + i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+  h.hub.update();
+
+  // Corrected after the first five frames, which the offset corrupted
+  EXPECT_EQ(h.hub.link_crc_errors_, 5u);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 5.0f);
+  EXPECT_EQ(h.radio.reg(0x0C), 12);  // FSCTRL0
+  EXPECT_EQ(h.radio.marcstate(), MARCSTATE_RX);
+  EXPECT_FLOAT_EQ(corrections.state, 1.0f);
+  EXPECT_NEAR(offset.state, 12 * esphome::multical21::FREQ_STEP_KHZ, 0.5f);
+
+  // The learnt offset is configured straight after a reboot
+  Harness rebooted;
+  rebooted.setup();
+  EXPECT_EQ(rebooted.radio.reg(0x0C), 12);
+  rebooted.radio.set_frequency_offset(12);
+  rebooted.radio.transmit(builder.compact(2000, 0, 10, 20), esphome::host::now_us() + 5000);
+  rebooted.run_until_air_idle();
+  EXPECT_EQ(rebooted.hub.link_crc_errors_, 0u);
+  EXPECT_TRUE(rebooted.sensors.total.has_state);
+  esphome::host::clear_preferences();
+}
+
+TEST(FrequencyOffset, TrackingCanBeTurnedOff) {
+  Harness h;
+  h.hub.set_frequency_tracking(false);
+  h.setup();
+  h.radio.set_frequency_offset(12);
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 8; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(1000 + i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.radio.reg(0x0C), 0);
+  EXPECT_EQ(h.hub.link_crc_errors_, 8u);
+  EXPECT_EQ(h.hub.get_frequency_tracker().corrections(), 0u);
+}
+
+TEST(Diversity, TelegramOnBothRadiosDecodedOnceWithStrongerSignal) {
+  Harness h;
+  h.use_second_radio();
+  h.setup();
+  EXPECT_EQ(h.radio2.marcstate(), MARCSTATE_RX);
+
+  // Long enough that either FIFO would overflow while the other radio's copy
+  // is drained, unless it is spilled meanwhile
+  TelegramBuilder builder;
+  auto plain = TelegramBuilder::long_plaintext(1234567, 1230000, 12, 21);
+  plain.insert(plain.end(), 150, 0x2F);
+  TelegramBuilder::seal_plaintext(plain);
+  auto frame = builder.build(plain);
+  ASSERT_GT(frame.size(), 3u * SimulatedCC1101::FIFO_SIZE);
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.set_signal(0xD0, 40);   // -98 dBm
+  h.radio2.set_signal(0xF4, 5);   // -80 dBm
+  h.radio.transmit(frame, start);
+  h.radio2.transmit(frame, start + 200);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  EXPECT_EQ(h.radio.overflows() + h.radio2.overflows(), 0u);
+  EXPECT_EQ(h.hub.rearms_, 0u);
+  EXPECT_EQ(h.hub.radios_[0].accepted_frames, 1u);
+  EXPECT_EQ(h.hub.radios_[1].accepted_frames, 1u);
+  EXPECT_EQ(h.hub.accepted_frames_, 1u);
+  EXPECT_EQ(h.hub.duplicate_frames_, 1u);
+  EXPECT_EQ(h.sensors.total.publish_count, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.567f);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 1.0f);
+
+  // One telegram, measured at the better antenna
+  const auto &link = h.meter.get_link_quality();
+  EXPECT_EQ(link.frames(), 1u);
+  EXPECT_FLOAT_EQ(link.last_rssi_dbm(), -80.0f);
+  EXPECT_EQ(link.last_lqi(), 5u);
+  EXPECT_EQ(h.meter.get_schedule().interval_ms(), 0u);
+}
+
+TEST(Diversity, EachRadioFillsTheOthersGaps) {
+  Harness h(false);  // Polling: spilled frames are found without a GDO0 edge
+  h.use_second_radio(false);
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  // Radio 1 loses telegram 2, radio 2 loses telegrams 1 and 3
+  for (int i = 0; i < 5; i++) {
+    builder.acc++;
+    auto frame = builder.compact(1000 + i, 0, 10, 20);
+    if (i != 2) {
+      h.radio.transmit(frame, start + i * TELEGRAM_INTERVAL_US);
+    }
+    if (i != 1 && i != 3) {
+      h.radio2.transmit(frame, start + i * TELEGRAM_INTERVAL_US + 100);
+    }
+  }
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.radios_[0].accepted_frames, 4u);
+  EXPECT_EQ(h.hub.radios_[1].accepted_frames, 3u);
+  EXPECT_EQ(h.hub.accepted_frames_, 5u);
+  EXPECT_EQ(h.hub.duplicate_frames_, 2u);
+  EXPECT_EQ(h.sensors.total.publish_count, 5u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1.004f);
+  // Copies do not disturb the transmit interval
+  EXPECT_EQ(h.meter.get_schedule().interval_ms(), TELEGRAM_INTERVAL_US / 1000);
+}
+
+TEST(Diversity, LinkCrcErrorNotCountedWhenOtherCopyGetsThrough) {
+  Harness h;
+  h.use_second_radio();
+  h.setup();
+  TelegramBuilder builder;
+  auto frame = builder.compact(1234567, 1230000, 12, 21);
+  auto corrupted = frame;
+  corrupted[1 + 16 + 10] ^= 0x01;
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(corrupted, start);
+  h.radio2.transmit(frame, start + 200);
+  builder.acc++;
+  auto lost = builder.compact(1234590, 1230000, 12, 21);
+  lost[1 + 16 + 10] ^= 0x01;
+  h.radio.transmit(lost, start + TELEGRAM_INTERVAL_US);
+  h.radio2.transmit(lost, start + TELEGRAM_INTERVAL_US + 200);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  // Three bad copies on air; only the telegram that neither radio got counts
+  EXPECT_EQ(h.hub.link_crc_errors_, 3u);
+  EXPECT_FLOAT_EQ(h.sensors.link_crc_errors.state, 1.0f);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 1.0f);
+  EXPECT_FLOAT_EQ(h.sensors.signal_quality.state, 50.0f);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1234.567f);
+}
+
+TEST(RepeatedTelegrams, RepeaterCopyDroppedBeforeDecrypt) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 4; i++) {
+    builder.acc++;
+    uint64_t at = start + i * TELEGRAM_INTERVAL_US;
+    h.radio.transmit(builder.compact(1000 + i, 0, 10, 20), at);
+    // The repeater sets the hop bit in CC, which changes the ciphertext too
+    TelegramBuilder repeated = builder;
+    repeated.cc |= 0x10;
+    h.radio.transmit(repeated.compact(1000 + i, 0, 10, 20), at + 1500000);
+  }
+  h.run_until_air_idle();
+  h.hub.update();
+
+  EXPECT_EQ(h.hub.accepted_frames_, 4u);
+  EXPECT_EQ(h.hub.duplicate_frames_, 4u);
+  EXPECT_EQ(h.sensors.total.publish_count, 4u);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 4.0f);
+  EXPECT_FLOAT_EQ(h.sensors.missed_telegrams.state, 0.0f);
+  // Repeats stay out of the schedule, so it still locks onto the meter's cadence
+  EXPECT_EQ(h.meter.get_schedule().interval_ms(), TELEGRAM_INTERVAL_US / 1000);
+  EXPECT_TRUE(h.meter.get_schedule().locked());
+}
+
+TEST(RepeatedTelegrams, NewTelegramReusingAccessNumberNotDropped) {
+  Harness h;
+  h.setup();
+  TelegramBuilder ours;
+  auto first = ours.compact(1000, 0, 10, 20);
+  // A new telegram that happens to reuse the ACC has another session number
+  TelegramBuilder restarted = ours;
+  restarted.sn ^= 0x01;
+  uint64_t start = esphome::host::now_us() + 5000;
+  h.radio.transmit(first, start);
+  h.radio.transmit(restarted.compact(1001, 0, 10, 20), start + TELEGRAM_INTERVAL_US);
+  h.run_until_air_idle();
+
+  EXPECT_EQ(h.hub.duplicate_frames_, 0u);
+  EXPECT_EQ(h.sensors.total.publish_count, 2u);
+}
+
+TEST(RepeatedTelegrams, AccessNumberGapsCountAsMissed) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  builder.acc = 0xFE;
+  uint64_t start = esphome::host::now_us() + 5000;
+  // ACC FE, FF, 02 (00 and 01 lost), 05 (03 and 04 lost), then a meter reset back to 10
+  const uint8_t accs[] = {0xFE, 0xFF, 0x02, 0x05, 0x10, 0x01};
+  for (int i = 0; i < 6; i++) {
+    builder.acc = accs[i];
+    h.radio.transmit(builder.compact(1000 + i, 0, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+  h.hub.update();
+
+  EXPECT_EQ(h.sensors.total.publish_count, 6u);
+  // 00, 01, 03, 04 and 06-0F; the step back to 01 starts over without counting
+  EXPECT_FLOAT_EQ(h.sensors.missed_telegrams.state, 14.0f);
+  EXPECT_FLOAT_EQ(h.sensors.link_crc_errors.state, 0.0f);
+}
+
+TEST(Memory, UsageReportedWithHeapBuffers) {
+  using esphome::multical21::CAPTURE_MAX_FRAME_LENGTH;
+  using esphome::multical21::MAX_FRAME_LENGTH;
+  using esphome::multical21::MAX_LINK_FRAME_LENGTH;
+  using esphome::multical21::MemoryUsage;
+  using esphome::multical21::Multical21Radio;
+  using esphome::multical21::SPILL_BUFFER_SIZE;
+  Harness h;
+  h.setup();
+  MemoryUsage lean = h.hub.memory_usage();
+  EXPECT_EQ(lean.objects, sizeof(Multical21Component) + sizeof(Multical21Meter));
+  EXPECT_EQ(lean.shared, (size_t) MAX_LINK_FRAME_LENGTH + MAX_FRAME_LENGTH);
+  // No capture ring and no spill buffer: only the meter table is on the heap
+  EXPECT_LT(lean.heap, 4 * sizeof(Multical21Meter *) + 1);
+
+  Harness full;
+  full.hub.set_capture_buffer_size(4096);
+  full.use_second_radio();
+  full.setup();
+  MemoryUsage usage = full.hub.memory_usage();
+  EXPECT_EQ(usage.objects, lean.objects + sizeof(Multical21Radio));
+  EXPECT_GE(usage.heap, lean.heap + 4096 + CAPTURE_RECORD_HEADER_BYTES + CAPTURE_MAX_FRAME_LENGTH +
+                            2 * SPILL_BUFFER_SIZE);
+}
+
+TEST(Memory, HubsShareFrameBuffers) {
+  Harness a;
+  Harness b;
+  a.setup();
+  b.setup();
+  // Both telegrams are on the air together; each hub decodes its own in the
+  // buffers they share
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  a.radio.transmit(builder.compact(1111111, 1100000, 12, 21), start);
+  b.radio.transmit(builder.compact(2222222, 2200000, 13, 22), start + 300);
+  for (int i = 0; i < 50; i++) {
+    esphome::host::advance_us(Harness::LOOP_INTERVAL_US);
+    a.radio.tick();
+    b.radio.tick();
+    a.hub.loop();
+    b.hub.loop();
+  }
+
+  EXPECT_FLOAT_EQ(a.sensors.total.state, 1111.111f);
+  EXPECT_FLOAT_EQ(b.sensors.total.state, 2222.222f);
+  EXPECT_FLOAT_EQ(a.sensors.water_temp.state, 12.0f);
+  EXPECT_FLOAT_EQ(b.sensors.water_temp.state, 13.0f);
+}
+
+TEST(ReadingQueue, KeepsOrderAcrossWrapAndCountsDrops) {
+  using esphome::multical21::SpscQueue;
+  SpscQueue<int, 4> queue;
+  int item = 0;
+  EXPECT_FALSE(queue.pop(&item));
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 3; i++) {
+      EXPECT_TRUE(queue.push(round * 10 + i));
+    }
+    for (int i = 0; i < 3; i++) {
+      ASSERT_TRUE(queue.pop(&item));
+      EXPECT_EQ(item, round * 10 + i);
+    }
+  }
+  EXPECT_EQ(queue.high_water(), 3u);
+
+  for (int i = 0; i < 6; i++) {
+    queue.push(100 + i);
+  }
+  EXPECT_EQ(queue.size(), 4u);
+  EXPECT_EQ(queue.high_water(), 4u);
+  EXPECT_EQ(queue.drops(), 2u);
+  // The newest were turned away; what got in comes out unchanged
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queue.pop(&item));
+    EXPECT_EQ(item, 100 + i);
+  }
+  EXPECT_FALSE(queue.pop(&item));
+}
+
+TEST(ReadingQueue, ProducerAndConsumerThreads) {
+  using esphome::multical21::SpscQueue;
+  struct Item {
+    uint32_t sequence;
+    uint32_t check;
+  };
+  static const uint32_t COUNT = 200000;
+  SpscQueue<Item, 8> queue;
+  std::thread producer([&queue]() {
+    for (uint32_t i = 0; i < COUNT;) {
+      if (queue.push(Item{i, ~i})) {
+        i++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  uint32_t expected = 0;
+  bool intact = true;
+  while (expected < COUNT) {
+    Item item;
+    if (!queue.pop(&item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    intact &= item.sequence == expected && item.check == ~expected;
+    expected++;
+  }
+  producer.join();
+  EXPECT_TRUE(intact);
+  EXPECT_EQ(queue.size(), 0u);
+  EXPECT_LE(queue.high_water(), 8u);
+}
+
+TEST(ReadingQueue, FramesDecodedWhileLoopStalledArePublishedLater) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 3; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(1000 + i, 900, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.service_for(2 * TELEGRAM_INTERVAL_US + 100000);
+
+  // All decoded, nothing published
+  EXPECT_EQ(h.hub.accepted_frames_, 3u);
+  EXPECT_EQ(h.hub.readings_.size(), 3u);
+  EXPECT_FALSE(h.sensors.total.has_state);
+  EXPECT_EQ(h.sensors.last_update.publish_count, 0u);
+
+  h.hub.publish_readings();
+  EXPECT_EQ(h.hub.readings_.size(), 0u);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, 1.002f);
+  EXPECT_EQ(h.sensors.total.publish_count, 3u);
+  EXPECT_EQ(h.meter.get_history().size(), 3u);
+  // Flow from the times the readings were decoded, not published: 1 L per 16 s
+  EXPECT_NEAR(h.sensors.flow.state, 225.0f, 1.0f);
+}
+
+TEST(ReadingQueue, HighWaterAndDropsReported) {
+  using esphome::multical21::READING_QUEUE_SIZE;
+  Harness h;
+  esphome::sensor::Sensor high_water;
+  esphome::sensor::Sensor drops;
+  h.hub.set_reading_queue_high_water_sensor(&high_water);
+  h.hub.set_reading_queue_drops_sensor(&drops);
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < READING_QUEUE_SIZE + 2; i++) {
+    builder.acc++;
+    h.radio.transmit(builder.compact(1000 + i, 900, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.service_for((READING_QUEUE_SIZE + 1) * TELEGRAM_INTERVAL_US + 100000);
+  h.run_for(10 * Harness::LOOP_INTERVAL_US);
+  h.hub.update();
+
+  // Every frame was decoded; the two that found the queue full are lost
+  EXPECT_EQ(h.hub.accepted_frames_, READING_QUEUE_SIZE + 2u);
+  EXPECT_FLOAT_EQ(high_water.state, READING_QUEUE_SIZE);
+  EXPECT_FLOAT_EQ(drops.state, 2.0f);
+  EXPECT_FLOAT_EQ(h.sensors.total.state, (1000 + READING_QUEUE_SIZE - 1) / 1000.0f);
+  EXPECT_EQ(h.meter.get_history().size(), READING_QUEUE_SIZE);
+}
+
+TEST(PublishPolicy, UnchangedValuesNotRepublished) {
+  Harness h;
+  h.setup();
+  TelegramBuilder builder;
+  uint64_t start = esphome::host::now_us() + 5000;
+  for (int i = 0; i < 4; i++) {
+    builder.acc++;
+    // Total moves once; target and temperatures never do
+    h.radio.transmit(builder.compact(i < 2 ? 1000 : 1001, 900, 10, 20), start + i * TELEGRAM_INTERVAL_US);
+  }
+  h.run_until_air_idle();
+  for (int i = 0; i < 10; i++) {
+    h.hub.update();
+  }
+
+  EXPECT_EQ(h.sensors.total.publish_count, 2u);
+  EXPECT_EQ(h.sensors.month_start.publish_count, 1u);
+  EXPECT_EQ(h.sensors.water_temp.publish_count, 1u);
+  EXPECT_EQ(h.sensors.frames_received.publish_count, 1u);
+  EXPECT_FLOAT_EQ(h.sensors.frames_received.state, 4.0f);
+  EXPECT_EQ(h.sensors.crc_errors.publish_count, 1u);
+}
+
+TEST(PublishPolicy, DeltaMinIntervalAndHeartbeat) {
+  using esphome::multical21::PolicySensor;
+  using esphome::multical21::PublishPolicy;
+  using esphome::multical21::PublishStats;
+  esphome::host::reset_clock(1000000);
+  esphome::sensor::Sensor out;
+  PolicySensor sensor;
+  PublishPolicy policy;
+  policy.min_delta = 0.5f;
+  policy.min_interval_ms = 10000;
+  policy.max_interval_ms = 60000;
+  sensor.set_sensor(&out, policy);
+  PublishStats stats;
+
+  sensor.publish(10.0f, &stats);
+  EXPECT_EQ(out.publish_count, 1u);
+  sensor.publish(10.3f, &stats);  // Below the delta
+  EXPECT_EQ(out.publish_count, 1u);
+
+  esphome::host::advance_us(2000000);
+  sensor.publish(11.0f, &stats);  // Past the delta, but inside the minimum interval
+  sensor.publish(12.0f, &stats);
+  EXPECT_EQ(out.publish_count, 1u);
+  sensor.flush(&stats);
+  EXPECT_EQ(out.publish_count, 1u);
+  esphome::host::advance_us(8000000);
+  sensor.flush(&stats);  // Minimum interval over: the latest held value goes out
+  EXPECT_EQ(out.publish_count, 2u);
+  EXPECT_FLOAT_EQ(out.state, 12.0f);
+
+  esphome::host::advance_us(59000000);
+  sensor.flush(&stats);
+  EXPECT_EQ(out.publish_count, 2u);
+  esphome::host::advance_us(1000000);
+  sensor.flush(&stats);  // Heartbeat
+  EXPECT_EQ(out.publish_count, 3u);
+  EXPECT_FLOAT_EQ(out.state, 12.0f);
+
+  EXPECT_EQ(stats.sent, 3u);
+  EXPECT_EQ(stats.suppressed, 2u);  // 10.3 and the superseded 11.0
+}
+
+TEST(StageStats, MinAvgMaxInMicroseconds) {
+  esphome::multical21::StageStats stats;
+  EXPECT_FLOAT_EQ(stats.avg_us(), 0.0f);
+  // Host cycle counter runs at a nominal 160 MHz
+  stats.record(160);
+  stats.record(480);
+  stats.record(320);
+  EXPECT_FLOAT_EQ(stats.min_us(), 1.0f);
+  EXPECT_FLOAT_EQ(stats.avg_us(), 2.0f);
+  EXPECT_FLOAT_EQ(stats.max_us(), 3.0f);
+  EXPECT_EQ(stats.count, 3u);
+}
+
+TEST(StageStats, TimingSensorsPublishedAfterFirstFrame) {
+  Harness h;
+  h.setup();
+  h.hub.update();
+  EXPECT_FALSE(h.sensors.decrypt_time.has_state);
+
+  TelegramBuilder builder;
+  h.radio.transmit(builder.compact(1234567, 1230000, 12, 21), esphome::host::now_us() + 5000);
+  h.run_until_air_idle();
+  h.hub.update();
+
+  // CPU work does not advance the host clock, so only presence is checked
+  EXPECT_TRUE(h.sensors.decrypt_time.has_state);
+  EXPECT_TRUE(h.sensors.processing_time.has_state);
+}
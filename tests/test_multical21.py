@@ -1,10 +1,18 @@
 """Unit tests for Multical21 component logic.
 
-Tests CRC16 EN13757, hex-to-bytes conversion, and frame structure constants.
-These mirror the C++ implementations to catch regressions.
+Tests CRC16 EN13757, hex-to-bytes conversion, frame structure constants, the
+codegen sensor slot table and the config validators in __init__.py.
+The first ones mirror the C++ implementations to catch regressions; meter
+dispatch itself is tested natively in tests/native.
 """
 
+import importlib.util
+import pathlib
+import re
 import struct
+import sys
+from unittest import mock
+
 import pytest
 
 # ---------------------------------------------------------------------------
@@ -95,22 +103,48 @@ def hex_to_bytes(hex_str: str, length: int) -> bytes:
 
 
 # ---------------------------------------------------------------------------
-# Frame constants (must match multical21.h)
+# Frame constants (must match dif_vif.h and format_cache.cpp)
 # ---------------------------------------------------------------------------
 
-COMPACT_FRAME_TYPE = 0x79
-COMPACT_POS_TOTAL = 9
-COMPACT_POS_TARGET = 13
-COMPACT_POS_FLOW_TEMP = 17
-COMPACT_POS_AMBIENT_TEMP = 18
-COMPACT_MIN_LENGTH = 19
-
-LONG_FRAME_TYPE = 0x78
-LONG_POS_TOTAL = 10
-LONG_POS_TARGET = 16
-LONG_POS_FLOW_TEMP = 23
-LONG_POS_AMBIENT_TEMP = 29
-LONG_MIN_LENGTH = 30
+CI_COMPACT_FRAME = 0x79
+CI_LONG_FRAME = 0x78
+LONG_RECORDS_START = 3
+COMPACT_SIGNATURE = 3
+COMPACT_DATA_START = 7
+
+# DIF data field -> data bytes (0 for variable length / special functions)
+DIF_DATA_LENGTH = [0, 1, 2, 3, 4, 4, 6, 8, 0, 1, 2, 3, 4, 0, 6, 0]
+
+# Multical 21 default data set: info codes, total, target, flow temp, external temp
+DEFAULT_FORMAT = bytes.fromhex("02FF2004134413615B6167")
+DEFAULT_SIGNATURE = 0xA8ED
+
+
+def format_records(fmt: bytes):
+    """Split DIF/VIF bytes into (dif, vif bytes, data length) per record."""
+    records = []
+    pos = 0
+    while pos < len(fmt):
+        start = pos
+        dif = fmt[pos]
+        pos += 1
+        while fmt[pos - 1] & 0x80:
+            pos += 1
+        pos += 1  # VIF
+        while fmt[pos - 1] & 0x80:
+            pos += 1
+        records.append((fmt[start:pos], DIF_DATA_LENGTH[dif & 0x0F]))
+    return records
+
+
+def data_offsets(fmt: bytes):
+    """Offset of each record's data within the compact frame record data."""
+    offsets = []
+    offset = 0
+    for _, length in format_records(fmt):
+        offsets.append(offset)
+        offset += length
+    return offsets, offset
 
 
 # ===========================================================================
@@ -196,87 +230,108 @@ class TestHexToBytes:
 
 
 class TestFrameConstants:
-    """Verify frame layout constants are self-consistent."""
-
-    def test_compact_positions_within_min_length(self):
-        """All compact frame field positions must fit within COMPACT_MIN_LENGTH."""
-        assert COMPACT_POS_TOTAL + 4 <= COMPACT_MIN_LENGTH
-        assert COMPACT_POS_TARGET + 4 <= COMPACT_MIN_LENGTH
-        assert COMPACT_POS_FLOW_TEMP < COMPACT_MIN_LENGTH
-        assert COMPACT_POS_AMBIENT_TEMP < COMPACT_MIN_LENGTH
-
-    def test_long_positions_within_min_length(self):
-        """All long frame field positions must fit within LONG_MIN_LENGTH."""
-        assert LONG_POS_TOTAL + 4 <= LONG_MIN_LENGTH
-        assert LONG_POS_TARGET + 4 <= LONG_MIN_LENGTH
-        assert LONG_POS_FLOW_TEMP < LONG_MIN_LENGTH
-        assert LONG_POS_AMBIENT_TEMP < LONG_MIN_LENGTH
+    """Sanity-check the record layout constants."""
 
-    def test_frame_types_differ(self):
-        assert COMPACT_FRAME_TYPE != LONG_FRAME_TYPE
+    def test_default_signature(self):
+        """Compact frames name their format by the CRC of the DIF/VIF bytes."""
+        assert crc16_en13757(DEFAULT_FORMAT) == DEFAULT_SIGNATURE
 
-    def test_long_frame_is_larger(self):
-        assert LONG_MIN_LENGTH > COMPACT_MIN_LENGTH
+    def test_default_layout_offsets(self):
+        """The default format puts the values where compact frames always had them."""
+        offsets, length = data_offsets(DEFAULT_FORMAT)
+        assert [COMPACT_DATA_START + o for o in offsets] == [7, 9, 13, 17, 18]
+        assert COMPACT_DATA_START + length == 19
+
+    def test_frame_types_differ(self):
+        assert CI_COMPACT_FRAME != CI_LONG_FRAME
 
-    def test_field_ordering(self):
-        """Fields should appear in order: total < target < flow_temp < ambient_temp."""
-        assert COMPACT_POS_TOTAL < COMPACT_POS_TARGET < COMPACT_POS_FLOW_TEMP < COMPACT_POS_AMBIENT_TEMP
-        assert LONG_POS_TOTAL < LONG_POS_TARGET < LONG_POS_FLOW_TEMP < LONG_POS_AMBIENT_TEMP
+    def test_compact_data_after_signature(self):
+        assert COMPACT_SIGNATURE + 4 == COMPACT_DATA_START
+        assert LONG_RECORDS_START == COMPACT_SIGNATURE
 
 
 class TestFrameParsing:
     """Verify that field extraction from mock frames produces expected values."""
 
     @staticmethod
-    def _build_compact_frame(total_liters: int, target_liters: int, flow_temp: int, ambient_temp: int) -> bytes:
-        """Build a minimal compact frame payload (no real encryption/CRC)."""
-        buf = bytearray(COMPACT_MIN_LENGTH)
-        buf[2] = COMPACT_FRAME_TYPE
-        struct.pack_into("<I", buf, COMPACT_POS_TOTAL, total_liters)
-        struct.pack_into("<I", buf, COMPACT_POS_TARGET, target_liters)
-        buf[COMPACT_POS_FLOW_TEMP] = flow_temp
-        buf[COMPACT_POS_AMBIENT_TEMP] = ambient_temp
-        # Store CRC at positions 0-1
-        crc = crc16_en13757(bytes(buf[2:]))
-        buf[0] = crc & 0xFF
-        buf[1] = (crc >> 8) & 0xFF
-        return bytes(buf)
+    def _record_data(total_liters: int, target_liters: int, flow_temp: int, ambient_temp: int) -> bytes:
+        return struct.pack("<HIIbb", 0, total_liters, target_liters, flow_temp, ambient_temp)
 
     @staticmethod
-    def _build_long_frame(total_liters: int, target_liters: int, flow_temp: int, ambient_temp: int) -> bytes:
-        """Build a minimal long frame payload (no real encryption/CRC)."""
-        buf = bytearray(LONG_MIN_LENGTH)
-        buf[2] = LONG_FRAME_TYPE
-        struct.pack_into("<I", buf, LONG_POS_TOTAL, total_liters)
-        struct.pack_into("<I", buf, LONG_POS_TARGET, target_liters)
-        buf[LONG_POS_FLOW_TEMP] = flow_temp
-        buf[LONG_POS_AMBIENT_TEMP] = ambient_temp
+    def _seal(buf: bytearray) -> bytes:
         crc = crc16_en13757(bytes(buf[2:]))
         buf[0] = crc & 0xFF
         buf[1] = (crc >> 8) & 0xFF
         return bytes(buf)
 
+    @classmethod
+    def _build_compact_frame(cls, total_liters: int, target_liters: int, flow_temp: int, ambient_temp: int) -> bytes:
+        """Build a compact frame payload (no encryption)."""
+        buf = bytearray([0, 0, CI_COMPACT_FRAME])
+        buf += struct.pack("<HH", DEFAULT_SIGNATURE, 0)
+        buf += cls._record_data(total_liters, target_liters, flow_temp, ambient_temp)
+        return cls._seal(buf)
+
+    @classmethod
+    def _build_long_frame(cls, total_liters: int, target_liters: int, flow_temp: int, ambient_temp: int) -> bytes:
+        """Build a long frame payload with DIF/VIF records (no encryption)."""
+        data = cls._record_data(total_liters, target_liters, flow_temp, ambient_temp)
+        buf = bytearray([0, 0, CI_LONG_FRAME])
+        pos = 0
+        for header, length in format_records(DEFAULT_FORMAT):
+            buf += header + data[pos:pos + length]
+            pos += length
+        return cls._seal(buf)
+
+    @staticmethod
+    def _split_long_frame(frame: bytes):
+        """Python mirror of split_records(): DIF/VIF bytes and record data."""
+        fmt = bytearray()
+        data = bytearray()
+        pos = LONG_RECORDS_START
+        while pos < len(frame):
+            start = pos
+            dif = frame[pos]
+            pos += 1
+            while frame[pos - 1] & 0x80:
+                pos += 1
+            pos += 1
+            while frame[pos - 1] & 0x80:
+                pos += 1
+            fmt += frame[start:pos]
+            length = DIF_DATA_LENGTH[dif & 0x0F]
+            data += frame[pos:pos + length]
+            pos += length
+        return bytes(fmt), bytes(data)
+
     def test_compact_frame_roundtrip(self):
         """Build a compact frame and extract the values back."""
         frame = self._build_compact_frame(123456, 100000, 25, 20)
-        assert frame[2] == COMPACT_FRAME_TYPE
-        total = struct.unpack_from("<I", frame, COMPACT_POS_TOTAL)[0]
-        target = struct.unpack_from("<I", frame, COMPACT_POS_TARGET)[0]
-        assert total == 123456
-        assert target == 100000
-        assert frame[COMPACT_POS_FLOW_TEMP] == 25
-        assert frame[COMPACT_POS_AMBIENT_TEMP] == 20
+        assert frame[2] == CI_COMPACT_FRAME
+        assert struct.unpack_from("<H", frame, COMPACT_SIGNATURE)[0] == DEFAULT_SIGNATURE
+        offsets, _ = data_offsets(DEFAULT_FORMAT)
+        data = frame[COMPACT_DATA_START:]
+        assert struct.unpack_from("<I", data, offsets[1])[0] == 123456
+        assert struct.unpack_from("<I", data, offsets[2])[0] == 100000
+        assert data[offsets[3]] == 25
+        assert data[offsets[4]] == 20
 
     def test_long_frame_roundtrip(self):
-        """Build a long frame and extract the values back."""
+        """Split a long frame into the format and data a compact frame carries."""
         frame = self._build_long_frame(999999, 500000, 30, 22)
-        assert frame[2] == LONG_FRAME_TYPE
-        total = struct.unpack_from("<I", frame, LONG_POS_TOTAL)[0]
-        target = struct.unpack_from("<I", frame, LONG_POS_TARGET)[0]
-        assert total == 999999
-        assert target == 500000
-        assert frame[LONG_POS_FLOW_TEMP] == 30
-        assert frame[LONG_POS_AMBIENT_TEMP] == 22
+        assert frame[2] == CI_LONG_FRAME
+        fmt, data = self._split_long_frame(frame)
+        assert fmt == DEFAULT_FORMAT
+        assert data == self._build_compact_frame(999999, 500000, 30, 22)[COMPACT_DATA_START:]
+
+    def test_reference_long_frame(self):
+        """Decrypted reference telegram from wmbusmeters."""
+        frame = bytes.fromhex("576c7802ff207100041308190000441308190000615b7f616713")
+        assert (frame[1] << 8) | frame[0] == crc16_en13757(frame[2:])
+        fmt, data = self._split_long_frame(frame)
+        assert fmt == DEFAULT_FORMAT
+        info, total, target, flow_temp, ambient_temp = struct.unpack("<HIIbb", data)
+        assert (info, total, target, flow_temp, ambient_temp) == (0x0071, 6408, 6408, 127, 19)
 
     def test_compact_frame_crc_valid(self):
         """CRC stored in frame should match calculated CRC."""
@@ -295,7 +350,7 @@ class TestFrameParsing:
     def test_compact_frame_crc_detects_corruption(self):
         """Corrupting a byte should make CRC fail."""
         frame = bytearray(self._build_compact_frame(12345, 10000, 18, 15))
-        frame[COMPACT_POS_TOTAL] ^= 0x01  # flip a bit
+        frame[COMPACT_DATA_START + 2] ^= 0x01  # flip a bit in the total
         read_crc = (frame[1] << 8) | frame[0]
         calc_crc = crc16_en13757(bytes(frame[2:]))
         assert read_crc != calc_crc
@@ -366,3 +421,149 @@ class TestInputValidation:
 
     def test_meter_id_with_spaces_stripped(self):
         assert validate_hex_str(8, "meter_id", " 1A2B3C4D ") == "1A2B3C4D"
+
+
+# ---------------------------------------------------------------------------
+# Sensor slots – codegen numbers each sensor key by its SensorSlot in C++
+# ---------------------------------------------------------------------------
+
+COMPONENT_DIR = pathlib.Path(__file__).resolve().parent.parent / "components" / "multical21"
+
+
+def cpp_sensor_slots():
+    """SensorSlot enumerators in declaration order, as lower-case keys."""
+    source = (COMPONENT_DIR / "publish_policy.h").read_text()
+    body = re.search(r"enum SensorSlot : uint8_t \{(.*?)\};", source, re.S).group(1)
+    return [name.lower() for name in re.findall(r"^\s*SLOT_(\w+)", body, re.M)]
+
+
+def python_sensor_slots():
+    source = (COMPONENT_DIR / "__init__.py").read_text()
+    body = re.search(r"SENSOR_SLOTS = \{(.*?)\}", source, re.S).group(1)
+    return {key: int(slot) for key, slot in re.findall(r'"(\w+)": (\d+)', body)}
+
+
+class TestSensorSlots:
+    """The codegen slot table must match the C++ enum and cover every sensor key."""
+
+    def test_slots_match_enum(self):
+        enum = cpp_sensor_slots()
+        for key, slot in python_sensor_slots().items():
+            if key.startswith("radio"):
+                assert enum[slot] == "radio_accepted_frames"
+            else:
+                assert enum[slot] == key
+
+    def test_every_sensor_key_has_a_slot(self):
+        source = (COMPONENT_DIR / "sensor.py").read_text()
+        keys = set(re.findall(r'^CONF_\w+ = "(\w+)"', source, re.M))
+        policy_options = {"only_on_change", "min_delta", "min_interval", "max_interval"}
+        assert keys - policy_options == set(python_sensor_slots())
+
+    def test_slots_fit_the_mask(self):
+        assert max(python_sensor_slots().values()) < 64
+
+
+# ---------------------------------------------------------------------------
+# Config validation – the real validators from __init__.py, loaded against
+# stand-ins for the esphome modules it imports
+# ---------------------------------------------------------------------------
+
+ESPHOME_MODULES = [
+    "esphome",
+    "esphome.codegen",
+    "esphome.config_validation",
+    "esphome.final_validate",
+    "esphome.pins",
+    "esphome.components",
+    "esphome.components.spi",
+    "esphome.components.time",
+    "esphome.components.esp32",
+    "esphome.components.esp32.const",
+    "esphome.const",
+    "esphome.core",
+]
+
+
+class Invalid(Exception):
+    """Stands in for esphome.config_validation.Invalid."""
+
+    def __init__(self, message, path=None):
+        super().__init__(message)
+        self.path = path or []
+
+
+@pytest.fixture
+def component(monkeypatch):
+    """components/multical21/__init__.py, imported with esphome stubbed out."""
+    for name in ESPHOME_MODULES:
+        module = mock.MagicMock(name=name)
+        monkeypatch.setitem(sys.modules, name, module)
+        parent, _, child = name.rpartition(".")
+        if parent:
+            setattr(sys.modules[parent], child, module)
+    cv = sys.modules["esphome.config_validation"]
+    cv.Invalid = Invalid
+    cv.string = str
+    # An ESP32 build with one I/O expander platform registered
+    sys.modules["esphome.pins"].PIN_SCHEMA_REGISTRY = {"esp32": None, "pcf8574": None}
+    sys.modules["esphome.core"].CORE.target_platform = "esp32"
+    spec = importlib.util.spec_from_file_location("multical21", COMPONENT_DIR / "__init__.py")
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+class TestMeterIdValidation:
+    """validate_unique_meter_ids() and validate_hex_str() as the config schema runs them."""
+
+    def test_duplicate_ids_rejected_case_insensitive(self, component):
+        config = {"meters": [{"meter_id": "aabbccdd"}, {"meter_id": "12345678"}], "meter_id": "AABBCCDD"}
+        with pytest.raises(Invalid, match="Duplicate meter_id: AABBCCDD"):
+            component.validate_unique_meter_ids(config)
+
+    def test_duplicates_within_meters_list_rejected(self, component):
+        config = {"meters": [{"meter_id": "12345678"}, {"meter_id": "12345678"}]}
+        with pytest.raises(Invalid, match="Duplicate meter_id: 12345678"):
+            component.validate_unique_meter_ids(config)
+
+    def test_unique_ids_accepted(self, component):
+        config = {"meters": [{"meter_id": "12345678"}, {"meter_id": "76348799"}], "meter_id": "00000001"}
+        assert component.validate_unique_meter_ids(config) is config
+
+    def test_hex_validator_strips_and_checks_length(self, component):
+        validate = component.validate_hex_str(8, "meter_id")
+        assert validate(" 1A2B3C4D ") == "1A2B3C4D"
+        with pytest.raises(Invalid, match="exactly 8 hex characters"):
+            validate("1A2B3C")
+        with pytest.raises(Invalid, match="only hex characters"):
+            validate("1A2B3C4G")
+
+
+class TestGdo0InterruptValidation:
+    """An edge interrupt needs an internal GPIO; expander pins are polled."""
+
+    INTERNAL = {"number": 4, "inverted": False}
+    EXPANDER = {"pcf8574": "expander", "number": 3, "inverted": False}
+
+    def test_interrupt_on_by_default_for_internal_pin(self, component):
+        config = component.validate_gdo0_interrupt({"gdo0_pin": self.INTERNAL})
+        assert config["gdo0_interrupt"] is True
+
+    def test_expander_pin_polled_by_default(self, component):
+        config = component.validate_gdo0_interrupt({"gdo0_pin": self.EXPANDER})
+        assert config["gdo0_interrupt"] is False
+
+    def test_interrupt_on_expander_pin_rejected(self, component):
+        with pytest.raises(Invalid, match="needs an internal GPIO") as error:
+            component.validate_gdo0_interrupt({"gdo0_pin": self.EXPANDER, "gdo0_interrupt": True})
+        assert error.value.path == ["gdo0_interrupt"]
+
+    def test_polling_an_internal_pin_allowed(self, component):
+        config = component.validate_gdo0_interrupt({"gdo0_pin": self.INTERNAL, "gdo0_interrupt": False})
+        assert config["gdo0_interrupt"] is False
+
+    def test_checked_for_both_radios(self, component):
+        cv = sys.modules["esphome.config_validation"]
+        schemas = [c for c in cv.All.call_args_list if component.validate_gdo0_interrupt in c.args]
+        assert len(schemas) == 2  # The hub's own radio and second_radio